@@ -18,6 +18,7 @@ enable_testing()
 
 find_package(CUnit)
 find_package(OpenSSL REQUIRED)
+find_package(Threads REQUIRED)
 
 set(CUNIT_LIB_NAME "")
 
@@ -36,6 +37,20 @@ add_executable  (test_ext_log_storage_memory
                 )
 target_link_libraries(test_ext_log_storage_memory kaac ${OPENSSL_LIBRARIES} ${CUNIT_LIB_NAME})
 
+add_executable  (test_ext_log_storage_ring
+                    test/platform-impl/test_ext_log_storage_ring.c
+                    src/kaa/platform-impl/ext_log_storage_ring.c
+                    test/kaa_test_external.c
+                )
+target_link_libraries(test_ext_log_storage_ring kaac ${OPENSSL_LIBRARIES} ${CUNIT_LIB_NAME})
+
+add_executable  (test_posix_log_storage
+                    test/platform-impl/test_posix_log_storage.c
+                    src/kaa/platform-impl/posix/posix_log_storage.c
+                    test/kaa_test_external.c
+                )
+target_link_libraries(test_posix_log_storage kaac ${OPENSSL_LIBRARIES} ${CUNIT_LIB_NAME})
+
 add_executable  (test_ext_log_upload_strategy_by_volume
                     test/platform-impl/test_ext_log_upload_strategy_by_volume.c
                     test/kaa_test_external.c
@@ -69,7 +84,11 @@ target_link_libraries(test_context kaac ${OPENSSL_LIBRARIES} ${CUNIT_LIB_NAME})
 add_executable  (test_event
                     test/test_kaa_event.c
                     test/kaa_test_external.c
+                    ${KAA_SRC_FOLDER}/kaa_event.c
+                    ${KAA_SRC_FOLDER}/collections/kaa_list.c
                 )
+# The test provides the allocator to check the event manager when allocations fail
+set_target_properties(test_event PROPERTIES COMPILE_DEFINITIONS KAA_TRACE_MEMORY_ALLOCATIONS)
 target_link_libraries(test_event kaac ${OPENSSL_LIBRARIES} ${CUNIT_LIB_NAME})
 
 add_executable  (test_status
@@ -104,6 +123,7 @@ add_executable  (test_log
                     ${KAA_SRC_FOLDER}/avro_src/encoding_binary.c
                     ${KAA_SRC_FOLDER}/collections/kaa_list.c
                     ${KAA_SRC_FOLDER}/utilities/kaa_log.c
+                    ${KAA_SRC_FOLDER}/utilities/kaa_timer_queue.c
                     ${KAA_SRC_FOLDER}/platform-impl/posix/logger.c
                     ${KAA_SRC_FOLDER}/kaa_platform_utils.c
                     ${KAA_SRC_FOLDER}/kaa_bootstrap_manager.c
@@ -125,6 +145,26 @@ add_executable  (test_deque
                 )
 target_link_libraries(test_deque kaac ${OPENSSL_LIBRARIES} ${CUNIT_LIB_NAME})
 
+add_executable  (test_buffer
+                    test/test_kaa_buffer.c
+                )
+target_link_libraries(test_buffer kaac ${CUNIT_LIB_NAME})
+
+add_executable  (test_timer_queue
+                    test/test_kaa_timer_queue.c
+                )
+target_link_libraries(test_timer_queue kaac ${CUNIT_LIB_NAME})
+
+add_executable  (test_spsc_queue
+                    test/test_kaa_spsc_queue.c
+                )
+target_link_libraries(test_spsc_queue kaac ${CMAKE_THREAD_LIBS_INIT} ${CUNIT_LIB_NAME})
+
+add_executable  (test_mpsc_queue
+                    test/test_kaa_mpsc_queue.c
+                )
+target_link_libraries(test_mpsc_queue kaac ${CMAKE_THREAD_LIBS_INIT} ${CUNIT_LIB_NAME})
+
 add_executable  (test_channel_manager
                     test/test_kaa_channel_manager.c
                     test/kaa_test_external.c
@@ -143,6 +183,14 @@ add_executable  (test_kaatcp_request
                 )
 target_link_libraries(test_kaatcp_request kaac ${CUNIT_LIB_NAME})
 
+if(KAA_WITH_TCP_COMPRESSION)
+    add_executable  (test_kaatcp_compression
+                        test/kaatcp/kaatcp_compression_test.c
+                        test/kaa_test_external.c
+                    )
+    target_link_libraries(test_kaatcp_compression kaac ${CUNIT_LIB_NAME})
+endif()
+
 add_executable  (test_kaa_tcp_channel_bootstrap
                     test/kaa_tcp_channel/test_kaa_tcp_channel_bootstrap.c
                     test/kaa_test_external.c
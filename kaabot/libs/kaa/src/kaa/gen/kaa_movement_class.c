@@ -38,6 +38,8 @@ typedef struct kaa_movement_class_ {
 
     on_kaa_movement_class_movement_direction movement_direction_listener;
     void * movement_direction_context;
+    on_kaa_movement_class_movement_direction_view movement_direction_view_listener;
+    void * movement_direction_view_context;
 
     unsigned char is_movement_direction_callback_added;
 
@@ -46,6 +48,7 @@ typedef struct kaa_movement_class_ {
 static kaa_movement_class listeners = {
 
     NULL, NULL,
+    NULL, NULL,
 
     0
 
@@ -54,7 +57,12 @@ static kaa_movement_class listeners = {
 static void kaa_event_manager_movement_direction_listener(const char * event_fqn, const char *data, size_t size, kaa_endpoint_id_p event_source)
 {
     (void)event_fqn;
-    if (listeners.movement_direction_listener) {
+    if (listeners.movement_direction_view_listener) {
+        struct avro_reader_t_ reader = { data, size, 0 };
+        kaa_movement_class_movement_direction_t event;
+        if (!kaa_movement_class_movement_direction_deserialize_into(&reader, &event))
+            listeners.movement_direction_view_listener(listeners.movement_direction_view_context, &event, event_source);
+    } else if (listeners.movement_direction_listener) {
         avro_reader_t reader = avro_reader_memory(data, size);
         kaa_movement_class_movement_direction_t * event = kaa_movement_class_movement_direction_deserialize(reader);
         avro_reader_free(reader);
@@ -74,5 +82,14 @@ kaa_error_t kaa_event_manager_set_kaa_movement_class_movement_direction_listener
     return KAA_ERR_NONE;
 }
 
-
-
+kaa_error_t kaa_event_manager_set_kaa_movement_class_movement_direction_view_listener(kaa_event_manager_t *self, on_kaa_movement_class_movement_direction_view listener, void *context)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    listeners.movement_direction_view_listener = listener;
+    listeners.movement_direction_view_context = context;
+    if (!listeners.is_movement_direction_callback_added) {
+        listeners.is_movement_direction_callback_added = 1;
+        return kaa_event_manager_add_on_event_callback(self, "com.krishna.kaabot.movementDirection", kaa_event_manager_movement_direction_listener);
+    }
+    return KAA_ERR_NONE;
+}
@@ -32,6 +32,14 @@ extern "C" {
  */
 typedef void (* on_kaa_movement_class_movement_direction)(void *context, kaa_movement_class_movement_direction_t *event, kaa_endpoint_id_p source);
 
+/**
+ * @brief Allocation-free listener of movement_direction events.
+ *
+ * The event is decoded on the stack and is valid only for the duration
+ * of the call. It must not be destroyed.
+ */
+typedef void (* on_kaa_movement_class_movement_direction_view)(void *context, const kaa_movement_class_movement_direction_t *event, kaa_endpoint_id_p source);
+
 
 /**
  * @brief Set listener for movement_direction events.
@@ -43,6 +51,19 @@ typedef void (* on_kaa_movement_class_movement_direction)(void *context, kaa_mov
  */
 kaa_error_t kaa_event_manager_set_kaa_movement_class_movement_direction_listener(kaa_event_manager_t *self, on_kaa_movement_class_movement_direction listener, void *context);
 
+/**
+ * @brief Set allocation-free listener for movement_direction events.
+ *
+ * Takes precedence over the listener set by
+ * @link kaa_event_manager_set_kaa_movement_class_movement_direction_listener @endlink.
+ *
+ * @param[in]       self        Valid pointer to event manager.
+ * @param[in]       listener    Listener callback.
+ * @param[in]       context     Listener's context.
+ * @return Error code.
+ */
+kaa_error_t kaa_event_manager_set_kaa_movement_class_movement_direction_view_listener(kaa_event_manager_t *self, on_kaa_movement_class_movement_direction_view listener, void *context);
+
 
 
 # ifdef __cplusplus
@@ -21,6 +21,7 @@
 # include "../avro_src/avro/io.h"
 # include "../avro_src/encoding.h"
 # include "../utilities/kaa_mem.h"
+# include "../kaa_common.h"
 
 /*
  * AUTO-GENERATED CODE
@@ -71,15 +72,25 @@ kaa_movement_class_movement_direction_t *kaa_movement_class_movement_direction_d
             (kaa_movement_class_movement_direction_t *)KAA_MALLOC(sizeof(kaa_movement_class_movement_direction_t));
 
     if (record) {
-        record->serialize = kaa_movement_class_movement_direction_serialize;
-        record->get_size = kaa_movement_class_movement_direction_get_size;
+        kaa_movement_class_movement_direction_deserialize_into(reader, record);
         record->destroy = kaa_data_destroy;
-
-        int64_t direction_value;
-        avro_binary_encoding.read_long(reader, &direction_value);
-        record->direction = direction_value;
     }
 
     return record;
 }
 
+kaa_error_t kaa_movement_class_movement_direction_deserialize_into(avro_reader_t reader, kaa_movement_class_movement_direction_t *record)
+{
+    KAA_RETURN_IF_NIL2(reader, record, KAA_ERR_BADPARAM);
+
+    record->serialize = kaa_movement_class_movement_direction_serialize;
+    record->get_size = kaa_movement_class_movement_direction_get_size;
+    record->destroy = NULL;
+
+    int64_t direction_value = 0;
+    if (avro_binary_encoding.read_long(reader, &direction_value))
+        return KAA_ERR_READ_FAILED;
+    record->direction = direction_value;
+
+    return KAA_ERR_NONE;
+}
@@ -18,6 +18,7 @@
 # define KAA_MOVEMENT_CLASS_DEFINITIONS_H_
 
 # include "../kaa_common_schema.h"
+# include "../kaa_error.h"
 # include "../collections/kaa_list.h"
 
 # ifdef __cplusplus
@@ -63,6 +64,12 @@ typedef struct {
 kaa_movement_class_movement_direction_t *kaa_movement_class_movement_direction_create();
 kaa_movement_class_movement_direction_t *kaa_movement_class_movement_direction_deserialize(avro_reader_t reader);
 
+/**
+ * @brief Decodes the record into caller-provided storage. Nothing is allocated,
+ * so the record must not be destroyed.
+ */
+kaa_error_t kaa_movement_class_movement_direction_deserialize_into(avro_reader_t reader, kaa_movement_class_movement_direction_t *record);
+
 #ifdef __cplusplus
 }      /* extern "C" */
 #endif
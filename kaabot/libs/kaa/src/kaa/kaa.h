@@ -26,6 +26,7 @@
 
 #include "kaa_context.h"
 #include "kaa_error.h"
+#include "platform/time.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -59,6 +60,33 @@ kaa_error_t kaa_start(kaa_context_t *kaa_context);
 
 
 
+/**
+ * @brief Retrieves the earliest moment when Kaa needs @link kaa_process_deadlines() @endlink to be called.
+ *
+ * Keepalive pings, log delivery timeouts and log upload retries are driven by deadlines
+ * on the @link KAA_TIME_MS @endlink clock instead of periodic polling. An IO loop should
+ * sleep no longer than until the returned deadline.
+ *
+ * @param[in]   kaa_context    Pointer to an initialized Kaa endpoint context.
+ * @param[out]  deadline       The earliest deadline in milliseconds.
+ *
+ * @return Error code. KAA_ERR_NOT_FOUND if there is nothing to wait for.
+ */
+kaa_error_t kaa_get_next_deadline(kaa_context_t *kaa_context, kaa_time_ms_t *deadline);
+
+
+
+/**
+ * @brief Handles all deadlines which have passed.
+ *
+ * @param[in]   kaa_context    Pointer to an initialized Kaa endpoint context.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_process_deadlines(kaa_context_t *kaa_context);
+
+
+
 /**
  * @brief De-initializes and destroys general Kaa endpoint context.
  *
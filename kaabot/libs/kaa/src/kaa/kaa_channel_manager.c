@@ -26,6 +26,9 @@
 #include "collections/kaa_list.h"
 #include "utilities/kaa_log.h"
 #include "utilities/kaa_mem.h"
+#include "utilities/kaa_timer_queue.h"
+#include "platform/defaults.h"
+#include "platform/time.h"
 #include "kaa_common_schema.h"
 #include "kaa_platform_common.h"
 #include "kaa_platform_protocol.h"
@@ -56,14 +59,26 @@ typedef struct {
 
 
 
+#define KAA_SYNC_SERVICE_COUNT    (KAA_SERVICE_CONFIGURATION + 1)
+#define KAA_SYNC_SERVICE_BIT(s)   (1U << (s))
+
 struct kaa_channel_manager_t {
     kaa_list_t         *transport_channels;
+    kaa_transport_channel_interface_t    *service_channels[KAA_SYNC_SERVICE_COUNT];  /* rebuilt on channel add/remove */
     kaa_context_t      *kaa_context;
     kaa_sync_info_t    sync_info;
+    uint32_t           pending_sync_services;                  /* KAA_SYNC_SERVICE_BIT() of each waiting service */
+    kaa_time_ms_t      sync_latency[KAA_SYNC_SERVICE_COUNT];   /* 0 - the service is synced right away */
+    kaa_timer_t        sync_timer;
 };
 
 
 
+kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa_channel_manager_t *self
+                                                                           , kaa_service_t service_type);
+
+
+
 static void destroy_channel(void *data)
 {
     KAA_RETURN_IF_NIL(data,);
@@ -99,6 +114,11 @@ static bool find_channel_by_protocol_id(/* current channel */void *data, /* chan
     return kaa_transport_protocol_id_equals(matcher, &channel_info);
 }
 
+static void on_sync_timer(void *context)
+{
+    kaa_channel_manager_flush_syncs((kaa_channel_manager_t *) context);
+}
+
 kaa_error_t kaa_channel_manager_create(kaa_channel_manager_t **channel_manager_p
                                      , kaa_context_t *context)
 {
@@ -109,10 +129,20 @@ kaa_error_t kaa_channel_manager_create(kaa_channel_manager_t **channel_manager_p
         return KAA_ERR_NOMEM;
 
     (*channel_manager_p)->transport_channels      = NULL;
+    memset((*channel_manager_p)->service_channels, 0, sizeof((*channel_manager_p)->service_channels));
     (*channel_manager_p)->kaa_context             = context;
     (*channel_manager_p)->sync_info.request_id    = 0;
     (*channel_manager_p)->sync_info.is_up_to_date = false;
 
+    (*channel_manager_p)->pending_sync_services = 0;
+    (*channel_manager_p)->sync_latency[KAA_SERVICE_BOOTSTRAP]     = 0;
+    (*channel_manager_p)->sync_latency[KAA_SERVICE_PROFILE]       = KAA_SYNC_LATENCY_PROFILE;
+    (*channel_manager_p)->sync_latency[KAA_SERVICE_USER]          = KAA_SYNC_LATENCY_USER;
+    (*channel_manager_p)->sync_latency[KAA_SERVICE_EVENT]         = KAA_SYNC_LATENCY_EVENT;
+    (*channel_manager_p)->sync_latency[KAA_SERVICE_LOGGING]       = KAA_SYNC_LATENCY_LOGGING;
+    (*channel_manager_p)->sync_latency[KAA_SERVICE_CONFIGURATION] = KAA_SYNC_LATENCY_CONFIGURATION;
+    kaa_timer_init(&(*channel_manager_p)->sync_timer, &on_sync_timer, *channel_manager_p);
+
     return KAA_ERR_NONE;
 }
 
@@ -151,6 +181,8 @@ kaa_error_t kaa_transport_channel_id_calculate(kaa_transport_channel_interface_t
 void kaa_channel_manager_destroy(kaa_channel_manager_t *self)
 {
     if (self) {
+        if (self->kaa_context->timer_queue)
+            kaa_timer_queue_cancel(self->kaa_context->timer_queue, &self->sync_timer);
         kaa_list_destroy(self->transport_channels, destroy_channel);
         KAA_FREE(self);
     }
@@ -178,6 +210,38 @@ static bool is_bootstrap_service_supported(kaa_transport_channel_interface_t *ch
     return false;
 }
 
+/*
+ * Maps each service to the first channel in the list that supports it,
+ * so the lookup on the sync path does not query every channel.
+ */
+static void update_service_channels(kaa_channel_manager_t *self)
+{
+    memset(self->service_channels, 0, sizeof(self->service_channels));
+
+    kaa_list_t *it = self->transport_channels;
+    for (; it; it = kaa_list_next(it)) {
+        kaa_transport_channel_wrapper_t *channel_wrapper =
+                (kaa_transport_channel_wrapper_t *) kaa_list_get_data(it);
+
+        kaa_service_t *services = NULL;
+        size_t service_count = 0;
+        kaa_error_t error_code = channel_wrapper->channel.get_supported_services(channel_wrapper->channel.context
+                                                                               , &services
+                                                                               , &service_count);
+        if (error_code || !services || !service_count) {
+            KAA_LOG_WARN(self->kaa_context->logger, error_code, "Failed to retrieve list of supported services "
+                                        "for transport channel [0x%08X]", channel_wrapper->channel_id);
+            continue;
+        }
+
+        while (service_count--) {
+            size_t service = (size_t) *services++;
+            if (service < KAA_SYNC_SERVICE_COUNT && !self->service_channels[service])
+                self->service_channels[service] = &channel_wrapper->channel;
+        }
+    }
+}
+
 static kaa_error_t add_channel(kaa_channel_manager_t *self
                              , kaa_transport_channel_interface_t *channel
                              , uint32_t *channel_id)
@@ -224,6 +288,7 @@ static kaa_error_t add_channel(kaa_channel_manager_t *self
 
     self->transport_channels = it;
     self->sync_info.is_up_to_date = false;
+    update_service_channels(self);
 
     KAA_LOG_INFO(self->kaa_context->logger, KAA_ERR_NONE,
             "%s transport channel [0x%08X] added (protocol: id=0x%08X, version=%u)"
@@ -238,11 +303,10 @@ static kaa_error_t init_channel(kaa_channel_manager_t *self
 {
     KAA_RETURN_IF_NIL2(self, channel, KAA_ERR_BADPARAM);
 
-    static kaa_transport_context_t transport_context = { NULL, NULL };
-    if (!transport_context.platform_protocol) {
-        transport_context.platform_protocol = self->kaa_context->platfrom_protocol;
-        transport_context.bootstrap_manager = self->kaa_context->bootstrap_manager;
-    }
+    kaa_transport_context_t transport_context;
+    transport_context.platform_protocol = self->kaa_context->platfrom_protocol;
+    transport_context.bootstrap_manager = self->kaa_context->bootstrap_manager;
+    transport_context.timer_queue = self->kaa_context->timer_queue;
 
     channel->init(channel->context, &transport_context);
 
@@ -315,6 +379,7 @@ kaa_error_t kaa_channel_manager_remove_transport_channel(kaa_channel_manager_t *
 
     if (!error_code) {
         self->sync_info.is_up_to_date = false;
+        update_service_channels(self);
         KAA_LOG_INFO(self->kaa_context->logger, KAA_ERR_NONE, "Transport channel [0x%08X] was removed", channel_id);
         return KAA_ERR_NONE;
     }
@@ -329,41 +394,98 @@ kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa
 {
     KAA_RETURN_IF_NIL(self, NULL);
 
-    kaa_error_t error_code = KAA_ERR_NONE;
+    if ((size_t) service_type < KAA_SYNC_SERVICE_COUNT && self->service_channels[service_type])
+        return self->service_channels[service_type];
 
-    kaa_list_t *it = self->transport_channels;
-    kaa_transport_channel_wrapper_t *channel_wrapper;
+    KAA_LOG_WARN(self->kaa_context->logger, KAA_ERR_NOT_FOUND,
+            "Failed to find transport channel for service %u", service_type);
+    return NULL;
+}
 
-    kaa_service_t *services;
-    size_t service_count;
+/*
+ * Requests a sync of the service. The request waits up to the service's latency
+ * budget, so requests arriving within the window are merged into a single sync.
+ */
+kaa_error_t kaa_channel_manager_request_sync(kaa_channel_manager_t *self, kaa_service_t service_type)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    if ((size_t) service_type >= KAA_SYNC_SERVICE_COUNT)
+        return KAA_ERR_BADPARAM;
 
-    while (it) {
-        channel_wrapper = (kaa_transport_channel_wrapper_t *) kaa_list_get_data(it);
+    self->pending_sync_services |= KAA_SYNC_SERVICE_BIT(service_type);
 
-        error_code = channel_wrapper->channel.get_supported_services(channel_wrapper->channel.context
-                                                                   , &services
-                                                                   , &service_count);
-        if (error_code || !services || !service_count) {
-            KAA_LOG_WARN(self->kaa_context->logger, error_code, "Failed to retrieve list of supported services "
-                                        "for transport channel [0x%08X]", channel_wrapper->channel_id);
-            continue;
-        }
+    kaa_timer_queue_t *timer_queue = self->kaa_context->timer_queue;
+    if (!timer_queue || !self->sync_latency[service_type])
+        return kaa_channel_manager_flush_syncs(self);
 
-        while (service_count--) {
-            if (*services++ == service_type) {
-                KAA_LOG_TRACE(self->kaa_context->logger, KAA_ERR_NONE, "Transport channel "
-                        "[0x%08X] for service %u was found"
-                        , channel_wrapper->channel_id, service_type);
-                return &channel_wrapper->channel;
+    kaa_time_ms_t deadline = KAA_TIME_MS() + self->sync_latency[service_type];
+    if (kaa_timer_is_scheduled(&self->sync_timer) && self->sync_timer.deadline <= deadline)
+        return KAA_ERR_NONE;
+
+    KAA_LOG_TRACE(self->kaa_context->logger, KAA_ERR_NONE, "Sync of service %u is due in %u ms"
+                                        , service_type, (unsigned) self->sync_latency[service_type]);
+    return kaa_timer_queue_schedule(timer_queue, &self->sync_timer, deadline);
+}
+
+kaa_error_t kaa_channel_manager_flush_syncs(kaa_channel_manager_t *self)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+
+    if (self->kaa_context->timer_queue)
+        kaa_timer_queue_cancel(self->kaa_context->timer_queue, &self->sync_timer);
+
+    /* Services requested by the sync handlers are scheduled anew */
+    uint32_t pending = self->pending_sync_services;
+    self->pending_sync_services = 0;
+
+    kaa_error_t error_code = KAA_ERR_NONE;
+
+    while (pending) {
+        kaa_service_t services[KAA_SYNC_SERVICE_COUNT];
+        size_t service_count = 0;
+        kaa_transport_channel_interface_t *channel = NULL;
+
+        size_t i = 0;
+        for (; i < KAA_SYNC_SERVICE_COUNT; ++i) {
+            if (!(pending & KAA_SYNC_SERVICE_BIT(i)))
+                continue;
+
+            kaa_transport_channel_interface_t *service_channel =
+                    kaa_channel_manager_get_transport_channel(self, (kaa_service_t) i);
+            if (!service_channel) {
+                pending &= ~KAA_SYNC_SERVICE_BIT(i);
+                continue;
+            }
+
+            if (!channel)
+                channel = service_channel;
+
+            if (service_channel == channel) {
+                services[service_count++] = (kaa_service_t) i;
+                pending &= ~KAA_SYNC_SERVICE_BIT(i);
             }
         }
 
-        it = kaa_list_next(it);
+        if (channel) {
+            kaa_error_t sync_error = channel->sync_handler(channel->context, services, service_count);
+            if (sync_error)
+                error_code = sync_error;
+        }
     }
 
-    KAA_LOG_WARN(self->kaa_context->logger, KAA_ERR_NOT_FOUND,
-            "Failed to find transport channel for service %u", service_type);
-    return NULL;
+    return error_code;
+}
+
+kaa_error_t kaa_channel_manager_set_sync_latency(kaa_channel_manager_t *self
+                                               , kaa_service_t service_type
+                                               , kaa_time_ms_t latency)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    if ((size_t) service_type >= KAA_SYNC_SERVICE_COUNT || service_type == KAA_SERVICE_BOOTSTRAP)
+        return KAA_ERR_BADPARAM;
+
+    self->sync_latency[service_type] = latency;
+    return KAA_ERR_NONE;
 }
 
 kaa_error_t kaa_channel_manager_bootstrap_request_get_size(kaa_channel_manager_t *self
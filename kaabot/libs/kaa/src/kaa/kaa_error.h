@@ -52,6 +52,7 @@ typedef enum {
     KAA_ERR_EVENT_NOT_ATTACHED      = -41,
     KAA_ERR_EVENT_BAD_FQN           = -42,
     KAA_ERR_EVENT_TRX_NOT_FOUND     = -43,
+    KAA_ERR_EVENT_QUEUE_FULL        = -44,
 
     KAA_ERR_BUFFER_IS_NOT_ENOUGH    = -51,
     KAA_ERR_BUFFER_INVALID_SIZE     = -52,
@@ -40,10 +40,158 @@ typedef size_t kaa_event_block_id;
     typedef struct kaa_event_manager_t      kaa_event_manager_t;
 #endif
 
+/**
+ * @brief What to do with a new event when the event queue is at its high-water mark.
+ */
+typedef enum {
+    KAA_EVENT_QUEUE_REJECT_NEW = 0,    /**< The event is rejected with KAA_ERR_EVENT_QUEUE_FULL */
+    KAA_EVENT_QUEUE_DROP_OLDEST        /**< The oldest event not sent yet is dropped to make room */
+} kaa_event_overflow_policy_t;
+
+
+/**
+ * @brief Limits the number of events waiting to be sent or delivered.
+ *
+ * By default the limit is @link KAA_EVENT_QUEUE_CAPACITY @endlink and new events are rejected
+ * once it is reached. Events sent in the in-flight syncs are never dropped, so with
+ * @link KAA_EVENT_QUEUE_DROP_OLDEST @endlink an event is still rejected if all queued ones are in flight.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       high_water_mark     Maximum number of queued events, from 1 up to @link KAA_EVENT_QUEUE_CAPACITY @endlink.
+ * @param[in]       policy              What to do with a new event when the limit is reached.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_event_manager_set_queue_limit(kaa_event_manager_t *self, size_t high_water_mark, kaa_event_overflow_policy_t policy);
+
+
+/**
+ * @brief How a new event is queued when an event with the same FQN and target waits to be sent.
+ */
+typedef enum {
+    KAA_EVENT_COALESCE_NONE = 0,    /**< Both events are sent */
+    KAA_EVENT_COALESCE_REPLACE      /**< The new event replaces the pending one, so only the latest value is sent */
+} kaa_event_coalescing_policy_t;
+
+
+/**
+ * @brief Sets the coalescing policy of the events with the given FQN.
+ *
+ * Suits state-style events, where only the latest value matters. A replaced event keeps
+ * its place in the queue and doesn't count against the queue limit. Events already sent
+ * and events added to event blocks are never replaced.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       fqn                 Fully-qualified name of the event (null-terminated string).
+ * @param[in]       policy              The coalescing policy.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_event_manager_set_coalescing_policy(kaa_event_manager_t *self, const char *fqn, kaa_event_coalescing_policy_t policy);
+
+
+/**
+ * @brief Event received in a server sync.
+ *
+ * The pointers refer to the server sync buffer and are valid only for the duration of the batch callback.
+ */
+typedef struct {
+    const char          *fqn;           /**< Fully-qualified name of the event (not null-terminated) */
+    size_t               fqn_length;
+    const char          *data;          /**< Event data, NULL if the event has no data */
+    size_t               data_size;
+    kaa_endpoint_id_p    source;        /**< Endpoint which sent the event */
+} kaa_event_view_t;
+
+typedef void (*kaa_event_batch_callback_t)(void *context, const kaa_event_view_t *events, size_t events_count);
+
+
+/**
+ * @brief Sets the callback which receives all events of a server sync at once.
+ *
+ * The callback is called after the whole event extension is parsed, with the events in the order
+ * they were received. While it is set, the per-FQN and the global event callbacks are not called.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       callback            The batch callback. NULL restores the per-event delivery.
+ * @param[in]       context             The callback's context.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_event_manager_set_batch_callback(kaa_event_manager_t *self, kaa_event_batch_callback_t callback, void *context);
+
+
+/**
+ * @brief Moves the event callbacks off the network thread.
+ *
+ * Received events are copied into a bounded lock-free single-producer/single-consumer queue
+ * instead of being passed to the per-FQN and global callbacks right away. A worker thread owned
+ * by the application runs the callbacks with @link kaa_event_manager_process_deferred_events @endlink.
+ * When the queue is full, new events are dropped and counted as overflows.
+ *
+ * Must be called before the client is started or while the worker thread doesn't run.
+ * Events still in the previous queue are dropped.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       capacity            Queue capacity, rounded up to a power of two. 0 restores the synchronous callbacks.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_event_manager_set_deferred_dispatch(kaa_event_manager_t *self, size_t capacity);
+
+
+typedef void (*kaa_event_deferred_notify_t)(void *context);
+
+
+/**
+ * @brief Sets the function which wakes the worker thread up when an event is queued for it.
+ *
+ * It is called from the thread which received the event, right after the event is queued,
+ * so the worker may wait for events instead of polling the queue.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       notify              The notification function. NULL disables the notifications.
+ * @param[in]       context             The function's context.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_event_manager_set_deferred_notify(kaa_event_manager_t *self, kaa_event_deferred_notify_t notify, void *context);
+
+
+/**
+ * @brief Runs the callbacks of the deferred events. Called from one worker thread only.
+ *
+ * The callbacks run in the calling thread. Any Kaa SDK calls made from them must be synchronized
+ * with the network thread by the application.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       max_count           Maximum number of events to process, 0 for all queued events.
+ * @param[out]      processed_count     Number of processed events. May be NULL.
+ *
+ * @return Error code. KAA_ERR_BAD_STATE if deferred dispatch is disabled.
+ */
+kaa_error_t kaa_event_manager_process_deferred_events(kaa_event_manager_t *self, size_t max_count, size_t *processed_count);
+
+
+/**
+ * @brief Retrieves the number of queued deferred events and of the events dropped since the queue was created.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[out]      queued_count        Number of events waiting for the worker thread. May be NULL.
+ * @param[out]      overflow_count      Number of events dropped because the queue was full. May be NULL.
+ *
+ * @return Error code. KAA_ERR_BAD_STATE if deferred dispatch is disabled.
+ */
+kaa_error_t kaa_event_manager_get_deferred_stats(kaa_event_manager_t *self, size_t *queued_count, size_t *overflow_count);
+
 
 /**
  * @brief Initiates a request to the server to search for available event listeners by given FQNs.
  *
+ * A search for the same set of FQNs (in any order) that is already in progress
+ * is shared: the callback is added to it and no new request is sent. If the listeners
+ * of the set are cached (see @link kaa_event_manager_set_listeners_cache_ttl @endlink),
+ * on_event_listeners is called right away.
  *
  * @param[in]       self                Valid pointer to the event manager instance.
  * @param[in]       fqns                List of FQN strings.
@@ -55,6 +203,92 @@ typedef size_t kaa_event_block_id;
 kaa_error_t kaa_event_manager_find_event_listeners(kaa_event_manager_t *self, const char *fqns[], size_t fqns_count, const kaa_event_listeners_callback_t *callback);
 
 
+/**
+ * @brief Sets how long the successful results of @link kaa_event_manager_find_event_listeners @endlink are reused.
+ *
+ * The cache is dropped when the endpoint is attached to or detached from a user.
+ * Failed searches are never cached.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       ttl_ms              Time to live of a cached result in milliseconds. 0 disables the cache (default).
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_event_manager_set_listeners_cache_ttl(kaa_event_manager_t *self, uint32_t ttl_ms);
+
+
+/**
+ * @brief What a loopback group still sends to the server.
+ */
+typedef enum {
+    KAA_EVENT_LOOPBACK_FORWARD_NON_LOCAL = 0,   /**< Events for a member of the group are only delivered locally */
+    KAA_EVENT_LOOPBACK_FORWARD_ALL              /**< Every event is sent to the server as well */
+} kaa_event_loopback_policy_t;
+
+#ifndef KAA_EVENT_LOOPBACK_GROUP_T
+# define KAA_EVENT_LOOPBACK_GROUP_T
+    typedef struct kaa_event_loopback_group_t      kaa_event_loopback_group_t;
+#endif
+
+
+/**
+ * @brief Creates a group of endpoints hosted in the same process, which deliver events to each other directly.
+ *
+ * An event sent by an attached member is passed right to the callbacks of the attached members
+ * it is meant for: the target or, for broadcasts, all of them. Broadcasts are sent to the server
+ * as well, for the endpoints hosted elsewhere. The copies the server delivers back to the members
+ * are skipped, other events from the members arrive from the server as usual.
+ *
+ * The members are expected to be attached to the same user and driven by the same thread.
+ *
+ * @param[out]      group_p             The new group.
+ * @param[in]       policy              Which events are sent to the server as well.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_event_loopback_group_create(kaa_event_loopback_group_t **group_p, kaa_event_loopback_policy_t policy);
+
+
+/**
+ * @brief Destroys the loopback group. Its members are removed from it.
+ *
+ * @param[in]       group               The group.
+ */
+void kaa_event_loopback_group_destroy(kaa_event_loopback_group_t *group);
+
+
+/**
+ * @brief Adds the endpoint to a loopback group, leaving its current group if any.
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       group               The group. NULL only leaves the current group.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_event_manager_join_loopback_group(kaa_event_manager_t *self, kaa_event_loopback_group_t *group);
+
+
+/**
+ * @brief Sends raw event
+ *
+ * It is not recommended to use this function directly. Instead you should use
+ * functions contained in EventClassFamily auto-generated headers (placed at src/event/).
+ *
+ * @param[in]       self                Valid pointer to the event manager instance.
+ * @param[in]       fqn                 Fully-qualified name of the event (null-terminated string).
+ * @param[in]       event_data          Serialized event object.
+ * @param[in]       event_data_size     Size of data in event_data parameter.
+ * @param[in]       target              The target endpoint of the event (null-terminated string). The size of
+ *                                      the target parameter should be equal to @link KAA_ENDPOINT_ID_LENGTH @endlink .
+ *                                      If @code NULL @endcode event will be broadcasted.
+ *
+ * @return Error code. KAA_ERR_EVENT_QUEUE_FULL if the event queue is at its high-water mark.
+ *         The event data is taken over on success only, on any error it is left to the caller.
+ */
+kaa_error_t kaa_event_manager_send_event(kaa_event_manager_t *self, const char *fqn, const char *event_data
+                                       , size_t event_data_size, kaa_endpoint_id_p target);
+
+
 /**
  * @brief Start a new event block.
  *
@@ -71,7 +305,8 @@ kaa_error_t kaa_event_create_transaction(kaa_event_manager_t *self, kaa_event_bl
 /**
  * @brief Send all the events from the event block at once.
  *
- * The event block is identified by the given trx_id.
+ * The event block is identified by the given trx_id. If the event queue has no room
+ * for all events of the block, KAA_ERR_EVENT_QUEUE_FULL is returned and the block is kept.
  *
  * @param[in]       self                Valid pointer to the event manager instance.
  * @param[in]       trx_id              The ID of the event block to be sent.
@@ -25,6 +25,7 @@
 #include "kaa_platform_protocol.h"
 #include "utilities/kaa_mem.h"
 #include "utilities/kaa_log.h"
+#include "collections/kaa_list.h"
 #include "kaa_context.h"
 #include "kaa_defaults.h"
 #include "kaa_event.h"
@@ -50,6 +51,8 @@ extern kaa_error_t kaa_bootstrap_manager_handle_server_sync(kaa_bootstrap_manage
                                                           , size_t extension_length);
 
 /** External user manager API */
+extern kaa_error_t kaa_user_need_user_resync(kaa_user_manager_t *self, bool *result);
+extern void        kaa_user_on_connection_lost(kaa_user_manager_t *self);
 extern kaa_error_t kaa_user_request_get_size(kaa_user_manager_t *self, size_t *expected_size);
 extern kaa_error_t kaa_user_request_serialize(kaa_user_manager_t *self, kaa_platform_message_writer_t* writer);
 extern kaa_error_t kaa_user_handle_server_sync(kaa_user_manager_t *self, kaa_platform_message_reader_t *reader, uint32_t extension_options, size_t extension_length);
@@ -62,21 +65,27 @@ extern kaa_error_t kaa_profile_handle_server_sync(kaa_profile_manager_t *self, k
 
 /** External event manager API */
 #ifndef KAA_DISABLE_FEATURE_EVENTS
+extern kaa_error_t kaa_event_need_event_resync(kaa_event_manager_t *self, bool *result);
+extern void        kaa_event_on_connection_lost(kaa_event_manager_t *self);
 extern kaa_error_t kaa_event_request_get_size(kaa_event_manager_t *self, size_t *expected_size);
 extern kaa_error_t kaa_event_request_serialize(kaa_event_manager_t *self, size_t request_id, kaa_platform_message_writer_t *writer);
 extern kaa_error_t kaa_event_handle_server_sync(kaa_event_manager_t *self, kaa_platform_message_reader_t *reader, uint32_t extension_options, size_t extension_length, size_t request_id);
+extern kaa_error_t kaa_event_on_sync_lost(kaa_event_manager_t *self, size_t request_id);
 #endif
 
 /** External logging API */
 #ifndef KAA_DISABLE_FEATURE_LOGGING
 extern kaa_error_t kaa_logging_need_logging_resync(kaa_log_collector_t *self, bool *result);
 extern kaa_error_t kaa_logging_request_get_size(kaa_log_collector_t *self, size_t *expected_size);
-extern kaa_error_t kaa_logging_request_serialize(kaa_log_collector_t *self, kaa_platform_message_writer_t *writer);
+extern kaa_error_t kaa_logging_request_serialize(kaa_log_collector_t *self, uint32_t request_id, kaa_platform_message_writer_t *writer);
 extern kaa_error_t kaa_logging_handle_server_sync(kaa_log_collector_t *self, kaa_platform_message_reader_t *reader, uint32_t extension_options, size_t extension_length);
+extern kaa_error_t kaa_logging_on_sync_lost(kaa_log_collector_t *self, uint32_t request_id);
 #endif
 
 /** External configuration API */
 #ifndef KAA_DISABLE_FEATURE_CONFIGURATION
+extern kaa_error_t kaa_configuration_need_configuration_resync(kaa_configuration_manager_t *self, bool *result);
+extern void        kaa_configuration_manager_on_connection_lost(kaa_configuration_manager_t *self);
 extern kaa_error_t kaa_configuration_manager_get_size(kaa_configuration_manager_t *self, size_t *expected_size);
 extern kaa_error_t kaa_configuration_manager_request_serialize(kaa_configuration_manager_t *self, kaa_platform_message_writer_t *writer);
 extern kaa_error_t kaa_configuration_manager_handle_server_sync(kaa_configuration_manager_t *self, kaa_platform_message_reader_t *reader, uint32_t extension_options, size_t extension_length);
@@ -86,12 +95,18 @@ extern kaa_error_t kaa_configuration_manager_handle_server_sync(kaa_configuratio
 extern kaa_error_t kaa_status_save(kaa_status_t *self);
 
 
+typedef struct {
+    uint32_t    request_id;
+    void       *channel;
+} pending_request_t;
+
 struct kaa_platform_protocol_t
 {
     kaa_context_t *kaa_context;
     kaa_status_t  *status;
     kaa_logger_t  *logger;
     uint32_t       request_id;
+    kaa_list_t    *pending_requests; /**< pending_request_t per client sync awaiting its server sync */
 };
 
 
@@ -166,6 +181,7 @@ kaa_error_t kaa_platform_protocol_create(kaa_platform_protocol_t **platform_prot
     KAA_RETURN_IF_NIL(*platform_protocol_p, KAA_ERR_NOMEM);
 
     (*platform_protocol_p)->request_id = 0;
+    (*platform_protocol_p)->pending_requests = NULL;
     (*platform_protocol_p)->kaa_context = context;
     (*platform_protocol_p)->status = status;
     (*platform_protocol_p)->logger = context->logger;
@@ -177,12 +193,49 @@ kaa_error_t kaa_platform_protocol_create(kaa_platform_protocol_t **platform_prot
 void kaa_platform_protocol_destroy(kaa_platform_protocol_t *self)
 {
     if (self) {
+        kaa_list_destroy(self->pending_requests, NULL);
         KAA_FREE(self);
     }
 }
 
 
 
+/*
+ * Checks whether the service has anything to send, the extensions of the services
+ * which don't are left out of the client sync.
+ */
+static kaa_error_t kaa_client_sync_need_extension(kaa_platform_protocol_t *self
+                                                , kaa_service_t service
+                                                , bool *need_extension)
+{
+    *need_extension = false;
+    switch (service) {
+    case KAA_SERVICE_BOOTSTRAP:
+        *need_extension = true;
+        return KAA_ERR_NONE;
+    case KAA_SERVICE_PROFILE:
+        return kaa_profile_need_profile_resync(self->kaa_context->profile_manager, need_extension);
+    case KAA_SERVICE_USER:
+        return kaa_user_need_user_resync(self->kaa_context->user_manager, need_extension);
+#ifndef KAA_DISABLE_FEATURE_EVENTS
+    case KAA_SERVICE_EVENT:
+        return kaa_event_need_event_resync(self->kaa_context->event_manager, need_extension);
+#endif
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+    case KAA_SERVICE_LOGGING:
+        return kaa_logging_need_logging_resync(self->kaa_context->log_collector, need_extension);
+#endif
+#ifndef KAA_DISABLE_FEATURE_CONFIGURATION
+    case KAA_SERVICE_CONFIGURATION:
+        return kaa_configuration_need_configuration_resync(self->kaa_context->configuration_manager, need_extension);
+#endif
+    default:
+        return KAA_ERR_NONE;
+    }
+}
+
+
+
 static kaa_error_t kaa_client_sync_get_size(kaa_platform_protocol_t *self
                                           , const kaa_service_t services[]
                                           , size_t services_count
@@ -203,6 +256,12 @@ static kaa_error_t kaa_client_sync_get_size(kaa_platform_protocol_t *self
     KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Calculated meta extension size %u", extension_size);
 
     while (!err_code && services_count--) {
+        bool need_extension = false;
+        err_code = kaa_client_sync_need_extension(self, services[services_count], &need_extension);
+        if (err_code || !need_extension)
+            continue;
+
+        extension_size = 0;
         switch (services[services_count]) {
         case KAA_SERVICE_BOOTSTRAP: {
             err_code = kaa_channel_manager_bootstrap_request_get_size(self->kaa_context->channel_manager
@@ -212,18 +271,10 @@ static kaa_error_t kaa_client_sync_get_size(kaa_platform_protocol_t *self
             break;
         }
         case KAA_SERVICE_PROFILE: {
-            bool need_resync = false;
-            err_code = kaa_profile_need_profile_resync(self->kaa_context->profile_manager
-                                                     , &need_resync);
-            if (err_code) {
-                KAA_LOG_ERROR(self->logger, err_code, "Failed to read 'need_resync' flag");
-            }
-
-            if (!err_code && need_resync) {
-                err_code = kaa_profile_request_get_size(self->kaa_context->profile_manager
-                                                      , &extension_size);
+            err_code = kaa_profile_request_get_size(self->kaa_context->profile_manager
+                                                  , &extension_size);
+            if (!err_code)
                 KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Calculated profile extension size %u", extension_size);
-            }
             break;
         }
         case KAA_SERVICE_USER: {
@@ -261,7 +312,6 @@ static kaa_error_t kaa_client_sync_get_size(kaa_platform_protocol_t *self
         }
 #endif
         default:
-            extension_size = 0;
             break;
         }
 
@@ -288,7 +338,7 @@ static kaa_error_t kaa_client_sync_serialize(kaa_platform_protocol_t *self
     kaa_error_t error_code = kaa_platform_message_writer_create(&writer, buffer, *size);
     KAA_RETURN_IF_ERR(error_code);
 
-    uint16_t total_services_count = services_count + 1 /* Meta extension */;
+    uint16_t total_services_count = 1 /* Meta extension */;
 
     error_code = kaa_platform_message_header_write(writer, KAA_PLATFORM_PROTOCOL_ID, KAA_PLATFORM_PROTOCOL_VERSION);
     if (error_code) {
@@ -301,6 +351,16 @@ static kaa_error_t kaa_client_sync_serialize(kaa_platform_protocol_t *self
     error_code = kaa_meta_data_request_serialize(self->status, writer, self->request_id);
 
     while (!error_code && services_count--) {
+        bool need_extension = false;
+        error_code = kaa_client_sync_need_extension(self, services[services_count], &need_extension);
+        if (error_code) {
+            KAA_LOG_ERROR(self->logger, error_code, "Failed to check whether %u service has anything to sync"
+                                                                            , services[services_count]);
+            break;
+        }
+        if (!need_extension)
+            continue;
+
         switch (services[services_count]) {
         case KAA_SERVICE_BOOTSTRAP: {
             error_code = kaa_channel_manager_bootstrap_request_serialize(self->kaa_context->channel_manager
@@ -310,20 +370,9 @@ static kaa_error_t kaa_client_sync_serialize(kaa_platform_protocol_t *self
             break;
         }
         case KAA_SERVICE_PROFILE: {
-            bool need_resync = false;
-            error_code = kaa_profile_need_profile_resync(self->kaa_context->profile_manager
-                                                     , &need_resync);
-            if (!error_code) {
-                if (need_resync) {
-                    error_code = kaa_profile_request_serialize(self->kaa_context->profile_manager, writer);
-                    if (error_code)
-                        KAA_LOG_ERROR(self->logger, error_code, "Failed to serialize the profile extension");
-                } else {
-                    --total_services_count;
-                }
-            } else {
-                KAA_LOG_ERROR(self->logger, error_code, "Failed to read profile's 'need_resync' flag");
-            }
+            error_code = kaa_profile_request_serialize(self->kaa_context->profile_manager, writer);
+            if (error_code)
+                KAA_LOG_ERROR(self->logger, error_code, "Failed to serialize the profile extension");
             break;
         }
         case KAA_SERVICE_USER: {
@@ -332,49 +381,34 @@ static kaa_error_t kaa_client_sync_serialize(kaa_platform_protocol_t *self
                 KAA_LOG_ERROR(self->logger, error_code, "Failed to serialize the user extension");
             break;
         }
-        case KAA_SERVICE_EVENT: {
 #ifndef KAA_DISABLE_FEATURE_EVENTS
+        case KAA_SERVICE_EVENT: {
             error_code = kaa_event_request_serialize(self->kaa_context->event_manager, self->request_id, writer);
             if (error_code)
                 KAA_LOG_ERROR(self->logger, error_code, "Failed to serialize the event extension");
-#else
-            --total_services_count;
-#endif
             break;
         }
-        case KAA_SERVICE_LOGGING: {
-#ifndef KAA_DISABLE_FEATURE_LOGGING
-            bool need_resync = false;
-            error_code = kaa_logging_need_logging_resync(self->kaa_context->log_collector, &need_resync);
-            if (!error_code) {
-                if (need_resync) {
-                    error_code = kaa_logging_request_serialize(self->kaa_context->log_collector, writer);
-                    if (error_code)
-                         KAA_LOG_ERROR(self->logger, error_code, "Failed to serialize the logging extension");
-                } else {
-                    --total_services_count;
-                }
-            } else {
-                KAA_LOG_ERROR(self->logger, error_code, "Failed to read logging's 'need_resync' flag");
-            }
-#else
-            --total_services_count;
 #endif
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+        case KAA_SERVICE_LOGGING: {
+            error_code = kaa_logging_request_serialize(self->kaa_context->log_collector, self->request_id, writer);
+            if (error_code)
+                 KAA_LOG_ERROR(self->logger, error_code, "Failed to serialize the logging extension");
             break;
         }
-        case KAA_SERVICE_CONFIGURATION: {
+#endif
 #ifndef KAA_DISABLE_FEATURE_CONFIGURATION
+        case KAA_SERVICE_CONFIGURATION: {
             error_code = kaa_configuration_manager_request_serialize(self->kaa_context->configuration_manager, writer);
             if (error_code)
                 KAA_LOG_ERROR(self->logger, error_code, "Failed to serialize the configuration extension");
-#else
-            --total_services_count;
-#endif
             break;
         }
+#endif
         default:
             break;
         }
+        ++total_services_count;
     }
     *(uint16_t *) extension_count_p = KAA_HTONS(total_services_count);
     *size = writer->current - writer->begin;
@@ -385,6 +419,75 @@ static kaa_error_t kaa_client_sync_serialize(kaa_platform_protocol_t *self
 
 
 
+static bool find_request_by_id(void *data, void *context)
+{
+    KAA_RETURN_IF_NIL2(data, context, false);
+    return (((pending_request_t *)data)->request_id == *((uint32_t *)context));
+}
+
+
+
+static void remember_request(kaa_platform_protocol_t *self, void *channel)
+{
+    pending_request_t *request = (pending_request_t *) KAA_MALLOC(sizeof(pending_request_t));
+    if (request) {
+        request->request_id = self->request_id;
+        request->channel = channel;
+
+        kaa_list_t *it = self->pending_requests ? kaa_list_push_back(self->pending_requests, request)
+                                                : kaa_list_create(request);
+        if (it) {
+            if (!self->pending_requests)
+                self->pending_requests = it;
+            return;
+        }
+        KAA_FREE(request);
+    }
+    KAA_LOG_WARN(self->logger, KAA_ERR_NOMEM, "Failed to remember request %u, its loss won't be detected", self->request_id);
+}
+
+
+
+static void notify_request_lost(kaa_platform_protocol_t *self, uint32_t request_id)
+{
+    KAA_LOG_WARN(self->logger, KAA_ERR_NONE, "Server sync for request %u is lost", request_id);
+#ifndef KAA_DISABLE_FEATURE_EVENTS
+    kaa_event_on_sync_lost(self->kaa_context->event_manager, request_id);
+#endif
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+    kaa_logging_on_sync_lost(self->kaa_context->log_collector, request_id);
+#endif
+}
+
+
+
+/*
+ * Forgets the answered request. A channel delivers server syncs in the order
+ * of its client syncs, so its older requests still pending got no answer.
+ */
+static void complete_request(kaa_platform_protocol_t *self, uint32_t request_id)
+{
+    kaa_list_t *it = kaa_list_find_next(self->pending_requests, &find_request_by_id, &request_id);
+    KAA_RETURN_IF_NIL(it,);
+
+    void *channel = ((pending_request_t *) kaa_list_get_data(it))->channel;
+    kaa_list_remove_at(&self->pending_requests, it, NULL);
+
+    kaa_list_t *cursor = self->pending_requests;
+    while (cursor) {
+        pending_request_t *request = (pending_request_t *) kaa_list_get_data(cursor);
+        kaa_list_t *next = kaa_list_next(cursor);
+        if (request->channel == channel && request->request_id < request_id) {
+            uint32_t lost_request_id = request->request_id;
+            kaa_list_remove_at(&self->pending_requests, cursor, NULL);
+            notify_request_lost(self, lost_request_id);
+        }
+        cursor = next;
+    }
+}
+
+
+
 kaa_error_t kaa_platform_protocol_serialize_client_sync(kaa_platform_protocol_t *self
                                                       , const kaa_serialize_info_t *info
                                                       , char **buffer
@@ -412,6 +515,7 @@ kaa_error_t kaa_platform_protocol_serialize_client_sync(kaa_platform_protocol_t
     if (error) {
         self->request_id--;
     } else {
+        remember_request(self, info->channel);
         KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Client sync successfully serialized");
     }
 
@@ -525,6 +629,9 @@ kaa_error_t kaa_platform_protocol_process_server_sync(kaa_platform_protocol_t *s
 
     kaa_platform_message_reader_destroy(reader);
 
+    if (request_id)
+        complete_request(self, request_id);
+
     if (!error_code) {
         error_code = kaa_status_save(self->status);
         KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Server sync successfully processed");
@@ -535,3 +642,32 @@ kaa_error_t kaa_platform_protocol_process_server_sync(kaa_platform_protocol_t *s
 
     return error_code;
 }
+
+
+
+kaa_error_t kaa_platform_protocol_drop_pending_syncs(kaa_platform_protocol_t *self, void *channel)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+
+    /* The server forgets the update subscriptions of the closed connection */
+    kaa_user_on_connection_lost(self->kaa_context->user_manager);
+#ifndef KAA_DISABLE_FEATURE_EVENTS
+    kaa_event_on_connection_lost(self->kaa_context->event_manager);
+#endif
+#ifndef KAA_DISABLE_FEATURE_CONFIGURATION
+    kaa_configuration_manager_on_connection_lost(self->kaa_context->configuration_manager);
+#endif
+
+    kaa_list_t *cursor = self->pending_requests;
+    while (cursor) {
+        pending_request_t *request = (pending_request_t *) kaa_list_get_data(cursor);
+        kaa_list_t *next = kaa_list_next(cursor);
+        if (request->channel == channel) {
+            uint32_t lost_request_id = request->request_id;
+            kaa_list_remove_at(&self->pending_requests, cursor, NULL);
+            notify_request_lost(self, lost_request_id);
+        }
+        cursor = next;
+    }
+    return KAA_ERR_NONE;
+}
@@ -39,12 +39,7 @@
 extern kaa_error_t kaa_status_set_endpoint_access_token(kaa_status_t *self, const char *token);
 
 
-extern kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa_channel_manager_t *self
-                                                                                  , kaa_service_t service_type);
-
-
-
-static kaa_service_t profile_sync_services[1] = { KAA_SERVICE_PROFILE };
+extern kaa_error_t kaa_channel_manager_request_sync(kaa_channel_manager_t *self, kaa_service_t service_type);
 
 
 
@@ -380,10 +375,7 @@ kaa_error_t kaa_profile_handle_server_sync(kaa_profile_manager_t *self
     self->need_resync = false;
     if (extension_options & KAA_PROFILE_RESYNC_OPTION) {
         self->need_resync = true;
-        kaa_transport_channel_interface_t *channel =
-                kaa_channel_manager_get_transport_channel(self->channel_manager, profile_sync_services[0]);
-        if (channel)
-            channel->sync_handler(channel->context, profile_sync_services, 1);
+        kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_PROFILE);
     }
 
 
@@ -442,10 +434,7 @@ kaa_error_t kaa_profile_manager_update_profile(kaa_profile_manager_t *self, kaa_
 
     self->need_resync = true;
 
-    kaa_transport_channel_interface_t *channel =
-            kaa_channel_manager_get_transport_channel(self->channel_manager, profile_sync_services[0]);
-    if (channel)
-        channel->sync_handler(channel->context, profile_sync_services, 1);
+    kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_PROFILE);
 
 #endif
     return KAA_ERR_NONE;
@@ -261,13 +261,30 @@ kaatcp_error_t kaatcp_get_request_kaasync(const kaatcp_kaasync_t *message, char
     KAA_RETURN_IF_ERR(rval);
 
     if (message->sync_request) {
-        memcpy(cursor, message->sync_request, message->sync_request_size);
+        if (message->sync_request != cursor)
+            memmove(cursor, message->sync_request, message->sync_request_size);
         cursor += message->sync_request_size;
     }
     *buf_size = cursor - buf;
     return KAATCP_ERR_NONE;
 }
 
+kaatcp_error_t kaatcp_get_request_kaasync_header_size(size_t sync_request_size, size_t *header_size)
+{
+    KAA_RETURN_IF_NIL2(sync_request_size, header_size, KAATCP_ERR_BAD_PARAM);
+
+    char header[6];
+    uint8_t basic_header_size = create_basic_header(KAATCP_MESSAGE_KAASYNC
+                                                  , sync_request_size + KAA_SYNC_HEADER_LENGTH
+                                                  , header);
+    if (!basic_header_size) {
+        return KAATCP_ERR_BAD_PARAM;
+    }
+
+    *header_size = basic_header_size + KAA_SYNC_HEADER_LENGTH;
+    return KAATCP_ERR_NONE;
+}
+
 
 kaatcp_error_t kaatcp_get_request_ping(char *buf, size_t *buf_size)
 {
@@ -36,8 +36,10 @@
 
 
 
-extern kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa_channel_manager_t *self
-                                                                                  , kaa_service_t service_type);
+extern kaa_error_t kaa_channel_manager_request_sync(kaa_channel_manager_t *self, kaa_service_t service_type);
+#ifndef KAA_DISABLE_FEATURE_EVENTS
+extern void kaa_event_manager_invalidate_listeners_cache(kaa_event_manager_t *self);
+#endif
 
 
 
@@ -54,8 +56,10 @@ struct kaa_user_manager_t {
     kaa_attachment_status_listeners_t   attachment_listeners;               /*!< Client code-defined user attachment listeners */
     user_info_t                        *user_info;                          /*!< User credentials */
     bool                                is_waiting_user_attach_response;
+    bool                                need_resync;                        /*!< No user extension asking for the attach updates was sent over the current connection yet */
     kaa_status_t                       *status;                             /*!< Reference to global status */
     kaa_channel_manager_t              *channel_manager;                    /*!< Reference to global channel manager */
+    kaa_event_manager_t                *event_manager;                      /*!< Reference to global event manager, may be NULL */
     kaa_logger_t                       *logger;
 };
 
@@ -74,9 +78,14 @@ typedef enum {
 
 
 
-static kaa_service_t user_sync_services[1] = {KAA_SERVICE_USER};
-
-
+static void kaa_user_set_attached(kaa_user_manager_t *self, bool is_attached)
+{
+    self->status->is_attached = is_attached;
+#ifndef KAA_DISABLE_FEATURE_EVENTS
+    /* Event listeners depend on the user */
+    kaa_event_manager_invalidate_listeners_cache(self->event_manager);
+#endif
+}
 
 static void destroy_user_info(user_info_t *user_info)
 {
@@ -130,6 +139,7 @@ static user_info_t *create_user_info(const char *external_id, const char *user_a
 kaa_error_t kaa_user_manager_create(kaa_user_manager_t **user_manager_p
                                   , kaa_status_t *status
                                   , kaa_channel_manager_t *channel_manager
+                                  , kaa_event_manager_t *event_manager
                                   , kaa_logger_t *logger)
 {
     KAA_RETURN_IF_NIL2(user_manager_p, status, KAA_ERR_BADPARAM);
@@ -143,8 +153,10 @@ kaa_error_t kaa_user_manager_create(kaa_user_manager_t **user_manager_p
     (*user_manager_p)->attachment_listeners.on_attach_failed  = NULL;
     (*user_manager_p)->user_info = NULL;
     (*user_manager_p)->is_waiting_user_attach_response = false;
+    (*user_manager_p)->need_resync = true;
     (*user_manager_p)->status = status;
     (*user_manager_p)->channel_manager = channel_manager;
+    (*user_manager_p)->event_manager = event_manager;
     (*user_manager_p)->logger = logger;
 
     return KAA_ERR_NONE;
@@ -185,10 +197,7 @@ kaa_error_t kaa_user_manager_attach_to_user(kaa_user_manager_t *self
     if (!self->user_info)
         return KAA_ERR_NOMEM;
 
-    kaa_transport_channel_interface_t *channel =
-            kaa_channel_manager_get_transport_channel(self->channel_manager, user_sync_services[0]);
-    if (channel)
-        channel->sync_handler(channel->context, user_sync_services, 1);
+    kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_USER);
 
     return KAA_ERR_NONE;
 }
@@ -224,6 +233,24 @@ static size_t kaa_user_request_get_size_no_header(kaa_user_manager_t *self)
     return expected_size;
 }
 
+kaa_error_t kaa_user_need_user_resync(kaa_user_manager_t *self, bool *result)
+{
+    KAA_RETURN_IF_NIL2(self, result, KAA_ERR_BADPARAM);
+    *result = self->need_resync || (self->user_info && !self->is_waiting_user_attach_response);
+    return KAA_ERR_NONE;
+}
+
+/*
+ * Called by the platform protocol when the connection to the server is closed.
+ * An attach request without the response is sent again.
+ */
+void kaa_user_on_connection_lost(kaa_user_manager_t *self)
+{
+    KAA_RETURN_IF_NIL(self,);
+    self->need_resync = true;
+    self->is_waiting_user_attach_response = false;
+}
+
 kaa_error_t kaa_user_request_get_size(kaa_user_manager_t *self, size_t *expected_size)
 {
     KAA_RETURN_IF_NIL2(self, expected_size, KAA_ERR_BADPARAM);
@@ -242,6 +269,7 @@ kaa_error_t kaa_user_request_serialize(kaa_user_manager_t *self, kaa_platform_me
         KAA_LOG_ERROR(self->logger, KAA_ERR_WRITE_FAILED, "Failed to write the user extension header");
         return KAA_ERR_WRITE_FAILED;
     }
+    self->need_resync = false;
 
     if (self->user_info && !self->is_waiting_user_attach_response) {
         *(writer->current++) = EXTERNAL_SYSTEM_AUTH_FIELD;
@@ -316,7 +344,7 @@ kaa_error_t kaa_user_handle_server_sync(kaa_user_manager_t *self
 
                 if (result == USER_RESULT_SUCCESS) {
                     KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Endpoint was successfully attached to user");
-                    self->status->is_attached = true;
+                    kaa_user_set_attached(self, true);
                     if (self->attachment_listeners.on_attach_success)
                         (self->attachment_listeners.on_attach_success)(self->attachment_listeners.context);
                 } else {
@@ -390,7 +418,7 @@ kaa_error_t kaa_user_handle_server_sync(kaa_user_manager_t *self
                 access_token[access_token_length] = '\0';
                 remaining_length -= kaa_aligned_size_get(access_token_length);
 
-                self->status->is_attached = true;
+                kaa_user_set_attached(self, true);
 
                 if (self->attachment_listeners.on_attached)
                     (self->attachment_listeners.on_attached)(self->attachment_listeners.context
@@ -411,7 +439,7 @@ kaa_error_t kaa_user_handle_server_sync(kaa_user_manager_t *self
                 access_token[access_token_length] = '\0';
                 remaining_length -= kaa_aligned_size_get(access_token_length);
 
-                self->status->is_attached = false;
+                kaa_user_set_attached(self, false);
 
                 if (self->attachment_listeners.on_detached)
                     (self->attachment_listeners.on_detached)(self->attachment_listeners.context, access_token);
@@ -28,8 +28,26 @@
 
 #define KAA_TCP_CHANNEL_KEEPALIVE           300
 
+#define KAA_TCP_CHANNEL_MAX_INFLIGHT_SYNCS  1
+
 #define KAATCP_PARSER_MAX_MESSAGE_LENGTH    999
+#define KAATCP_PARSER_INITIAL_BUFFER_SIZE   999
+/* A grown parser buffer shrinks back after this many frames that fit the initial size */
+#define KAATCP_PARSER_SHRINK_AFTER_FRAMES   8
 
 #define KAA_MAX_LOG_MESSAGE_LENGTH          247
 
+#define KAA_EVENT_QUEUE_CAPACITY            8
+#define KAA_EVENT_INLINE_SIZE               48
+
+/* Ranges of log records the ring log storage tracks: unmarked records, in-flight and acknowledged buckets */
+#define KAA_RING_LOG_STORAGE_MAX_RANGES     8
+
+/* The client loop doesn't process Kaa deadlines, so services are synced right away */
+#define KAA_SYNC_LATENCY_PROFILE            0
+#define KAA_SYNC_LATENCY_USER               0
+#define KAA_SYNC_LATENCY_EVENT              0
+#define KAA_SYNC_LATENCY_LOGGING            0
+#define KAA_SYNC_LATENCY_CONFIGURATION      0
+
 #endif /* ECONAIS_EC19D_DEFAULTS_H_ */
@@ -19,7 +19,7 @@ CFILES-PLAT-IMPL = kaa/platform-impl/ext_log_storage_memory.c kaa/platform-impl/
 CFILES-PROTO = kaa/kaa_protocols/kaa_tcp/kaatcp_parser.c kaa/kaa_protocols/kaa_tcp/kaatcp_request.c
 CFILES-AVRO = kaa/avro_src/io.c kaa/avro_src/encoding_binary.c
 CFILES-COLLECTIONS = kaa/collections/kaa_deque.c kaa/collections/kaa_list.c
-CFILES-UTIL = kaa/utilities/kaa_log.c kaa/utilities/kaa_mem.c kaa/utilities/kaa_buffer.c
+CFILES-UTIL = kaa/utilities/kaa_log.c kaa/utilities/kaa_mem.c kaa/utilities/kaa_buffer.c kaa/utilities/kaa_timer_queue.c kaa/utilities/kaa_spsc_queue.c
 CFILES-GEN = kaa/gen/kaa_logging_gen.c kaa/gen/kaa_profile_gen.c kaa/gen/kaa_configuration_gen.c
 
 CFILES-KAA = $(CFILES-ECONAIS-PLAT) $(CFILES-PLAT-IMPL) $(CFILES-PROTO) $(CFILES-AVRO) $(CFILES-COLLECTIONS) $(CFILES-GEN) $(CFILES-UTIL) kaa/kaa.c kaa/kaa_common_schema.c kaa/kaa_logging.c kaa/kaa_status.c kaa/kaa_channel_manager.c kaa/kaa_platform_utils.c kaa/kaa_bootstrap_manager.c kaa/kaa_event.c kaa/kaa_platform_protocol.c kaa/kaa_profile.c kaa/kaa_user.c kaa/kaa_configuration_manager.c
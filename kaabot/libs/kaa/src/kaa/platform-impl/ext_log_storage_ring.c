@@ -0,0 +1,529 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Log storage keeping the records in a single preallocated circular arena.
+ *
+ * Each record is stored as a 32-bit length followed by the serialized data.
+ * Records never wrap: one that doesn't fit at the end of the arena is placed
+ * at its beginning. The records between the head and the tail are split into
+ * a short ordered table of contiguous ranges: unmarked records, records of an
+ * in-flight bucket, and acknowledged buckets whose space is reclaimed once the
+ * head reaches them. Adding, marking, acknowledging and evicting a record
+ * never depend on the number of stored records.
+ */
+
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../platform/platform.h"
+#include "../platform/defaults.h"
+
+#include "../platform/ext_log_storage.h"
+
+#include "../kaa_common.h"
+
+#include "../utilities/kaa_mem.h"
+#include "../utilities/kaa_log.h"
+
+
+
+#define RECORD_HEADER_SIZE    sizeof(uint32_t)
+
+typedef struct {
+    size_t      begin;      /**< Offset of the first record */
+    size_t      end;        /**< Offset past the last record */
+    size_t      count;      /**< Number of records */
+    size_t      size;       /**< Volume occupied by the records data */
+    uint16_t    bucket_id;  /**< Bucket ID, zero for unmarked records */
+    bool        is_removed; /**< The bucket is acknowledged, waiting for the head to reclaim it */
+} ext_log_range_t;
+
+typedef struct {
+    char           *arena;                  /**< Records storage */
+    size_t          capacity;               /**< Size of the arena */
+    size_t          head;                   /**< Offset of the eldest record */
+    size_t          tail;                   /**< Offset past the newest record */
+    size_t          wrap;                   /**< End of the records at the end of the arena once the tail wrapped around */
+    bool            is_wrapped;             /**< The tail is behind the head */
+    size_t          reserved;               /**< Offset of the buffer handed out for the next record */
+    bool            is_reserved;            /**< The next record is serialized right into the arena */
+    ext_log_range_t ranges[KAA_RING_LOG_STORAGE_MAX_RANGES]; /**< Ranges in order from the head */
+    size_t          ranges_count;           /**< Number of ranges in use */
+    size_t          records_count;          /**< Number of records, except acknowledged ones */
+    size_t          total_occupied_size;    /**< Volume occupied by all logs */
+    size_t          unmarked_occupied_size; /**< Volume occupied by unmarked logs */
+    size_t          unmarked_record_count;  /**< Number of unmarked logs */
+    kaa_logger_t   *logger;                 /**< Logger instance */
+} ext_log_storage_ring_t;
+
+
+
+/**
+ * @brief Creates the instance of the ring log storage.
+ *
+ * The eldest records are evicted when a new one does not fit into the arena.
+ *
+ * @param[out]    log_storage_context_p    The pointer to the new storage instance.
+ * @param[in]     logger                   The logger.
+ * @param[in]     storage_size             The size of the arena, including 4 bytes per record.
+ *
+ * @return    Error code.
+ */
+kaa_error_t ext_ring_log_storage_create(void **log_storage_context_p, kaa_logger_t *logger, size_t storage_size);
+
+
+
+/**
+ * @brief Destroys the instance of the ring log storage.
+ *
+ * @param[in]   context The log storage context.
+ * @return    Error code.
+ */
+kaa_error_t ext_log_storage_destroy(void *context);
+
+
+
+kaa_error_t ext_ring_log_storage_create(void **log_storage_context_p, kaa_logger_t *logger, size_t storage_size)
+{
+    KAA_RETURN_IF_NIL3(log_storage_context_p, logger, storage_size, KAA_ERR_BADPARAM);
+
+    if (storage_size <= RECORD_HEADER_SIZE) {
+        KAA_LOG_WARN(logger, KAA_ERR_BADPARAM, "Failed to create log storage: size %zu is too small", storage_size);
+        return KAA_ERR_BADPARAM;
+    }
+
+    ext_log_storage_ring_t *log_storage = (ext_log_storage_ring_t *) KAA_MALLOC(sizeof(ext_log_storage_ring_t) + storage_size);
+    KAA_RETURN_IF_NIL(log_storage, KAA_ERR_NOMEM);
+
+    memset(log_storage, 0, sizeof(ext_log_storage_ring_t));
+    log_storage->arena    = (char *) (log_storage + 1);
+    log_storage->capacity = storage_size;
+    log_storage->wrap     = storage_size;
+    log_storage->logger   = logger;
+
+    *log_storage_context_p = (void *)log_storage;
+    return KAA_ERR_NONE;
+}
+
+
+
+static uint32_t record_size_at(ext_log_storage_ring_t *self, size_t offset)
+{
+    uint32_t size;
+    memcpy(&size, self->arena + offset, RECORD_HEADER_SIZE);
+    return size;
+}
+
+
+
+static size_t next_record_offset(ext_log_storage_ring_t *self, size_t offset)
+{
+    offset += RECORD_HEADER_SIZE + record_size_at(self, offset);
+    return (self->is_wrapped && offset == self->wrap) ? 0 : offset;
+}
+
+
+
+static void reset(ext_log_storage_ring_t *self)
+{
+    self->head = 0;
+    self->tail = 0;
+    self->wrap = self->capacity;
+    self->is_wrapped = false;
+    self->ranges_count = 0;
+}
+
+
+
+static void set_head(ext_log_storage_ring_t *self, size_t offset)
+{
+    if (self->is_wrapped && offset == self->wrap) {
+        offset = 0;
+        self->wrap = self->capacity;
+        self->is_wrapped = false;
+    }
+    self->head = offset;
+}
+
+
+
+static void remove_range(ext_log_storage_ring_t *self, size_t index)
+{
+    --self->ranges_count;
+    memmove(&self->ranges[index], &self->ranges[index + 1], (self->ranges_count - index) * sizeof(ext_log_range_t));
+}
+
+
+
+static ext_log_range_t *insert_range(ext_log_storage_ring_t *self, size_t index)
+{
+    if (self->ranges_count == KAA_RING_LOG_STORAGE_MAX_RANGES)
+        return NULL;
+
+    memmove(&self->ranges[index + 1], &self->ranges[index], (self->ranges_count - index) * sizeof(ext_log_range_t));
+    ++self->ranges_count;
+    memset(&self->ranges[index], 0, sizeof(ext_log_range_t));
+    return &self->ranges[index];
+}
+
+
+
+static bool is_mergeable(const ext_log_range_t *left, const ext_log_range_t *right)
+{
+    if (left->is_removed || right->is_removed)
+        return left->is_removed && right->is_removed;
+    return !left->bucket_id && !right->bucket_id;
+}
+
+
+
+/*
+ * Merges adjacent ranges of unmarked records and of acknowledged buckets,
+ * then reclaims the acknowledged buckets at the head.
+ */
+static void compact(ext_log_storage_ring_t *self)
+{
+    size_t i = 1;
+    while (i < self->ranges_count) {
+        ext_log_range_t *left = &self->ranges[i - 1];
+        ext_log_range_t *right = &self->ranges[i];
+        if (is_mergeable(left, right)) {
+            left->end = right->end;
+            left->count += right->count;
+            left->size += right->size;
+            remove_range(self, i);
+        } else {
+            ++i;
+        }
+    }
+
+    while (self->ranges_count && self->ranges[0].is_removed) {
+        set_head(self, self->ranges[0].end);
+        remove_range(self, 0);
+    }
+
+    if (!self->records_count)
+        reset(self);
+}
+
+
+
+/*
+ * Removes the eldest record, which may belong to a bucket in flight.
+ */
+static void evict_eldest(ext_log_storage_ring_t *self)
+{
+    ext_log_range_t *range = &self->ranges[0];
+    size_t size = record_size_at(self, self->head);
+
+    set_head(self, self->head + RECORD_HEADER_SIZE + size);
+    range->begin = self->head;
+    --range->count;
+    range->size -= size;
+
+    --self->records_count;
+    self->total_occupied_size -= size;
+    if (!range->bucket_id) {
+        --self->unmarked_record_count;
+        self->unmarked_occupied_size -= size;
+    }
+
+    if (!range->count) {
+        remove_range(self, 0);
+        compact(self);
+    }
+}
+
+
+
+/*
+ * Finds the place for a record of the given size, evicting the eldest records if needed.
+ */
+static kaa_error_t reserve(ext_log_storage_ring_t *self, size_t record_size, size_t *offset)
+{
+    size_t required = RECORD_HEADER_SIZE + record_size;
+    if (required > self->capacity) {
+        KAA_LOG_WARN(self->logger, KAA_ERR_INSUFFICIENT_BUFFER, "Log record of size %zu doesn't fit "
+                                                "into the log storage of size %zu", record_size, self->capacity);
+        return KAA_ERR_INSUFFICIENT_BUFFER;
+    }
+
+    size_t removed_record_count = 0;
+    for (;;) {
+        if (!self->records_count) {
+            reset(self);
+            *offset = 0;
+            break;
+        }
+
+        if (!self->is_wrapped) {
+            if (self->capacity - self->tail >= required) {
+                *offset = self->tail;
+                break;
+            }
+            if (self->head >= required) {
+                *offset = 0;
+                break;
+            }
+        } else if (self->head - self->tail >= required) {
+            *offset = self->tail;
+            break;
+        }
+
+        evict_eldest(self);
+        ++removed_record_count;
+    }
+
+    if (removed_record_count)
+        KAA_LOG_INFO(self->logger, KAA_ERR_NONE, "%zu records forcibly removed", removed_record_count);
+
+    return KAA_ERR_NONE;
+}
+
+
+
+static bool is_reserved_buffer(ext_log_storage_ring_t *self, const kaa_log_record_t *record)
+{
+    return self->is_reserved && record->data == self->arena + self->reserved + RECORD_HEADER_SIZE;
+}
+
+
+
+kaa_error_t ext_log_storage_allocate_log_record_buffer(void *context, kaa_log_record_t *record)
+{
+    KAA_RETURN_IF_NIL3(context, record, record->size, KAA_ERR_BADPARAM);
+    ext_log_storage_ring_t *self = (ext_log_storage_ring_t *)context;
+
+    kaa_error_t error_code = reserve(self, record->size, &self->reserved);
+    KAA_RETURN_IF_ERR(error_code);
+
+    self->is_reserved = true;
+    record->data = self->arena + self->reserved + RECORD_HEADER_SIZE;
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_deallocate_log_record_buffer(void *context, kaa_log_record_t *record)
+{
+    KAA_RETURN_IF_NIL3(context, record, record->data, KAA_ERR_BADPARAM);
+    ext_log_storage_ring_t *self = (ext_log_storage_ring_t *)context;
+
+    if (is_reserved_buffer(self, record))
+        self->is_reserved = false;
+    else
+        KAA_FREE(record->data);
+
+    record->data = NULL;
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_add_log_record(void *context, kaa_log_record_t *record)
+{
+    KAA_RETURN_IF_NIL3(context, record, record->data, KAA_ERR_BADPARAM);
+    ext_log_storage_ring_t *self = (ext_log_storage_ring_t *)context;
+
+    bool is_copied = !is_reserved_buffer(self, record);
+    size_t offset = self->reserved;
+    if (is_copied) {
+        // The record wasn't allocated by the storage, so it is copied into the arena.
+        kaa_error_t error_code = reserve(self, record->size, &offset);
+        KAA_RETURN_IF_ERR(error_code);
+    }
+
+    ext_log_range_t *range = self->ranges_count ? &self->ranges[self->ranges_count - 1] : NULL;
+    if (!range || range->bucket_id || range->is_removed) {
+        range = insert_range(self, self->ranges_count);
+        if (!range) {
+            // Never happens: marking records keeps a spare range for the new ones.
+            return KAA_ERR_BAD_STATE;
+        }
+        range->begin = offset;
+    }
+
+    if (is_copied) {
+        memcpy(self->arena + offset + RECORD_HEADER_SIZE, record->data, record->size);
+        KAA_FREE(record->data);
+    }
+    self->is_reserved = false;
+
+    uint32_t size = record->size;
+    memcpy(self->arena + offset, &size, RECORD_HEADER_SIZE);
+
+    if (self->records_count && !offset && self->tail) {
+        self->wrap = self->tail;
+        self->is_wrapped = true;
+    }
+    self->tail = offset + RECORD_HEADER_SIZE + size;
+
+    range->end = self->tail;
+    ++range->count;
+    range->size += size;
+
+    ++self->records_count;
+    self->total_occupied_size += size;
+    self->unmarked_occupied_size += size;
+    ++self->unmarked_record_count;
+
+    record->data = NULL;
+    record->size = 0;
+
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_write_next_record(void *context
+                                            , char *buffer
+                                            , size_t buffer_len
+                                            , uint16_t bucket_id
+                                            , size_t *record_len)
+{
+    KAA_RETURN_IF_NIL5(context, buffer, buffer_len, bucket_id, record_len, KAA_ERR_BADPARAM);
+    ext_log_storage_ring_t *self = (ext_log_storage_ring_t *)context;
+
+    size_t i = 0;
+    while (i < self->ranges_count && (self->ranges[i].bucket_id || self->ranges[i].is_removed))
+        ++i;
+
+    if (i == self->ranges_count) {
+        *record_len = 0;
+        return KAA_ERR_NOT_FOUND;
+    }
+
+    size_t offset = self->ranges[i].begin;
+    size_t size = record_size_at(self, offset);
+    *record_len = size;
+    if (size > buffer_len)
+        return KAA_ERR_INSUFFICIENT_BUFFER;
+
+    ext_log_range_t *bucket = (i && self->ranges[i - 1].bucket_id == bucket_id && !self->ranges[i - 1].is_removed)
+                            ? &self->ranges[i - 1] : NULL;
+    if (!bucket) {
+        // Keeps a spare range for the records added after this one.
+        if (self->ranges_count + 1 == KAA_RING_LOG_STORAGE_MAX_RANGES
+                || !(bucket = insert_range(self, i))) {
+            KAA_LOG_WARN(self->logger, KAA_ERR_NOT_FOUND, "Too many log buckets in flight, "
+                                                                "can't start bucket %u", bucket_id);
+            *record_len = 0;
+            return KAA_ERR_NOT_FOUND;
+        }
+        bucket->begin = offset;
+        bucket->bucket_id = bucket_id;
+        ++i;
+    }
+
+    memcpy(buffer, self->arena + offset + RECORD_HEADER_SIZE, size);
+
+    bucket->end = offset + RECORD_HEADER_SIZE + size;
+    ++bucket->count;
+    bucket->size += size;
+
+    ext_log_range_t *unmarked = &self->ranges[i];
+    --unmarked->count;
+    unmarked->size -= size;
+    if (unmarked->count)
+        unmarked->begin = next_record_offset(self, offset);
+    else
+        remove_range(self, i);
+
+    --self->unmarked_record_count;
+    self->unmarked_occupied_size -= size;
+
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_remove_by_bucket_id(void *context, uint16_t bucket_id)
+{
+    KAA_RETURN_IF_NIL2(context, bucket_id, KAA_ERR_BADPARAM);
+    ext_log_storage_ring_t *self = (ext_log_storage_ring_t *)context;
+
+    bool is_found = false;
+    for (size_t i = 0; i < self->ranges_count; ++i) {
+        ext_log_range_t *range = &self->ranges[i];
+        if (range->bucket_id == bucket_id && !range->is_removed) {
+            range->is_removed = true;
+            self->records_count -= range->count;
+            self->total_occupied_size -= range->size;
+            is_found = true;
+        }
+    }
+
+    if (!is_found)
+        return KAA_ERR_NOT_FOUND;
+
+    compact(self);
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_unmark_by_bucket_id(void *context, uint16_t bucket_id)
+{
+    KAA_RETURN_IF_NIL2(context, bucket_id, KAA_ERR_BADPARAM);
+    ext_log_storage_ring_t *self = (ext_log_storage_ring_t *)context;
+
+    bool is_found = false;
+    for (size_t i = 0; i < self->ranges_count; ++i) {
+        ext_log_range_t *range = &self->ranges[i];
+        if (range->bucket_id == bucket_id && !range->is_removed) {
+            range->bucket_id = 0;
+            self->unmarked_record_count += range->count;
+            self->unmarked_occupied_size += range->size;
+            is_found = true;
+        }
+    }
+
+    if (!is_found)
+        return KAA_ERR_NOT_FOUND;
+
+    compact(self);
+    return KAA_ERR_NONE;
+}
+
+
+
+size_t ext_log_storage_get_total_size(const void *context)
+{
+    KAA_RETURN_IF_NIL(context, 0);
+    return ((ext_log_storage_ring_t *)context)->unmarked_occupied_size;
+}
+
+
+
+size_t ext_log_storage_get_records_count(const void *context)
+{
+    KAA_RETURN_IF_NIL(context, 0);
+    return ((ext_log_storage_ring_t *)context)->unmarked_record_count;
+}
+
+
+
+kaa_error_t ext_log_storage_destroy(void *context)
+{
+    KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
+    KAA_FREE(context);
+    return KAA_ERR_NONE;
+}
+
+#endif
@@ -27,7 +27,11 @@
 #include "../utilities/kaa_mem.h"
 #include "../utilities/kaa_buffer.h"
 #include "../utilities/kaa_log.h"
+#include "../utilities/kaa_timer_queue.h"
 #include "../kaa_protocols/kaa_tcp/kaatcp.h"
+#ifdef KAA_TCP_CHANNEL_COMPRESSION
+#include "../kaa_protocols/kaa_tcp/kaatcp_compression.h"
+#endif
 #include "../platform/ext_system_logger.h"
 #include "../platform/time.h"
 #include "../kaa_platform_common.h"
@@ -79,9 +83,10 @@ typedef struct {
 } kaa_tcp_access_point_t;
 
 typedef struct {
-    uint16_t      keepalive_interval;
-    kaa_time_t    last_sent_keepalive;
-    kaa_time_t    last_receive_keepalive;
+    uint16_t         keepalive_interval;
+    kaa_time_ms_t    last_sent_keepalive;
+    kaa_time_ms_t    last_receive_keepalive;
+    kaa_timer_t      timer;
 } kaa_tcp_keepalive_t ;
 
 typedef struct {
@@ -91,6 +96,12 @@ typedef struct {
     size_t    signature_size;
 } kaa_tcp_encrypt_t;
 
+typedef struct {
+    char      *buffer;
+    size_t    buffer_size;
+    size_t    header_size;
+} kaa_tcp_kaasync_frame_t;
+
 typedef struct {
     kaa_logger_t                   *logger;
     kaa_tcp_channel_state_t        channel_state;
@@ -109,8 +120,15 @@ typedef struct {
     kaa_buffer_t                   *out_buffer;
     kaatcp_parser_t                *parser;
     uint16_t                       message_id;
+    size_t                         inflight_syncs;
+    size_t                         max_inflight_syncs;
     kaa_tcp_keepalive_t            keepalive;
     kaa_tcp_encrypt_t              encryption;
+#ifdef KAA_TCP_CHANNEL_COMPRESSION
+    kaatcp_compression_t           *compression;
+    size_t                         compression_threshold;
+    kaa_tcp_channel_compression_stats_t    compression_stats;
+#endif
 } kaa_tcp_channel_t;
 
 
@@ -146,8 +164,12 @@ static kaa_error_t kaa_tcp_channel_release_access_point(kaa_tcp_channel_t *self)
 static kaa_error_t kaa_tcp_channel_write_pending_services(kaa_tcp_channel_t *self, kaa_service_t *service, size_t services_count);
 static kaa_error_t kaa_tcp_write_buffer(kaa_tcp_channel_t *self);
 static char* kaa_tcp_write_pending_services_allocator_fn(void *context, size_t buffer_size);
+static char* kaa_tcp_kaasync_frame_allocator_fn(void *context, size_t buffer_size);
 static kaa_error_t kaa_tcp_channel_ping(kaa_tcp_channel_t *self);
+static void kaa_tcp_channel_update_keepalive_timer(kaa_tcp_channel_t *self);
+static void kaa_tcp_channel_on_keepalive_timer(void *context);
 static kaa_error_t kaa_tcp_channel_disconnect_internal(kaa_tcp_channel_t *self, kaatcp_disconnect_reason_t return_code);
+static void kaa_tcp_channel_drop_inflight_syncs(kaa_tcp_channel_t *self);
 
 
 
@@ -190,6 +212,7 @@ kaa_error_t kaa_tcp_channel_create(kaa_transport_channel_interface_t *self
     kaa_tcp_channel->channel_state = KAA_TCP_CHANNEL_UNDEFINED;
     kaa_tcp_channel->access_point.state = AP_NOT_SET;
     kaa_tcp_channel->access_point.socket_descriptor = KAA_TCP_SOCKET_NOT_SET;
+    kaa_tcp_channel->max_inflight_syncs = KAA_TCP_CHANNEL_MAX_INFLIGHT_SYNCS;
 
     /*
      * Copies supported services.
@@ -219,15 +242,15 @@ kaa_error_t kaa_tcp_channel_create(kaa_transport_channel_interface_t *self
     /*
      * Creates read/write buffers.
      */
-    error_code = kaa_buffer_create_buffer(&kaa_tcp_channel->in_buffer
-                                        , KAA_TCP_CHANNEL_IN_BUFFER_SIZE);
+    error_code = kaa_buffer_create_circular_buffer(&kaa_tcp_channel->in_buffer
+                                                 , KAA_TCP_CHANNEL_IN_BUFFER_SIZE);
     if (error_code) {
         KAA_LOG_ERROR(logger, error_code, "Failed to create IN buffer for channel");
         kaa_tcp_channel_destroy_context(kaa_tcp_channel);
         return error_code;
     }
-    error_code = kaa_buffer_create_buffer(&kaa_tcp_channel->out_buffer
-                                        , KAA_TCP_CHANNEL_OUT_BUFFER_SIZE);
+    error_code = kaa_buffer_create_circular_buffer(&kaa_tcp_channel->out_buffer
+                                                 , KAA_TCP_CHANNEL_OUT_BUFFER_SIZE);
     if (error_code) {
         KAA_LOG_ERROR(logger, error_code, "Failed to create OUT buffer for channel");
         kaa_tcp_channel_destroy_context(kaa_tcp_channel);
@@ -238,12 +261,22 @@ kaa_error_t kaa_tcp_channel_create(kaa_transport_channel_interface_t *self
      * Initializes keepalive configuration.
      */
     kaa_tcp_channel->keepalive.keepalive_interval = KAA_TCP_CHANNEL_KEEPALIVE;
-    kaa_tcp_channel->keepalive.last_sent_keepalive = KAA_TIME();
+    kaa_tcp_channel->keepalive.last_sent_keepalive = KAA_TIME_MS();
     kaa_tcp_channel->keepalive.last_receive_keepalive = kaa_tcp_channel->keepalive.last_sent_keepalive;
+    kaa_timer_init(&kaa_tcp_channel->keepalive.timer, &kaa_tcp_channel_on_keepalive_timer, kaa_tcp_channel);
 
     KAA_LOG_TRACE(logger, KAA_ERR_NONE, "Kaa TCP channel keepalive is %u",
                                     kaa_tcp_channel->keepalive.keepalive_interval);
 
+#ifdef KAA_TCP_CHANNEL_COMPRESSION
+    if (kaatcp_compression_create(&kaa_tcp_channel->compression)) {
+        KAA_LOG_ERROR(logger, KAA_ERR_NOMEM, "Failed to create Kaa TCP compression context");
+        kaa_tcp_channel_destroy_context(kaa_tcp_channel);
+        return KAA_ERR_NOMEM;
+    }
+    kaa_tcp_channel->compression_threshold = KAA_TCP_CHANNEL_COMPRESSION_THRESHOLD;
+#endif
+
     /*
      * Assigns supported transport protocol id.
      */
@@ -390,6 +423,9 @@ kaa_error_t kaa_tcp_channel_destroy_context(void *context)
     kaa_error_t error_code = KAA_ERR_NONE;
 
     if (channel->parser) {
+        KAA_LOG_DEBUG(channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] parser buffer high-water mark %zu bytes"
+                                                        , channel->access_point.id, kaatcp_parser_get_high_water_mark(channel->parser));
+        kaatcp_parser_deinit(channel->parser);
         KAA_FREE(channel->parser);
         channel->parser = NULL;
     }
@@ -399,6 +435,11 @@ kaa_error_t kaa_tcp_channel_destroy_context(void *context)
     kaa_buffer_destroy(channel->in_buffer);
     kaa_buffer_destroy(channel->out_buffer);
 
+#ifdef KAA_TCP_CHANNEL_COMPRESSION
+    kaatcp_compression_destroy(channel->compression);
+    channel->compression = NULL;
+#endif
+
     if (channel->pending_request_services) {
         KAA_FREE(channel->pending_request_services);
         channel->pending_request_services = NULL;
@@ -453,10 +494,12 @@ kaa_error_t kaa_tcp_channel_set_access_point(void *context, kaa_access_point_t *
     kaa_error_t error_code = KAA_ERR_NONE;
 
     KAA_LOG_TRACE(channel->logger, KAA_ERR_NONE, "Kaa TCP channel setting access point...");
-    if (channel->access_point.state != AP_NOT_SET) {
+    //A failed access point is AP_NOT_SET but still holds its connection data
+    if (channel->access_point.state != AP_NOT_SET || channel->access_point.hostname) {
         KAA_LOG_TRACE(channel->logger, KAA_ERR_NONE, "Kaa TCP channel removing previous access point [0x%08X] ", channel->access_point.id);
         error_code = kaa_tcp_channel_release_access_point(channel);
         KAA_RETURN_IF_ERR(error_code);
+        kaa_tcp_channel_drop_inflight_syncs(channel);
     }
 
     channel->access_point.state = AP_SET;
@@ -608,17 +651,18 @@ bool kaa_tcp_channel_is_ready(kaa_transport_channel_interface_t *self
                 //If there are some pending sync services put W into fd_set
                 if (tcp_channel->pending_request_service_count > 0) {
                     if (is_service_pending(tcp_channel, KAA_SERVICE_BOOTSTRAP)
-                        || tcp_channel->channel_state == KAA_TCP_CHANNEL_AUTHORIZED)
+                        || (tcp_channel->channel_state == KAA_TCP_CHANNEL_AUTHORIZED
+                            && tcp_channel->inflight_syncs < tcp_channel->max_inflight_syncs))
                     {
                         return true;
                     }
                 }
                 //If out buffer have some bytes to transmit
-                char * buf = NULL;
-                size_t buf_size = 0;
-                error_code = kaa_buffer_get_unprocessed_space(tcp_channel->out_buffer, &buf, &buf_size);
+                kaa_buffer_segment_t segments[KAA_BUFFER_MAX_SEGMENTS];
+                size_t segment_count = 0;
+                error_code = kaa_buffer_get_unprocessed_segments(tcp_channel->out_buffer, segments, &segment_count, NULL);
                 KAA_RETURN_IF_ERR(error_code);
-                if (buf_size > 0)
+                if (segment_count > 0)
                     return true;
             }
             break;
@@ -675,14 +719,22 @@ kaa_error_t kaa_tcp_channel_process_event(kaa_transport_channel_interface_t *sel
                             }
                             KAA_RETURN_IF_ERR(error_code);
 
-                            error_code = kaa_buffer_get_unprocessed_space(tcp_channel->in_buffer, &buf, &buf_size);
+                            kaa_buffer_segment_t segments[KAA_BUFFER_MAX_SEGMENTS];
+                            size_t segment_count = 0;
+                            error_code = kaa_buffer_get_unprocessed_segments(tcp_channel->in_buffer, segments, &segment_count, &buf_size);
                             if (error_code) {
                                 KAA_LOG_ERROR(tcp_channel->logger, error_code, "Kaa TCP channel [0x%08X] error get unprocessed %zu bytes"
                                                                                         , tcp_channel->access_point.id, bytes_read);
                             }
                             KAA_RETURN_IF_ERR(error_code);
                             //TODO Modify parser errors code
-                            kaatcp_error_t kaatcp_error_code = kaatcp_parser_process_buffer(tcp_channel->parser, buf, buf_size);
+                            kaatcp_error_t kaatcp_error_code = KAATCP_ERR_NONE;
+                            size_t i = 0;
+                            for (; !kaatcp_error_code && i < segment_count; ++i) {
+                                kaatcp_error_code = kaatcp_parser_process_buffer(tcp_channel->parser
+                                                                               , segments[i].data
+                                                                               , segments[i].size);
+                            }
                             if (kaatcp_error_code) {
                                 error_code = KAA_ERR_TCPCHANNEL_PARSER_ERROR;
                                 KAA_LOG_ERROR(tcp_channel->logger, error_code, "Kaa TCP channel [0x%08X] failed to parse the buffer (kaatcp_error_code=%d)"
@@ -747,9 +799,10 @@ kaa_error_t kaa_tcp_channel_process_event(kaa_transport_channel_interface_t *sel
                     KAA_LOG_TRACE(tcp_channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] disconnecting..."
                                                                                     , tcp_channel->access_point.id);
                     //Check if buffer is empty, close socket.
-                    char *buf = NULL;
+                    kaa_buffer_segment_t segments[KAA_BUFFER_MAX_SEGMENTS];
+                    size_t segment_count = 0;
                     size_t buf_size = 0;
-                    error_code = kaa_buffer_get_unprocessed_space(tcp_channel->out_buffer, &buf, &buf_size);
+                    error_code = kaa_buffer_get_unprocessed_segments(tcp_channel->out_buffer, segments, &segment_count, &buf_size);
                     if (error_code || !buf_size)
                         error_code = kaa_tcp_channel_socket_io_error(tcp_channel);
                     else {
@@ -762,6 +815,10 @@ kaa_error_t kaa_tcp_channel_process_event(kaa_transport_channel_interface_t *sel
                         KAA_LOG_TRACE(tcp_channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] going to sync Bootstrap service"
                                                                                                      , tcp_channel->access_point.id);
                         error_code = kaa_tcp_channel_write_pending_services(tcp_channel, boostrap_service, 1);
+                    } else if (tcp_channel->channel_state == KAA_TCP_CHANNEL_AUTHORIZED
+                            && tcp_channel->inflight_syncs >= tcp_channel->max_inflight_syncs) {
+                        KAA_LOG_TRACE(tcp_channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] waiting for %zu in-flight syncs"
+                                                                    , tcp_channel->access_point.id, tcp_channel->inflight_syncs);
                     } else if (tcp_channel->channel_state == KAA_TCP_CHANNEL_AUTHORIZED) {
                         KAA_LOG_TRACE(tcp_channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] going to sync all services"
                                                                                                 , tcp_channel->access_point.id);
@@ -873,9 +930,9 @@ kaa_error_t kaa_tcp_channel_check_keepalive(kaa_transport_channel_interface_t *s
             return error_code;
         }
 
-        kaa_time_t interval = KAA_TIME() - tcp_channel->keepalive.last_sent_keepalive;
+        kaa_time_ms_t interval = KAA_TIME_MS() - tcp_channel->keepalive.last_sent_keepalive;
 
-        if (interval >= (tcp_channel->keepalive.keepalive_interval / 2)) {
+        if (interval >= (kaa_time_ms_t)tcp_channel->keepalive.keepalive_interval * 1000 / 2) {
             //Send ping request
 
             error_code = kaa_tcp_channel_ping(tcp_channel);
@@ -887,6 +944,14 @@ kaa_error_t kaa_tcp_channel_check_keepalive(kaa_transport_channel_interface_t *s
 
 
 
+bool kaa_tcp_channel_is_access_point_pending(kaa_transport_channel_interface_t *self)
+{
+    KAA_RETURN_IF_NIL2(self, self->context, false);
+    return ((kaa_tcp_channel_t *) self->context)->access_point.state == AP_SET;
+}
+
+
+
 /*
  * Set socket events callbacks.
  */
@@ -916,6 +981,7 @@ kaa_error_t kaa_tcp_channel_set_keepalive_timeout(kaa_transport_channel_interfac
     kaa_tcp_channel_t *tcp_channel = (kaa_tcp_channel_t *)self->context;
 
     tcp_channel->keepalive.keepalive_interval = keepalive;
+    kaa_tcp_channel_update_keepalive_timer(tcp_channel);
 
     KAA_LOG_INFO(tcp_channel->logger,KAA_ERR_NONE,"Kaa TCP channel [0x%08X] keepalive is set to %u seconds"
                                     , tcp_channel->access_point.id, tcp_channel->keepalive.keepalive_interval);
@@ -925,10 +991,60 @@ kaa_error_t kaa_tcp_channel_set_keepalive_timeout(kaa_transport_channel_interfac
 
 
 
+kaa_error_t kaa_tcp_channel_set_max_inflight_syncs(kaa_transport_channel_interface_t *self
+                                                 , size_t max_syncs)
+{
+    KAA_RETURN_IF_NIL3(self, self->context, max_syncs, KAA_ERR_BADPARAM);
+    kaa_tcp_channel_t *tcp_channel = (kaa_tcp_channel_t *)self->context;
+
+    tcp_channel->max_inflight_syncs = max_syncs;
+
+    KAA_LOG_INFO(tcp_channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] in-flight syncs window is set to %zu"
+                                    , tcp_channel->access_point.id, tcp_channel->max_inflight_syncs);
+
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t kaa_tcp_channel_set_compression_threshold(kaa_transport_channel_interface_t *self
+                                                    , size_t threshold)
+{
+    KAA_RETURN_IF_NIL2(self, self->context, KAA_ERR_BADPARAM);
+#ifdef KAA_TCP_CHANNEL_COMPRESSION
+    kaa_tcp_channel_t *tcp_channel = (kaa_tcp_channel_t *)self->context;
+
+    tcp_channel->compression_threshold = threshold;
+
+    KAA_LOG_INFO(tcp_channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] compression threshold is set to %zu bytes"
+                                    , tcp_channel->access_point.id, tcp_channel->compression_threshold);
+
+    return KAA_ERR_NONE;
+#else
+    return KAA_ERR_UNSUPPORTED;
+#endif
+}
+
+
+
+kaa_error_t kaa_tcp_channel_get_compression_stats(kaa_transport_channel_interface_t *self
+                                                , kaa_tcp_channel_compression_stats_t *stats)
+{
+    KAA_RETURN_IF_NIL3(self, self->context, stats, KAA_ERR_BADPARAM);
+#ifdef KAA_TCP_CHANNEL_COMPRESSION
+    *stats = ((kaa_tcp_channel_t *)self->context)->compression_stats;
+    return KAA_ERR_NONE;
+#else
+    return KAA_ERR_UNSUPPORTED;
+#endif
+}
+
+
+
 kaa_error_t kaa_tcp_channel_disconnect(kaa_transport_channel_interface_t  *self)
 {
     KAA_RETURN_IF_NIL2(self, self->context, KAA_ERR_BADPARAM);
-    return kaa_tcp_channel_disconnect_internal((kaa_tcp_channel_t *)self, KAATCP_DISCONNECT_NONE);
+    return kaa_tcp_channel_disconnect_internal((kaa_tcp_channel_t *)self->context, KAATCP_DISCONNECT_NONE);
 }
 
 
@@ -945,9 +1061,10 @@ void kaa_tcp_channel_connack_message_callback(void *context, kaatcp_connack_t me
                                                                                 , channel->access_point.id);
 
             if (channel->keepalive.keepalive_interval > 0) {
-                channel->keepalive.last_receive_keepalive = KAA_TIME();
+                channel->keepalive.last_receive_keepalive = KAA_TIME_MS();
                 channel->keepalive.last_sent_keepalive = channel->keepalive.last_receive_keepalive;
             }
+            kaa_tcp_channel_update_keepalive_timer(channel);
 
         } else {
             KAA_LOG_WARN(channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] authorization failed"
@@ -986,14 +1103,43 @@ void kaa_tcp_channel_kaasync_message_callback(void *context, kaatcp_kaasync_t *m
     KAA_LOG_INFO(channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] KAASYNC message received"
                                                                             , channel->access_point.id);
 
+    if (channel->inflight_syncs > 0)
+        --channel->inflight_syncs;
+
     uint8_t zipped = message->sync_header.flags & KAA_SYNC_ZIPPED_BIT;
     uint8_t encrypted = message->sync_header.flags & KAA_SYNC_ENCRYPTED_BIT;
 
-    if (!zipped && !encrypted) {
-        kaa_error_t error_code =
-                kaa_platform_protocol_process_server_sync(channel->transport_context.platform_protocol
-                                                        , message->sync_request
-                                                        , message->sync_request_size);
+    const char *sync = message->sync_request;
+    size_t sync_size = message->sync_request_size;
+    kaa_error_t error_code = KAA_ERR_NONE;
+
+#ifdef KAA_TCP_CHANNEL_COMPRESSION
+    if (zipped && !encrypted) {
+        kaatcp_error_t inflate_error_code = kaatcp_compression_inflate(channel->compression
+                                                                     , message->sync_request
+                                                                     , message->sync_request_size
+                                                                     , KAATCP_PARSER_MAX_MESSAGE_LENGTH
+                                                                     , &sync
+                                                                     , &sync_size);
+        if (inflate_error_code) {
+            error_code = KAA_ERR_BADDATA;
+        } else {
+            channel->compression_stats.zipped_bytes_received += message->sync_request_size;
+            channel->compression_stats.unzipped_bytes_received += sync_size;
+            KAA_LOG_TRACE(channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] inflated server sync (%zu -> %zu bytes)"
+                                                            , channel->access_point.id, message->sync_request_size, sync_size);
+            zipped = 0;
+        }
+    }
+#endif
+
+    if (error_code) {
+        KAA_LOG_ERROR(channel->logger, error_code, "Kaa TCP channel [0x%08X] failed to inflate server sync"
+                                                                                , channel->access_point.id);
+    } else if (!zipped && !encrypted) {
+        error_code = kaa_platform_protocol_process_server_sync(channel->transport_context.platform_protocol
+                                                             , sync
+                                                             , sync_size);
         if (error_code)
             KAA_LOG_ERROR(channel->logger, error_code, "Kaa TCP channel [0x%08X] failed to process server sync"
                                                                                     , channel->access_point.id);
@@ -1002,8 +1148,6 @@ void kaa_tcp_channel_kaasync_message_callback(void *context, kaatcp_kaasync_t *m
                                                                                         , channel->access_point.id, zipped, encrypted);
     }
 
-    kaatcp_parser_kaasync_destroy(message);
-
     //Check if service supports only bootstrap, after sync it disconnects.
     if (channel->channel_operation_type == KAA_SERVER_BOOTSTRAP) {
         channel->sync_state = KAA_TCP_CHANNEL_SYNC_OP_FINISHED;
@@ -1018,7 +1162,7 @@ void kaa_tcp_channel_pingresp_message_callback(void *context)
     KAA_RETURN_IF_NIL(context,);
     kaa_tcp_channel_t *channel = (kaa_tcp_channel_t *)context;
 
-    channel->keepalive.last_receive_keepalive = KAA_TIME();
+    channel->keepalive.last_receive_keepalive = KAA_TIME_MS();
 
     KAA_LOG_INFO(channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] PING message received"
                                                                     , channel->access_point.id);
@@ -1040,6 +1184,7 @@ kaa_error_t kaa_tcp_channel_socket_io_error(kaa_tcp_channel_t *self)
 
     self->access_point.state = AP_RESOLVED;
     self->channel_state = KAA_TCP_CHANNEL_UNDEFINED;
+    kaa_tcp_channel_update_keepalive_timer(self);
 
 
     if (self->access_point.socket_descriptor >= 0) {
@@ -1070,6 +1215,8 @@ kaa_error_t kaa_tcp_channel_socket_io_error(kaa_tcp_channel_t *self)
 
     self->sync_state = KAA_TCP_CHANNEL_SYNC_OP_UNDEFINED;
 
+    kaa_tcp_channel_drop_inflight_syncs(self);
+
     return error_code;
 }
 
@@ -1098,6 +1245,7 @@ kaa_error_t kaa_tcp_channel_authorize(kaa_tcp_channel_t *self)
     serialize_info.services_count = self->supported_service_count;
     serialize_info.allocator = kaa_tcp_write_pending_services_allocator_fn;
     serialize_info.allocator_context = (void*) self;
+    serialize_info.channel = self;
 
     char *sync_buffer = NULL;
     size_t sync_size = 0;
@@ -1429,6 +1577,8 @@ kaa_error_t kaa_tcp_channel_release_access_point(kaa_tcp_channel_t *self)
                                                                                 , self->access_point.id);
 
     if (self->access_point.state == AP_CONNECTED || self->access_point.state == AP_CONNECTING) {
+        if (self->event_callback)
+            self->event_callback(self->event_context, SOCKET_DISCONNECTED, self->access_point.socket_descriptor);
         ext_tcp_utils_tcp_socket_close(self->access_point.socket_descriptor);
     }
 
@@ -1436,6 +1586,9 @@ kaa_error_t kaa_tcp_channel_release_access_point(kaa_tcp_channel_t *self)
     self->access_point.state = AP_NOT_SET;
     self->access_point.id = 0;
 
+    if (self->transport_context.timer_queue)
+        kaa_timer_queue_cancel(self->transport_context.timer_queue, &self->keepalive.timer);
+
     if (self->access_point.hostname) {
         KAA_FREE(self->access_point.hostname);
         self->access_point.hostname = NULL;
@@ -1467,16 +1620,17 @@ kaa_error_t kaa_tcp_channel_write_pending_services(kaa_tcp_channel_t *self
 
     KAA_RETURN_IF_NIL2(service, services_count, KAA_ERR_NONE);
 
-    char *buffer = NULL;
-    size_t buffer_size = 0;
-    kaa_error_t error_code = kaa_buffer_allocate_space(self->out_buffer, &buffer, &buffer_size);
+    kaa_tcp_kaasync_frame_t frame;
+    memset(&frame, 0, sizeof(kaa_tcp_kaasync_frame_t));
+    kaa_error_t error_code = kaa_buffer_allocate_space(self->out_buffer, &frame.buffer, &frame.buffer_size);
     KAA_RETURN_IF_ERR(error_code);
 
     kaa_serialize_info_t serialize_info;
     serialize_info.services = service;
     serialize_info.services_count = services_count;
-    serialize_info.allocator = kaa_tcp_write_pending_services_allocator_fn;
-    serialize_info.allocator_context = (void*) self;
+    serialize_info.allocator = kaa_tcp_kaasync_frame_allocator_fn;
+    serialize_info.allocator_context = (void*) &frame;
+    serialize_info.channel = self;
 
     char *sync_buffer = NULL;
     size_t sync_size = 0;
@@ -1494,8 +1648,6 @@ kaa_error_t kaa_tcp_channel_write_pending_services(kaa_tcp_channel_t *self
     if (error_code) {
         KAA_LOG_ERROR(self->logger, error_code, "Kaa TCP channel [0x%08X] failed to serialize client sync"
                                                                                     , self->access_point.id);
-        if (sync_buffer)
-            KAA_FREE(sync_buffer);
         return error_code;
     }
 
@@ -1504,6 +1656,31 @@ kaa_error_t kaa_tcp_channel_write_pending_services(kaa_tcp_channel_t *self
     bool zipped = false;
     bool encrypted = false;
 
+#ifdef KAA_TCP_CHANNEL_COMPRESSION
+    if (self->compression_threshold && sync_size >= self->compression_threshold) {
+        const char *zipped_buffer = NULL;
+        size_t zipped_size = 0;
+        kaatcp_error_t deflate_error_code = kaatcp_compression_deflate(self->compression
+                                                                     , sync_buffer
+                                                                     , sync_size
+                                                                     , &zipped_buffer
+                                                                     , &zipped_size);
+        if (deflate_error_code) {
+            KAA_LOG_WARN(self->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] failed to deflate client sync (error_code %d), sending it unzipped"
+                                                                                    , self->access_point.id, deflate_error_code);
+        } else if (zipped_size < sync_size) {
+            KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] deflated client sync (%zu -> %zu bytes)"
+                                                                    , self->access_point.id, sync_size, zipped_size);
+            self->compression_stats.unzipped_bytes_sent += sync_size;
+            self->compression_stats.zipped_bytes_sent += zipped_size;
+            // kaatcp_get_request_kaasync() copies the zipped sync back behind the header.
+            sync_buffer = (char *) zipped_buffer;
+            sync_size = zipped_size;
+            zipped = true;
+        }
+    }
+#endif
+
     kaatcp_error_t parser_error_code = kaatcp_fill_kaasync_message(sync_buffer
                                                                   , sync_size
                                                                   , self->message_id++
@@ -1514,30 +1691,24 @@ kaa_error_t kaa_tcp_channel_write_pending_services(kaa_tcp_channel_t *self
     if (parser_error_code) {
         KAA_LOG_ERROR(self->logger, KAA_ERR_TCPCHANNEL_PARSER_ERROR, "Kaa TCP channel [0x%08X] failed to fill KAASYNC message"
                                                                                                         , self->access_point.id);
-        if (sync_buffer)
-            KAA_FREE(sync_buffer);
         return KAA_ERR_TCPCHANNEL_PARSER_ERROR;
     }
 
-    parser_error_code = kaatcp_get_request_kaasync(&kaa_sync_message, buffer, &buffer_size);
+    /* The client sync is already in place, so only the header is written in front of it. */
+    size_t buffer_size = frame.buffer_size;
+    parser_error_code = kaatcp_get_request_kaasync(&kaa_sync_message, frame.buffer, &buffer_size);
     if (parser_error_code) {
         KAA_LOG_ERROR(self->logger, KAA_ERR_TCPCHANNEL_PARSER_ERROR, "Kaa TCP channel [0x%08X] failed to serialize KAASYNC message"
                                                                                                                 , self->access_point.id);
-        if (sync_buffer)
-            KAA_FREE(sync_buffer);
         return KAA_ERR_TCPCHANNEL_PARSER_ERROR;
     }
 
-    KAA_LOG_INFO(self->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] going to send KAASYNC message (%d bytes)"
+    KAA_LOG_INFO(self->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] going to send KAASYNC message (%zu bytes)"
                                                                                 , self->access_point.id, sync_size);
 
     error_code = kaa_buffer_lock_space(self->out_buffer, buffer_size);
-
-    if (sync_buffer) {
-        KAA_FREE(sync_buffer);
-        sync_buffer = NULL;
-    }
     KAA_RETURN_IF_ERR(error_code);
+    ++self->inflight_syncs;
 
     error_code = kaa_tcp_write_buffer(self);
     return error_code;
@@ -1552,31 +1723,40 @@ kaa_error_t kaa_tcp_write_buffer(kaa_tcp_channel_t *self)
 {
     KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
     kaa_error_t error_code = KAA_ERR_NONE;
-    char *buf = NULL;
+    kaa_buffer_segment_t segments[KAA_BUFFER_MAX_SEGMENTS];
+    size_t segment_count = 0;
     size_t buf_size = 0;
     size_t bytes_written = 0;
-    error_code = kaa_buffer_get_unprocessed_space(self->out_buffer, &buf, &buf_size);
+    error_code = kaa_buffer_get_unprocessed_segments(self->out_buffer, segments, &segment_count, &buf_size);
     KAA_LOG_INFO(self->logger, error_code, "Kaa TCP channel [0x%08X] writing %zu bytes to the socket"
                                                                     , self->access_point.id, buf_size);
     KAA_RETURN_IF_ERR(error_code);
-    if (buf_size > 0) {
+
+    size_t total_written = 0;
+    size_t i = 0;
+    for (; i < segment_count; ++i) {
+        bytes_written = 0;
         ext_tcp_socket_io_errors_t io_error =
                 ext_tcp_utils_tcp_socket_write(self->access_point.socket_descriptor
-                                             , buf
-                                             , buf_size
+                                             , segments[i].data
+                                             , segments[i].size
                                              , &bytes_written);
-        switch (io_error) {
-            case KAA_TCP_SOCK_IO_OK:
-                error_code = kaa_buffer_free_allocated_space(self->out_buffer, bytes_written);
-                KAA_LOG_TRACE(self->logger, error_code, "Kaa TCP channel [0x%08X] %zu bytes were successfully written"
-                                                                                , self->access_point.id, bytes_written);
-                break;
-            default:
-                KAA_LOG_WARN(self->logger, KAA_ERR_SOCKET_ERROR, "Kaa TCP channel [0x%08X] write failed"
-                                                                                    , self->access_point.id);
-                error_code = kaa_tcp_channel_socket_io_error(self);
-                break;
+        if (io_error != KAA_TCP_SOCK_IO_OK) {
+            KAA_LOG_WARN(self->logger, KAA_ERR_SOCKET_ERROR, "Kaa TCP channel [0x%08X] write failed"
+                                                                                , self->access_point.id);
+            return kaa_tcp_channel_socket_io_error(self);
         }
+
+        total_written += bytes_written;
+        // The socket is full, the rest will be written on the next WRITE event.
+        if (bytes_written < segments[i].size)
+            break;
+    }
+
+    if (total_written > 0) {
+        error_code = kaa_buffer_free_allocated_space(self->out_buffer, total_written);
+        KAA_LOG_TRACE(self->logger, error_code, "Kaa TCP channel [0x%08X] %zu bytes were successfully written"
+                                                                        , self->access_point.id, total_written);
     }
 
     return error_code;
@@ -1596,6 +1776,26 @@ char *kaa_tcp_write_pending_services_allocator_fn(void *context, size_t buffer_s
 
 
 
+/*
+ * Allocator for kaa_platform_protocol_serialize_client_sync() which places
+ * the client sync into out_buffer right after the space for the KAASYNC header.
+ */
+char *kaa_tcp_kaasync_frame_allocator_fn(void *context, size_t buffer_size)
+{
+    KAA_RETURN_IF_NIL2(context, buffer_size, NULL);
+    kaa_tcp_kaasync_frame_t *frame = (kaa_tcp_kaasync_frame_t *) context;
+
+    if (kaatcp_get_request_kaasync_header_size(buffer_size, &frame->header_size))
+        return NULL;
+
+    if (frame->header_size + buffer_size > frame->buffer_size)
+        return NULL;
+
+    return frame->buffer + frame->header_size;
+}
+
+
+
 /*
  * Send Ping request message
  */
@@ -1618,7 +1818,8 @@ kaa_error_t kaa_tcp_channel_ping(kaa_tcp_channel_t * self)
 
     error_code = kaa_buffer_lock_space(self->out_buffer, buffer_size);
 
-    self->keepalive.last_sent_keepalive = KAA_TIME();
+    self->keepalive.last_sent_keepalive = KAA_TIME_MS();
+    kaa_tcp_channel_update_keepalive_timer(self);
 
     KAA_LOG_INFO(self->logger,KAA_ERR_NONE,"Kaa TCP channel [0x%08X] going to send PING message (%zu bytes)"
                                                                         , self->access_point.id, buffer_size);
@@ -1670,3 +1871,60 @@ kaa_error_t kaa_tcp_channel_disconnect_internal(kaa_tcp_channel_t  *self
 
     return error_code;
 }
+
+
+
+/*
+ * Arms the keepalive timer to the moment the next PING is due. The timer is
+ * stopped while the channel is not authorized.
+ */
+void kaa_tcp_channel_update_keepalive_timer(kaa_tcp_channel_t *self)
+{
+    kaa_timer_queue_t *timer_queue = self->transport_context.timer_queue;
+    KAA_RETURN_IF_NIL(timer_queue,);
+
+    if (self->keepalive.keepalive_interval == 0 || self->channel_state != KAA_TCP_CHANNEL_AUTHORIZED) {
+        kaa_timer_queue_cancel(timer_queue, &self->keepalive.timer);
+        return;
+    }
+
+    kaa_time_ms_t deadline = self->keepalive.last_sent_keepalive
+                           + (kaa_time_ms_t)self->keepalive.keepalive_interval * 1000 / 2;
+    kaa_error_t error_code = kaa_timer_queue_schedule(timer_queue, &self->keepalive.timer, deadline);
+    if (error_code) {
+        KAA_LOG_ERROR(self->logger, error_code, "Kaa TCP channel [0x%08X] failed to schedule keepalive"
+                                                                        , self->access_point.id);
+    }
+}
+
+
+
+void kaa_tcp_channel_on_keepalive_timer(void *context)
+{
+    kaa_tcp_channel_t *self = (kaa_tcp_channel_t *) context;
+    if (self->channel_state != KAA_TCP_CHANNEL_AUTHORIZED)
+        return;
+
+    if (kaa_tcp_channel_ping(self)) {
+        // Try again in the next keepalive period
+        self->keepalive.last_sent_keepalive = KAA_TIME_MS();
+        kaa_tcp_channel_update_keepalive_timer(self);
+    }
+}
+
+
+
+/*
+ * The server syncs for the client syncs sent over the closed connection will never arrive.
+ */
+void kaa_tcp_channel_drop_inflight_syncs(kaa_tcp_channel_t *self)
+{
+    self->inflight_syncs = 0;
+    KAA_RETURN_IF_NIL(self->transport_context.platform_protocol,);
+
+    kaa_error_t error_code = kaa_platform_protocol_drop_pending_syncs(self->transport_context.platform_protocol, self);
+    if (error_code) {
+        KAA_LOG_WARN(self->logger, error_code, "Kaa TCP channel [0x%08X] failed to drop in-flight syncs"
+                                                                            , self->access_point.id);
+    }
+}
@@ -0,0 +1,839 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @file posix_kaa_client.c
+ *
+ * Kaa client IO loop for Linux. Channel sockets, timers and external
+ * descriptors are all served by a single epoll instance. A channel socket
+ * is only re-registered when its descriptor or its read/write interest
+ * changes, and a timerfd is armed to the next Kaa deadline, so an idle
+ * endpoint sleeps until a keepalive or a log timeout is due. Commands
+ * posted by other threads go through a lock-free queue and the wakeup
+ * eventfd, so the loop sleeps until there is work for it.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "posix_kaa_client.h"
+#include "../../kaa.h"
+#include "../../kaa_common.h"
+#include "../../kaa_event.h"
+#include "../../kaa_channel_manager.h"
+#include "../../collections/kaa_list.h"
+#include "../../utilities/kaa_log.h"
+#include "../../utilities/kaa_mem.h"
+#include "../../utilities/kaa_mpsc_queue.h"
+#include "../../platform/ext_transport_channel.h"
+#include "../../platform/defaults.h"
+#include "../kaa_tcp_channel.h"
+
+
+
+#define KAA_CLIENT_MAX_EPOLL_EVENTS    8
+
+
+
+static kaa_service_t BOOTSTRAP_SERVICE[] = { KAA_SERVICE_BOOTSTRAP };
+static const int BOOTSTRAP_SERVICE_COUNT = sizeof(BOOTSTRAP_SERVICE) / sizeof(kaa_service_t);
+
+static kaa_service_t OPERATIONS_SERVICES[] = { KAA_SERVICE_PROFILE
+                                             , KAA_SERVICE_USER
+#ifndef KAA_DISABLE_FEATURE_EVENTS
+                                             , KAA_SERVICE_EVENT
+#endif
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+                                             , KAA_SERVICE_LOGGING
+#endif
+#ifndef KAA_DISABLE_FEATURE_CONFIGURATION
+                                             , KAA_SERVICE_CONFIGURATION
+#endif
+                                             };
+static const int OPERATIONS_SERVICES_COUNT = sizeof(OPERATIONS_SERVICES) / sizeof(kaa_service_t);
+
+
+
+typedef enum {
+    KAA_CLIENT_SOURCE_CHANNEL = 0,
+    KAA_CLIENT_SOURCE_DEADLINE_TIMER,
+    KAA_CLIENT_SOURCE_PROCESS_TIMER,
+    KAA_CLIENT_SOURCE_WAKEUP,
+    KAA_CLIENT_SOURCE_EXTERNAL
+} kaa_client_source_type_t;
+
+typedef struct {
+    kaa_mpsc_node_t                      node;      /* Must be the first member */
+    kaa_client_command_fn                command;
+    void                                 *context;
+} kaa_client_command_t;
+
+typedef struct {
+    kaa_client_source_type_t             type;
+    int                                  fd;        /* -1 while not registered in epoll */
+    uint32_t                             events;    /* epoll events registered for fd */
+    kaa_client_t                         *client;
+    kaa_transport_channel_interface_t    *channel;
+    kaa_client_fd_handler_fn             handler;
+    void                                 *handler_context;
+} kaa_client_source_t;
+
+struct kaa_client_t {
+    kaa_context_t                        *kaa_context;
+    volatile bool                        operate;
+    int                                  epoll_fd;
+    kaa_transport_channel_interface_t    bootstrap_channel;
+    kaa_transport_channel_interface_t    operations_channel;
+    kaa_client_source_t                  bootstrap_source;
+    kaa_client_source_t                  operations_source;
+    kaa_client_source_t                  deadline_timer;
+    kaa_client_source_t                  process_timer;
+    kaa_client_source_t                  wakeup;
+    kaa_mpsc_queue_t                     commands;
+    size_t                               commands_count;    /* Updated atomically */
+    kaa_time_ms_t                        armed_deadline;    /* 0 while the deadline timer is disarmed */
+    kaa_list_t                           *external_sources;
+    kaa_list_t                           *removed_sources;
+    external_process_fn                  external_process;
+    void                                 *external_process_context;
+};
+
+
+
+static void kaa_client_init_source(kaa_client_t *self, kaa_client_source_t *source, kaa_client_source_type_t type)
+{
+    memset(source, 0, sizeof(kaa_client_source_t));
+    source->type = type;
+    source->fd = -1;
+    source->client = self;
+}
+
+
+
+static kaa_error_t kaa_client_register_fd(kaa_client_t *self, kaa_client_source_t *source, int fd, uint32_t events)
+{
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = source;
+
+    if (epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+        KAA_LOG_ERROR(self->kaa_context->logger, KAA_ERR_BAD_STATE, "Failed to add descriptor %d to epoll: %s"
+                                                                            , fd, strerror(errno));
+        return KAA_ERR_BAD_STATE;
+    }
+
+    source->fd = fd;
+    source->events = events;
+    return KAA_ERR_NONE;
+}
+
+
+
+static void kaa_client_unregister_fd(kaa_client_t *self, kaa_client_source_t *source)
+{
+    if (source->fd < 0)
+        return;
+
+    /* The descriptor may be already closed, in which case epoll dropped it itself */
+    epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+    source->fd = -1;
+    source->events = 0;
+}
+
+
+
+/*
+ * Brings the epoll registration of a channel socket in line with the channel's state.
+ * Nothing is done unless the descriptor or the read/write interest has changed.
+ */
+static kaa_error_t kaa_client_update_channel(kaa_client_t *self, kaa_client_source_t *source)
+{
+    kaa_fd_t fd = KAA_TCP_SOCKET_NOT_SET;
+    kaa_error_t error_code = kaa_tcp_channel_get_descriptor(source->channel, &fd);
+    KAA_RETURN_IF_ERR(error_code);
+
+    uint32_t events = 0;
+    if (fd >= 0) {
+        if (kaa_tcp_channel_is_ready(source->channel, FD_READ))
+            events |= EPOLLIN;
+        if (kaa_tcp_channel_is_ready(source->channel, FD_WRITE))
+            events |= EPOLLOUT;
+    }
+
+    if (fd == source->fd && events == source->events)
+        return KAA_ERR_NONE;
+
+    if (fd == source->fd && events) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.ptr = source;
+
+        if (!epoll_ctl(self->epoll_fd, EPOLL_CTL_MOD, fd, &event)) {
+            source->events = events;
+            return KAA_ERR_NONE;
+        }
+        if (errno != ENOENT) {
+            KAA_LOG_ERROR(self->kaa_context->logger, KAA_ERR_BAD_STATE, "Failed to modify descriptor %d in epoll: %s"
+                                                                                , fd, strerror(errno));
+            return KAA_ERR_BAD_STATE;
+        }
+    }
+
+    kaa_client_unregister_fd(self, source);
+
+    if (fd >= 0 && events)
+        return kaa_client_register_fd(self, source, fd, events);
+
+    return KAA_ERR_NONE;
+}
+
+
+
+/*
+ * Drops the epoll registration before the channel closes its socket,
+ * so a new socket that reuses the same number is never mistaken for it.
+ */
+static kaa_error_t kaa_client_on_channel_event(void *context, kaa_tcp_channel_event_t event_type, kaa_fd_t fd)
+{
+    KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
+    kaa_client_source_t *source = (kaa_client_source_t *) context;
+
+    if (event_type != SOCKET_CONNECTED && source->fd == fd)
+        kaa_client_unregister_fd(source->client, source);
+
+    return KAA_ERR_NONE;
+}
+
+
+
+/*
+ * A new access point is resolved and connected by the keepalive check.
+ * Returns true if the channel still waits for it afterwards, i.e. the connection failed.
+ */
+static bool kaa_client_connect_channel(kaa_client_t *self, kaa_transport_channel_interface_t *channel)
+{
+    if (!kaa_tcp_channel_is_access_point_pending(channel))
+        return false;
+
+    kaa_error_t error_code = kaa_tcp_channel_check_keepalive(channel);
+    if (error_code)
+        KAA_LOG_WARN(self->kaa_context->logger, error_code, "Failed to connect to the new access point");
+
+    return kaa_tcp_channel_is_access_point_pending(channel);
+}
+
+
+
+static kaa_error_t kaa_client_arm_timer(kaa_client_t *self, kaa_client_source_t *timer, time_t period)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = period;
+    spec.it_interval.tv_sec = period;
+
+    if (timerfd_settime(timer->fd, 0, &spec, NULL)) {
+        KAA_LOG_ERROR(self->kaa_context->logger, KAA_ERR_BAD_STATE, "Failed to arm timer: %s", strerror(errno));
+        return KAA_ERR_BAD_STATE;
+    }
+    return KAA_ERR_NONE;
+}
+
+
+
+/*
+ * Arms the deadline timer to the earliest Kaa deadline. KAA_TIME_MS() and
+ * the timer share CLOCK_MONOTONIC, so the deadline is set as absolute time.
+ * The timer is disarmed if nothing is scheduled.
+ */
+static kaa_error_t kaa_client_update_deadline_timer(kaa_client_t *self)
+{
+    kaa_time_ms_t deadline = 0;
+    kaa_error_t error_code = kaa_get_next_deadline(self->kaa_context, &deadline);
+    if (error_code == KAA_ERR_NOT_FOUND)
+        deadline = 0;
+    else if (error_code)
+        return error_code;
+    else if (!deadline)
+        deadline = 1;   /* A zero it_value disarms the timer */
+
+    if (deadline == self->armed_deadline)
+        return KAA_ERR_NONE;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = deadline / 1000;
+    spec.it_value.tv_nsec = (deadline % 1000) * 1000000;
+
+    if (timerfd_settime(self->deadline_timer.fd, TFD_TIMER_ABSTIME, &spec, NULL)) {
+        KAA_LOG_ERROR(self->kaa_context->logger, KAA_ERR_BAD_STATE, "Failed to arm deadline timer: %s", strerror(errno));
+        return KAA_ERR_BAD_STATE;
+    }
+
+    self->armed_deadline = deadline;
+    return KAA_ERR_NONE;
+}
+
+
+
+static void kaa_client_read_counter(kaa_client_t *self, int fd)
+{
+    uint64_t counter = 0;
+    if (read(fd, &counter, sizeof(counter)) < 0 && errno != EAGAIN) {
+        KAA_LOG_WARN(self->kaa_context->logger, KAA_ERR_READ_FAILED, "Failed to read descriptor %d: %s"
+                                                                            , fd, strerror(errno));
+    }
+}
+
+
+
+static kaa_error_t kaa_client_wakeup(kaa_client_t *self)
+{
+    uint64_t counter = 1;
+    if (write(self->wakeup.fd, &counter, sizeof(counter)) < 0 && errno != EAGAIN)
+        return KAA_ERR_WRITE_FAILED;
+    return KAA_ERR_NONE;
+}
+
+
+
+/*
+ * Runs at most a queue capacity worth of commands, so a flood of posts
+ * can't starve the channels. The loop is woken up again for the rest.
+ */
+static void kaa_client_run_commands(kaa_client_t *self)
+{
+    size_t count = 0;
+    kaa_client_command_t *command;
+    while (count < KAA_CLIENT_COMMAND_QUEUE_CAPACITY
+            && (command = (kaa_client_command_t *) kaa_mpsc_queue_pop(&self->commands))) {
+        __atomic_sub_fetch(&self->commands_count, 1, __ATOMIC_RELAXED);
+        command->command(self, command->context);
+        KAA_FREE(command);
+        ++count;
+    }
+
+    if (count == KAA_CLIENT_COMMAND_QUEUE_CAPACITY && __atomic_load_n(&self->commands_count, __ATOMIC_RELAXED))
+        kaa_client_wakeup(self);
+}
+
+
+
+static void kaa_client_process_channel(kaa_client_t *self, kaa_client_source_t *source, uint32_t events)
+{
+    if (source->fd < 0)
+        return;
+
+    kaa_error_t error_code = KAA_ERR_NONE;
+    int fd = source->fd;
+
+    if ((source->events & EPOLLIN) && (events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+        KAA_LOG_DEBUG(self->kaa_context->logger, KAA_ERR_NONE, "Processing IN event for the client socket %d", fd);
+        error_code = kaa_tcp_channel_process_event(source->channel, FD_READ);
+        if (error_code)
+            KAA_LOG_ERROR(self->kaa_context->logger, error_code, "Failed to process IN event for the client socket %d", fd);
+    }
+
+    /* The socket could be closed while reading */
+    if (source->fd != fd)
+        return;
+
+    if ((source->events & EPOLLOUT) && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        KAA_LOG_DEBUG(self->kaa_context->logger, KAA_ERR_NONE, "Processing OUT event for the client socket %d", fd);
+        error_code = kaa_tcp_channel_process_event(source->channel, FD_WRITE);
+        if (error_code)
+            KAA_LOG_ERROR(self->kaa_context->logger, error_code, "Failed to process OUT event for the client socket %d", fd);
+    }
+}
+
+
+
+static void kaa_client_dispatch(kaa_client_t *self, kaa_client_source_t *source, uint32_t events)
+{
+    switch (source->type) {
+        case KAA_CLIENT_SOURCE_CHANNEL:
+            kaa_client_process_channel(self, source, events);
+            break;
+        case KAA_CLIENT_SOURCE_DEADLINE_TIMER:
+            kaa_client_read_counter(self, source->fd);
+            self->armed_deadline = 0;
+            kaa_process_deadlines(self->kaa_context);
+            break;
+        case KAA_CLIENT_SOURCE_PROCESS_TIMER:
+            kaa_client_read_counter(self, source->fd);
+            if (self->external_process)
+                self->external_process(self->external_process_context);
+            break;
+        case KAA_CLIENT_SOURCE_WAKEUP:
+            kaa_client_read_counter(self, source->fd);
+            kaa_client_run_commands(self);
+            break;
+        case KAA_CLIENT_SOURCE_EXTERNAL:
+            if (source->fd >= 0 && source->handler) {
+                uint32_t fd_events = 0;
+                if (events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                    fd_events |= KAA_CLIENT_FD_READ;
+                if (events & EPOLLOUT)
+                    fd_events |= KAA_CLIENT_FD_WRITE;
+                source->handler(source->handler_context, source->fd, fd_events);
+            }
+            break;
+    }
+}
+
+
+
+static kaa_error_t kaa_client_init_channel(kaa_client_t *self
+                                         , kaa_transport_channel_interface_t *channel
+                                         , kaa_client_source_t *source
+                                         , kaa_service_t *services
+                                         , size_t service_count)
+{
+    kaa_error_t error_code = kaa_tcp_channel_create(channel, self->kaa_context->logger, services, service_count);
+    KAA_RETURN_IF_ERR(error_code);
+
+    kaa_client_init_source(self, source, KAA_CLIENT_SOURCE_CHANNEL);
+    source->channel = channel;
+
+    error_code = kaa_tcp_channel_set_socket_events_callback(channel, kaa_client_on_channel_event, source);
+    if (error_code) {
+        channel->destroy(channel->context);
+        channel->context = NULL;
+        return error_code;
+    }
+
+    error_code = kaa_channel_manager_add_transport_channel(self->kaa_context->channel_manager, channel, NULL);
+    if (error_code) {
+        channel->destroy(channel->context);
+        channel->context = NULL;
+    }
+    return error_code;
+}
+
+
+
+static kaa_error_t kaa_client_init_loop(kaa_client_t *self)
+{
+    self->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (self->epoll_fd < 0) {
+        KAA_LOG_ERROR(self->kaa_context->logger, KAA_ERR_BAD_STATE, "Failed to create epoll instance: %s", strerror(errno));
+        return KAA_ERR_BAD_STATE;
+    }
+
+    kaa_client_init_source(self, &self->deadline_timer, KAA_CLIENT_SOURCE_DEADLINE_TIMER);
+    kaa_client_init_source(self, &self->process_timer, KAA_CLIENT_SOURCE_PROCESS_TIMER);
+    kaa_client_init_source(self, &self->wakeup, KAA_CLIENT_SOURCE_WAKEUP);
+
+    int deadline_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int process_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    kaa_error_t error_code = KAA_ERR_NONE;
+    if (deadline_fd < 0 || process_fd < 0 || wakeup_fd < 0) {
+        KAA_LOG_ERROR(self->kaa_context->logger, KAA_ERR_BAD_STATE, "Failed to create timer or event descriptors: %s"
+                                                                                                , strerror(errno));
+        error_code = KAA_ERR_BAD_STATE;
+    }
+
+    if (!error_code)
+        error_code = kaa_client_register_fd(self, &self->deadline_timer, deadline_fd, EPOLLIN);
+    if (!error_code)
+        error_code = kaa_client_register_fd(self, &self->process_timer, process_fd, EPOLLIN);
+    if (!error_code)
+        error_code = kaa_client_register_fd(self, &self->wakeup, wakeup_fd, EPOLLIN);
+
+    if (error_code) {
+        if (deadline_fd >= 0)
+            close(deadline_fd);
+        if (process_fd >= 0)
+            close(process_fd);
+        if (wakeup_fd >= 0)
+            close(wakeup_fd);
+        self->deadline_timer.fd = -1;
+        self->process_timer.fd = -1;
+        self->wakeup.fd = -1;
+    }
+    return error_code;
+}
+
+
+
+kaa_error_t kaa_client_create(kaa_client_t **kaa_client, kaa_client_props_t *props)
+{
+    KAA_RETURN_IF_NIL2(kaa_client, props, KAA_ERR_BADPARAM);
+
+    kaa_client_t *self = (kaa_client_t *) KAA_CALLOC(1, sizeof(kaa_client_t));
+    KAA_RETURN_IF_NIL(self, KAA_ERR_NOMEM);
+
+    self->epoll_fd = -1;
+    self->deadline_timer.fd = -1;
+    self->process_timer.fd = -1;
+    self->wakeup.fd = -1;
+    kaa_mpsc_queue_init(&self->commands);
+
+    kaa_error_t error_code = kaa_init(&self->kaa_context);
+    if (error_code) {
+        KAA_FREE(self);
+        return error_code;
+    }
+
+    error_code = kaa_client_init_loop(self);
+    if (!error_code)
+        error_code = kaa_client_init_channel(self, &self->bootstrap_channel, &self->bootstrap_source
+                                           , BOOTSTRAP_SERVICE, BOOTSTRAP_SERVICE_COUNT);
+    if (!error_code) {
+        if (props->operations_services)
+            error_code = kaa_client_init_channel(self, &self->operations_channel, &self->operations_source
+                                               , props->operations_services, props->operations_service_count);
+        else
+            error_code = kaa_client_init_channel(self, &self->operations_channel, &self->operations_source
+                                               , OPERATIONS_SERVICES, OPERATIONS_SERVICES_COUNT);
+    }
+    if (error_code) {
+        KAA_LOG_ERROR(self->kaa_context->logger, error_code, "Failed to create Kaa client");
+        kaa_client_destroy(self);
+        return error_code;
+    }
+
+    KAA_LOG_INFO(self->kaa_context->logger, KAA_ERR_NONE, "Kaa client created");
+
+    *kaa_client = self;
+    return KAA_ERR_NONE;
+}
+
+
+
+void kaa_client_destroy(kaa_client_t *self)
+{
+    if (!self)
+        return;
+
+    if (self->operations_channel.context)
+        kaa_tcp_channel_disconnect(&self->operations_channel);
+
+    /* Commands which never ran only release their contexts */
+    kaa_client_command_t *command;
+    while ((command = (kaa_client_command_t *) kaa_mpsc_queue_pop(&self->commands))) {
+        command->command(NULL, command->context);
+        KAA_FREE(command);
+    }
+
+    if (self->deadline_timer.fd >= 0)
+        close(self->deadline_timer.fd);
+    if (self->process_timer.fd >= 0)
+        close(self->process_timer.fd);
+    if (self->wakeup.fd >= 0)
+        close(self->wakeup.fd);
+    if (self->epoll_fd >= 0)
+        close(self->epoll_fd);
+
+    kaa_list_destroy(self->external_sources, NULL);
+    kaa_list_destroy(self->removed_sources, NULL);
+
+    /* Channels are owned and destroyed by the channel manager */
+    if (self->kaa_context)
+        kaa_deinit(self->kaa_context);
+
+    KAA_FREE(self);
+}
+
+
+
+kaa_context_t* kaa_client_get_context(kaa_client_t *kaa_client)
+{
+    KAA_RETURN_IF_NIL(kaa_client, NULL);
+    return kaa_client->kaa_context;
+}
+
+
+
+kaa_error_t kaa_client_start(kaa_client_t *kaa_client
+                           , external_process_fn external_process
+                           , void *external_process_context
+                           , time_t max_delay)
+{
+    KAA_RETURN_IF_NIL(kaa_client, KAA_ERR_BADPARAM);
+
+    kaa_client->external_process = external_process;
+    kaa_client->external_process_context = external_process_context;
+    kaa_client->operate = true;
+
+    KAA_LOG_INFO(kaa_client->kaa_context->logger, KAA_ERR_NONE, "Starting Kaa client...");
+
+    kaa_error_t error_code = kaa_start(kaa_client->kaa_context);
+    if (error_code) {
+        KAA_LOG_ERROR(kaa_client->kaa_context->logger, error_code, "Failed to start Kaa workflow");
+        return error_code;
+    }
+
+    if (external_process && max_delay > 0) {
+        error_code = kaa_client_arm_timer(kaa_client, &kaa_client->process_timer, max_delay);
+        KAA_RETURN_IF_ERR(error_code);
+    }
+
+    struct epoll_event events[KAA_CLIENT_MAX_EPOLL_EVENTS];
+
+    while (kaa_client->operate) {
+        bool retry = kaa_client_connect_channel(kaa_client, &kaa_client->bootstrap_channel);
+        retry = kaa_client_connect_channel(kaa_client, &kaa_client->operations_channel) || retry;
+
+        error_code = kaa_client_update_channel(kaa_client, &kaa_client->bootstrap_source);
+        if (!error_code)
+            error_code = kaa_client_update_channel(kaa_client, &kaa_client->operations_source);
+        if (!error_code)
+            error_code = kaa_client_update_deadline_timer(kaa_client);
+        if (error_code)
+            break;
+
+        int timeout = retry ? KAA_CLIENT_ACCESS_POINT_RETRY_DELAY * 1000 : -1;
+        int event_count = epoll_wait(kaa_client->epoll_fd, events, KAA_CLIENT_MAX_EPOLL_EVENTS, timeout);
+        if (event_count < 0) {
+            if (errno == EINTR)
+                continue;
+            KAA_LOG_ERROR(kaa_client->kaa_context->logger, KAA_ERR_BAD_STATE, "Failed to poll descriptors: %s", strerror(errno));
+            error_code = KAA_ERR_BAD_STATE;
+            break;
+        }
+
+        size_t i = 0;
+        for (; i < (size_t) event_count; ++i)
+            kaa_client_dispatch(kaa_client, (kaa_client_source_t *) events[i].data.ptr, events[i].events);
+
+        /* Sources removed by handlers may still be referenced by the current batch */
+        kaa_list_destroy(kaa_client->removed_sources, NULL);
+        kaa_client->removed_sources = NULL;
+    }
+
+    kaa_client_arm_timer(kaa_client, &kaa_client->process_timer, 0);
+    kaa_client_arm_timer(kaa_client, &kaa_client->deadline_timer, 0);
+    kaa_client->armed_deadline = 0;
+
+    KAA_LOG_INFO(kaa_client->kaa_context->logger, KAA_ERR_NONE, "Kaa client stopped");
+
+    return error_code;
+}
+
+
+
+kaa_error_t kaa_client_stop(kaa_client_t *kaa_client)
+{
+    KAA_RETURN_IF_NIL(kaa_client, KAA_ERR_BADPARAM);
+
+    kaa_client->operate = false;
+
+    /* Wake up the loop if it is called from another thread */
+    return kaa_client_wakeup(kaa_client);
+}
+
+
+
+kaa_error_t kaa_client_post(kaa_client_t *kaa_client, kaa_client_command_fn command, void *context)
+{
+    KAA_RETURN_IF_NIL2(kaa_client, command, KAA_ERR_BADPARAM);
+
+    if (__atomic_add_fetch(&kaa_client->commands_count, 1, __ATOMIC_RELAXED) > KAA_CLIENT_COMMAND_QUEUE_CAPACITY) {
+        __atomic_sub_fetch(&kaa_client->commands_count, 1, __ATOMIC_RELAXED);
+        return KAA_ERR_BUFFER_IS_NOT_ENOUGH;
+    }
+
+    kaa_client_command_t *node = (kaa_client_command_t *) KAA_MALLOC(sizeof(kaa_client_command_t));
+    if (!node) {
+        __atomic_sub_fetch(&kaa_client->commands_count, 1, __ATOMIC_RELAXED);
+        return KAA_ERR_NOMEM;
+    }
+
+    node->command = command;
+    node->context = context;
+    kaa_mpsc_queue_push(&kaa_client->commands, &node->node);
+
+    /* The command is queued anyway, a failed wakeup only delays it until the next one */
+    kaa_client_wakeup(kaa_client);
+    return KAA_ERR_NONE;
+}
+
+
+
+#ifndef KAA_DISABLE_FEATURE_EVENTS
+typedef struct {
+    char               *data;
+    size_t             data_size;
+    bool               has_target;
+    kaa_endpoint_id    target;
+    char               fqn[];
+} kaa_client_posted_event_t;
+
+static void kaa_client_send_posted_event(kaa_client_t *self, void *context)
+{
+    kaa_client_posted_event_t *event = (kaa_client_posted_event_t *) context;
+    if (self) {
+        kaa_error_t error_code = kaa_event_manager_send_event(self->kaa_context->event_manager, event->fqn
+                                                            , event->data, event->data_size
+                                                            , event->has_target ? event->target : NULL);
+        /* On success the event manager owns the data */
+        if (!error_code)
+            event->data = NULL;
+        else
+            KAA_LOG_ERROR(self->kaa_context->logger, error_code, "Failed to send posted event \"%s\"", event->fqn);
+    }
+    if (event->data)
+        KAA_FREE(event->data);
+    KAA_FREE(event);
+}
+
+kaa_error_t kaa_client_post_event(kaa_client_t *kaa_client, const char *fqn
+                                , const char *event_data, size_t event_data_size
+                                , kaa_endpoint_id_p target)
+{
+    KAA_RETURN_IF_NIL2(kaa_client, fqn, KAA_ERR_BADPARAM);
+
+    size_t fqn_size = strlen(fqn) + 1;
+    kaa_client_posted_event_t *event = (kaa_client_posted_event_t *) KAA_MALLOC(sizeof(kaa_client_posted_event_t) + fqn_size);
+    KAA_RETURN_IF_NIL(event, KAA_ERR_NOMEM);
+
+    memcpy(event->fqn, fqn, fqn_size);
+    event->data = NULL;
+    event->data_size = 0;
+    event->has_target = target != NULL;
+    if (target)
+        memcpy(event->target, target, KAA_ENDPOINT_ID_LENGTH);
+
+    if (event_data && event_data_size) {
+        event->data = (char *) KAA_MALLOC(event_data_size);
+        if (!event->data) {
+            KAA_FREE(event);
+            return KAA_ERR_NOMEM;
+        }
+        memcpy(event->data, event_data, event_data_size);
+        event->data_size = event_data_size;
+    }
+
+    kaa_error_t error_code = kaa_client_post(kaa_client, kaa_client_send_posted_event, event);
+    if (error_code)
+        kaa_client_send_posted_event(NULL, event);
+    return error_code;
+}
+#endif
+
+
+
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+static void kaa_client_add_posted_log_record(kaa_client_t *self, void *context)
+{
+    kaa_user_log_record_t *record = (kaa_user_log_record_t *) context;
+    if (self) {
+        kaa_error_t error_code = kaa_logging_add_record(self->kaa_context->log_collector, record);
+        if (error_code)
+            KAA_LOG_ERROR(self->kaa_context->logger, error_code, "Failed to add posted log record");
+    }
+    record->destroy(record);
+}
+
+kaa_error_t kaa_client_post_log_record(kaa_client_t *kaa_client, kaa_user_log_record_t *record)
+{
+    KAA_RETURN_IF_NIL2(kaa_client, record, KAA_ERR_BADPARAM);
+    return kaa_client_post(kaa_client, kaa_client_add_posted_log_record, record);
+}
+#endif
+
+
+
+static bool kaa_client_match_fd(void *data, void *context)
+{
+    return ((kaa_client_source_t *) data)->fd == *(int *) context;
+}
+
+
+
+static void kaa_client_keep_source(void *data)
+{
+    (void) data;
+}
+
+
+
+static kaa_error_t kaa_client_push_source(kaa_list_t **list, kaa_client_source_t *source)
+{
+    kaa_list_t *head = *list ? kaa_list_push_front(*list, source) : kaa_list_create(source);
+    KAA_RETURN_IF_NIL(head, KAA_ERR_NOMEM);
+    *list = head;
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t kaa_client_add_fd(kaa_client_t *kaa_client, int fd, uint32_t events
+                            , kaa_client_fd_handler_fn handler, void *context)
+{
+    KAA_RETURN_IF_NIL2(kaa_client, handler, KAA_ERR_BADPARAM);
+    if (fd < 0 || !(events & (KAA_CLIENT_FD_READ | KAA_CLIENT_FD_WRITE)))
+        return KAA_ERR_BADPARAM;
+
+    if (kaa_list_find_next(kaa_client->external_sources, kaa_client_match_fd, &fd))
+        return KAA_ERR_ALREADY_EXISTS;
+
+    kaa_client_source_t *source = (kaa_client_source_t *) KAA_MALLOC(sizeof(kaa_client_source_t));
+    KAA_RETURN_IF_NIL(source, KAA_ERR_NOMEM);
+
+    kaa_client_init_source(kaa_client, source, KAA_CLIENT_SOURCE_EXTERNAL);
+    source->handler = handler;
+    source->handler_context = context;
+
+    uint32_t epoll_events = 0;
+    if (events & KAA_CLIENT_FD_READ)
+        epoll_events |= EPOLLIN;
+    if (events & KAA_CLIENT_FD_WRITE)
+        epoll_events |= EPOLLOUT;
+
+    kaa_error_t error_code = kaa_client_register_fd(kaa_client, source, fd, epoll_events);
+    if (error_code) {
+        KAA_FREE(source);
+        return error_code;
+    }
+
+    error_code = kaa_client_push_source(&kaa_client->external_sources, source);
+    if (error_code) {
+        kaa_client_unregister_fd(kaa_client, source);
+        KAA_FREE(source);
+    }
+    return error_code;
+}
+
+
+
+kaa_error_t kaa_client_remove_fd(kaa_client_t *kaa_client, int fd)
+{
+    KAA_RETURN_IF_NIL(kaa_client, KAA_ERR_BADPARAM);
+
+    kaa_list_t *it = kaa_list_find_next(kaa_client->external_sources, kaa_client_match_fd, &fd);
+    KAA_RETURN_IF_NIL(it, KAA_ERR_NOT_FOUND);
+
+    kaa_client_source_t *source = (kaa_client_source_t *) kaa_list_get_data(it);
+    kaa_client_unregister_fd(kaa_client, source);
+
+    /* On failure the unregistered source stays in the list rather than risk a dangling pointer */
+    kaa_error_t error_code = kaa_client_push_source(&kaa_client->removed_sources, source);
+    KAA_RETURN_IF_ERR(error_code);
+
+    kaa_list_remove_at(&kaa_client->external_sources, it, kaa_client_keep_source);
+    return KAA_ERR_NONE;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @file posix_kaa_client.h
+ * @brief POSIX extensions of the Kaa client. The IO loop is built on epoll,
+ * so an application may register its own descriptors and have them served
+ * by the same loop instead of running a second one. Other threads hand work
+ * over to the loop through a lock-free command queue.
+ */
+
+#ifndef POSIX_KAA_CLIENT_H_
+#define POSIX_KAA_CLIENT_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include "../../kaa_error.h"
+#include "../../kaa_common.h"
+#include "../../kaa_context.h"
+#include "../../platform/kaa_client.h"
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+#include "../../kaa_logging.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KAA_CLIENT_FD_READ     0x01
+#define KAA_CLIENT_FD_WRITE    0x02
+
+/**
+ * @brief Called from the Kaa client IO loop when an external descriptor is ready.
+ *
+ * @param[in]   context    Callback's context
+ * @param[in]   fd         The descriptor
+ * @param[in]   events     KAA_CLIENT_FD_READ and/or KAA_CLIENT_FD_WRITE
+ */
+typedef void (*kaa_client_fd_handler_fn)(void *context, int fd, uint32_t events);
+
+/**
+ * @brief Adds an external descriptor to the Kaa client IO loop.
+ *
+ * The handler is called from @link kaa_client_start @endlink whenever
+ * the descriptor is ready for one of the requested events. Kaa SDK calls
+ * made from the handler are safe.
+ *
+ * @param[in]   kaa_client    Pointer to a Kaa client.
+ * @param[in]   fd            The descriptor.
+ * @param[in]   events        KAA_CLIENT_FD_READ and/or KAA_CLIENT_FD_WRITE.
+ * @param[in]   handler       The readiness handler.
+ * @param[in]   context       The handler's context.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_client_add_fd(kaa_client_t *kaa_client, int fd, uint32_t events
+                            , kaa_client_fd_handler_fn handler, void *context);
+
+/**
+ * @brief Removes an external descriptor from the Kaa client IO loop.
+ *
+ * @param[in]   kaa_client    Pointer to a Kaa client.
+ * @param[in]   fd            The descriptor previously added by @link kaa_client_add_fd @endlink.
+ *
+ * @return Error code. KAA_ERR_NOT_FOUND if the descriptor is not registered.
+ */
+kaa_error_t kaa_client_remove_fd(kaa_client_t *kaa_client, int fd);
+
+/**
+ * @brief Command run by the Kaa client IO loop.
+ *
+ * @param[in]   kaa_client    The Kaa client. NULL if the command is dropped
+ *                            because the client is destroyed, the command should
+ *                            only release its context then.
+ * @param[in]   context       Command's context
+ */
+typedef void (*kaa_client_command_fn)(kaa_client_t *kaa_client, void *context);
+
+/**
+ * @brief Queues a command to be run by the Kaa client IO loop.
+ *
+ * Thread-safe and lock-free, may be called from any thread. The loop is woken up
+ * and runs the commands in the order they were posted by each thread. Commands
+ * posted before @link kaa_client_start @endlink are run once the loop starts.
+ *
+ * @param[in]   kaa_client    Pointer to a Kaa client.
+ * @param[in]   command       The command.
+ * @param[in]   context       The command's context.
+ *
+ * @return Error code. KAA_ERR_BUFFER_IS_NOT_ENOUGH if
+ * @link KAA_CLIENT_COMMAND_QUEUE_CAPACITY @endlink commands are already queued.
+ */
+kaa_error_t kaa_client_post(kaa_client_t *kaa_client, kaa_client_command_fn command, void *context);
+
+#ifndef KAA_DISABLE_FEATURE_EVENTS
+/**
+ * @brief Sends an event from any thread.
+ *
+ * The FQN, the data and the target are copied, so the caller keeps its buffers.
+ * The event is passed to the event manager by the IO loop, errors are logged there.
+ *
+ * @param[in]   kaa_client         Pointer to a Kaa client.
+ * @param[in]   fqn                Fully-qualified name of the event (null-terminated string).
+ * @param[in]   event_data         Serialized event data. May be NULL.
+ * @param[in]   event_data_size    Size of the event data.
+ * @param[in]   target             Target endpoint. NULL to broadcast the event.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_client_post_event(kaa_client_t *kaa_client, const char *fqn
+                                , const char *event_data, size_t event_data_size
+                                , kaa_endpoint_id_p target);
+#endif
+
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+/**
+ * @brief Adds a log record from any thread.
+ *
+ * The record is owned by the Kaa client from now on: the IO loop adds it to
+ * the log storage and destroys it.
+ *
+ * @param[in]   kaa_client    Pointer to a Kaa client.
+ * @param[in]   record        The log record.
+ *
+ * @return Error code. The caller keeps the record on failure.
+ */
+kaa_error_t kaa_client_post_log_record(kaa_client_t *kaa_client, kaa_user_log_record_t *record);
+#endif
+
+#ifdef __cplusplus
+}      /* extern "C" */
+#endif
+#endif /* POSIX_KAA_CLIENT_H_ */
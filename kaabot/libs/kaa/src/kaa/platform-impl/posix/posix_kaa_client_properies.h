@@ -24,8 +24,13 @@
 #ifndef POSIX_KAA_CLIENT_PROPERIES_H_
 #define POSIX_KAA_CLIENT_PROPERIES_H_
 
+#include <stddef.h>
+#include "../../kaa_common.h"
+
 typedef struct {
         unsigned long max_update_time;
+        kaa_service_t *operations_services;         /* NULL - all the services the SDK is built with */
+        size_t operations_service_count;
 } kaa_client_props_t;
 
 #endif /* POSIX_KAA_CLIENT_PROPERIES_H_ */
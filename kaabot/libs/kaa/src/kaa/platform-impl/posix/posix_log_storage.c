@@ -0,0 +1,727 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The file starts with two copies of the storage header, which are updated in
+ * turn, so a torn write never loses both. The rest of the file is a circular
+ * area of records. Each record has a header with a sequence number and a CRC-32
+ * of the record, so the recovery walks the records from the head until the first
+ * one which is torn or left from an earlier pass over the file.
+ *
+ * The head saved in the header is flushed before its space is reused, so the
+ * records after it are never overwritten while the file still points at them.
+ */
+
+#ifndef KAA_DISABLE_FEATURE_LOGGING
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "posix_log_storage.h"
+
+#include "../../platform/ext_log_storage.h"
+#include "../../kaa_common.h"
+#include "../../utilities/kaa_mem.h"
+#include "../../utilities/kaa_log.h"
+
+
+
+#define FILE_LOG_STORAGE_MAGIC      0x474F4C4B  /* "KLOG" */
+#define FILE_LOG_STORAGE_VERSION    1
+#define RECORD_MAGIC                0x4345524B  /* "KREC" */
+
+#define RECORD_FLAG_DELIVERED       0x01
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    generation;     /**< The copy with the greater generation is the current one */
+    uint32_t    capacity;       /**< Size of the records area */
+    uint32_t    head;           /**< Offset of the eldest record */
+    uint32_t    head_seq;       /**< Sequence number of the eldest record */
+    uint32_t    checksum;       /**< CRC-32 of the fields above */
+    uint32_t    reserved;
+} file_header_t;
+
+#define RECORDS_OFFSET              (2 * sizeof(file_header_t))
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    seq;            /**< Sequence number, incremented for each record */
+    uint32_t    size;           /**< Size of the record data */
+    uint32_t    checksum;       /**< CRC-32 of the sequence number, the size and the data */
+    uint16_t    bucket_id;      /**< Bucket ID, only valid until the storage is closed */
+    uint16_t    flags;          /**< RECORD_FLAG_DELIVERED */
+} record_header_t;
+
+typedef struct {
+    int                             fd;
+    char                           *map;
+    size_t                          map_size;
+    char                           *records;            /**< Records area */
+    size_t                          capacity;           /**< Size of the records area */
+    size_t                          head;               /**< Offset of the eldest record */
+    size_t                          tail;               /**< Offset past the newest record */
+    size_t                          wrap;               /**< End of the records at the end of the area once the tail wrapped around */
+    bool                            is_wrapped;         /**< The tail is behind the head */
+    uint32_t                        head_seq;           /**< Sequence number of the eldest record */
+    uint32_t                        next_seq;           /**< Sequence number of the next record */
+    uint32_t                        generation;         /**< Generation of the current header copy */
+    bool                            is_head_saved;      /**< The header matches the head */
+    bool                            is_head_synced;     /**< The header on the disk matches the head */
+    size_t                          cursor;             /**< Offset of the first record which may be unmarked */
+    size_t                          cursor_index;       /**< Index of that record, counting from the head */
+    size_t                          reserved;           /**< Offset of the buffer handed out for the next record */
+    bool                            is_reserved;        /**< The next record is serialized right into the file */
+    size_t                          stored_count;       /**< Number of records between the head and the tail */
+    size_t                          records_count;      /**< Number of records, except delivered ones */
+    size_t                          total_occupied_size;/**< Volume occupied by all logs */
+    size_t                          unmarked_occupied_size; /**< Volume occupied by unmarked logs */
+    size_t                          unmarked_record_count;  /**< Number of unmarked logs */
+    uint16_t                        synced_bucket_id;   /**< The last bucket flushed with EXT_LOG_STORAGE_SYNC_PER_BUCKET */
+    ext_log_storage_sync_policy_t   sync_policy;
+    kaa_time_ms_t                   sync_period;
+    kaa_time_ms_t                   last_sync;
+    kaa_logger_t                   *logger;             /**< Logger instance */
+} ext_log_storage_file_t;
+
+
+
+/**
+ * @brief Destroys the instance of the file log storage. The records are flushed to the disk.
+ *
+ * @param[in]   context The log storage context.
+ * @return    Error code.
+ */
+kaa_error_t ext_log_storage_destroy(void *context);
+
+
+
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *) data;
+    crc = ~crc;
+    while (size--) {
+        crc ^= *bytes++;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+
+
+static uint32_t record_checksum(const record_header_t *header)
+{
+    uint32_t crc = crc32_update(0, &header->seq, sizeof(header->seq));
+    crc = crc32_update(crc, &header->size, sizeof(header->size));
+    return crc32_update(crc, header + 1, header->size);
+}
+
+
+
+static size_t record_footprint(size_t size)
+{
+    return (sizeof(record_header_t) + size + 3) & ~(size_t) 3;
+}
+
+
+
+static record_header_t *record_at(ext_log_storage_file_t *self, size_t offset)
+{
+    return (record_header_t *) (self->records + offset);
+}
+
+
+
+static size_t next_record_offset(ext_log_storage_file_t *self, size_t offset)
+{
+    offset += record_footprint(record_at(self, offset)->size);
+    return (self->is_wrapped && offset == self->wrap) ? 0 : offset;
+}
+
+
+
+static kaa_error_t sync_all(ext_log_storage_file_t *self)
+{
+    if (msync(self->map, self->map_size, MS_SYNC)) {
+        KAA_LOG_ERROR(self->logger, KAA_ERR_WRITE_FAILED, "Failed to flush the log storage");
+        return KAA_ERR_WRITE_FAILED;
+    }
+    self->is_head_synced = self->is_head_saved;
+    self->last_sync = KAA_TIME_MS();
+    return KAA_ERR_NONE;
+}
+
+
+
+static void sync_range(ext_log_storage_file_t *self, size_t offset, size_t size)
+{
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t begin = offset & ~(page_size - 1);
+    if (msync(self->map + begin, offset + size - begin, MS_SYNC))
+        KAA_LOG_ERROR(self->logger, KAA_ERR_WRITE_FAILED, "Failed to flush the log storage");
+}
+
+
+
+static void sync_on_timer(ext_log_storage_file_t *self)
+{
+    if (self->sync_policy == EXT_LOG_STORAGE_SYNC_ON_TIMER && KAA_TIME_MS() - self->last_sync >= self->sync_period)
+        sync_all(self);
+}
+
+
+
+static void save_head(ext_log_storage_file_t *self)
+{
+    if (self->is_head_saved)
+        return;
+
+    ++self->generation;
+    file_header_t *header = (file_header_t *) self->map + (self->generation & 1);
+    header->magic      = FILE_LOG_STORAGE_MAGIC;
+    header->version    = FILE_LOG_STORAGE_VERSION;
+    header->generation = self->generation;
+    header->capacity   = self->capacity;
+    header->head       = self->head;
+    header->head_seq   = self->head_seq;
+    header->reserved   = 0;
+    header->checksum   = crc32_update(0, header, offsetof(file_header_t, checksum));
+
+    self->is_head_saved = true;
+    self->is_head_synced = false;
+}
+
+
+
+static void set_head(ext_log_storage_file_t *self, size_t offset)
+{
+    if (self->is_wrapped && offset == self->wrap) {
+        offset = 0;
+        self->wrap = self->capacity;
+        self->is_wrapped = false;
+    }
+    self->head = offset;
+    self->cursor = offset;
+    self->cursor_index = 0;
+    self->is_head_saved = false;
+}
+
+
+
+static void reset(ext_log_storage_file_t *self)
+{
+    self->tail = 0;
+    self->wrap = self->capacity;
+    self->is_wrapped = false;
+    self->head_seq = self->next_seq;
+    set_head(self, 0);
+}
+
+
+
+/*
+ * Moves the head past the eldest record.
+ */
+static void drop_eldest(ext_log_storage_file_t *self)
+{
+    set_head(self, next_record_offset(self, self->head));
+    ++self->head_seq;
+    if (!--self->stored_count)
+        reset(self);
+}
+
+
+
+/*
+ * Moves the head past the delivered records.
+ */
+static void reclaim(ext_log_storage_file_t *self)
+{
+    while (self->stored_count && (record_at(self, self->head)->flags & RECORD_FLAG_DELIVERED))
+        drop_eldest(self);
+}
+
+
+
+static void evict_eldest(ext_log_storage_file_t *self)
+{
+    record_header_t *record = record_at(self, self->head);
+
+    --self->records_count;
+    self->total_occupied_size -= record->size;
+    if (!record->bucket_id) {
+        --self->unmarked_record_count;
+        self->unmarked_occupied_size -= record->size;
+    }
+
+    drop_eldest(self);
+    reclaim(self);
+}
+
+
+
+static kaa_error_t reserve(ext_log_storage_file_t *self, size_t record_size, size_t *offset)
+{
+    size_t required = record_footprint(record_size);
+    if (required > self->capacity) {
+        KAA_LOG_WARN(self->logger, KAA_ERR_INSUFFICIENT_BUFFER, "Log record of size %zu doesn't fit "
+                                                "into the log storage of size %zu", record_size, self->capacity);
+        return KAA_ERR_INSUFFICIENT_BUFFER;
+    }
+
+    size_t removed_record_count = 0;
+    for (;;) {
+        if (!self->stored_count) {
+            reset(self);
+            *offset = 0;
+            break;
+        }
+
+        if (!self->is_wrapped) {
+            if (self->capacity - self->tail >= required) {
+                *offset = self->tail;
+                break;
+            }
+            if (self->head >= required) {
+                *offset = 0;
+                break;
+            }
+        } else if (self->head - self->tail >= required) {
+            *offset = self->tail;
+            break;
+        }
+
+        evict_eldest(self);
+        ++removed_record_count;
+    }
+
+    if (removed_record_count)
+        KAA_LOG_INFO(self->logger, KAA_ERR_NONE, "%zu records forcibly removed", removed_record_count);
+
+    // The file must not point at the records the new one is going to overwrite.
+    save_head(self);
+    if (!self->is_head_synced) {
+        sync_range(self, 0, RECORDS_OFFSET);
+        self->is_head_synced = true;
+    }
+
+    return KAA_ERR_NONE;
+}
+
+
+
+static const record_header_t *valid_record_at(ext_log_storage_file_t *self, size_t offset, uint32_t seq)
+{
+    if (self->capacity - offset < sizeof(record_header_t))
+        return NULL;
+
+    const record_header_t *record = record_at(self, offset);
+    if (record->magic != RECORD_MAGIC || record->seq != seq)
+        return NULL;
+    if (record_footprint(record->size) > self->capacity - offset)
+        return NULL;
+    if (self->is_wrapped && offset + record_footprint(record->size) > self->head)
+        return NULL;
+    if (record->checksum != record_checksum(record))
+        return NULL;
+    return record;
+}
+
+
+
+static bool load_header(ext_log_storage_file_t *self)
+{
+    const file_header_t *current = NULL;
+    for (size_t i = 0; i < 2; ++i) {
+        const file_header_t *header = (const file_header_t *) self->map + i;
+        if (header->magic != FILE_LOG_STORAGE_MAGIC || header->version != FILE_LOG_STORAGE_VERSION)
+            continue;
+        if (header->checksum != crc32_update(0, header, offsetof(file_header_t, checksum)))
+            continue;
+        if (header->capacity != self->capacity || header->head >= self->capacity)
+            continue;
+        if (!current || header->generation > current->generation)
+            current = header;
+    }
+
+    if (!current)
+        return false;
+
+    self->generation = current->generation;
+    self->head = current->head;
+    self->head_seq = current->head_seq;
+    return true;
+}
+
+
+
+/*
+ * Walks the records from the head and restores them as unmarked.
+ */
+static void recover(ext_log_storage_file_t *self)
+{
+    size_t offset = self->head;
+    uint32_t seq = self->head_seq;
+
+    for (;;) {
+        const record_header_t *record = valid_record_at(self, offset, seq);
+        if (!record && !self->is_wrapped && offset) {
+            // The record may have not fit at the end of the file
+            self->is_wrapped = true;
+            self->wrap = offset;
+            record = valid_record_at(self, 0, seq);
+            if (record) {
+                offset = 0;
+            } else {
+                self->is_wrapped = false;
+                self->wrap = self->capacity;
+            }
+        }
+        if (!record)
+            break;
+
+        record_at(self, offset)->bucket_id = 0;
+        ++self->stored_count;
+        if (!(record->flags & RECORD_FLAG_DELIVERED)) {
+            ++self->records_count;
+            self->total_occupied_size += record->size;
+            ++self->unmarked_record_count;
+            self->unmarked_occupied_size += record->size;
+        }
+
+        offset += record_footprint(record->size);
+        ++seq;
+    }
+
+    self->tail = offset;
+    self->next_seq = seq;
+    self->cursor = self->head;
+    self->cursor_index = 0;
+    self->is_head_saved = true;
+    self->is_head_synced = true;
+
+    reclaim(self);
+    if (!self->stored_count)
+        reset(self);
+}
+
+
+
+kaa_error_t ext_file_log_storage_create(void **log_storage_context_p
+                                      , kaa_logger_t *logger
+                                      , const char *file_name
+                                      , size_t storage_size
+                                      , ext_log_storage_sync_policy_t sync_policy
+                                      , kaa_time_ms_t sync_period)
+{
+    KAA_RETURN_IF_NIL4(log_storage_context_p, logger, file_name, storage_size, KAA_ERR_BADPARAM);
+
+    storage_size &= ~(size_t) 3;
+    if (storage_size < record_footprint(1) || storage_size > UINT32_MAX) {
+        KAA_LOG_WARN(logger, KAA_ERR_BADPARAM, "Failed to create log storage: bad size %zu", storage_size);
+        return KAA_ERR_BADPARAM;
+    }
+
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) KAA_CALLOC(1, sizeof(ext_log_storage_file_t));
+    KAA_RETURN_IF_NIL(self, KAA_ERR_NOMEM);
+
+    self->logger = logger;
+    self->capacity = storage_size;
+    self->wrap = storage_size;
+    self->map_size = RECORDS_OFFSET + storage_size;
+    self->sync_policy = sync_policy;
+    self->sync_period = sync_period;
+    self->last_sync = KAA_TIME_MS();
+
+    self->fd = open(file_name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (self->fd < 0) {
+        KAA_LOG_ERROR(logger, KAA_ERR_READ_FAILED, "Failed to open log storage file '%s'", file_name);
+        KAA_FREE(self);
+        return KAA_ERR_READ_FAILED;
+    }
+
+    struct stat file_stat;
+    bool is_reused = !fstat(self->fd, &file_stat) && (size_t) file_stat.st_size == self->map_size;
+    if (!is_reused && ftruncate(self->fd, self->map_size)) {
+        KAA_LOG_ERROR(logger, KAA_ERR_WRITE_FAILED, "Failed to resize log storage file '%s'", file_name);
+        close(self->fd);
+        KAA_FREE(self);
+        return KAA_ERR_WRITE_FAILED;
+    }
+
+    self->map = (char *) mmap(NULL, self->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, self->fd, 0);
+    if (self->map == MAP_FAILED) {
+        KAA_LOG_ERROR(logger, KAA_ERR_NOMEM, "Failed to map log storage file '%s'", file_name);
+        close(self->fd);
+        KAA_FREE(self);
+        return KAA_ERR_NOMEM;
+    }
+    self->records = self->map + RECORDS_OFFSET;
+
+    if (is_reused && load_header(self)) {
+        recover(self);
+        KAA_LOG_INFO(logger, KAA_ERR_NONE, "Recovered %zu log records from '%s'", self->records_count, file_name);
+    } else {
+        KAA_LOG_INFO(logger, KAA_ERR_NONE, "Initialized log storage file '%s'", file_name);
+        // Records left from an earlier file must not be taken for the new ones.
+        memset(self->map, 0, self->map_size);
+        reset(self);
+        save_head(self);
+        sync_all(self);
+    }
+
+    *log_storage_context_p = (void *) self;
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_file_log_storage_sync(void *context)
+{
+    KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) context;
+    save_head(self);
+    return sync_all(self);
+}
+
+
+
+static bool is_reserved_buffer(ext_log_storage_file_t *self, const kaa_log_record_t *record)
+{
+    return self->is_reserved && record->data == (char *) (record_at(self, self->reserved) + 1);
+}
+
+
+
+kaa_error_t ext_log_storage_allocate_log_record_buffer(void *context, kaa_log_record_t *record)
+{
+    KAA_RETURN_IF_NIL3(context, record, record->size, KAA_ERR_BADPARAM);
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) context;
+
+    kaa_error_t error_code = reserve(self, record->size, &self->reserved);
+    KAA_RETURN_IF_ERR(error_code);
+
+    self->is_reserved = true;
+    record->data = (char *) (record_at(self, self->reserved) + 1);
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_deallocate_log_record_buffer(void *context, kaa_log_record_t *record)
+{
+    KAA_RETURN_IF_NIL3(context, record, record->data, KAA_ERR_BADPARAM);
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) context;
+
+    if (is_reserved_buffer(self, record))
+        self->is_reserved = false;
+    else
+        KAA_FREE(record->data);
+
+    record->data = NULL;
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_add_log_record(void *context, kaa_log_record_t *record)
+{
+    KAA_RETURN_IF_NIL3(context, record, record->data, KAA_ERR_BADPARAM);
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) context;
+
+    size_t offset = self->reserved;
+    if (!is_reserved_buffer(self, record)) {
+        // The record wasn't allocated by the storage, so it is copied into the file.
+        kaa_error_t error_code = reserve(self, record->size, &offset);
+        KAA_RETURN_IF_ERR(error_code);
+        memcpy(record_at(self, offset) + 1, record->data, record->size);
+        KAA_FREE(record->data);
+    }
+    self->is_reserved = false;
+
+    record_header_t *header = record_at(self, offset);
+    header->seq = self->next_seq++;
+    header->size = record->size;
+    header->bucket_id = 0;
+    header->flags = 0;
+    header->checksum = record_checksum(header);
+    header->magic = RECORD_MAGIC;
+
+    if (self->stored_count && !offset && self->tail) {
+        // A cursor which has run up to the old tail goes on with the record at the start of the area.
+        if (self->cursor == self->tail)
+            self->cursor = 0;
+        self->wrap = self->tail;
+        self->is_wrapped = true;
+    }
+    self->tail = offset + record_footprint(record->size);
+
+    ++self->stored_count;
+    ++self->records_count;
+    self->total_occupied_size += record->size;
+    ++self->unmarked_record_count;
+    self->unmarked_occupied_size += record->size;
+
+    if (self->sync_policy == EXT_LOG_STORAGE_SYNC_PER_RECORD)
+        sync_range(self, RECORDS_OFFSET + offset, record_footprint(record->size));
+    else
+        sync_on_timer(self);
+
+    record->data = NULL;
+    record->size = 0;
+
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_write_next_record(void *context
+                                            , char *buffer
+                                            , size_t buffer_len
+                                            , uint16_t bucket_id
+                                            , size_t *record_len)
+{
+    KAA_RETURN_IF_NIL5(context, buffer, buffer_len, bucket_id, record_len, KAA_ERR_BADPARAM);
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) context;
+
+    while (self->cursor_index < self->stored_count) {
+        record_header_t *record = record_at(self, self->cursor);
+        if (!record->bucket_id && !(record->flags & RECORD_FLAG_DELIVERED)) {
+            *record_len = record->size;
+            if (record->size > buffer_len)
+                return KAA_ERR_INSUFFICIENT_BUFFER;
+
+            if (self->sync_policy == EXT_LOG_STORAGE_SYNC_PER_BUCKET && self->synced_bucket_id != bucket_id) {
+                sync_all(self);
+                self->synced_bucket_id = bucket_id;
+            }
+
+            memcpy(buffer, record + 1, record->size);
+            record->bucket_id = bucket_id;
+            --self->unmarked_record_count;
+            self->unmarked_occupied_size -= record->size;
+            return KAA_ERR_NONE;
+        }
+
+        self->cursor = next_record_offset(self, self->cursor);
+        ++self->cursor_index;
+    }
+
+    *record_len = 0;
+    return KAA_ERR_NOT_FOUND;
+}
+
+
+
+kaa_error_t ext_log_storage_remove_by_bucket_id(void *context, uint16_t bucket_id)
+{
+    KAA_RETURN_IF_NIL2(context, bucket_id, KAA_ERR_BADPARAM);
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) context;
+
+    bool is_found = false;
+    size_t offset = self->head;
+    for (size_t i = 0; i < self->stored_count; ++i) {
+        record_header_t *record = record_at(self, offset);
+        if (record->bucket_id == bucket_id && !(record->flags & RECORD_FLAG_DELIVERED)) {
+            record->flags |= RECORD_FLAG_DELIVERED;
+            --self->records_count;
+            self->total_occupied_size -= record->size;
+            is_found = true;
+        }
+        offset = next_record_offset(self, offset);
+    }
+
+    if (!is_found)
+        return KAA_ERR_NOT_FOUND;
+
+    reclaim(self);
+    save_head(self);
+
+    if (self->sync_policy == EXT_LOG_STORAGE_SYNC_ON_TIMER)
+        sync_on_timer(self);
+    else
+        sync_all(self);
+
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_storage_unmark_by_bucket_id(void *context, uint16_t bucket_id)
+{
+    KAA_RETURN_IF_NIL2(context, bucket_id, KAA_ERR_BADPARAM);
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) context;
+
+    bool is_found = false;
+    size_t offset = self->head;
+    for (size_t i = 0; i < self->stored_count; ++i) {
+        record_header_t *record = record_at(self, offset);
+        if (record->bucket_id == bucket_id && !(record->flags & RECORD_FLAG_DELIVERED)) {
+            record->bucket_id = 0;
+            ++self->unmarked_record_count;
+            self->unmarked_occupied_size += record->size;
+            is_found = true;
+        }
+        offset = next_record_offset(self, offset);
+    }
+
+    if (!is_found)
+        return KAA_ERR_NOT_FOUND;
+
+    self->cursor = self->head;
+    self->cursor_index = 0;
+    return KAA_ERR_NONE;
+}
+
+
+
+size_t ext_log_storage_get_total_size(const void *context)
+{
+    KAA_RETURN_IF_NIL(context, 0);
+    return ((ext_log_storage_file_t *) context)->unmarked_occupied_size;
+}
+
+
+
+size_t ext_log_storage_get_records_count(const void *context)
+{
+    KAA_RETURN_IF_NIL(context, 0);
+    return ((ext_log_storage_file_t *) context)->unmarked_record_count;
+}
+
+
+
+kaa_error_t ext_log_storage_destroy(void *context)
+{
+    KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
+    ext_log_storage_file_t *self = (ext_log_storage_file_t *) context;
+
+    save_head(self);
+    sync_all(self);
+    munmap(self->map, self->map_size);
+    close(self->fd);
+    KAA_FREE(self);
+    return KAA_ERR_NONE;
+}
+
+#endif
@@ -19,9 +19,22 @@
 #define POSIX_TIME_H_
 
 #include <time.h>
+#include <stdint.h>
 
 typedef time_t kaa_time_t;
 
 #define KAA_TIME() (kaa_time_t)time(NULL)
 
+/* Monotonic time in milliseconds. Used for all SDK deadlines. */
+typedef uint64_t kaa_time_ms_t;
+
+static inline kaa_time_ms_t posix_get_monotonic_time_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (kaa_time_ms_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#define KAA_TIME_MS() posix_get_monotonic_time_ms()
+
 #endif /* POSIX_TIME_H_ */
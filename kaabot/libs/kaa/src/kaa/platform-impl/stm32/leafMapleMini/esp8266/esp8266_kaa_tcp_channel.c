@@ -363,6 +363,9 @@ kaa_error_t kaa_tcp_channel_destroy_context(void *context)
     KAA_LOG_TRACE(channel->logger, KAA_ERR_NONE, "Kaa TCP channel destroy context");
 
     if (channel->parser) {
+        KAA_LOG_DEBUG(channel->logger, KAA_ERR_NONE, "Kaa TCP channel [0x%08X] parser buffer high-water mark %zu bytes"
+                                                        , channel->access_point.id, kaatcp_parser_get_high_water_mark(channel->parser));
+        kaatcp_parser_deinit(channel->parser);
         KAA_FREE(channel->parser);
         channel->parser = NULL;
     }
@@ -658,8 +661,6 @@ void kaa_tcp_channel_kaasync_message_callback(void *context, kaatcp_kaasync_t *m
                                                                                         , channel->access_point.id, zipped, encrypted);
     }
 
-    kaatcp_parser_kaasync_destroy(message);
-
     //Check if service supports only bootstrap, after sync it disconnects.
     if (channel->channel_operation_type == KAA_SERVER_BOOTSTRAP) {
         channel->sync_state = KAA_TCP_CHANNEL_SYNC_OP_FINISHED;
@@ -725,6 +726,8 @@ kaa_error_t kaa_tcp_channel_socket_io_error(kaa_tcp_channel_t *self)
 
     self->sync_state = KAA_TCP_CHANNEL_SYNC_OP_UNDEFINED;
 
+    kaa_platform_protocol_drop_pending_syncs(self->transport_context.platform_protocol, self);
+
     return error_code;
 }
 
@@ -753,6 +756,7 @@ kaa_error_t kaa_tcp_channel_authorize(kaa_tcp_channel_t *self)
     serialize_info.services_count = self->supported_service_count;
     serialize_info.allocator = kaa_tcp_write_pending_services_allocator_fn;
     serialize_info.allocator_context = (void*) self;
+    serialize_info.channel = self;
 
     char *sync_buffer = NULL;
     size_t sync_size = 0;
@@ -1049,6 +1053,7 @@ kaa_error_t kaa_tcp_channel_write_pending_services(kaa_tcp_channel_t *self
     serialize_info.services_count = services_count;
     serialize_info.allocator = kaa_tcp_write_pending_services_allocator_fn;
     serialize_info.allocator_context = (void*) self;
+    serialize_info.channel = self;
 
     char *sync_buffer = NULL;
     size_t sync_size = 0;
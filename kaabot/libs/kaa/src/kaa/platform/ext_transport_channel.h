@@ -20,6 +20,7 @@
 #include "../kaa_common.h"
 #include "../kaa_platform_protocol.h"
 #include "../kaa_bootstrap_manager.h"
+#include "../utilities/kaa_timer_queue.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,6 +35,7 @@ extern "C" {
 typedef struct {
     kaa_platform_protocol_t    *platform_protocol;
     kaa_bootstrap_manager_t    *bootstrap_manager;
+    kaa_timer_queue_t          *timer_queue;          /**< Deadline timers, may be NULL. */
 } kaa_transport_context_t;
 
 
@@ -35,6 +35,9 @@ CFLAGS += -DSTM32_LEAF_PLATFORM
 # Local rules and targets
 cSRCS_$(d) :=  utilities/kaa_log.c \
                utilities/kaa_buffer.c \
+               utilities/kaa_timer_queue.c \
+               utilities/kaa_spsc_queue.c \
+               utilities/kaa_mpsc_queue.c \
                utilities/kaa_base64.c \
                platform-impl/stm32/leafMapleMini/logger.c \
                platform-impl/stm32/leafMapleMini/esp8266/esp8266.c \
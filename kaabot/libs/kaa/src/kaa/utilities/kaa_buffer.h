@@ -18,6 +18,7 @@
 #ifndef KAA_BUFFER_H_
 #define KAA_BUFFER_H_
 
+#include <stddef.h>
 #include "../kaa_error.h"
 
 #ifdef __cplusplus
@@ -26,11 +27,38 @@ extern "C" {
 
 typedef struct kaa_buffer_t kaa_buffer_t;
 
+/**
+ * The maximum number of contiguous chunks the unprocessed data of a circular
+ * buffer can be split into.
+ */
+#define KAA_BUFFER_MAX_SEGMENTS    2
+
+/**
+ * A contiguous chunk of buffer data. The field order matches POSIX
+ * @c struct @c iovec, so an array of segments can be handed to readv/writev-like
+ * calls by platforms that support scatter/gather I/O.
+ */
+typedef struct {
+    char      *data;
+    size_t    size;
+} kaa_buffer_segment_t;
+
 
 
 kaa_error_t kaa_buffer_create_buffer(kaa_buffer_t **buffer_p
                                    , size_t buffer_size);
 
+/**
+ * @brief Creates a buffer which works in the circular mode.
+ *
+ * Freeing processed bytes only moves the read position, the unprocessed data
+ * are never shifted. As a result, the unprocessed data may be split into two
+ * segments, see @link kaa_buffer_get_unprocessed_segments @endlink.
+ * @link kaa_buffer_allocate_space @endlink always returns a contiguous region.
+ */
+kaa_error_t kaa_buffer_create_circular_buffer(kaa_buffer_t **buffer_p
+                                            , size_t buffer_size);
+
 kaa_error_t kaa_buffer_destroy(kaa_buffer_t *buffer_p);
 
 kaa_error_t kaa_buffer_allocate_space(kaa_buffer_t *buffer_p
@@ -47,6 +75,21 @@ kaa_error_t kaa_buffer_get_unprocessed_space(kaa_buffer_t *buffer_p
                                            , char **buffer
                                            , size_t *available_size);
 
+/**
+ * @brief Retrieves all unprocessed data as a list of contiguous segments.
+ *
+ * @param[in]   buffer_p          The buffer instance.
+ * @param[out]  segments          The array of at least @link KAA_BUFFER_MAX_SEGMENTS @endlink elements.
+ * @param[out]  segment_count     The number of filled segments (0 if there are no unprocessed data).
+ * @param[out]  available_size    The total size of the unprocessed data. May be NULL.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_buffer_get_unprocessed_segments(kaa_buffer_t *buffer_p
+                                              , kaa_buffer_segment_t *segments
+                                              , size_t *segment_count
+                                              , size_t *available_size);
+
 kaa_error_t kaa_buffer_reset(kaa_buffer_t *buffer_p);
 
 #ifdef __cplusplus
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include "kaa_mpsc_queue.h"
+#include "../kaa_common.h"
+
+/*
+ * A producer swaps itself into the head first and links the previous head
+ * to itself afterwards. Between the two steps the chain is broken and the
+ * consumer treats the queue as empty. The stub node keeps the queue non-empty
+ * so the consumer never has to touch the head.
+ */
+
+
+
+void kaa_mpsc_queue_init(kaa_mpsc_queue_t *queue)
+{
+    KAA_RETURN_IF_NIL(queue,);
+    queue->stub.next = NULL;
+    queue->head = &queue->stub;
+    queue->tail = &queue->stub;
+}
+
+
+
+void kaa_mpsc_queue_push(kaa_mpsc_queue_t *queue, kaa_mpsc_node_t *node)
+{
+    KAA_RETURN_IF_NIL2(queue, node,);
+    node->next = NULL;
+    kaa_mpsc_node_t *prev = __atomic_exchange_n(&queue->head, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+
+
+kaa_mpsc_node_t *kaa_mpsc_queue_pop(kaa_mpsc_queue_t *queue)
+{
+    KAA_RETURN_IF_NIL(queue, NULL);
+
+    kaa_mpsc_node_t *tail = queue->tail;
+    kaa_mpsc_node_t *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if (tail == &queue->stub) {
+        if (!next)
+            return NULL;
+        queue->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+
+    /* The tail is the last node unless a producer is half-way */
+    if (tail != __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    /* Put the stub behind the last node so it can be detached */
+    kaa_mpsc_queue_push(queue, &queue->stub);
+
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
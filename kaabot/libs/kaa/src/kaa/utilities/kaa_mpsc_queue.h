@@ -0,0 +1,68 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file kaa_mpsc_queue.h
+ * @brief Lock-free multi-producer/single-consumer queue
+ *
+ * An intrusive linked queue: items embed a @link kaa_mpsc_node_t @endlink,
+ * so pushing never allocates. Any thread may push, only one thread may pop.
+ */
+
+#ifndef KAA_MPSC_QUEUE_H_
+#define KAA_MPSC_QUEUE_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct kaa_mpsc_node_t {
+    struct kaa_mpsc_node_t    *next;
+} kaa_mpsc_node_t;
+
+/**
+ * The queue is embedded into its owner and must be initialized
+ * with @link kaa_mpsc_queue_init @endlink.
+ */
+typedef struct {
+    kaa_mpsc_node_t    *head;     /* The newest node, swapped by the producers */
+    kaa_mpsc_node_t    *tail;     /* The oldest node, owned by the consumer */
+    kaa_mpsc_node_t    stub;
+} kaa_mpsc_queue_t;
+
+
+
+void kaa_mpsc_queue_init(kaa_mpsc_queue_t *queue);
+
+/**
+ * @brief Adds a node. May be called from any thread.
+ */
+void kaa_mpsc_queue_push(kaa_mpsc_queue_t *queue, kaa_mpsc_node_t *node);
+
+/**
+ * @brief Removes the oldest node. Called from the consumer thread only.
+ *
+ * @return The node or NULL if the queue is empty. NULL is also returned while
+ * a concurrent push is half-done, the node shows up once that push returns.
+ */
+kaa_mpsc_node_t *kaa_mpsc_queue_pop(kaa_mpsc_queue_t *queue);
+
+#ifdef __cplusplus
+}      /* extern "C" */
+#endif
+#endif /* KAA_MPSC_QUEUE_H_ */
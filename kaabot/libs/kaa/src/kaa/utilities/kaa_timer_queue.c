@@ -0,0 +1,227 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "kaa_timer_queue.h"
+#include "kaa_mem.h"
+#include "../kaa_common.h"
+
+#define KAA_TIMER_QUEUE_INITIAL_CAPACITY    8
+
+struct kaa_timer_queue_t {
+    kaa_timer_t    **heap;
+    size_t         size;
+    size_t         capacity;
+};
+
+
+
+void kaa_timer_init(kaa_timer_t *timer, kaa_timer_fn callback, void *context)
+{
+    KAA_RETURN_IF_NIL(timer,);
+    timer->deadline = 0;
+    timer->callback = callback;
+    timer->context = context;
+    timer->heap_index = KAA_TIMER_NOT_SCHEDULED;
+}
+
+
+
+bool kaa_timer_is_scheduled(const kaa_timer_t *timer)
+{
+    return timer && timer->heap_index != KAA_TIMER_NOT_SCHEDULED;
+}
+
+
+
+kaa_error_t kaa_timer_queue_create(kaa_timer_queue_t **queue_p)
+{
+    KAA_RETURN_IF_NIL(queue_p, KAA_ERR_BADPARAM);
+
+    kaa_timer_queue_t *queue = (kaa_timer_queue_t *) KAA_MALLOC(sizeof(kaa_timer_queue_t));
+    KAA_RETURN_IF_NIL(queue, KAA_ERR_NOMEM);
+
+    queue->heap = (kaa_timer_t **) KAA_CALLOC(KAA_TIMER_QUEUE_INITIAL_CAPACITY, sizeof(kaa_timer_t *));
+    if (!queue->heap) {
+        KAA_FREE(queue);
+        return KAA_ERR_NOMEM;
+    }
+
+    queue->size = 0;
+    queue->capacity = KAA_TIMER_QUEUE_INITIAL_CAPACITY;
+    *queue_p = queue;
+    return KAA_ERR_NONE;
+}
+
+
+
+void kaa_timer_queue_destroy(kaa_timer_queue_t *queue)
+{
+    KAA_RETURN_IF_NIL(queue,);
+
+    size_t i;
+    for (i = 0; i < queue->size; ++i)
+        queue->heap[i]->heap_index = KAA_TIMER_NOT_SCHEDULED;
+
+    KAA_FREE(queue->heap);
+    KAA_FREE(queue);
+}
+
+
+
+static void kaa_timer_queue_place(kaa_timer_queue_t *queue, kaa_timer_t *timer, size_t index)
+{
+    queue->heap[index] = timer;
+    timer->heap_index = index;
+}
+
+
+
+static void kaa_timer_queue_sift_up(kaa_timer_queue_t *queue, size_t index)
+{
+    kaa_timer_t *timer = queue->heap[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (queue->heap[parent]->deadline <= timer->deadline)
+            break;
+        kaa_timer_queue_place(queue, queue->heap[parent], index);
+        index = parent;
+    }
+    kaa_timer_queue_place(queue, timer, index);
+}
+
+
+
+static void kaa_timer_queue_sift_down(kaa_timer_queue_t *queue, size_t index)
+{
+    kaa_timer_t *timer = queue->heap[index];
+    for (;;) {
+        size_t child = 2 * index + 1;
+        if (child >= queue->size)
+            break;
+        if (child + 1 < queue->size && queue->heap[child + 1]->deadline < queue->heap[child]->deadline)
+            ++child;
+        if (timer->deadline <= queue->heap[child]->deadline)
+            break;
+        kaa_timer_queue_place(queue, queue->heap[child], index);
+        index = child;
+    }
+    kaa_timer_queue_place(queue, timer, index);
+}
+
+
+
+static kaa_error_t kaa_timer_queue_grow(kaa_timer_queue_t *queue)
+{
+    size_t new_capacity = queue->capacity * 2;
+    kaa_timer_t **new_heap = (kaa_timer_t **) KAA_MALLOC(new_capacity * sizeof(kaa_timer_t *));
+    KAA_RETURN_IF_NIL(new_heap, KAA_ERR_NOMEM);
+
+    memcpy(new_heap, queue->heap, queue->size * sizeof(kaa_timer_t *));
+    KAA_FREE(queue->heap);
+    queue->heap = new_heap;
+    queue->capacity = new_capacity;
+    return KAA_ERR_NONE;
+}
+
+
+
+static void kaa_timer_queue_remove_at(kaa_timer_queue_t *queue, size_t index)
+{
+    kaa_timer_t *removed = queue->heap[index];
+    removed->heap_index = KAA_TIMER_NOT_SCHEDULED;
+
+    if (index == --queue->size)
+        return;
+
+    kaa_timer_queue_place(queue, queue->heap[queue->size], index);
+    if (index > 0 && queue->heap[index]->deadline < queue->heap[(index - 1) / 2]->deadline)
+        kaa_timer_queue_sift_up(queue, index);
+    else
+        kaa_timer_queue_sift_down(queue, index);
+}
+
+
+
+kaa_error_t kaa_timer_queue_schedule(kaa_timer_queue_t *queue, kaa_timer_t *timer, kaa_time_ms_t deadline)
+{
+    KAA_RETURN_IF_NIL3(queue, timer, timer->callback, KAA_ERR_BADPARAM);
+
+    if (kaa_timer_is_scheduled(timer)) {
+        kaa_time_ms_t previous = timer->deadline;
+        timer->deadline = deadline;
+        if (deadline < previous)
+            kaa_timer_queue_sift_up(queue, timer->heap_index);
+        else
+            kaa_timer_queue_sift_down(queue, timer->heap_index);
+        return KAA_ERR_NONE;
+    }
+
+    if (queue->size == queue->capacity) {
+        kaa_error_t error = kaa_timer_queue_grow(queue);
+        KAA_RETURN_IF_ERR(error);
+    }
+
+    timer->deadline = deadline;
+    kaa_timer_queue_place(queue, timer, queue->size++);
+    kaa_timer_queue_sift_up(queue, timer->heap_index);
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t kaa_timer_queue_cancel(kaa_timer_queue_t *queue, kaa_timer_t *timer)
+{
+    KAA_RETURN_IF_NIL2(queue, timer, KAA_ERR_BADPARAM);
+
+    if (!kaa_timer_is_scheduled(timer))
+        return KAA_ERR_NONE;
+
+    if (timer->heap_index >= queue->size || queue->heap[timer->heap_index] != timer)
+        return KAA_ERR_BADPARAM;
+
+    kaa_timer_queue_remove_at(queue, timer->heap_index);
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t kaa_timer_queue_get_next_deadline(kaa_timer_queue_t *queue, kaa_time_ms_t *deadline)
+{
+    KAA_RETURN_IF_NIL2(queue, deadline, KAA_ERR_BADPARAM);
+
+    if (!queue->size)
+        return KAA_ERR_NOT_FOUND;
+
+    *deadline = queue->heap[0]->deadline;
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t kaa_timer_queue_process(kaa_timer_queue_t *queue, kaa_time_ms_t now)
+{
+    KAA_RETURN_IF_NIL(queue, KAA_ERR_BADPARAM);
+
+    size_t budget = queue->size;
+    while (budget-- && queue->size && queue->heap[0]->deadline <= now) {
+        kaa_timer_t *timer = queue->heap[0];
+        kaa_timer_queue_remove_at(queue, 0);
+        timer->callback(timer->context);
+    }
+    return KAA_ERR_NONE;
+}
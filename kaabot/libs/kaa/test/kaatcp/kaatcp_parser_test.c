@@ -62,8 +62,6 @@ void kaasync_listener(void *context, kaatcp_kaasync_t *message)
 
     ASSERT_EQUAL(message->sync_request_size, 1);
     ASSERT_EQUAL((uint8_t)message->sync_request[0], 0xFF);
-
-    kaatcp_parser_kaasync_destroy(message);
 }
 
 void ping_listener(void *context)
@@ -100,6 +98,136 @@ void test_kaatcp_parser()
 
     ASSERT_NOT_EQUAL(disconnect_received, 0);
 
+    kaatcp_parser_deinit(&parser);
+
+    KAA_TRACE_OUT(logger);
+}
+
+void test_kaatcp_parser_fragmented_kaasync()
+{
+    KAA_TRACE_IN(logger);
+
+    kaatcp_parser_handlers_t handlers = { NULL, &connack_listener, &disconnect_listener, &kaasync_listener, &ping_listener };
+    kaatcp_parser_t parser;
+
+    kaatcp_error_t rval = kaatcp_parser_init(&parser, &handlers);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+
+    kaasync_received = 0;
+
+    unsigned char kaa_sync_message[] = { 0xF0, 0x0D, 0x00, 0x06, 'K', 'a', 'a', 't', 'c', 'p', 0x01, 0x00, 0x05, 0x14, 0xFF };
+    rval = kaatcp_parser_process_buffer(&parser, (const char *)kaa_sync_message, 8);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+    ASSERT_EQUAL(kaasync_received, 0);
+
+    rval = kaatcp_parser_process_buffer(&parser, (const char *)kaa_sync_message + 8, 7);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+    ASSERT_NOT_EQUAL(kaasync_received, 0);
+
+    kaatcp_parser_deinit(&parser);
+
+    KAA_TRACE_OUT(logger);
+}
+
+void test_kaatcp_parser_payload_growth()
+{
+    KAA_TRACE_IN(logger);
+
+    kaatcp_parser_handlers_t handlers = { NULL, NULL, NULL, NULL, NULL };
+    kaatcp_parser_t parser;
+
+    kaatcp_error_t rval = kaatcp_parser_init(&parser, &handlers);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+    ASSERT_EQUAL(parser.payload_size, KAATCP_PARSER_INITIAL_BUFFER_SIZE);
+
+    size_t payload_length = 3 * KAATCP_PARSER_INITIAL_BUFFER_SIZE;
+    if (payload_length > KAATCP_PARSER_MAX_MESSAGE_LENGTH)
+        payload_length = KAATCP_PARSER_MAX_MESSAGE_LENGTH;
+
+    char header[] = { KAATCP_MESSAGE_UNKNOWN << 4, 0x80 | (payload_length & 0x7F), payload_length >> 7 };
+    rval = kaatcp_parser_process_buffer(&parser, header, sizeof(header));
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+
+    /* Feeding the payload in pieces makes the parser assemble the frame in its own buffer. */
+    char chunk[16];
+    memset(chunk, 0, sizeof(chunk));
+    size_t fed = 0;
+    while (fed < payload_length) {
+        size_t size = (payload_length - fed > sizeof(chunk)) ? sizeof(chunk) : payload_length - fed;
+        rval = kaatcp_parser_process_buffer(&parser, chunk, size);
+        ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+        if (fed == 0) {
+            ASSERT_TRUE(parser.payload_size >= payload_length);
+            ASSERT_TRUE(parser.payload_size <= KAATCP_PARSER_MAX_MESSAGE_LENGTH);
+        }
+        fed += size;
+    }
+
+    ASSERT_EQUAL(parser.state, KAATCP_PARSER_STATE_NONE);
+    ASSERT_TRUE(parser.payload_size >= payload_length);
+    ASSERT_TRUE(kaatcp_parser_get_high_water_mark(&parser) >= payload_length);
+
+    /* The grown buffer is kept until enough small frames went through it. */
+    char empty_frame[] = { KAATCP_MESSAGE_UNKNOWN << 4, 0x00 };
+    size_t i = 0;
+    for (; i < KAATCP_PARSER_SHRINK_AFTER_FRAMES - 1; ++i) {
+        rval = kaatcp_parser_process_buffer(&parser, empty_frame, sizeof(empty_frame));
+        ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+        ASSERT_TRUE(parser.payload_size >= payload_length);
+    }
+    rval = kaatcp_parser_process_buffer(&parser, empty_frame, sizeof(empty_frame));
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+    ASSERT_EQUAL(parser.payload_size, KAATCP_PARSER_INITIAL_BUFFER_SIZE);
+    ASSERT_TRUE(kaatcp_parser_get_high_water_mark(&parser) >= payload_length);
+
+    char too_long_header[] = { 0xF0, 0xFF, 0xFF, 0xFF, 0x7F };
+    rval = kaatcp_parser_process_buffer(&parser, too_long_header, sizeof(too_long_header));
+    ASSERT_EQUAL(rval, KAATCP_ERR_BUFFER_NOT_ENOUGH);
+
+    kaatcp_parser_reset(&parser);
+    char bad_length_header[] = { 0xF0, 0x80, 0x80, 0x80, 0x80, 0x01 };
+    rval = kaatcp_parser_process_buffer(&parser, bad_length_header, sizeof(bad_length_header));
+    ASSERT_EQUAL(rval, KAATCP_ERR_INVALID_PROTOCOL);
+
+    kaatcp_parser_deinit(&parser);
+
+    KAA_TRACE_OUT(logger);
+}
+
+void test_kaatcp_parser_short_frames()
+{
+    KAA_TRACE_IN(logger);
+
+    kaatcp_parser_handlers_t handlers = { NULL, &connack_listener, &disconnect_listener, &kaasync_listener, &ping_listener };
+    kaatcp_parser_t parser;
+
+    kaatcp_error_t rval = kaatcp_parser_init(&parser, &handlers);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+
+    kaasync_received = 0;
+    connack_received = 0;
+    disconnect_received = 0;
+
+    /* The KAASYNC header lacks the flags byte. */
+    unsigned char kaa_sync_message[] = { 0xF0, 0x0B, 0x00, 0x06, 'K', 'a', 'a', 't', 'c', 'p', 0x01, 0x00, 0x05 };
+    rval = kaatcp_parser_process_buffer(&parser, (const char *)kaa_sync_message, sizeof(kaa_sync_message));
+    ASSERT_EQUAL(rval, KAATCP_ERR_INVALID_PROTOCOL);
+    ASSERT_EQUAL(kaasync_received, 0);
+
+    kaatcp_parser_reset(&parser);
+    unsigned char connack_message[] = { 0x20, 0x00 };
+    rval = kaatcp_parser_process_buffer(&parser, (const char *)connack_message, sizeof(connack_message));
+    ASSERT_EQUAL(rval, KAATCP_ERR_INVALID_PROTOCOL);
+    ASSERT_EQUAL(connack_received, 0);
+
+    kaatcp_parser_reset(&parser);
+    unsigned char disconnect_message[] = { 0xE0, 0x01, 0x00 };
+    rval = kaatcp_parser_process_buffer(&parser, (const char *)disconnect_message, sizeof(disconnect_message));
+    ASSERT_EQUAL(rval, KAATCP_ERR_INVALID_PROTOCOL);
+    ASSERT_EQUAL(disconnect_received, 0);
+
+    kaatcp_parser_deinit(&parser);
+
     KAA_TRACE_OUT(logger);
 }
 
@@ -122,5 +250,8 @@ int test_deinit(void)
 KAA_SUITE_MAIN(Log, test_init, test_deinit
        ,
        KAA_TEST_CASE(kaatcp_parser, test_kaatcp_parser)
+       KAA_TEST_CASE(kaatcp_parser_fragmented_kaasync, test_kaatcp_parser_fragmented_kaasync)
+       KAA_TEST_CASE(kaatcp_parser_payload_growth, test_kaatcp_parser_payload_growth)
+       KAA_TEST_CASE(kaatcp_parser_short_frames, test_kaatcp_parser_short_frames)
 )
 
@@ -257,6 +257,68 @@ void test_write_next_log_record()
 
 
 
+static void check_next_log_record(void *storage, uint16_t bucket_id, const char *data)
+{
+    char buffer[4];
+    size_t record_len = 0;
+    kaa_error_t error_code = ext_log_storage_write_next_record(storage, buffer, sizeof(buffer), bucket_id, &record_len);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(record_len, sizeof(buffer));
+    ASSERT_EQUAL(memcmp(buffer, data, sizeof(buffer)), 0);
+}
+
+void test_unmark_keeps_record_order()
+{
+    KAA_TRACE_IN(logger);
+
+    void *storage;
+    kaa_error_t error_code = ext_unlimited_log_storage_create(&storage, logger);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    add_log_record(storage, "AAAA", 4);
+    add_log_record(storage, "BBBB", 4);
+    add_log_record(storage, "CCCC", 4);
+    add_log_record(storage, "DDDD", 4);
+    add_log_record(storage, "EEEE", 4);
+
+    check_next_log_record(storage, 1, "AAAA");
+    check_next_log_record(storage, 2, "BBBB");
+    check_next_log_record(storage, 1, "CCCC");
+
+    /* The records of the failed bucket return in front of the unmarked ones */
+    ASSERT_EQUAL(ext_log_storage_unmark_by_bucket_id(storage, 1), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_unmark_by_bucket_id(storage, 1), KAA_ERR_NOT_FOUND);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 4);
+    ASSERT_EQUAL(ext_log_storage_get_total_size(storage), 16);
+
+    check_next_log_record(storage, 3, "AAAA");
+    check_next_log_record(storage, 3, "CCCC");
+    check_next_log_record(storage, 3, "DDDD");
+
+    /* Merged between the unmarked records */
+    ASSERT_EQUAL(ext_log_storage_unmark_by_bucket_id(storage, 2), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_unmark_by_bucket_id(storage, 3), KAA_ERR_NONE);
+
+    check_next_log_record(storage, 4, "AAAA");
+    check_next_log_record(storage, 4, "BBBB");
+    check_next_log_record(storage, 4, "CCCC");
+    check_next_log_record(storage, 5, "DDDD");
+    check_next_log_record(storage, 5, "EEEE");
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 0);
+
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 4), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 4), KAA_ERR_NOT_FOUND);
+    ASSERT_EQUAL(ext_log_storage_unmark_by_bucket_id(storage, 5), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 2);
+    check_next_log_record(storage, 6, "DDDD");
+
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
 void test_remove_by_bucket_id()
 {
     KAA_TRACE_IN(logger);
@@ -302,15 +364,31 @@ void test_remove_by_bucket_id()
     error_code = ext_log_storage_write_next_record(storage, buffer, buffer_size, bucket_id_3, &record_len);
     ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
 
+    /* Only unmarked records are counted */
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 0);
+    ASSERT_EQUAL(ext_log_storage_get_total_size(storage), 0);
+
+    error_code = ext_log_storage_remove_by_bucket_id(storage, bucket_id_2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
     error_code = ext_log_storage_remove_by_bucket_id(storage, bucket_id_2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+
+    error_code = ext_log_storage_unmark_by_bucket_id(storage, bucket_id_1);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     ASSERT_EQUAL(ext_log_storage_get_records_count(storage), record_count / 2);
     ASSERT_EQUAL(ext_log_storage_get_total_size(storage), (record_count / 2) * data_size);
 
+    for (i = 0; i < record_count / 2; ++i) {
+        error_code = ext_log_storage_write_next_record(storage, buffer, buffer_size, bucket_id_1, &record_len);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    }
+
     error_code = ext_log_storage_remove_by_bucket_id(storage, bucket_id_1);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
+    error_code = ext_log_storage_write_next_record(storage, buffer, buffer_size, bucket_id_3, &record_len);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
     ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 0);
     ASSERT_EQUAL(ext_log_storage_get_total_size(storage), 0);
 
@@ -461,6 +539,7 @@ KAA_SUITE_MAIN(MetaExtension, test_init, test_deinit,
         KAA_TEST_CASE(allocate_log_record_buffer, test_allocate_log_record_buffer)
         KAA_TEST_CASE(add_log_record, test_add_log_record)
         KAA_TEST_CASE(write_next_log_record, test_write_next_log_record)
+        KAA_TEST_CASE(unmark_keeps_record_order, test_unmark_keeps_record_order)
         KAA_TEST_CASE(remove_by_bucket_id, test_remove_by_bucket_id)
         KAA_TEST_CASE(unmark_by_bucket_id, test_unmark_by_bucket_id)
         KAA_TEST_CASE(shrink_to_size, test_shrink_to_size)
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../kaa_test.h"
+
+#include "utilities/kaa_mem.h"
+#include "utilities/kaa_log.h"
+
+#include "platform/ext_log_storage.h"
+
+
+
+extern kaa_error_t ext_ring_log_storage_create(void **log_storage_context_p, kaa_logger_t *logger, size_t storage_size);
+extern kaa_error_t ext_log_storage_destroy(void *context);
+
+
+
+#define TEST_RECORD_SIZE        4
+#define TEST_RECORD_FOOTPRINT   (sizeof(uint32_t) + TEST_RECORD_SIZE)
+
+static kaa_logger_t *logger = NULL;
+
+
+
+static void add_log_record(void *storage, const char *data)
+{
+    kaa_log_record_t record = { NULL, TEST_RECORD_SIZE };
+    kaa_error_t error_code = ext_log_storage_allocate_log_record_buffer(storage, &record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    memcpy(record.data, data, TEST_RECORD_SIZE);
+
+    error_code = ext_log_storage_add_log_record(storage, &record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_NULL(record.data);
+}
+
+static void check_next_log_record(void *storage, uint16_t bucket_id, const char *data)
+{
+    char buffer[TEST_RECORD_SIZE];
+    size_t record_len = 0;
+    kaa_error_t error_code = ext_log_storage_write_next_record(storage, buffer, sizeof(buffer), bucket_id, &record_len);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(record_len, TEST_RECORD_SIZE);
+    ASSERT_EQUAL(memcmp(buffer, data, TEST_RECORD_SIZE), 0);
+}
+
+
+
+void test_create_ring_storage()
+{
+    KAA_TRACE_IN(logger);
+
+    void *storage;
+
+    kaa_error_t error_code = ext_ring_log_storage_create(NULL, logger, 64);
+    ASSERT_NOT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = ext_ring_log_storage_create(&storage, NULL, 64);
+    ASSERT_NOT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = ext_ring_log_storage_create(&storage, logger, sizeof(uint32_t));
+    ASSERT_NOT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = ext_ring_log_storage_create(&storage, logger, 64);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_log_record_t record = { NULL, 64 };
+    error_code = ext_log_storage_allocate_log_record_buffer(storage, &record);
+    ASSERT_EQUAL(error_code, KAA_ERR_INSUFFICIENT_BUFFER);
+
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_write_and_remove()
+{
+    KAA_TRACE_IN(logger);
+
+    void *storage;
+    kaa_error_t error_code = ext_ring_log_storage_create(&storage, logger, 64);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    add_log_record(storage, "AAAA");
+
+    /* A record added from a buffer of its own is copied */
+    kaa_log_record_t record = { (char *) KAA_MALLOC(TEST_RECORD_SIZE), TEST_RECORD_SIZE };
+    ASSERT_NOT_NULL(record.data);
+    memcpy(record.data, "BBBB", TEST_RECORD_SIZE);
+    error_code = ext_log_storage_add_log_record(storage, &record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 2);
+    ASSERT_EQUAL(ext_log_storage_get_total_size(storage), 2 * TEST_RECORD_SIZE);
+
+    char buffer[TEST_RECORD_SIZE];
+    size_t record_len = 0;
+    error_code = ext_log_storage_write_next_record(storage, buffer, TEST_RECORD_SIZE - 1, 1, &record_len);
+    ASSERT_EQUAL(error_code, KAA_ERR_INSUFFICIENT_BUFFER);
+    ASSERT_EQUAL(record_len, TEST_RECORD_SIZE);
+
+    check_next_log_record(storage, 1, "AAAA");
+    check_next_log_record(storage, 1, "BBBB");
+
+    error_code = ext_log_storage_write_next_record(storage, buffer, TEST_RECORD_SIZE, 1, &record_len);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+    ASSERT_EQUAL(record_len, 0);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 0);
+
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 2), KAA_ERR_NOT_FOUND);
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 1), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 1), KAA_ERR_NOT_FOUND);
+
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_wrap_and_evict()
+{
+    KAA_TRACE_IN(logger);
+
+    void *storage;
+    kaa_error_t error_code = ext_ring_log_storage_create(&storage, logger, 3 * TEST_RECORD_FOOTPRINT + 2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    add_log_record(storage, "AAAA");
+    add_log_record(storage, "BBBB");
+    add_log_record(storage, "CCCC");
+
+    check_next_log_record(storage, 1, "AAAA");
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 1), KAA_ERR_NONE);
+
+    /* Placed at the beginning of the arena into the space of the acknowledged record */
+    add_log_record(storage, "DDDD");
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 3);
+
+    /* The eldest record is evicted */
+    add_log_record(storage, "EEEE");
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 3);
+    ASSERT_EQUAL(ext_log_storage_get_total_size(storage), 3 * TEST_RECORD_SIZE);
+
+    check_next_log_record(storage, 2, "CCCC");
+    check_next_log_record(storage, 2, "DDDD");
+    check_next_log_record(storage, 2, "EEEE");
+
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 2), KAA_ERR_NONE);
+
+    /* The empty storage is rewound */
+    kaa_log_record_t record = { NULL, 3 * TEST_RECORD_FOOTPRINT + 2 - sizeof(uint32_t) };
+    error_code = ext_log_storage_allocate_log_record_buffer(storage, &record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ext_log_storage_deallocate_log_record_buffer(storage, &record);
+    ASSERT_NULL(record.data);
+
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_buckets_out_of_order()
+{
+    KAA_TRACE_IN(logger);
+
+    void *storage;
+    kaa_error_t error_code = ext_ring_log_storage_create(&storage, logger, 64);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    add_log_record(storage, "AAAA");
+    add_log_record(storage, "BBBB");
+    add_log_record(storage, "CCCC");
+    add_log_record(storage, "DDDD");
+
+    check_next_log_record(storage, 1, "AAAA");
+    check_next_log_record(storage, 1, "BBBB");
+    check_next_log_record(storage, 2, "CCCC");
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 1);
+
+    /* The later bucket is delivered, the earlier one failed */
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 2), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_unmark_by_bucket_id(storage, 1), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_unmark_by_bucket_id(storage, 1), KAA_ERR_NOT_FOUND);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 3);
+    ASSERT_EQUAL(ext_log_storage_get_total_size(storage), 3 * TEST_RECORD_SIZE);
+
+    add_log_record(storage, "EEEE");
+
+    check_next_log_record(storage, 3, "AAAA");
+    check_next_log_record(storage, 3, "BBBB");
+    check_next_log_record(storage, 3, "DDDD");
+    check_next_log_record(storage, 3, "EEEE");
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 0);
+
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+int test_init()
+{
+    kaa_error_t error = kaa_log_create(&logger, KAA_MAX_LOG_MESSAGE_LENGTH, KAA_MAX_LOG_LEVEL, NULL);
+    if (error || !logger) {
+        return error;
+    }
+
+    return 0;
+}
+
+int test_deinit()
+{
+    kaa_log_destroy(logger);
+    return 0;
+}
+
+
+
+KAA_SUITE_MAIN(RingLogStorage, test_init, test_deinit,
+        KAA_TEST_CASE(create_ring_storage, test_create_ring_storage)
+        KAA_TEST_CASE(write_and_remove, test_write_and_remove)
+        KAA_TEST_CASE(wrap_and_evict, test_wrap_and_evict)
+        KAA_TEST_CASE(buckets_out_of_order, test_buckets_out_of_order)
+)
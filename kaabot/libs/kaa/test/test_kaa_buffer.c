@@ -0,0 +1,175 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kaa_test.h"
+
+#include "utilities/kaa_buffer.h"
+#include <string.h>
+
+#define TEST_BUFFER_SIZE 16
+
+static void test_buffer_write(kaa_buffer_t *buffer, const char *data, size_t data_size)
+{
+    char *buf = NULL;
+    size_t buf_size = 0;
+    kaa_error_t error_code = kaa_buffer_allocate_space(buffer, &buf, &buf_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_TRUE(buf_size >= data_size);
+
+    memcpy(buf, data, data_size);
+    error_code = kaa_buffer_lock_space(buffer, data_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+}
+
+void test_kaa_buffer_linear()
+{
+    kaa_buffer_t *buffer = NULL;
+    kaa_error_t error_code = kaa_buffer_create_buffer(&buffer, TEST_BUFFER_SIZE);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_buffer_write(buffer, "0123456789", 10);
+
+    error_code = kaa_buffer_free_allocated_space(buffer, 4);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    char *buf = NULL;
+    size_t buf_size = 0;
+    error_code = kaa_buffer_get_unprocessed_space(buffer, &buf, &buf_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(buf_size, 6);
+    ASSERT_EQUAL(memcmp(buf, "456789", 6), 0);
+
+    error_code = kaa_buffer_allocate_space(buffer, &buf, &buf_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(buf_size, TEST_BUFFER_SIZE - 6);
+
+    error_code = kaa_buffer_free_allocated_space(buffer, 7);
+    ASSERT_EQUAL(error_code, KAA_ERR_BUFFER_INVALID_SIZE);
+
+    kaa_buffer_destroy(buffer);
+}
+
+void test_kaa_buffer_circular_wrap()
+{
+    kaa_buffer_t *buffer = NULL;
+    kaa_error_t error_code = kaa_buffer_create_circular_buffer(&buffer, TEST_BUFFER_SIZE);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_buffer_write(buffer, "0123456789AB", 12);
+
+    error_code = kaa_buffer_free_allocated_space(buffer, 8);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /* The head region (8 bytes) is larger than the tail one (4 bytes). */
+    char *buf = NULL;
+    size_t buf_size = 0;
+    error_code = kaa_buffer_allocate_space(buffer, &buf, &buf_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(buf_size, 8);
+
+    memcpy(buf, "CDEFG", 5);
+    error_code = kaa_buffer_lock_space(buffer, 5);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_buffer_segment_t segments[KAA_BUFFER_MAX_SEGMENTS];
+    size_t segment_count = 0;
+    size_t available_size = 0;
+    error_code = kaa_buffer_get_unprocessed_segments(buffer, segments, &segment_count, &available_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(segment_count, 2);
+    ASSERT_EQUAL(available_size, 9);
+    ASSERT_EQUAL(segments[0].size, 4);
+    ASSERT_EQUAL(memcmp(segments[0].data, "89AB", 4), 0);
+    ASSERT_EQUAL(segments[1].size, 5);
+    ASSERT_EQUAL(memcmp(segments[1].data, "CDEFG", 5), 0);
+
+    /* Only the gap between the write and the read positions is free now. */
+    error_code = kaa_buffer_allocate_space(buffer, &buf, &buf_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(buf_size, 3);
+
+    error_code = kaa_buffer_free_allocated_space(buffer, 6);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_buffer_get_unprocessed_segments(buffer, segments, &segment_count, &available_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(segment_count, 1);
+    ASSERT_EQUAL(available_size, 3);
+    ASSERT_EQUAL(memcmp(segments[0].data, "EFG", 3), 0);
+
+    error_code = kaa_buffer_free_allocated_space(buffer, 4);
+    ASSERT_EQUAL(error_code, KAA_ERR_BUFFER_INVALID_SIZE);
+
+    error_code = kaa_buffer_free_allocated_space(buffer, 3);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /* An empty buffer is rewound to offer the whole space. */
+    error_code = kaa_buffer_allocate_space(buffer, &buf, &buf_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(buf_size, TEST_BUFFER_SIZE);
+
+    kaa_buffer_destroy(buffer);
+}
+
+void test_kaa_buffer_circular_full()
+{
+    kaa_buffer_t *buffer = NULL;
+    kaa_error_t error_code = kaa_buffer_create_circular_buffer(&buffer, TEST_BUFFER_SIZE);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_buffer_write(buffer, "0123456789ABCDEF", TEST_BUFFER_SIZE);
+
+    char *buf = NULL;
+    size_t buf_size = 0;
+    error_code = kaa_buffer_allocate_space(buffer, &buf, &buf_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(buf_size, 0);
+
+    error_code = kaa_buffer_lock_space(buffer, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_BUFFER_IS_NOT_ENOUGH);
+
+    error_code = kaa_buffer_free_allocated_space(buffer, 2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_buffer_write(buffer, "GH", 2);
+
+    kaa_buffer_segment_t segments[KAA_BUFFER_MAX_SEGMENTS];
+    size_t segment_count = 0;
+    size_t available_size = 0;
+    error_code = kaa_buffer_get_unprocessed_segments(buffer, segments, &segment_count, &available_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(segment_count, 2);
+    ASSERT_EQUAL(available_size, TEST_BUFFER_SIZE);
+    ASSERT_EQUAL(segments[0].data[0], '2');
+    ASSERT_EQUAL(segments[1].data[0], 'G');
+
+    error_code = kaa_buffer_reset(buffer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_buffer_get_unprocessed_segments(buffer, segments, &segment_count, &available_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(segment_count, 0);
+    ASSERT_EQUAL(available_size, 0);
+
+    kaa_buffer_destroy(buffer);
+}
+
+KAA_SUITE_MAIN(Buffer, NULL, NULL
+        ,
+        KAA_TEST_CASE(buffer_linear, test_kaa_buffer_linear)
+        KAA_TEST_CASE(buffer_circular_wrap, test_kaa_buffer_circular_wrap)
+        KAA_TEST_CASE(buffer_circular_full, test_kaa_buffer_circular_full)
+)
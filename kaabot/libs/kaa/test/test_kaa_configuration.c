@@ -46,6 +46,7 @@ extern void kaa_configuration_manager_destroy(kaa_configuration_manager_t *self)
 extern kaa_error_t kaa_configuration_manager_get_size(kaa_configuration_manager_t *self, size_t *expected_size);
 extern kaa_error_t kaa_configuration_manager_request_serialize(kaa_configuration_manager_t *self, kaa_platform_message_writer_t *writer);
 extern kaa_error_t kaa_configuration_manager_handle_server_sync(kaa_configuration_manager_t *self, kaa_platform_message_reader_t *reader, uint32_t extension_options, size_t extension_length);
+extern kaa_error_t kaa_configuration_need_configuration_resync(kaa_configuration_manager_t *self, bool *result);
 
 
 static kaa_logger_t *logger = NULL;
@@ -138,6 +139,67 @@ void test_response()
 }
 
 
+void test_resync_after_update()
+{
+    KAA_TRACE_IN(logger);
+
+    size_t request_size = 0;
+    ASSERT_EQUAL(kaa_configuration_manager_get_size(config_manager, &request_size), KAA_ERR_NONE);
+    char request_buffer[request_size];
+    kaa_platform_message_writer_t *writer = NULL;
+    ASSERT_EQUAL(kaa_platform_message_writer_create(&writer, request_buffer, request_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_configuration_manager_request_serialize(config_manager, writer), KAA_ERR_NONE);
+    kaa_platform_message_writer_destroy(writer);
+
+    bool need_resync = true;
+    ASSERT_EQUAL(kaa_configuration_need_configuration_resync(config_manager, &need_resync), KAA_ERR_NONE);
+    ASSERT_FALSE(need_resync);
+
+    const uint32_t new_seq_n = CONFIG_NEW_SEQ_N + 1;
+    const size_t response_size = kaa_aligned_size_get(KAA_CONFIGURATION_DATA_LENGTH) + sizeof(uint32_t) + sizeof(uint32_t);
+    char response[response_size];
+    char *response_cursor = response;
+
+    *((uint32_t *) response_cursor) = KAA_HTONL(new_seq_n);
+    response_cursor += sizeof(uint32_t);
+
+    *((uint32_t *) response_cursor) = KAA_HTONL(KAA_CONFIGURATION_DATA_LENGTH);
+    response_cursor += sizeof(uint32_t);
+
+    memcpy(response_cursor, KAA_CONFIGURATION_DATA, KAA_CONFIGURATION_DATA_LENGTH);
+
+    kaa_platform_message_reader_t *reader = NULL;
+    ASSERT_EQUAL(kaa_platform_message_reader_create(&reader, response, response_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_configuration_manager_handle_server_sync(config_manager, reader, CONFIG_RESPONSE_FLAGS, response_size), KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    /* The next sync carries the configuration extension with the new sequence number and hash */
+    ASSERT_EQUAL(kaa_configuration_need_configuration_resync(config_manager, &need_resync), KAA_ERR_NONE);
+    ASSERT_TRUE(need_resync);
+
+    ASSERT_EQUAL(kaa_configuration_manager_get_size(config_manager, &request_size), KAA_ERR_NONE);
+    char update_buffer[request_size];
+    ASSERT_EQUAL(kaa_platform_message_writer_create(&writer, update_buffer, request_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_configuration_manager_request_serialize(config_manager, writer), KAA_ERR_NONE);
+
+    char *cursor = writer->begin;
+    ASSERT_EQUAL(*cursor, KAA_CONFIGURATION_EXTENSION_TYPE);
+    cursor += 2 * sizeof(uint32_t);
+
+    ASSERT_EQUAL(KAA_NTOHL(*((uint32_t *) cursor)), new_seq_n);
+    cursor += sizeof(uint32_t);
+
+    kaa_digest check_hash;
+    ext_calculate_sha_hash(KAA_CONFIGURATION_DATA, KAA_CONFIGURATION_DATA_LENGTH, check_hash);
+    ASSERT_EQUAL(memcmp(cursor, check_hash, SHA_1_DIGEST_LENGTH), 0);
+
+    kaa_platform_message_writer_destroy(writer);
+
+    ASSERT_EQUAL(kaa_configuration_need_configuration_resync(config_manager, &need_resync), KAA_ERR_NONE);
+    ASSERT_FALSE(need_resync);
+}
+
+
 #endif
 
 
@@ -182,5 +244,6 @@ KAA_SUITE_MAIN(Log, test_init, test_deinit
        ,
        KAA_TEST_CASE(create_request, test_create_request)
        KAA_TEST_CASE(process_response, test_response)
+       KAA_TEST_CASE(resync_after_update, test_resync_after_update)
 #endif
         )
@@ -25,10 +25,10 @@
 
 #include "kaa_test.h"
 
+#include "kaa_status.h"
 #include "kaa_context.h"
 #include "utilities/kaa_log.h"
 #include "utilities/kaa_mem.h"
-#include "kaa_status.h"
 #include "kaa_channel_manager.h"
 #include "kaa_platform_utils.h"
 #include "platform/sock.h"
@@ -59,6 +59,10 @@ extern kaa_error_t kaa_event_manager_add_event_to_transaction(kaa_event_manager_
 extern kaa_error_t kaa_event_request_get_size(kaa_event_manager_t *self, size_t *expected_size);
 extern kaa_error_t kaa_event_handle_server_sync(kaa_event_manager_t *self, kaa_platform_message_reader_t *reader, uint32_t extension_options, size_t extension_length, size_t request_id);
 extern kaa_error_t kaa_event_request_serialize(kaa_event_manager_t *self, size_t request_id, kaa_platform_message_writer_t *writer);
+extern kaa_error_t kaa_event_on_sync_lost(kaa_event_manager_t *self, size_t request_id);
+extern kaa_error_t kaa_event_need_event_resync(kaa_event_manager_t *self, bool *result);
+extern void        kaa_event_on_connection_lost(kaa_event_manager_t *self);
+extern void        kaa_event_manager_invalidate_listeners_cache(kaa_event_manager_t *self);
 extern kaa_error_t kaa_event_manager_add_on_event_callback(kaa_event_manager_t *self, const char *fqn, kaa_event_callback_t callback);
 
 static int global_events_counter = 0;
@@ -77,6 +81,40 @@ static int test_deinit(void);
 
 
 
+/*
+ * test_event builds the event manager with KAA_TRACE_MEMORY_ALLOCATIONS,
+ * so its allocations can be made to fail. -1 means they never fail.
+ */
+static long allocations_until_failure = -1;
+
+static bool allocation_fails(void)
+{
+    if (allocations_until_failure < 0)
+        return false;
+    return allocations_until_failure-- == 0;
+}
+
+void *kaa_trace_memory_allocs_malloc(size_t s, const char *file, int line)
+{
+    return allocation_fails() ? NULL : malloc(s);
+}
+
+void *kaa_trace_memory_allocs_calloc(size_t n, size_t s, const char *file, int line)
+{
+    return allocation_fails() ? NULL : calloc(n, s);
+}
+
+void kaa_trace_memory_allocs_free(void *p, const char *file, int line)
+{
+    free(p);
+}
+
+void kaa_trace_memory_allocs_set_logger(kaa_logger_t *logger)
+{
+}
+
+
+
 void test_kaa_create_event_manager()
 {
     KAA_TRACE_IN(logger);
@@ -216,6 +254,123 @@ void test_kaa_event_listeners_handle_sync()
     kaa_platform_message_reader_destroy(reader);
 }
 
+static size_t event_listeners_cb_count = 0;
+static size_t event_listeners_failed_cb_count = 0;
+
+static kaa_error_t counting_event_listeners_callback(void *context, const kaa_endpoint_id listeners[], size_t listeners_count)
+{
+    ASSERT_EQUAL(listeners_count, 2);
+    ASSERT_EQUAL(memcmp(listeners[1], endpoint_id2, KAA_ENDPOINT_ID_LENGTH), 0);
+    ++event_listeners_cb_count;
+    return KAA_ERR_NONE;
+}
+
+static kaa_error_t counting_event_listeners_failed_callback(void *context)
+{
+    ++event_listeners_failed_cb_count;
+    return KAA_ERR_NONE;
+}
+
+static void handle_listeners_response(uint16_t request_id, uint16_t result)
+{
+    const uint32_t extension_size = 52;
+    char buffer[extension_size];
+
+    char *cursor = buffer;
+    *cursor = 0; // field id (0)
+    cursor += sizeof(uint16_t);
+    *((uint16_t *) cursor) = KAA_HTONS(1); // responses count = 1
+    cursor += sizeof(uint16_t);
+    *((uint16_t *) cursor) = KAA_HTONS(request_id);
+    cursor += sizeof(uint16_t);
+    *((uint16_t *) cursor) = KAA_HTONS(result);
+    cursor += sizeof(uint16_t);
+    *((uint32_t *) cursor) = KAA_HTONL(2); // listener count = 2
+    cursor += sizeof(uint32_t);
+    memcpy(cursor, endpoint_id1, KAA_ENDPOINT_ID_LENGTH);
+    cursor += KAA_ENDPOINT_ID_LENGTH;
+    memcpy(cursor, endpoint_id2, KAA_ENDPOINT_ID_LENGTH);
+
+    kaa_platform_message_reader_t *reader;
+    ASSERT_EQUAL(kaa_platform_message_reader_create(&reader, buffer, extension_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_handle_server_sync(event_manager, reader, 0, extension_size, 1), KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+}
+
+static void serialize_listeners_request(size_t sync_request_id)
+{
+    size_t size = 0;
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &size), KAA_ERR_NONE);
+
+    char buffer[size];
+    kaa_platform_message_writer_t *writer;
+    ASSERT_EQUAL(kaa_platform_message_writer_create(&writer, buffer, size), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_request_serialize(event_manager, sync_request_id, writer), KAA_ERR_NONE);
+    kaa_platform_message_writer_destroy(writer);
+}
+
+void test_kaa_event_listeners_cache()
+{
+    KAA_TRACE_IN(logger);
+
+    const char *fqns[] = { "test.fqn3", "test.fqn4" };
+    const char *reordered_fqns[] = { "test.fqn4", "test.fqn3" };
+    kaa_event_listeners_callback_t callback = { NULL, &counting_event_listeners_callback
+                                                    , &counting_event_listeners_failed_callback };
+
+    ASSERT_EQUAL(kaa_event_manager_set_listeners_cache_ttl(event_manager, 60000), KAA_ERR_NONE);
+
+    size_t empty_size = 0;
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &empty_size), KAA_ERR_NONE);
+
+    // The same FQN set in another order joins the outstanding request
+    ASSERT_EQUAL(kaa_event_manager_find_event_listeners(event_manager, fqns, 2, &callback), KAA_ERR_NONE);
+    size_t single_request_size = 0;
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &single_request_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_find_event_listeners(event_manager, reordered_fqns, 2, &callback), KAA_ERR_NONE);
+    size_t actual_size = 0;
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &actual_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(actual_size, single_request_size);
+
+    serialize_listeners_request(2);
+    size_t sent_size = 0;
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &sent_size), KAA_ERR_NONE);
+    handle_listeners_response(2, 0);
+    ASSERT_EQUAL(event_listeners_cb_count, 2);
+
+    // Served from the cache without a request
+    ASSERT_EQUAL(kaa_event_manager_find_event_listeners(event_manager, reordered_fqns, 2, &callback), KAA_ERR_NONE);
+    ASSERT_EQUAL(event_listeners_cb_count, 3);
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &actual_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(actual_size, empty_size);
+
+    kaa_event_manager_invalidate_listeners_cache(event_manager);
+    ASSERT_EQUAL(kaa_event_manager_find_event_listeners(event_manager, fqns, 2, &callback), KAA_ERR_NONE);
+    ASSERT_EQUAL(event_listeners_cb_count, 3);
+
+    // A search lost with its sync is sent again
+    serialize_listeners_request(3);
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &actual_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(actual_size, sent_size);
+    ASSERT_EQUAL(kaa_event_on_sync_lost(event_manager, 3), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &actual_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(actual_size, single_request_size);
+
+    // Failures are not cached
+    serialize_listeners_request(4);
+    handle_listeners_response(3, 1);
+    ASSERT_EQUAL(event_listeners_failed_cb_count, 1);
+    ASSERT_EQUAL(kaa_event_manager_find_event_listeners(event_manager, fqns, 2, &callback), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &actual_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(actual_size, single_request_size);
+
+    serialize_listeners_request(5);
+    handle_listeners_response(4, 0);
+    ASSERT_EQUAL(event_listeners_cb_count, 4);
+
+    ASSERT_EQUAL(kaa_event_manager_set_listeners_cache_ttl(event_manager, 0), KAA_ERR_NONE);
+}
+
 void test_kaa_event_sync_get_size()
 {
     KAA_TRACE_IN(logger);
@@ -355,10 +510,14 @@ void test_event_sync_serialize()
 
     const char *fqn = "test fqn";
     /**
-     * Allocated data will be freed automatically.
+     * Allocated data will be freed automatically. The manager may free it right away,
+     * so the expected event is serialized from a copy.
      */
     const size_t event_data_size = 16;
-    const char *event_data = (const char *) KAA_MALLOC(event_data_size);
+    char *event_data = (char *) KAA_MALLOC(event_data_size);
+    memset(event_data, 'd', event_data_size);
+    char expected_event_data[event_data_size];
+    memcpy(expected_event_data, event_data, event_data_size);
 
     kaa_endpoint_id target = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
 
@@ -417,7 +576,7 @@ void test_event_sync_serialize()
     error_code = kaa_platform_message_write(manual_writer, &event_count, sizeof(uint16_t));
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
-    error_code = serialize_event(manual_writer, fqn, event_data, event_data_size, target, ++sequence_number, true);
+    error_code = serialize_event(manual_writer, fqn, expected_event_data, event_data_size, target, ++sequence_number, true);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
     error_code = serialize_event(manual_writer, fqn, NULL, 0, NULL, ++sequence_number, true);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
@@ -449,16 +608,406 @@ void test_event_sync_serialize()
 
 
 
+static uint16_t serialize_events_request(size_t request_id);
+
+static void compare_events_request(size_t request_id
+                                 , const char **fqns
+                                 , const char **event_data
+                                 , const size_t *event_data_sizes
+                                 , const uint32_t *sequence_numbers
+                                 , uint16_t event_count)
+{
+    size_t event_sync_size = 0;
+    kaa_error_t error_code = kaa_event_request_get_size(event_manager, &event_sync_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    char manual_buffer[event_sync_size];
+    char auto_buffer[event_sync_size];
+
+    kaa_platform_message_writer_t *manual_writer;
+    error_code = kaa_platform_message_writer_create(&manual_writer, manual_buffer, event_sync_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_writer_t *auto_writer;
+    error_code = kaa_platform_message_writer_create(&auto_writer, auto_buffer, event_sync_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    const uint8_t event_field = 1;
+    const uint8_t reserved_field = 0;
+    uint16_t network_event_count = KAA_HTONS(event_count);
+
+    error_code = kaa_platform_message_write_extension_header(manual_writer
+                                                           , KAA_EVENT_EXTENSION_TYPE
+                                                           , 0x1
+                                                           , event_sync_size - KAA_EXTENSION_HEADER_SIZE);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_platform_message_write(manual_writer, &event_field, sizeof(uint8_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_platform_message_write(manual_writer, &reserved_field, sizeof(uint8_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_platform_message_write(manual_writer, &network_event_count, sizeof(uint16_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    uint16_t i = 0;
+    for (; i < event_count; ++i) {
+        error_code = serialize_event(manual_writer, fqns[i], event_data[i], event_data_sizes[i], NULL, sequence_numbers[i], true);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    }
+
+    error_code = kaa_event_request_serialize(event_manager, request_id, auto_writer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /* The extension header options are flags, compare them separately from the event list. */
+    ASSERT_EQUAL(memcmp(auto_buffer, manual_buffer, KAA_EXTENSION_HEADER_SIZE), 0);
+    size_t events_offset = KAA_EXTENSION_HEADER_SIZE + sizeof(uint16_t);
+    ASSERT_EQUAL(memcmp(auto_buffer + events_offset, manual_buffer + events_offset, event_sync_size - events_offset), 0);
+
+    kaa_platform_message_writer_destroy(manual_writer);
+    kaa_platform_message_writer_destroy(auto_writer);
+}
+
+void test_event_sync_serialize_large_payload()
+{
+    test_deinit();
+    test_init();
+
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code;
+
+    /**
+     * The first event data and the second event FQN do not fit into a queue slot
+     * and are kept in separate buffers, the third event is stored in the slot.
+     */
+    char long_fqn[KAA_EVENT_INLINE_SIZE + 8];
+    memset(long_fqn, 'f', sizeof(long_fqn) - 1);
+    long_fqn[sizeof(long_fqn) - 1] = '\0';
+
+    char large_data[2 * KAA_EVENT_INLINE_SIZE];
+    memset(large_data, 'l', sizeof(large_data));
+    char small_data[8];
+    memset(small_data, 's', sizeof(small_data));
+
+    const char *fqns[] = { "test fqn", long_fqn, "short fqn" };
+    const char *event_data[] = { large_data, small_data, small_data };
+    const size_t event_data_sizes[] = { sizeof(large_data), sizeof(small_data), sizeof(small_data) };
+    const uint16_t event_count = sizeof(fqns) / sizeof(fqns[0]);
+    const uint32_t sequence_numbers[] = { 54322, 54323, 54324 };
+
+    const size_t server_sync_buffer_size = sizeof(uint32_t);
+    char server_sync_buffer[server_sync_buffer_size];
+    uint32_t sequence_number = 54321;
+    *(uint32_t *) server_sync_buffer = KAA_HTONL(sequence_number);
+
+    kaa_platform_message_reader_t *server_sync_reader;
+    error_code = kaa_platform_message_reader_create(&server_sync_reader, server_sync_buffer, server_sync_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, server_sync_reader, 0x1, sizeof(uint32_t), 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(server_sync_reader);
+
+    uint16_t i = 0;
+    for (; i < event_count; ++i) {
+        /* The manager takes ownership of the data */
+        char *data = (char *) KAA_MALLOC(event_data_sizes[i]);
+        ASSERT_NOT_NULL(data);
+        memcpy(data, event_data[i], event_data_sizes[i]);
+        error_code = kaa_event_manager_send_event(event_manager, fqns[i], data, event_data_sizes[i], NULL);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    }
+
+    compare_events_request(1, fqns, event_data, event_data_sizes, sequence_numbers, event_count);
+
+    /* A lost request puts the events back in the queue with the same payloads and numbers */
+    ASSERT_EQUAL(kaa_event_on_sync_lost(event_manager, 1), KAA_ERR_NONE);
+    compare_events_request(2, fqns, event_data, event_data_sizes, sequence_numbers, event_count);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+void test_event_resend_with_full_queue()
+{
+    test_deinit();
+    test_init();
+
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code;
+
+    char sequence_number_buffer[sizeof(uint32_t)];
+    *((uint32_t *) sequence_number_buffer) = KAA_HTONL(100);
+    kaa_platform_message_reader_t *reader;
+    error_code = kaa_platform_message_reader_create(&reader, sequence_number_buffer, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, reader, 0x1, sizeof(uint32_t), 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    /**
+     * Two events in request 1, one in request 2, the rest of the queue is pending.
+     * Request 1 is lost while the queue is full.
+     */
+    const size_t pending_count = KAA_EVENT_QUEUE_CAPACITY - 3;
+    char fqn_storage[KAA_EVENT_QUEUE_CAPACITY][16];
+    const char *fqns[KAA_EVENT_QUEUE_CAPACITY];
+    const char *event_data[KAA_EVENT_QUEUE_CAPACITY];
+    size_t event_data_sizes[KAA_EVENT_QUEUE_CAPACITY];
+    uint32_t sequence_numbers[KAA_EVENT_QUEUE_CAPACITY];
+
+    size_t i = 0;
+    for (; i < KAA_EVENT_QUEUE_CAPACITY; ++i) {
+        if (i < 2)
+            snprintf(fqn_storage[i], sizeof(fqn_storage[i]), "A%zu", i);
+        else if (i == 2)
+            snprintf(fqn_storage[i], sizeof(fqn_storage[i]), "B0");
+        else
+            snprintf(fqn_storage[i], sizeof(fqn_storage[i]), "P%zu", i - 3);
+        fqns[i] = fqn_storage[i];
+        event_data[i] = NULL;
+        event_data_sizes[i] = 0;
+        sequence_numbers[i] = 101 + i;
+
+        error_code = kaa_event_manager_send_event(event_manager, fqns[i], NULL, 0, NULL);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+        if (i == 1)
+            ASSERT_EQUAL(serialize_events_request(1), 2);
+        else if (i == 2)
+            ASSERT_EQUAL(serialize_events_request(2), 1);
+    }
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "overflow", NULL, 0, NULL), KAA_ERR_EVENT_QUEUE_FULL);
+
+    ASSERT_EQUAL(kaa_event_on_sync_lost(event_manager, 1), KAA_ERR_NONE);
+
+    /* The lost events go first, then the pending ones, each exactly once */
+    const char *expected_fqns[KAA_EVENT_QUEUE_CAPACITY - 1];
+    uint32_t expected_sequence_numbers[KAA_EVENT_QUEUE_CAPACITY - 1];
+    size_t expected_count = 0;
+    for (i = 0; i < KAA_EVENT_QUEUE_CAPACITY; ++i) {
+        if (i == 2)
+            continue;
+        expected_fqns[expected_count] = fqns[i];
+        expected_sequence_numbers[expected_count] = sequence_numbers[i];
+        ++expected_count;
+    }
+    ASSERT_EQUAL(expected_count, 2 + pending_count);
+
+    compare_events_request(3, expected_fqns, event_data, event_data_sizes, expected_sequence_numbers, expected_count);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+static uint16_t serialize_events_request(size_t request_id)
+{
+    size_t event_sync_size = 0;
+    kaa_error_t error_code = kaa_event_request_get_size(event_manager, &event_sync_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    char buffer[event_sync_size];
+    kaa_platform_message_writer_t *writer;
+    error_code = kaa_platform_message_writer_create(&writer, buffer, event_sync_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_event_request_serialize(event_manager, request_id, writer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_writer_destroy(writer);
+
+    if (event_sync_size == KAA_EXTENSION_HEADER_SIZE)
+        return 0;
+    return KAA_NTOHS(*(uint16_t *) (buffer + KAA_EXTENSION_HEADER_SIZE + sizeof(uint16_t)));
+}
+
+void test_event_pipelined_requests()
+{
+    test_deinit();
+    test_init();
+
+    KAA_TRACE_IN(logger);
+
+    uint32_t sequence_number = KAA_HTONL(1);
+    kaa_platform_message_reader_t *reader;
+    kaa_error_t error_code = kaa_platform_message_reader_create(&reader, (const char *) &sequence_number, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, reader, 0x1, sizeof(uint32_t), 0);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    error_code = kaa_event_manager_send_event(event_manager, "test fqn 1", NULL, 0, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(serialize_events_request(10), 1);
+
+    // Events of the in-flight request 10 are not resent with request 11
+    error_code = kaa_event_manager_send_event(event_manager, "test fqn 2", NULL, 0, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(serialize_events_request(11), 1);
+    ASSERT_EQUAL(serialize_events_request(12), 0);
+
+    // Request 10 is lost, so its event goes out again
+    ASSERT_EQUAL(kaa_event_on_sync_lost(event_manager, 10), KAA_ERR_NONE);
+    ASSERT_EQUAL(serialize_events_request(13), 1);
+
+    // Request 11 is acknowledged independently of request 13
+    error_code = kaa_platform_message_reader_create(&reader, (const char *) &sequence_number, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, reader, 0, 0, 11);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    ASSERT_EQUAL(kaa_event_on_sync_lost(event_manager, 11), KAA_ERR_NOT_FOUND);
+    ASSERT_EQUAL(kaa_event_on_sync_lost(event_manager, 13), KAA_ERR_NONE);
+    ASSERT_EQUAL(serialize_events_request(14), 1);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_event_queue_backpressure()
+{
+    test_deinit();
+    test_init();
+
+    KAA_TRACE_IN(logger);
+
+    uint32_t sequence_number = KAA_HTONL(1);
+    kaa_platform_message_reader_t *reader;
+    kaa_error_t error_code = kaa_platform_message_reader_create(&reader, (const char *) &sequence_number, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, reader, 0x1, sizeof(uint32_t), 0);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    ASSERT_EQUAL(kaa_event_manager_set_queue_limit(event_manager, 0, KAA_EVENT_QUEUE_REJECT_NEW), KAA_ERR_BADPARAM);
+    ASSERT_EQUAL(kaa_event_manager_set_queue_limit(event_manager, 2, KAA_EVENT_QUEUE_REJECT_NEW), KAA_ERR_NONE);
+
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn 1", NULL, 0, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn 2", NULL, 0, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn 3", NULL, 0, NULL), KAA_ERR_EVENT_QUEUE_FULL);
+
+    // In-flight events are never dropped
+    ASSERT_EQUAL(serialize_events_request(1), 2);
+    ASSERT_EQUAL(kaa_event_manager_set_queue_limit(event_manager, 2, KAA_EVENT_QUEUE_DROP_OLDEST), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn 3", NULL, 0, NULL), KAA_ERR_EVENT_QUEUE_FULL);
+
+    error_code = kaa_platform_message_reader_create(&reader, (const char *) &sequence_number, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, reader, 0, 0, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    // Pending events make room for the new ones
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn 3", NULL, 0, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn 4", NULL, 0, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn 5", NULL, 0, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(serialize_events_request(2), 2);
+
+    // Request 2 stays in flight while the ring wraps around it
+    ASSERT_EQUAL(kaa_event_manager_set_queue_limit(event_manager, 4, KAA_EVENT_QUEUE_REJECT_NEW), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn", NULL, 0, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(serialize_events_request(3), 1);
+
+    size_t request_id = 4;
+    for (; request_id < 4 + 2 * KAA_EVENT_QUEUE_CAPACITY; ++request_id) {
+        ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn", NULL, 0, NULL), KAA_ERR_NONE);
+        ASSERT_EQUAL(serialize_events_request(request_id), 1);
+
+        error_code = kaa_platform_message_reader_create(&reader, (const char *) &sequence_number, sizeof(uint32_t));
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+        error_code = kaa_event_handle_server_sync(event_manager, reader, 0, 0, request_id - 1);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+        kaa_platform_message_reader_destroy(reader);
+    }
+
+    ASSERT_EQUAL(kaa_event_on_sync_lost(event_manager, 2), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_on_sync_lost(event_manager, request_id - 1), KAA_ERR_NONE);
+    ASSERT_EQUAL(serialize_events_request(request_id), 3);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+static char *create_event_data(char value)
+{
+    char *data = (char *) KAA_MALLOC(sizeof(char));
+    *data = value;
+    return data;
+}
+
+void test_event_coalescing()
+{
+    test_deinit();
+    test_init();
+
+    KAA_TRACE_IN(logger);
+
+    uint32_t sequence_number = KAA_HTONL(1);
+    kaa_platform_message_reader_t *reader;
+    kaa_error_t error_code = kaa_platform_message_reader_create(&reader, (const char *) &sequence_number, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, reader, 0x1, sizeof(uint32_t), 0);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    ASSERT_EQUAL(kaa_event_manager_set_coalescing_policy(event_manager, "state fqn", KAA_EVENT_COALESCE_REPLACE), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_set_queue_limit(event_manager, 3, KAA_EVENT_QUEUE_REJECT_NEW), KAA_ERR_NONE);
+
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "state fqn", create_event_data('a'), 1, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "state fqn", create_event_data('b'), 1, endpoint_id1), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn", NULL, 0, NULL), KAA_ERR_NONE);
+
+    // The queue is at its limit, but the pending states are replaced
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "state fqn", create_event_data('c'), 1, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "state fqn", NULL, 0, endpoint_id1), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "test fqn", NULL, 0, NULL), KAA_ERR_EVENT_QUEUE_FULL);
+
+    size_t event_sync_size = 0;
+    error_code = kaa_event_request_get_size(event_manager, &event_sync_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    const size_t event_header_size = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t);
+    ASSERT_EQUAL(event_sync_size, KAA_EXTENSION_HEADER_SIZE
+                                + sizeof(uint32_t)
+                                + event_header_size + sizeof(uint32_t) + kaa_aligned_size_get(strlen("state fqn")) + kaa_aligned_size_get(1)
+                                + event_header_size + KAA_ENDPOINT_ID_LENGTH + kaa_aligned_size_get(strlen("state fqn"))
+                                + event_header_size + kaa_aligned_size_get(strlen("test fqn")));
+
+    ASSERT_EQUAL(serialize_events_request(1), 3);
+
+    // Sent states are not replaced
+    ASSERT_EQUAL(kaa_event_manager_set_queue_limit(event_manager, 4, KAA_EVENT_QUEUE_REJECT_NEW), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "state fqn", create_event_data('d'), 1, NULL), KAA_ERR_NONE);
+
+    ASSERT_EQUAL(kaa_event_manager_set_coalescing_policy(event_manager, "state fqn", KAA_EVENT_COALESCE_NONE), KAA_ERR_NONE);
+    char *event_data = create_event_data('e');
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "state fqn", event_data, 1, NULL), KAA_ERR_EVENT_QUEUE_FULL);
+    KAA_FREE(event_data);
+
+    ASSERT_EQUAL(serialize_events_request(2), 1);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
 void global_event_cb(const char *fqn, const char *data, size_t size, kaa_endpoint_id_p source)
 {
-    global_events_counter++;
+    if (!strcmp(fqn, "unimportant fqn"))
+        global_events_counter++;
 }
 
 
 
 void specific_event_cb(const char *fqn, const char *data, size_t size, kaa_endpoint_id_p source)
 {
-    specific_events_counter++;
+    if (!strcmp(fqn, "important fqn"))
+        specific_events_counter++;
+}
+
+
+
+void unexpected_event_cb(const char *fqn, const char *data, size_t size, kaa_endpoint_id_p source)
+{
+    ASSERT_TRUE(false);
 }
 
 static size_t event_get_size(const char *fqn
@@ -546,6 +1095,73 @@ void test_event_blocks()
     kaa_platform_message_reader_destroy(server_sync_reader);
 }
 
+void test_event_data_ownership_on_nomem()
+{
+    KAA_TRACE_IN(logger);
+
+    test_deinit();
+    test_init();
+
+    char sequence_number_buffer[sizeof(uint32_t)] = { 0 };
+    kaa_platform_message_reader_t *reader;
+    kaa_error_t error_code = kaa_platform_message_reader_create(&reader, sequence_number_buffer, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, reader, 0x01, sizeof(uint32_t), 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    kaa_event_block_id trx_id = 0;
+    error_code = kaa_event_create_transaction(event_manager, &trx_id);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /**
+     * The first data is copied into the event, the second one is kept by pointer.
+     * Every allocation of the manager fails in turn until the event is added.
+     */
+    const char *fqn = "test.fqn";
+    const size_t data_sizes[] = { 8, 2 * KAA_EVENT_INLINE_SIZE };
+    const size_t data_count = sizeof(data_sizes) / sizeof(data_sizes[0]);
+    size_t i = 0;
+    for (; i < data_count; ++i) {
+        long allocations = 0;
+        do {
+            char *data = (char *) KAA_MALLOC(data_sizes[i]);
+            ASSERT_NOT_NULL(data);
+            memset(data, 'd', data_sizes[i]);
+
+            allocations_until_failure = allocations++;
+            error_code = kaa_event_manager_add_event_to_transaction(event_manager, trx_id, fqn, data, data_sizes[i], NULL);
+            allocations_until_failure = -1;
+
+            /* The data is left to the caller on errors, the generated wrappers free it */
+            if (error_code) {
+                ASSERT_EQUAL(error_code, KAA_ERR_NOMEM);
+                KAA_FREE(data);
+            }
+        } while (error_code);
+        ASSERT_TRUE(allocations > 1);
+    }
+
+    error_code = kaa_event_finish_transaction(event_manager, trx_id);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    size_t expected_size = KAA_EXTENSION_HEADER_SIZE
+                         + sizeof(uint32_t)              // Events count
+                         + data_count * sizeof(uint32_t) // Event sequence numbers
+                         + data_count * sizeof(uint32_t) // Event options + FQN length
+                         + data_count * sizeof(uint32_t) // Event data sizes
+                         + data_count * kaa_aligned_size_get(strlen(fqn));
+    for (i = 0; i < data_count; ++i)
+        expected_size += kaa_aligned_size_get(data_sizes[i]);
+
+    size_t request_size = 0;
+    error_code = kaa_event_request_get_size(event_manager, &request_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(request_size, expected_size);
+
+    KAA_TRACE_OUT(logger);
+}
+
 void test_kaa_server_sync_with_event_callbacks()
 {
     KAA_TRACE_IN(logger);
@@ -570,6 +1186,16 @@ void test_kaa_server_sync_with_event_callbacks()
 
     kaa_endpoint_id source = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
 
+     error_code = kaa_event_manager_add_on_event_callback(event_manager, important_fqn, unexpected_event_cb);
+     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+     /* Enough FQNs for the callbacks table to grow */
+     char other_fqn[] = "important fqn 0";
+     for (; other_fqn[sizeof(other_fqn) - 2] <= '9'; ++other_fqn[sizeof(other_fqn) - 2]) {
+         error_code = kaa_event_manager_add_on_event_callback(event_manager, other_fqn, unexpected_event_cb);
+         ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+     }
+
      error_code = kaa_event_manager_add_on_event_callback(event_manager, important_fqn, specific_event_cb);
      ASSERT_EQUAL(error_code, KAA_ERR_NONE);
      error_code = kaa_event_manager_add_on_event_callback(event_manager, NULL, global_event_cb);
@@ -624,10 +1250,353 @@ void test_kaa_server_sync_with_event_callbacks()
      kaa_platform_message_writer_destroy(server_sync_writer);
      KAA_FREE((void *) event_data);
 }
+
+typedef struct {
+    size_t    calls;
+    size_t    events_count;
+    bool      is_correct;
+} test_event_batch_t;
+
+static void batch_event_cb(void *context, const kaa_event_view_t *events, size_t events_count)
+{
+    test_event_batch_t *batch = (test_event_batch_t *) context;
+    ++batch->calls;
+    batch->events_count = events_count;
+    batch->is_correct = events_count == 3
+                     && events[0].fqn_length == strlen("fqn.a") && !memcmp(events[0].fqn, "fqn.a", events[0].fqn_length)
+                     && !events[0].data && !events[0].data_size
+                     && events[1].fqn_length == strlen("fqn.b") && !memcmp(events[1].fqn, "fqn.b", events[1].fqn_length)
+                     && events[1].data_size == 3 && !memcmp(events[1].data, "one", 3)
+                     && events[2].fqn_length == strlen("fqn.a") && !memcmp(events[2].fqn, "fqn.a", events[2].fqn_length)
+                     && events[2].data_size == 3 && !memcmp(events[2].data, "two", 3)
+                     && events[2].source[0] == 1;
+}
+
+void test_kaa_server_sync_with_batch_callback()
+{
+    KAA_TRACE_IN(logger);
+
+    test_deinit();
+    test_init();
+
+    kaa_endpoint_id source = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
+    test_event_batch_t batch = { 0, 0, false };
+
+    kaa_error_t error_code = kaa_event_manager_add_on_event_callback(event_manager, "fqn.a", unexpected_event_cb);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_manager_set_batch_callback(event_manager, batch_event_cb, &batch);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    size_t server_sync_buffer_size = sizeof(uint32_t)
+                                   + event_get_size("fqn.a", NULL, 0, source)
+                                   + event_get_size("fqn.b", "one", 3, source)
+                                   + event_get_size("fqn.a", "two", 3, source);
+
+    char server_sync_buffer[server_sync_buffer_size];
+    kaa_platform_message_writer_t *server_sync_writer;
+    error_code = kaa_platform_message_writer_create(&server_sync_writer, server_sync_buffer, server_sync_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    const uint8_t event_field = 1;
+    error_code = kaa_platform_message_write(server_sync_writer, &event_field, sizeof(uint8_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    server_sync_writer->current += sizeof(uint8_t);
+    uint16_t event_count = KAA_HTONS(3);
+    error_code = kaa_platform_message_write(server_sync_writer, &event_count, sizeof(uint16_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = serialize_event(server_sync_writer, "fqn.a", NULL, 0, source, 0, false);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = serialize_event(server_sync_writer, "fqn.b", "one", 3, source, 0, false);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = serialize_event(server_sync_writer, "fqn.a", "two", 3, source, 0, false);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_platform_message_reader_t *server_sync_reader;
+    error_code = kaa_platform_message_reader_create(&server_sync_reader, server_sync_buffer, server_sync_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /* The events are delivered in one call and the per-FQN callback is bypassed */
+    error_code = kaa_event_handle_server_sync(event_manager, server_sync_reader, 0, server_sync_buffer_size, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(batch.calls, 1);
+    ASSERT_EQUAL(batch.events_count, 3);
+    ASSERT_TRUE(batch.is_correct);
+
+    /* A sync without events doesn't call the batch callback */
+    error_code = kaa_event_handle_server_sync(event_manager, server_sync_reader, 0, 0, 2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(batch.calls, 1);
+
+    kaa_platform_message_reader_destroy(server_sync_reader);
+    kaa_platform_message_writer_destroy(server_sync_writer);
+}
+
+static size_t deferred_events_counter = 0;
+
+static void deferred_event_cb(const char *fqn, const char *data, size_t size, kaa_endpoint_id_p source)
+{
+    ASSERT_EQUAL(strcmp(fqn, "fqn.deferred"), 0);
+    ASSERT_EQUAL(size, 3);
+    ASSERT_EQUAL(memcmp(data, "one", 3), 0);
+    ASSERT_EQUAL(source[1], 2);
+    ++deferred_events_counter;
+}
+
+static void deferred_notify(void *context)
+{
+    ++*(size_t *) context;
+}
+
+void test_kaa_server_sync_with_deferred_dispatch()
+{
+    KAA_TRACE_IN(logger);
+
+    test_deinit();
+    test_init();
+
+    kaa_endpoint_id source = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
+
+    size_t processed_count = 0;
+    kaa_error_t error_code = kaa_event_manager_process_deferred_events(event_manager, 0, &processed_count);
+    ASSERT_EQUAL(error_code, KAA_ERR_BAD_STATE);
+
+    error_code = kaa_event_manager_add_on_event_callback(event_manager, "fqn.deferred", deferred_event_cb);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_manager_set_deferred_dispatch(event_manager, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    size_t notify_count = 0;
+    error_code = kaa_event_manager_set_deferred_notify(event_manager, &deferred_notify, &notify_count);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    size_t server_sync_buffer_size = sizeof(uint32_t) + 2 * event_get_size("fqn.deferred", "one", 3, source);
+
+    char server_sync_buffer[server_sync_buffer_size];
+    kaa_platform_message_writer_t *server_sync_writer;
+    error_code = kaa_platform_message_writer_create(&server_sync_writer, server_sync_buffer, server_sync_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    const uint8_t event_field = 1;
+    error_code = kaa_platform_message_write(server_sync_writer, &event_field, sizeof(uint8_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    server_sync_writer->current += sizeof(uint8_t);
+    uint16_t event_count = KAA_HTONS(2);
+    error_code = kaa_platform_message_write(server_sync_writer, &event_count, sizeof(uint16_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = serialize_event(server_sync_writer, "fqn.deferred", "one", 3, source, 0, false);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = serialize_event(server_sync_writer, "fqn.deferred", "one", 3, source, 0, false);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_platform_message_reader_t *server_sync_reader;
+    error_code = kaa_platform_message_reader_create(&server_sync_reader, server_sync_buffer, server_sync_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /* The queue holds one event, the other one overflows. No callback runs yet. */
+    error_code = kaa_event_handle_server_sync(event_manager, server_sync_reader, 0, server_sync_buffer_size, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(deferred_events_counter, 0);
+
+    size_t queued_count = 0;
+    size_t overflow_count = 0;
+    error_code = kaa_event_manager_get_deferred_stats(event_manager, &queued_count, &overflow_count);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(queued_count, 1);
+    ASSERT_EQUAL(overflow_count, 1);
+
+    /* The worker is woken up for the queued event only */
+    ASSERT_EQUAL(notify_count, 1);
+
+    /* The event data outlives the server sync buffer */
+    memset(server_sync_buffer, 0, server_sync_buffer_size);
+
+    error_code = kaa_event_manager_process_deferred_events(event_manager, 0, &processed_count);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(processed_count, 1);
+    ASSERT_EQUAL(deferred_events_counter, 1);
+
+    error_code = kaa_event_manager_set_deferred_dispatch(event_manager, 0);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_platform_message_reader_destroy(server_sync_reader);
+    kaa_platform_message_writer_destroy(server_sync_writer);
+}
+
+static size_t loopback_events_counter = 0;
+
+static void loopback_event_cb(const char *fqn, const char *data, size_t size, kaa_endpoint_id_p source)
+{
+    ASSERT_EQUAL(strcmp(fqn, "fqn.loopback"), 0);
+    ASSERT_EQUAL(size, 3);
+    ASSERT_EQUAL(memcmp(data, "abc", 3), 0);
+    ASSERT_EQUAL(memcmp(source, endpoint_id1, KAA_ENDPOINT_ID_LENGTH), 0);
+    ++loopback_events_counter;
+}
+
+static char *loopback_event_data(void)
+{
+    char *data = (char *) KAA_MALLOC(3);
+    memcpy(data, "abc", 3);
+    return data;
+}
+
+void test_kaa_event_loopback()
+{
+    KAA_TRACE_IN(logger);
+
+    test_deinit();
+    test_init();
+
+    memcpy(status->endpoint_public_key_hash, endpoint_id1, KAA_ENDPOINT_ID_LENGTH);
+    status->is_attached = true;
+
+    kaa_status_t *sibling_status = NULL;
+    kaa_error_t error_code = kaa_status_create(&sibling_status);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    memcpy(sibling_status->endpoint_public_key_hash, endpoint_id2, KAA_ENDPOINT_ID_LENGTH);
+    sibling_status->is_attached = true;
+
+    kaa_event_manager_t *sibling = NULL;
+    error_code = kaa_event_manager_create(&sibling, sibling_status, channel_manager, logger);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_manager_add_on_event_callback(sibling, "fqn.loopback", loopback_event_cb);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_event_loopback_group_t *group = NULL;
+    error_code = kaa_event_loopback_group_create(&group, KAA_EVENT_LOOPBACK_FORWARD_NON_LOCAL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_join_loopback_group(event_manager, group), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_manager_join_loopback_group(sibling, group), KAA_ERR_NONE);
+
+    /* Synchronizes the sequence number, so the pending events are counted in the sync size */
+    char sequence_number_buffer[sizeof(uint32_t)];
+    *((uint32_t *) sequence_number_buffer) = KAA_HTONL(1);
+    kaa_platform_message_reader_t *sequence_number_reader;
+    error_code = kaa_platform_message_reader_create(&sequence_number_reader, sequence_number_buffer, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, sequence_number_reader, 0x1, sizeof(uint32_t), 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(sequence_number_reader);
+
+    size_t empty_size = 0;
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &empty_size), KAA_ERR_NONE);
+
+    /* An event for the resident endpoint is not sent to the server */
+    error_code = kaa_event_manager_send_event(event_manager, "fqn.loopback", loopback_event_data(), 3, endpoint_id2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(loopback_events_counter, 1);
+    size_t actual_size = 0;
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &actual_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(actual_size, empty_size);
+
+    /* A broadcast is delivered locally and sent to the server */
+    error_code = kaa_event_manager_send_event(event_manager, "fqn.loopback", loopback_event_data(), 3, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(loopback_events_counter, 2);
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &actual_size), KAA_ERR_NONE);
+    ASSERT_NOT_EQUAL(actual_size, empty_size);
+
+    /* The copy the server delivers back is skipped */
+    size_t server_sync_buffer_size = sizeof(uint32_t) + event_get_size("fqn.loopback", "abc", 3, endpoint_id1);
+    char server_sync_buffer[server_sync_buffer_size];
+    kaa_platform_message_writer_t *server_sync_writer;
+    error_code = kaa_platform_message_writer_create(&server_sync_writer, server_sync_buffer, server_sync_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    const uint8_t event_field = 1;
+    error_code = kaa_platform_message_write(server_sync_writer, &event_field, sizeof(uint8_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    server_sync_writer->current += sizeof(uint8_t);
+    uint16_t event_count = KAA_HTONS(1);
+    error_code = kaa_platform_message_write(server_sync_writer, &event_count, sizeof(uint16_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = serialize_event(server_sync_writer, "fqn.loopback", "abc", 3, endpoint_id1, 0, false);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_platform_message_reader_t *server_sync_reader;
+    error_code = kaa_platform_message_reader_create(&server_sync_reader, server_sync_buffer, server_sync_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(sibling, server_sync_reader, 0, server_sync_buffer_size, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(loopback_events_counter, 2);
+
+    /* An event from the resident endpoint which wasn't delivered locally is not skipped */
+    kaa_platform_message_reader_destroy(server_sync_reader);
+    error_code = kaa_platform_message_reader_create(&server_sync_reader, server_sync_buffer, server_sync_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(sibling, server_sync_reader, 0, server_sync_buffer_size, 2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(loopback_events_counter, 3);
+
+    /* Out of the group the event is only sent to the server */
+    ASSERT_EQUAL(kaa_event_manager_join_loopback_group(sibling, NULL), KAA_ERR_NONE);
+    error_code = kaa_event_manager_send_event(event_manager, "fqn.loopback", loopback_event_data(), 3, endpoint_id2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(loopback_events_counter, 3);
+
+    kaa_platform_message_reader_destroy(server_sync_reader);
+    kaa_platform_message_writer_destroy(server_sync_writer);
+    kaa_event_loopback_group_destroy(group);
+    kaa_event_manager_destroy(sibling);
+    kaa_status_destroy(sibling_status);
+}
 #endif
 
 
 
+void test_kaa_event_need_resync()
+{
+    KAA_TRACE_IN(logger);
+
+    test_deinit();
+    test_init();
+
+    bool need_resync = false;
+    ASSERT_EQUAL(kaa_event_need_event_resync(event_manager, &need_resync), KAA_ERR_NONE);
+    ASSERT_TRUE(need_resync);
+
+    char sequence_number_buffer[sizeof(uint32_t)];
+    *((uint32_t *) sequence_number_buffer) = KAA_HTONL(1);
+    kaa_platform_message_reader_t *reader;
+    kaa_error_t error_code = kaa_platform_message_reader_create(&reader, sequence_number_buffer, sizeof(uint32_t));
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_event_handle_server_sync(event_manager, reader, 0x1, sizeof(uint32_t), 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    kaa_platform_message_reader_destroy(reader);
+
+    /* The receive-events flag still has to be sent once */
+    ASSERT_EQUAL(kaa_event_need_event_resync(event_manager, &need_resync), KAA_ERR_NONE);
+    ASSERT_TRUE(need_resync);
+
+    size_t request_size = 0;
+    ASSERT_EQUAL(kaa_event_request_get_size(event_manager, &request_size), KAA_ERR_NONE);
+    char request_buffer[request_size];
+    kaa_platform_message_writer_t *writer;
+    ASSERT_EQUAL(kaa_platform_message_writer_create(&writer, request_buffer, request_size), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_request_serialize(event_manager, 2, writer), KAA_ERR_NONE);
+    kaa_platform_message_writer_destroy(writer);
+
+    ASSERT_EQUAL(kaa_event_need_event_resync(event_manager, &need_resync), KAA_ERR_NONE);
+    ASSERT_FALSE(need_resync);
+
+    /* A pending event needs a sync */
+    const char *event_data = (const char *) KAA_MALLOC(1);
+    ASSERT_EQUAL(kaa_event_manager_send_event(event_manager, "fqn.resync", event_data, 1, NULL), KAA_ERR_NONE);
+    ASSERT_EQUAL(kaa_event_need_event_resync(event_manager, &need_resync), KAA_ERR_NONE);
+    ASSERT_TRUE(need_resync);
+
+    test_deinit();
+    test_init();
+
+    /* A new connection gets the receive-events flag again */
+    kaa_event_on_connection_lost(event_manager);
+    ASSERT_EQUAL(kaa_event_need_event_resync(event_manager, &need_resync), KAA_ERR_NONE);
+    ASSERT_TRUE(need_resync);
+}
+
+
+
 static int test_init(void)
 {
     kaa_error_t error = kaa_log_create(&logger, KAA_MAX_LOG_MESSAGE_LENGTH, KAA_MAX_LOG_LEVEL, NULL);
@@ -677,9 +1646,20 @@ KAA_SUITE_MAIN(Event, test_init, test_deinit
           KAA_TEST_CASE(create_event_manager, test_kaa_create_event_manager)
           KAA_TEST_CASE(compile_event_request, test_kaa_event_sync_get_size)
           KAA_TEST_CASE(event_sync_serialize, test_event_sync_serialize)
+          KAA_TEST_CASE(event_sync_serialize_large_payload, test_event_sync_serialize_large_payload)
+          KAA_TEST_CASE(event_resend_with_full_queue, test_event_resend_with_full_queue)
           KAA_TEST_CASE(add_on_event_callback, test_kaa_server_sync_with_event_callbacks)
           KAA_TEST_CASE(event_listeners_serialize_request, test_kaa_event_listeners_serialize_request)
           KAA_TEST_CASE(event_listeners_handle_sync, test_kaa_event_listeners_handle_sync)
+          KAA_TEST_CASE(event_listeners_cache, test_kaa_event_listeners_cache)
           KAA_TEST_CASE(event_test_blocks, test_event_blocks)
+          KAA_TEST_CASE(event_data_ownership_on_nomem, test_event_data_ownership_on_nomem)
+          KAA_TEST_CASE(event_pipelined_requests, test_event_pipelined_requests)
+          KAA_TEST_CASE(event_queue_backpressure, test_event_queue_backpressure)
+          KAA_TEST_CASE(event_coalescing, test_event_coalescing)
+          KAA_TEST_CASE(server_sync_with_batch_callback, test_kaa_server_sync_with_batch_callback)
+          KAA_TEST_CASE(server_sync_with_deferred_dispatch, test_kaa_server_sync_with_deferred_dispatch)
+          KAA_TEST_CASE(event_loopback, test_kaa_event_loopback)
+          KAA_TEST_CASE(event_need_resync, test_kaa_event_need_resync)
 #endif
         )
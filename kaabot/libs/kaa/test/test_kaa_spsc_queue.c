@@ -0,0 +1,115 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kaa_test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utilities/kaa_spsc_queue.h"
+
+#define TEST_QUEUE_CAPACITY     4
+#define TEST_ITEMS_COUNT        100000
+
+void test_kaa_spsc_queue_bounds()
+{
+    kaa_spsc_queue_t *queue = NULL;
+    kaa_error_t error_code = kaa_spsc_queue_create(&queue, 3);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    ASSERT_NULL(kaa_spsc_queue_pop(queue));
+
+    /* The capacity is rounded up to 4 */
+    int items[TEST_QUEUE_CAPACITY + 1];
+    size_t i;
+    for (i = 0; i < TEST_QUEUE_CAPACITY; ++i) {
+        error_code = kaa_spsc_queue_push(queue, &items[i]);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    }
+    error_code = kaa_spsc_queue_push(queue, &items[TEST_QUEUE_CAPACITY]);
+    ASSERT_EQUAL(error_code, KAA_ERR_BUFFER_IS_NOT_ENOUGH);
+
+    size_t size = 0;
+    size_t overflow_count = 0;
+    error_code = kaa_spsc_queue_get_stats(queue, &size, &overflow_count);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(size, TEST_QUEUE_CAPACITY);
+    ASSERT_EQUAL(overflow_count, 1);
+
+    /* A freed slot is reused, the order is kept across the wrap */
+    ASSERT_EQUAL(kaa_spsc_queue_pop(queue), &items[0]);
+    error_code = kaa_spsc_queue_push(queue, &items[TEST_QUEUE_CAPACITY]);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    for (i = 1; i <= TEST_QUEUE_CAPACITY; ++i) {
+        ASSERT_EQUAL(kaa_spsc_queue_pop(queue), &items[i]);
+    }
+    ASSERT_NULL(kaa_spsc_queue_pop(queue));
+
+    error_code = kaa_spsc_queue_get_stats(queue, &size, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(size, 0);
+
+    kaa_spsc_queue_destroy(queue);
+}
+
+static void *test_producer(void *context)
+{
+    kaa_spsc_queue_t *queue = (kaa_spsc_queue_t *) context;
+    uintptr_t i = 1;
+    while (i <= TEST_ITEMS_COUNT) {
+        if (!kaa_spsc_queue_push(queue, (void *) i))
+            ++i;
+        else
+            sched_yield();
+    }
+    return NULL;
+}
+
+void test_kaa_spsc_queue_threads()
+{
+    kaa_spsc_queue_t *queue = NULL;
+    kaa_error_t error_code = kaa_spsc_queue_create(&queue, TEST_QUEUE_CAPACITY);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    pthread_t producer;
+    ASSERT_EQUAL(pthread_create(&producer, NULL, &test_producer, queue), 0);
+
+    /* Every item arrives exactly once and in order */
+    uintptr_t expected = 1;
+    bool is_ordered = true;
+    while (expected <= TEST_ITEMS_COUNT) {
+        void *item = kaa_spsc_queue_pop(queue);
+        if (item) {
+            is_ordered = is_ordered && (uintptr_t) item == expected;
+            ++expected;
+        } else {
+            sched_yield();
+        }
+    }
+
+    ASSERT_EQUAL(pthread_join(producer, NULL), 0);
+    ASSERT_TRUE(is_ordered);
+    ASSERT_NULL(kaa_spsc_queue_pop(queue));
+
+    kaa_spsc_queue_destroy(queue);
+}
+
+KAA_SUITE_MAIN(SpscQueue, NULL, NULL
+        ,
+        KAA_TEST_CASE(spsc_queue_bounds, test_kaa_spsc_queue_bounds)
+        KAA_TEST_CASE(spsc_queue_threads, test_kaa_spsc_queue_threads)
+)
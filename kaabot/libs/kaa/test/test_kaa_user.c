@@ -51,7 +51,8 @@ extern kaa_error_t kaa_channel_manager_create(kaa_channel_manager_t **channel_ma
 extern void        kaa_channel_manager_destroy(kaa_channel_manager_t *self);
 
 extern kaa_error_t kaa_user_manager_create(kaa_user_manager_t **user_manager_p, kaa_status_t *status
-                                         , kaa_channel_manager_t *channel_manager, kaa_logger_t *logger);
+                                         , kaa_channel_manager_t *channel_manager, kaa_event_manager_t *event_manager
+                                         , kaa_logger_t *logger);
 extern void kaa_user_manager_destroy(kaa_user_manager_t *self);
 
 extern kaa_error_t kaa_user_request_get_size(kaa_user_manager_t *self, size_t *expected_size);
@@ -239,7 +240,7 @@ int test_init(void)
         return error;
     }
 
-    error = kaa_user_manager_create(&user_manager, status, channel_manager, logger);
+    error = kaa_user_manager_create(&user_manager, status, channel_manager, NULL, logger);
     if (error || !user_manager) {
         return error;
     }
@@ -71,6 +71,7 @@ void test_empty_log_collector_extension_count(void)
     info->services_count = 1;
     info->allocator = &allocator;
     info->allocator_context = mock;
+    info->channel = NULL;
     mock_strategy_context_t *strategy = (mock_strategy_context_t*) KAA_MALLOC(sizeof(mock_strategy_context_t));
     ASSERT_NOT_NULL(strategy);
     mock_storage_context_t *storage = (mock_storage_context_t*) KAA_MALLOC(sizeof(mock_storage_context_t));
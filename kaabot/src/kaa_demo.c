@@ -22,8 +22,9 @@
 #include <errno.h>
 #include <execinfo.h>
 #include <stddef.h>
-#include <sys/select.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <stdbool.h>
 
 #ifdef USE_MRAA
 #include <mraa.h>
@@ -57,21 +58,19 @@
 #define THERMO_REQUEST_FQN          "org.kaaproject.kaa.schema.sample.event.thermo.ThermostatInfoRequest"
 #define CHANGE_DEGREE_REQUEST_FQN   "org.kaaproject.kaa.schema.sample.event.thermo.ChangeDegreeRequest"
 
+#define MOTION_QUEUE_CAPACITY       16
+#define LISTENERS_CACHE_TTL_MS      30000
 
-static kaa_context_t *kaa_context_ = NULL;
-
-static kaa_service_t BOOTSTRAP_SERVICE[] = { KAA_SERVICE_BOOTSTRAP };
-static const int BOOTSTRAP_SERVICE_COUNT = sizeof(BOOTSTRAP_SERVICE) / sizeof(kaa_service_t);
-
-static kaa_service_t OPERATIONS_SERVICES[] = { KAA_SERVICE_PROFILE
-                                             , KAA_SERVICE_USER
-                                             , KAA_SERVICE_EVENT};
-static const int OPERATIONS_SERVICES_COUNT = sizeof(OPERATIONS_SERVICES) / sizeof(kaa_service_t);
 
-static kaa_transport_channel_interface_t bootstrap_channel;
-static kaa_transport_channel_interface_t operations_channel;
+static kaa_client_t *kaa_client_ = NULL;
+static kaa_context_t *kaa_context_ = NULL;
 
-static bool is_shutdown = false;
+static pthread_t motion_worker_;
+static pthread_mutex_t motion_lock_ = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t motion_ready_ = PTHREAD_COND_INITIALIZER;
+static size_t motion_pending_ = 0;
+static bool motion_worker_running_ = false;
+static kaa_logger_t *motion_logger_ = NULL;
 
 #ifdef USE_MRAA
 
@@ -105,40 +104,76 @@ void motion_kaabot(float pulseWidthLeft, float pulseWidthRight)
 }
 #endif //USE_MRAA
 
-void kaa_on_movement_class_direction(void *context, kaa_movement_class_movement_direction_t *event, kaa_endpoint_id_p source)
+void kaa_on_movement_class_direction(void *context, const kaa_movement_class_movement_direction_t *event, kaa_endpoint_id_p source)
 {
     float pulseWidthLeft = 0.0
         , pulseWidthRight = 0.0;
 
     switch (event->direction) {
     case ENUM_DIRECTIONT_BOT_BACKWARD:
-        KAA_LOG_WARN(kaa_context_->logger, 0, "Backward!");
+        KAA_LOG_WARN(motion_logger_, 0, "Backward!");
         pulseWidthLeft = 0.2f;
         pulseWidthRight = 0.9f;
         break;
     case ENUM_DIRECTIONT_BOT_FORWARD:
-        KAA_LOG_WARN(kaa_context_->logger, 0, "Forward!");
+        KAA_LOG_WARN(motion_logger_, 0, "Forward!");
         pulseWidthLeft = 0.9f;
         pulseWidthRight = 0.2f;
         break;
     case ENUM_DIRECTIONT_BOT_LEFT:
-        KAA_LOG_WARN(kaa_context_->logger, 0, "Left!");
+        KAA_LOG_WARN(motion_logger_, 0, "Left!");
         pulseWidthLeft = 0.0f;
         pulseWidthRight = 0.1f;
         break;
     case ENUM_DIRECTIONT_BOT_RIGHT:
-        KAA_LOG_WARN(kaa_context_->logger, 0, "Right!");
+        KAA_LOG_WARN(motion_logger_, 0, "Right!");
         pulseWidthLeft = 0.1f;
         pulseWidthRight = 0.0f;
         break;
     case ENUM_DIRECTIONT_BOT_STOP:
-        KAA_LOG_WARN(kaa_context_->logger, 0, "Stop!");
+        KAA_LOG_WARN(motion_logger_, 0, "Stop!");
         break;
     }
 #ifdef USE_MRAA
     motion_kaabot(pulseWidthLeft, pulseWidthRight);
 #endif
-    event->destroy(event);
+}
+
+/*
+ * Called from the network thread once a movement event is queued.
+ */
+static void motion_notify(void *context)
+{
+    pthread_mutex_lock(&motion_lock_);
+    ++motion_pending_;
+    pthread_cond_signal(&motion_ready_);
+    pthread_mutex_unlock(&motion_lock_);
+}
+
+/*
+ * Drives the motors off the network thread, so the PWM setup doesn't block
+ * the socket IO. The worker sleeps until the network thread queues an event
+ * and logs with its own logger, as the Kaa logger isn't thread-safe.
+ */
+static void *motion_worker(void *context)
+{
+    kaa_event_manager_t *event_manager = (kaa_event_manager_t *) context;
+
+    pthread_mutex_lock(&motion_lock_);
+    while (motion_worker_running_) {
+        if (!motion_pending_) {
+            pthread_cond_wait(&motion_ready_, &motion_lock_);
+            continue;
+        }
+        motion_pending_ = 0;
+        pthread_mutex_unlock(&motion_lock_);
+
+        kaa_event_manager_process_deferred_events(event_manager, 0, NULL);
+
+        pthread_mutex_lock(&motion_lock_);
+    }
+    pthread_mutex_unlock(&motion_lock_);
+    return NULL;
 }
 
 
@@ -187,7 +222,7 @@ kaa_error_t kaa_on_attach_success(void *context)
 kaa_error_t kaa_on_attach_failed(void *context, user_verifier_error_code_t error_code, const char *reason)
 {
     printf("Kaa Demo attach failed\n");
-    is_shutdown = true;
+    kaa_client_stop(kaa_client_);
     return KAA_ERR_NONE;
 }
 
@@ -198,32 +233,16 @@ kaa_error_t kaa_on_attach_failed(void *context, user_verifier_error_code_t error
 kaa_error_t kaa_sdk_init()
 {
     printf("Initializing Kaa SDK...\n");
-    kaa_error_t error_code = kaa_init(&kaa_context_);
+    kaa_client_props_t props = { 0 };
+    kaa_error_t error_code = kaa_client_create(&kaa_client_, &props);
     if (error_code) {
-        printf("Error during kaa context creation %d\n", error_code);
+        printf("Error during kaa client creation %d\n", error_code);
         return error_code;
     }
+    kaa_context_ = kaa_client_get_context(kaa_client_);
 
-    error_code = kaa_tcp_channel_create(&operations_channel
-                                      , kaa_context_->logger
-                                      , OPERATIONS_SERVICES
-                                      , OPERATIONS_SERVICES_COUNT);
-    KAA_RETURN_IF_ERR(error_code);
-
-    error_code = kaa_tcp_channel_create(&bootstrap_channel
-                                      , kaa_context_->logger
-                                      , BOOTSTRAP_SERVICE
-                                      , BOOTSTRAP_SERVICE_COUNT);
-    KAA_RETURN_IF_ERR(error_code);
-
-    error_code = kaa_channel_manager_add_transport_channel(kaa_context_->channel_manager
-                                                         , &bootstrap_channel
-                                                         , NULL);
-    KAA_RETURN_IF_ERR(error_code);
-
-    error_code = kaa_channel_manager_add_transport_channel(kaa_context_->channel_manager
-                                                         , &operations_channel
-                                                         , NULL);
+    /* Repeated listener searches within the TTL are answered without a server round trip */
+    error_code = kaa_event_manager_set_listeners_cache_ttl(kaa_context_->event_manager, LISTENERS_CACHE_TTL_MS);
     KAA_RETURN_IF_ERR(error_code);
 
     kaa_attachment_status_listeners_t listeners = { NULL, &kaa_on_attached, &kaa_on_detached, &kaa_on_attach_success, &kaa_on_attach_failed };
@@ -238,10 +257,26 @@ kaa_error_t kaa_sdk_init()
 
 
     // Set motion direction listener
-    error_code = kaa_event_manager_set_kaa_movement_class_movement_direction_listener(kaa_context_->event_manager
+    error_code = kaa_event_manager_set_kaa_movement_class_movement_direction_view_listener(kaa_context_->event_manager
             , &kaa_on_movement_class_direction, NULL);
     KAA_RETURN_IF_ERR(error_code);
 
+    error_code = kaa_log_create(&motion_logger_, KAA_MAX_LOG_MESSAGE_LENGTH, KAA_MAX_LOG_LEVEL, NULL);
+    KAA_RETURN_IF_ERR(error_code);
+
+    error_code = kaa_event_manager_set_deferred_dispatch(kaa_context_->event_manager, MOTION_QUEUE_CAPACITY);
+    KAA_RETURN_IF_ERR(error_code);
+
+    error_code = kaa_event_manager_set_deferred_notify(kaa_context_->event_manager, &motion_notify, NULL);
+    KAA_RETURN_IF_ERR(error_code);
+
+    motion_worker_running_ = true;
+    if (pthread_create(&motion_worker_, NULL, &motion_worker, kaa_context_->event_manager)) {
+        motion_worker_running_ = false;
+        printf("Failed to start motion worker\n");
+        return KAA_ERR_BAD_STATE;
+    }
+
     return KAA_ERR_NONE;
 }
 
@@ -260,99 +295,25 @@ kaa_error_t kaa_demo_init()
 
 void kaa_demo_destroy()
 {
-    kaa_tcp_channel_disconnect(&operations_channel);
-    kaa_deinit(kaa_context_);
+    pthread_mutex_lock(&motion_lock_);
+    bool is_running = motion_worker_running_;
+    motion_worker_running_ = false;
+    pthread_cond_signal(&motion_ready_);
+    pthread_mutex_unlock(&motion_lock_);
+
+    if (is_running)
+        pthread_join(motion_worker_, NULL);
+    kaa_client_destroy(kaa_client_);
+    kaa_log_destroy(motion_logger_);
 }
 
 int kaa_demo_event_loop()
 {
-    kaa_error_t error_code = kaa_start(kaa_context_);
-    if (error_code) {
-        printf("Failed to start Kaa workflow\n");
-        return -1;
-    }
-
-    uint16_t select_timeout;
-    error_code = kaa_tcp_channel_get_max_timeout(&operations_channel, &select_timeout);
+    kaa_error_t error_code = kaa_client_start(kaa_client_, NULL, NULL, 0);
     if (error_code) {
-        printf("Failed to get Operations channel keepalive timeout\n");
+        printf("Kaa client loop failed\n");
         return -1;
     }
-
-    if (select_timeout > 3) {
-        select_timeout = 3;
-    }
-
-    fd_set read_fds, write_fds, except_fds;
-    int ops_fd = 0, bootstrap_fd = 0;
-    struct timeval select_tv = { 0, 0 };
-    int max_fd = 0;
-
-    while (!is_shutdown) {
-        FD_ZERO(&read_fds);
-        FD_ZERO(&write_fds);
-        FD_ZERO(&except_fds);
-
-        max_fd = 0;
-
-        kaa_tcp_channel_get_descriptor(&operations_channel, &ops_fd);
-        if (max_fd < ops_fd)
-            max_fd = ops_fd;
-        kaa_tcp_channel_get_descriptor(&bootstrap_channel, &bootstrap_fd);
-        if (max_fd < bootstrap_fd)
-            max_fd = bootstrap_fd;
-
-        if (kaa_tcp_channel_is_ready(&operations_channel, FD_READ))
-            FD_SET(ops_fd, &read_fds);
-        if (kaa_tcp_channel_is_ready(&operations_channel, FD_WRITE))
-            FD_SET(ops_fd, &write_fds);
-
-        if (kaa_tcp_channel_is_ready(&bootstrap_channel, FD_READ))
-            FD_SET(bootstrap_fd, &read_fds);
-        if (kaa_tcp_channel_is_ready(&bootstrap_channel, FD_WRITE))
-            FD_SET(bootstrap_fd, &write_fds);
-
-        select_tv.tv_sec = select_timeout;
-        select_tv.tv_usec = 0;
-
-        int poll_result = select(max_fd + 1, &read_fds, &write_fds, NULL, &select_tv);
-        if (poll_result == 0) {
-            kaa_tcp_channel_check_keepalive(&operations_channel);
-            kaa_tcp_channel_check_keepalive(&bootstrap_channel);
-        } else if (poll_result > 0) {
-            if (bootstrap_fd >= 0) {
-                if (FD_ISSET(bootstrap_fd, &read_fds)) {
-                    KAA_LOG_DEBUG(kaa_context_->logger, KAA_ERR_NONE,"Processing IN event for the Bootstrap client socket %d", bootstrap_fd);
-                    error_code = kaa_tcp_channel_process_event(&bootstrap_channel, FD_READ);
-                    if (error_code)
-                        KAA_LOG_ERROR(kaa_context_->logger, KAA_ERR_NONE,"Failed to process IN event for the Bootstrap client socket %d", bootstrap_fd);
-                }
-                if (FD_ISSET(bootstrap_fd, &write_fds)) {
-                    KAA_LOG_DEBUG(kaa_context_->logger, KAA_ERR_NONE,"Processing OUT event for the Bootstrap client socket %d", bootstrap_fd);
-                    error_code = kaa_tcp_channel_process_event(&bootstrap_channel, FD_WRITE);
-                    if (error_code)
-                        KAA_LOG_ERROR(kaa_context_->logger, error_code,"Failed to process OUT event for the Bootstrap client socket %d", bootstrap_fd);
-                }
-            }
-            if (ops_fd >= 0) {
-                if (FD_ISSET(ops_fd, &read_fds)) {
-                    KAA_LOG_DEBUG(kaa_context_->logger, KAA_ERR_NONE,"Processing IN event for the Operations client socket %d", ops_fd);
-                    error_code = kaa_tcp_channel_process_event(&operations_channel, FD_READ);
-                    if (error_code)
-                        KAA_LOG_ERROR(kaa_context_->logger, error_code,"Failed to process IN event for the Operations client socket %d", ops_fd);
-                }
-                if (FD_ISSET(ops_fd, &write_fds)) {
-                    KAA_LOG_DEBUG(kaa_context_->logger, KAA_ERR_NONE,"Processing OUT event for the Operations client socket %d", ops_fd);
-                    error_code = kaa_tcp_channel_process_event(&operations_channel, FD_WRITE);
-                    if (error_code)
-                        KAA_LOG_ERROR(kaa_context_->logger, error_code,"Failed to process OUT event for the Operations client socket %d", ops_fd);
-                }
-            }
-        } else {
-            KAA_LOG_ERROR(kaa_context_->logger, KAA_ERR_BAD_STATE,"Failed to poll descriptors: %s", strerror(errno));
-            return -1;
-        }
-    }
     return 0;
 }
 
@@ -61,6 +61,8 @@ kaa_error_t kaa_event_manager_send_kaa_movement_class_movement_direction(kaa_eve
     event->serialize(writer, event);
     kaa_error_t result = kaa_event_manager_send_event(self, "com.krishna.kaabot.movementDirection", writer->buf, writer->written, target);
     avro_writer_free(writer);
+    if (result)
+        KAA_FREE(buffer);
     return result;
 }
 
@@ -79,6 +81,8 @@ kaa_error_t kaa_event_manager_add_kaa_movement_class_movement_direction_event_to
     event->serialize(writer, event);
     kaa_error_t result = kaa_event_manager_add_event_to_transaction(self, trx_id, "com.krishna.kaabot.movementDirection", writer->buf, writer->written, target);
     avro_writer_free(writer);
+    if (result)
+        KAA_FREE(buffer);
     return result;
 }
 
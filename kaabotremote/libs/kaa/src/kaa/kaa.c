@@ -23,6 +23,7 @@
 #include "kaa.h"
 #include "utilities/kaa_mem.h"
 #include "utilities/kaa_log.h"
+#include "utilities/kaa_timer_queue.h"
 
 #include "kaa_common.h"
 
@@ -35,7 +36,8 @@
  * External constructors and destructors from around the Kaa SDK
  */
 extern kaa_error_t kaa_user_manager_create(kaa_user_manager_t **user_manager_p, kaa_status_t *status,
-                                           kaa_channel_manager_t *channel_manager, kaa_logger_t *logger);
+                                           kaa_channel_manager_t *channel_manager, kaa_event_manager_t *event_manager,
+                                           kaa_logger_t *logger);
 
 extern void kaa_user_manager_destroy(kaa_user_manager_t *user_manager);
 
@@ -59,7 +61,8 @@ extern void kaa_event_manager_destroy(kaa_event_manager_t *self);
 
 #ifndef KAA_DISABLE_FEATURE_LOGGING
 extern kaa_error_t kaa_log_collector_create(kaa_log_collector_t ** log_collector_p, kaa_status_t *status,
-                                            kaa_channel_manager_t *channel_manager, kaa_logger_t *logger);
+                                            kaa_channel_manager_t *channel_manager, kaa_timer_queue_t *timer_queue,
+                                            kaa_logger_t *logger);
 extern void kaa_log_collector_destroy(kaa_log_collector_t *self);
 #endif
 
@@ -94,7 +97,13 @@ static kaa_error_t kaa_context_create(kaa_context_t **context_p, kaa_logger_t *l
 
     (*context_p)->logger = logger;
 
-    kaa_error_t error = KAA_ERR_NONE;
+    kaa_error_t error = kaa_timer_queue_create(&((*context_p)->timer_queue));
+    if (error) {
+        KAA_FREE(*context_p);
+        *context_p = NULL;
+        return error;
+    }
+
     (*context_p)->status = (kaa_status_holder_t *) KAA_MALLOC(sizeof(kaa_status_holder_t));
     if (!(*context_p)->status)
         error = KAA_ERR_NOMEM;
@@ -128,7 +137,8 @@ static kaa_error_t kaa_context_create(kaa_context_t **context_p, kaa_logger_t *l
 #ifndef KAA_DISABLE_FEATURE_LOGGING
     if (!error)
         error = kaa_log_collector_create(&((*context_p)->log_collector), (*context_p)->status->status_instance,
-                                         (*context_p)->channel_manager, (*context_p)->logger);
+                                         (*context_p)->channel_manager, (*context_p)->timer_queue,
+                                         (*context_p)->logger);
 #else
     (*context_p)->log_collector = NULL;
 #endif
@@ -143,7 +153,8 @@ static kaa_error_t kaa_context_create(kaa_context_t **context_p, kaa_logger_t *l
 
     if (!error)
         error = kaa_user_manager_create(&((*context_p)->user_manager), (*context_p)->status->status_instance,
-                                        (*context_p)->channel_manager, (*context_p)->logger);
+                                        (*context_p)->channel_manager, (*context_p)->event_manager,
+                                        (*context_p)->logger);
 
     if (error) {
         kaa_context_destroy(*context_p);
@@ -173,6 +184,7 @@ static kaa_error_t kaa_context_destroy(kaa_context_t *context)
     kaa_configuration_manager_destroy(context->configuration_manager);
 #endif
     kaa_platform_protocol_destroy(context->platfrom_protocol);
+    kaa_timer_queue_destroy(context->timer_queue);
     KAA_FREE(context);
     return KAA_ERR_NONE;
 }
@@ -256,6 +268,18 @@ kaa_error_t kaa_start(kaa_context_t *kaa_context)
     return KAA_ERR_NONE;
 }
 
+kaa_error_t kaa_get_next_deadline(kaa_context_t *kaa_context, kaa_time_ms_t *deadline)
+{
+    KAA_RETURN_IF_NIL2(kaa_context, deadline, KAA_ERR_BADPARAM);
+    return kaa_timer_queue_get_next_deadline(kaa_context->timer_queue, deadline);
+}
+
+kaa_error_t kaa_process_deadlines(kaa_context_t *kaa_context)
+{
+    KAA_RETURN_IF_NIL(kaa_context, KAA_ERR_BADPARAM);
+    return kaa_timer_queue_process(kaa_context->timer_queue, KAA_TIME_MS());
+}
+
 kaa_error_t kaa_deinit(kaa_context_t *kaa_context)
 {
     KAA_RETURN_IF_NIL(kaa_context, KAA_ERR_BADPARAM);
@@ -29,6 +29,7 @@
 
 #include "kaa_common.h"
 #include "platform/ext_transport_channel.h"
+#include "platform/time.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -91,6 +92,35 @@ kaa_error_t kaa_channel_manager_add_transport_channel(kaa_channel_manager_t *sel
 kaa_error_t kaa_channel_manager_remove_transport_channel(kaa_channel_manager_t *self
                                                        , uint32_t channel_id);
 
+/**
+ * @brief Sets the latency budget of the service.
+ *
+ * Sync requests of Kaa services are not sent right away. A request waits
+ * up to the latency budget of its service, and all requests which arrive
+ * meanwhile are sent in a single sync per channel. The defaults are
+ * KAA_SYNC_LATENCY_* from the platform defaults.
+ *
+ * @param[in]   self            Channel manager.
+ * @param[in]   service_type    The service. The bootstrap service is always synced right away.
+ * @param[in]   latency         The budget in milliseconds. 0 - sync the service right away.
+ *
+ * @return                      Error code.
+ */
+kaa_error_t kaa_channel_manager_set_sync_latency(kaa_channel_manager_t *self
+                                               , kaa_service_t service_type
+                                               , kaa_time_ms_t latency);
+
+/**
+ * @brief Sends all postponed sync requests right away.
+ *
+ * Use for urgent traffic which should not wait for the latency budget.
+ *
+ * @param[in]   self          Channel manager.
+ *
+ * @return                    Error code.
+ */
+kaa_error_t kaa_channel_manager_flush_syncs(kaa_channel_manager_t *self);
+
 #ifdef __cplusplus
 }      /* extern "C" */
 #endif
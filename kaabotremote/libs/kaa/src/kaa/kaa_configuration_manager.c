@@ -46,9 +46,7 @@
 
 #define KAA_CONFIGURATION_BODY_PRESENT           0x02
 
-extern kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa_channel_manager_t *self, kaa_service_t service_type);
-
-static kaa_service_t configuration_sync_services[1] = { KAA_SERVICE_CONFIGURATION };
+extern kaa_error_t kaa_channel_manager_request_sync(kaa_channel_manager_t *self, kaa_service_t service_type);
 
 struct kaa_configuration_manager {
     kaa_digest                           configuration_hash;
@@ -57,6 +55,7 @@ struct kaa_configuration_manager {
     kaa_channel_manager_t               *channel_manager;
     kaa_status_t                        *status;
     kaa_logger_t                        *logger;
+    bool                                 need_resync;    /**< The update subscription isn't sent over the current connection yet */
 };
 
 
@@ -82,6 +81,7 @@ kaa_error_t kaa_configuration_manager_create(kaa_configuration_manager_t **confi
     manager->status = status;
     manager->logger = logger;
     manager->root_receiver = (kaa_configuration_root_receiver_t) { NULL, NULL };
+    manager->need_resync = true;
 
     char *buffer = NULL;
     size_t buffer_size = 0;
@@ -127,6 +127,26 @@ void kaa_configuration_manager_destroy(kaa_configuration_manager_t *self)
 
 
 
+kaa_error_t kaa_configuration_need_configuration_resync(kaa_configuration_manager_t *self, bool *result)
+{
+    KAA_RETURN_IF_NIL2(self, result, KAA_ERR_BADPARAM);
+    *result = self->need_resync;
+    return KAA_ERR_NONE;
+}
+
+
+
+/*
+ * Called by the platform protocol when the connection to the server is closed.
+ */
+void kaa_configuration_manager_on_connection_lost(kaa_configuration_manager_t *self)
+{
+    KAA_RETURN_IF_NIL(self,);
+    self->need_resync = true;
+}
+
+
+
 kaa_error_t kaa_configuration_manager_get_size(kaa_configuration_manager_t *self, size_t *expected_size)
 {
     KAA_RETURN_IF_NIL2(self, expected_size, KAA_ERR_BADPARAM);
@@ -163,6 +183,7 @@ kaa_error_t kaa_configuration_manager_request_serialize(kaa_configuration_manage
     }
 
     *writer = tmp_writer;
+    self->need_resync = false;
 
     return KAA_ERR_NONE;
 }
@@ -209,10 +230,9 @@ kaa_error_t kaa_configuration_manager_handle_server_sync(kaa_configuration_manag
             if (self->root_receiver.on_configuration_updated)
                 self->root_receiver.on_configuration_updated(self->root_receiver.context, self->root_record);
 
-            kaa_transport_channel_interface_t *channel =
-                    kaa_channel_manager_get_transport_channel(self->channel_manager, configuration_sync_services[0]);
-            if (channel)
-                channel->sync_handler(channel->context, configuration_sync_services, 1);
+            /* The server learns the hash of the new configuration from the next sync */
+            self->need_resync = true;
+            kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_CONFIGURATION);
         }
     }
     return KAA_ERR_NONE;
@@ -75,6 +75,10 @@ typedef struct kaa_channel_manager_t    kaa_channel_manager_t;
     typedef struct kaa_configuration_manager kaa_configuration_manager_t;
 #endif
 
+#ifndef KAA_TIMER_QUEUE_T
+# define KAA_TIMER_QUEUE_T
+    typedef struct kaa_timer_queue_t        kaa_timer_queue_t;
+#endif
 
 #ifndef KAA_LOGGER_T
 # define KAA_LOGGER_T
@@ -97,6 +101,7 @@ typedef struct {
     kaa_log_collector_t         *log_collector;          /**< See @link kaa_logging.h @endlink. */
     kaa_configuration_manager_t *configuration_manager;  /**< See @link kaa_configuration_manager.h @endlink. */
     kaa_logger_t               *logger;                  /**< See @link kaa_log.h @endlink. */
+    kaa_timer_queue_t           *timer_queue;            /**< See @link kaa_timer_queue.h @endlink. */
 } kaa_context_t;
 
 #ifdef __cplusplus
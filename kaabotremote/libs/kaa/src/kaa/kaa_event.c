@@ -24,6 +24,8 @@
 # include "platform/stdio.h"
 # include "platform/sock.h"
 # include "platform/ext_sha.h"
+# include "platform/defaults.h"
+# include "platform/time.h"
 # include "kaa_event.h"
 # include "kaa_status.h"
 # include "kaa_channel_manager.h"
@@ -33,6 +35,7 @@
 # include "collections/kaa_list.h"
 # include "utilities/kaa_mem.h"
 # include "utilities/kaa_log.h"
+# include "utilities/kaa_spsc_queue.h"
 # include "platform/ext_system_logger.h"
 # include "gen/kaa_event_fqn_definitions.h"
 
@@ -46,6 +49,8 @@
 # define KAA_EVENT_OPTION_TARGET_ID_PRESENT    0x1
 # define KAA_EVENT_OPTION_EVENT_HAS_DATA       0x2
 
+# define KAA_EVENT_CALLBACKS_INITIAL_CAPACITY  8    /* Power of two */
+
 typedef enum {
     EVENT_LISTENERS_FIELD = 0x00,
     EVENTS_FIELD = 0x01,
@@ -56,27 +61,51 @@ typedef enum {
     EVENT_LISTENERS_FAILURE = 0x01
 } event_listeners_result_t;
 
+typedef enum {
+    KAA_EVENT_SLOT_FREE = 0,
+    KAA_EVENT_SLOT_PENDING,
+    KAA_EVENT_SLOT_SENT
+} kaa_event_slot_state_t;
+
 typedef struct {
-    int32_t          seq_num;
+    int32_t                   seq_num;
+    kaa_event_slot_state_t    state;
+    uint16_t                  fqn_size;
+    bool                      has_target;
     /**
-     * Use kaa_bytes_t for the fqn parameter (string type) to reduce strlen overhead.
-     * The kaa_bytes_t buffer will be null terminated.
+     * The FQN and then the data are kept in inline_buffer as long as they fit into it,
+     * so a queued event usually costs no allocations. Larger ones are kept on the heap.
+     * None of the buffers is null terminated.
      */
-    kaa_bytes_t*    event_class_fqn;
-    kaa_bytes_t*    event_data;
-    kaa_bytes_t*    target;
+    char                     *fqn_buffer;      /**< NULL if the FQN is inline */
+    char                     *data_buffer;     /**< Moved from the caller, NULL if the data is inline or empty */
+    size_t                    data_size;
+    kaa_endpoint_id           target;
+    char                      inline_buffer[KAA_EVENT_INLINE_SIZE];
 } kaa_event_t;
 
 typedef struct {
-    size_t        request_id;
-    kaa_list_t    *sent_events;
-} sent_events_tuple_t;
+    size_t                    request_id;
+    size_t                    begin;           /**< Position of the first event sent in the request */
+    size_t                    end;             /**< Position past the last one */
+} kaa_event_request_range_t;
 
 typedef struct {
-    char *fqn;
-    kaa_event_callback_t  cb;
+    uint32_t                hash;
+    size_t                  fqn_length;
+    char                   *fqn;        /**< NULL if the slot is empty */
+    kaa_event_callback_t    cb;
 } event_callback_pair_t;
 
+/* Event waiting in the deferred queue, the FQN and the data are stored right after it */
+typedef struct {
+    kaa_event_callback_t    callback;
+    const char             *data;
+    size_t                  data_size;
+    kaa_endpoint_id         source;
+    char                    fqn[];
+} kaa_deferred_event_t;
+
 typedef struct {
     kaa_event_block_id    id;
     kaa_list_t            *events;
@@ -91,57 +120,153 @@ typedef enum {
 typedef struct {
     uint16_t                        request_id;
     bool                            is_sent;
+    size_t                          sync_request_id;  /**< Client sync the request was sent in */
     kaa_bytes_t                   **fqns;
     size_t                          fqns_count;
+    uint32_t                        fqns_hash;        /**< Hash of the FQN set, independent of the FQN order */
     kaa_event_listeners_callback_t  callback;
+    kaa_list_t                     *waiters;          /**< Callbacks of the identical searches made while this one is in progress */
 } kaa_event_listeners_request_t;
 
+typedef struct {
+    kaa_bytes_t                   **fqns;
+    size_t                          fqns_count;
+    uint32_t                        fqns_hash;
+    kaa_endpoint_id                *listeners;
+    size_t                          listeners_count;
+    kaa_time_ms_t                   expires_at;
+} kaa_event_listeners_cache_entry_t;
+
+struct kaa_event_loopback_group_t {
+    kaa_list_t                  *members;   /**< Event managers of the group, not owned */
+    kaa_event_loopback_policy_t  policy;
+};
+
+typedef struct {
+    kaa_endpoint_id                 source;
+    uint32_t                        fingerprint;  /**< Hash of the FQN and the data */
+} kaa_event_loopback_echo_t;
+
 /* Public stuff */
 struct kaa_event_manager_t {
-    sent_events_tuple_t         events_awaiting_response;
-    kaa_list_t                 *pending_events;
-    kaa_list_t                 *event_callbacks;
+    kaa_event_t                *events;               /**< Ring of the events not yet delivered to the server */
+    size_t                      events_capacity;
+    size_t                      events_head;          /**< Position of the oldest event */
+    size_t                      events_pending;       /**< Position of the oldest pending event */
+    size_t                      events_tail;          /**< Position past the newest event */
+    kaa_event_request_range_t  *sent_requests;        /**< Events of the requests in flight, oldest first */
+    size_t                      sent_requests_count;
+    size_t                      events_count;         /**< Pending and sent events */
+    size_t                      pending_events_count;
+    size_t                      pending_events_size;  /**< Serialized size of the pending events */
+    size_t                      events_high_water_mark;
+    kaa_event_overflow_policy_t overflow_policy;
+    event_callback_pair_t      *event_callbacks;      /**< Open addressing hash table keyed by FQN */
+    size_t                      event_callbacks_capacity;
+    size_t                      event_callbacks_count;
+    char                       *event_fqn;            /**< Null-terminated FQN of the event passed to the global callback */
+    size_t                      event_fqn_size;
+    kaa_list_t                 *coalesced_fqns;       /**< FQNs of the events with KAA_EVENT_COALESCE_REPLACE policy */
+    kaa_event_view_t           *event_views;          /**< Events of the server sync being handled, for the batch callback */
+    size_t                      event_views_capacity;
+    size_t                      event_views_count;
+    kaa_event_batch_callback_t  batch_event_callback;
+    void                       *batch_event_context;
+    kaa_spsc_queue_t           *deferred_events;      /**< Events for the application's worker thread, NULL if disabled */
+    kaa_event_deferred_notify_t deferred_notify;
+    void                       *deferred_notify_context;
     kaa_list_t                 *transactions;
     kaa_list_t                 *event_listeners_requests;
+    kaa_list_t                 *event_listeners_cache;
+    uint32_t                    event_listeners_cache_ttl;
+    kaa_event_loopback_group_t *loopback_group;
+    kaa_list_t                 *loopback_echoes;      /**< Events delivered by the group which the server is to deliver again */
+    size_t                      loopback_echoes_count;
     kaa_event_block_id          trx_counter;
     kaa_event_callback_t        global_event_callback;
     size_t                      event_sequence_number;
     size_t                      extension_payload_size;
     kaa_event_sequence_number_status_t sequence_number_status;
+    bool                        need_resync;          /**< The receive-events flag isn't sent over the current connection yet */
 
     kaa_status_t                *status;
     kaa_channel_manager_t       *channel_manager;
     kaa_logger_t                *logger;
 
     uint16_t                     event_listeners_request_id;
-
-    kaa_endpoint_id_p            event_source;
 };
 
-static kaa_service_t event_sync_services[1] = { KAA_SERVICE_EVENT };
 
 
+extern kaa_error_t kaa_channel_manager_request_sync(kaa_channel_manager_t *self, kaa_service_t service_type);
 
-extern kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa_channel_manager_t *self
-                                                                                  , kaa_service_t service_type);
 
+static void destroy_event_listener_fqns(kaa_bytes_t **fqns, size_t fqns_count)
+{
+    KAA_RETURN_IF_NIL(fqns,);
+    size_t i = 0;
+    for (; i < fqns_count; ++i) {
+        if (fqns[i]) {
+            kaa_bytes_destroy(fqns[i]);
+        }
+    }
+    KAA_FREE(fqns);
+}
 
 static void destroy_event_listener_request(void *request_p)
 {
     KAA_RETURN_IF_NIL(request_p,);
     kaa_event_listeners_request_t *subscriber = (kaa_event_listeners_request_t *) request_p;
-    if (subscriber->fqns) {
-        size_t i = 0;
-        for (; i < subscriber->fqns_count; ++i) {
-            if (subscriber->fqns[i]) {
-                kaa_bytes_destroy(subscriber->fqns[i]);
-            }
-        }
-        KAA_FREE(subscriber->fqns);
-    }
+    destroy_event_listener_fqns(subscriber->fqns, subscriber->fqns_count);
+    kaa_list_destroy(subscriber->waiters, NULL);
     KAA_FREE(subscriber);
 }
 
+static void destroy_event_listeners_cache_entry(void *entry_p)
+{
+    KAA_RETURN_IF_NIL(entry_p,);
+    kaa_event_listeners_cache_entry_t *entry = (kaa_event_listeners_cache_entry_t *) entry_p;
+    destroy_event_listener_fqns(entry->fqns, entry->fqns_count);
+    if (entry->listeners)
+        KAA_FREE(entry->listeners);
+    KAA_FREE(entry);
+}
+
+static uint32_t kaa_event_fqn_hash(const char *fqn, size_t fqn_length);
+static bool kaa_event_loopback_deliver(kaa_event_manager_t *self, kaa_event_view_t *event
+                                     , kaa_endpoint_id_p target, bool is_forwarded);
+
+/*
+ * Sum of the FQN hashes, so the same set of FQNs gets the same hash in any order.
+ */
+static uint32_t kaa_event_fqns_hash(const char *fqns[], size_t fqns_count)
+{
+    uint32_t hash = 0;
+    size_t i = 0;
+    for (; i < fqns_count; ++i) {
+        hash += kaa_event_fqn_hash(fqns[i], strlen(fqns[i]));
+    }
+    return hash;
+}
+
+static bool kaa_event_fqns_match(kaa_bytes_t **fqns, size_t fqns_count, uint32_t fqns_hash
+                               , const char *other_fqns[], size_t other_fqns_count, uint32_t other_fqns_hash)
+{
+    if (fqns_count != other_fqns_count || fqns_hash != other_fqns_hash)
+        return false;
+
+    size_t i = 0;
+    for (; i < other_fqns_count; ++i) {
+        size_t fqn_length = strlen(other_fqns[i]);
+        size_t j = 0;
+        while (j < fqns_count && (fqns[j]->size != fqn_length || memcmp(fqns[j]->buffer, other_fqns[i], fqn_length)))
+            ++j;
+        if (j == fqns_count)
+            return false;
+    }
+    return true;
+}
+
 static kaa_event_listeners_request_t *create_event_listener_request(uint16_t request_id, const char *fqns[], size_t fqns_count, const kaa_event_listeners_callback_t *callback)
 {
     kaa_event_listeners_request_t *result = (kaa_event_listeners_request_t *) KAA_MALLOC(sizeof(kaa_event_listeners_request_t));
@@ -163,9 +288,12 @@ static kaa_event_listeners_request_t *create_event_listener_request(uint16_t req
         }
     }
 
+    result->fqns_hash = kaa_event_fqns_hash(fqns, fqns_count);
     result->callback = *callback;
+    result->waiters = NULL;
     result->request_id = request_id;
     result->is_sent = false;
+    result->sync_request_id = 0;
 
     return result;
 }
@@ -177,52 +305,137 @@ static bool find_listeners_request_by_id(void *request_p, void *context)
     return (request && request_id && ((*request_id) == request->request_id));
 }
 
-static void kaa_event_destroy(void* data)
+/*
+ * Used to unlink an item from a list without destroying it.
+ */
+static void keep_list_data(void *data)
 {
-    if (data) {
-        kaa_event_t* record = (kaa_event_t*)data;
+    (void) data;
+}
+
+static bool find_by_pointer(void *data, void *context)
+{
+    return data == context;
+}
+
+static const char *kaa_event_get_fqn(const kaa_event_t *event)
+{
+    return event->fqn_buffer ? event->fqn_buffer : event->inline_buffer;
+}
 
-        kaa_bytes_destroy(record->event_class_fqn);
-        kaa_bytes_destroy(record->event_data);
-        kaa_bytes_destroy(record->target);
+static const char *kaa_event_get_data(const kaa_event_t *event)
+{
+    if (event->data_buffer)
+        return event->data_buffer;
+    if (!event->data_size)
+        return NULL;
+    return event->inline_buffer + (event->fqn_buffer ? 0 : event->fqn_size);
+}
 
-        KAA_FREE(record);
+/*
+ * Takes the data over. It is copied after the inline FQN if there is room for it.
+ */
+static void kaa_event_set_data(kaa_event_t *event, const char *data, size_t data_size)
+{
+    if (event->data_buffer)
+        KAA_FREE(event->data_buffer);
+    event->data_buffer = NULL;
+    event->data_size = 0;
+
+    if (!data || !data_size)
+        return;
+
+    size_t inline_offset = event->fqn_buffer ? 0 : event->fqn_size;
+    if (data_size <= KAA_EVENT_INLINE_SIZE - inline_offset) {
+        memcpy(event->inline_buffer + inline_offset, data, data_size);
+        KAA_FREE((char *) data);
+    } else {
+        event->data_buffer = (char *) data;
     }
+    event->data_size = data_size;
 }
 
-static event_callback_pair_t *create_event_callback_pair(const char *fqn
-                                                       , kaa_event_callback_t callback)
+static void kaa_event_release(kaa_event_t *event)
 {
-    event_callback_pair_t *pair = (event_callback_pair_t *) KAA_MALLOC(sizeof(event_callback_pair_t));
-    KAA_RETURN_IF_NIL(pair, NULL);
+    if (event->fqn_buffer)
+        KAA_FREE(event->fqn_buffer);
+    if (event->data_buffer)
+        KAA_FREE(event->data_buffer);
+
+    event->fqn_buffer = NULL;
+    event->data_buffer = NULL;
+    event->state = KAA_EVENT_SLOT_FREE;
+}
 
-    size_t fqn_length = strlen(fqn);
-    pair->fqn = (char *) KAA_MALLOC((fqn_length + 1) * sizeof(char));
-    if (!pair->fqn) {
-        KAA_FREE(pair);
-        return NULL;
+static void kaa_event_destroy(void* data)
+{
+    if (data) {
+        kaa_event_release((kaa_event_t *) data);
+        KAA_FREE(data);
     }
-    strcpy(pair->fqn, fqn);
-    pair->cb = callback;
-    return pair;
 }
 
-static void kaa_event_destroy_callback_pair(void *pair_p)
+/*
+ * FNV-1a hash of the FQN bytes.
+ */
+static uint32_t kaa_event_fqn_hash(const char *fqn, size_t fqn_length)
 {
-    event_callback_pair_t *pair = (event_callback_pair_t *) pair_p;
-    KAA_FREE(pair->fqn);
-    KAA_FREE(pair);
+    uint32_t hash = 2166136261U;
+    while (fqn_length--) {
+        hash ^= (uint8_t) *fqn++;
+        hash *= 16777619U;
+    }
+    return hash;
 }
 
-static kaa_event_callback_t find_event_callback(kaa_list_t *head, const char *fqn)
+/*
+ * Returns the slot of the FQN in the callbacks table, which is empty if there is no callback for it.
+ */
+static event_callback_pair_t *find_event_callback(kaa_event_manager_t *self
+                                                , const char *fqn
+                                                , size_t fqn_length
+                                                , uint32_t hash)
 {
-    while (head) {
-        event_callback_pair_t *pair = (event_callback_pair_t *) kaa_list_get_data(head);
-        if (strcmp(fqn, pair->fqn) == 0)
-            return pair->cb;
-        head = kaa_list_next(head);
+    KAA_RETURN_IF_NIL(self->event_callbacks_capacity, NULL);
+
+    size_t mask = self->event_callbacks_capacity - 1;
+    size_t i = hash & mask;
+    for (;; i = (i + 1) & mask) {
+        event_callback_pair_t *pair = &self->event_callbacks[i];
+        if (!pair->fqn)
+            return pair;
+        if (pair->hash == hash && pair->fqn_length == fqn_length && !memcmp(pair->fqn, fqn, fqn_length))
+            return pair;
     }
-    return NULL;
+}
+
+static kaa_error_t resize_event_callbacks(kaa_event_manager_t *self, size_t capacity)
+{
+    event_callback_pair_t *table = (event_callback_pair_t *) KAA_CALLOC(capacity, sizeof(event_callback_pair_t));
+    KAA_RETURN_IF_NIL(table, KAA_ERR_NOMEM);
+
+    event_callback_pair_t *old_table = self->event_callbacks;
+    size_t old_capacity = self->event_callbacks_capacity;
+
+    self->event_callbacks = table;
+    self->event_callbacks_capacity = capacity;
+
+    size_t i = 0;
+    for (; i < old_capacity; ++i) {
+        event_callback_pair_t *pair = &old_table[i];
+        if (pair->fqn)
+            *find_event_callback(self, pair->fqn, pair->fqn_length, pair->hash) = *pair;
+    }
+
+    if (old_table)
+        KAA_FREE(old_table);
+    return KAA_ERR_NONE;
+}
+
+static bool find_fqn(void *fqn_p, void *context)
+{
+    KAA_RETURN_IF_NIL2(fqn_p, context, false);
+    return strcmp((const char *) fqn_p, (const char *) context) == 0;
 }
 
 static event_transaction_t *create_transaction(kaa_event_block_id id)
@@ -251,6 +464,277 @@ static bool transaction_search_by_id_predicate(void *trx_p, void *context)
     return (matcher && trx) ? ((*matcher) == trx->id) : false;
 }
 
+static size_t kaa_event_get_request_size(const kaa_event_t *event)
+{
+    size_t expected_size = sizeof(uint32_t) /*Event sequence number*/
+                         + sizeof(uint16_t) /*Event options*/
+                         + sizeof(uint16_t); /*Event class FQN length */
+
+    if (event->data_size) {
+        expected_size += sizeof(uint32_t); /*Event data size*/
+    }
+
+    if (event->has_target) {
+        expected_size += KAA_ENDPOINT_ID_LENGTH; /*Target Endpoint ID*/
+    }
+
+    expected_size += kaa_aligned_size_get(event->fqn_size); /*Event class FQN + padding */
+
+    if (event->data_size) {
+        expected_size += kaa_aligned_size_get(event->data_size);/*Event data + padding*/
+    }
+
+    return expected_size;
+}
+
+/*
+ * The event queue is a ring of kaa_event_t slots addressed by positions which only grow.
+ * From the head up to events_pending there are the events sent to the server and the holes
+ * left by the delivered ones, from there up to the tail the pending events follow with no
+ * holes. The events of a request occupy a range of positions, so a server sync frees its
+ * range at once and the head moves past the holes. The holes left by out-of-order
+ * deliveries are squeezed out only when the tail reaches the end of the ring.
+ */
+static kaa_event_t *kaa_event_queue_at(kaa_event_manager_t *self, size_t position)
+{
+    return &self->events[position % self->events_capacity];
+}
+
+static void kaa_event_queue_trim(kaa_event_manager_t *self)
+{
+    while (self->events_head < self->events_pending
+            && kaa_event_queue_at(self, self->events_head)->state == KAA_EVENT_SLOT_FREE) {
+        ++self->events_head;
+    }
+}
+
+static void kaa_event_queue_move(kaa_event_manager_t *self, size_t from, size_t to)
+{
+    kaa_event_t *event = kaa_event_queue_at(self, from);
+    *kaa_event_queue_at(self, to) = *event;
+    event->fqn_buffer = NULL;
+    event->data_buffer = NULL;
+    event->state = KAA_EVENT_SLOT_FREE;
+}
+
+static void kaa_event_queue_compact(kaa_event_manager_t *self)
+{
+    size_t holes = 0;
+    size_t range = 0;
+    size_t position = self->events_head;
+    for (; position < self->events_tail; ++position) {
+        if (kaa_event_queue_at(self, position)->state == KAA_EVENT_SLOT_FREE) {
+            ++holes;
+            continue;
+        }
+        if (range < self->sent_requests_count && self->sent_requests[range].begin == position) {
+            self->sent_requests[range].begin -= holes;
+            self->sent_requests[range].end -= holes;
+            ++range;
+        }
+        if (holes)
+            kaa_event_queue_move(self, position, position - holes);
+    }
+
+    /* The pending events have no holes between them */
+    self->events_pending -= holes;
+    self->events_tail -= holes;
+}
+
+static bool kaa_event_queue_drop_oldest(kaa_event_manager_t *self)
+{
+    if (self->events_pending == self->events_tail)
+        return false;
+
+    kaa_event_t *event = kaa_event_queue_at(self, self->events_pending++);
+    KAA_LOG_WARN(self->logger, KAA_ERR_EVENT_QUEUE_FULL, "Event queue is full, dropping the oldest event \"%.*s\""
+                                            , (int) event->fqn_size, kaa_event_get_fqn(event));
+    --self->pending_events_count;
+    self->pending_events_size -= kaa_event_get_request_size(event);
+    --self->events_count;
+    kaa_event_release(event);
+    kaa_event_queue_trim(self);
+    return true;
+}
+
+/*
+ * Makes room for the given number of events according to the high-water mark and the overflow policy.
+ */
+static kaa_error_t kaa_event_queue_reserve(kaa_event_manager_t *self, size_t count)
+{
+    if (count > self->events_high_water_mark)
+        return KAA_ERR_EVENT_QUEUE_FULL;
+
+    while (self->events_count + count > self->events_high_water_mark) {
+        if (self->overflow_policy != KAA_EVENT_QUEUE_DROP_OLDEST || !kaa_event_queue_drop_oldest(self))
+            return KAA_ERR_EVENT_QUEUE_FULL;
+    }
+
+    if (self->events_tail - self->events_head + count > self->events_capacity)
+        kaa_event_queue_compact(self);
+
+    return KAA_ERR_NONE;
+}
+
+/*
+ * Moves the event into the queue. The room for it must be reserved beforehand.
+ */
+static void kaa_event_queue_push(kaa_event_manager_t *self, kaa_event_t *event)
+{
+    kaa_event_t *slot = kaa_event_queue_at(self, self->events_tail++);
+    *slot = *event;
+    slot->state = KAA_EVENT_SLOT_PENDING;
+
+    event->fqn_buffer = NULL;
+    event->data_buffer = NULL;
+
+    ++self->events_count;
+    ++self->pending_events_count;
+    self->pending_events_size += kaa_event_get_request_size(slot);
+}
+
+/*
+ * Hands the data over to the pending event with the same FQN and target
+ * if the FQN has KAA_EVENT_COALESCE_REPLACE policy.
+ */
+static bool kaa_event_queue_coalesce(kaa_event_manager_t *self
+                                   , const char *fqn
+                                   , const char *event_data
+                                   , size_t event_data_size
+                                   , kaa_endpoint_id_p target)
+{
+    if (!kaa_list_find_next(self->coalesced_fqns, &find_fqn, (void *) fqn))
+        return false;
+
+    size_t fqn_size = strlen(fqn);
+    size_t position = self->events_pending;
+    for (; position < self->events_tail; ++position) {
+        kaa_event_t *event = kaa_event_queue_at(self, position);
+        if (event->fqn_size != fqn_size || memcmp(kaa_event_get_fqn(event), fqn, fqn_size))
+            continue;
+        if (event->has_target != (target != NULL)
+                || (target && memcmp(event->target, target, KAA_ENDPOINT_ID_LENGTH)))
+            continue;
+
+        self->pending_events_size -= kaa_event_get_request_size(event);
+        kaa_event_set_data(event, event_data, event_data_size);
+        self->pending_events_size += kaa_event_get_request_size(event);
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Marks the pending events as sent in the request.
+ */
+static void kaa_event_queue_send(kaa_event_manager_t *self, size_t request_id)
+{
+    if (self->events_pending == self->events_tail)
+        return;
+
+    size_t position = self->events_pending;
+    for (; position < self->events_tail; ++position)
+        kaa_event_queue_at(self, position)->state = KAA_EVENT_SLOT_SENT;
+
+    /* Every range holds an event in flight, so there are no more ranges than slots */
+    kaa_event_request_range_t *range = &self->sent_requests[self->sent_requests_count++];
+    range->request_id = request_id;
+    range->begin = self->events_pending;
+    range->end = self->events_tail;
+
+    self->events_pending = self->events_tail;
+    self->pending_events_count = 0;
+    self->pending_events_size = 0;
+}
+
+static kaa_event_request_range_t *kaa_event_queue_find_request(kaa_event_manager_t *self, size_t request_id)
+{
+    size_t i = 0;
+    for (; i < self->sent_requests_count; ++i) {
+        if (self->sent_requests[i].request_id == request_id)
+            return &self->sent_requests[i];
+    }
+    return NULL;
+}
+
+static void kaa_event_queue_remove_request(kaa_event_manager_t *self, kaa_event_request_range_t *range)
+{
+    size_t index = range - self->sent_requests;
+    memmove(range, range + 1, (self->sent_requests_count - index - 1) * sizeof(kaa_event_request_range_t));
+    --self->sent_requests_count;
+}
+
+static size_t kaa_event_queue_release_request(kaa_event_manager_t *self, size_t request_id)
+{
+    kaa_event_request_range_t *range = kaa_event_queue_find_request(self, request_id);
+    if (!range)
+        return 0;
+
+    size_t position = range->begin;
+    for (; position < range->end; ++position)
+        kaa_event_release(kaa_event_queue_at(self, position));
+
+    size_t released = range->end - range->begin;
+    self->events_count -= released;
+    kaa_event_queue_remove_request(self, range);
+    kaa_event_queue_trim(self);
+    return released;
+}
+
+static void kaa_event_queue_reverse(kaa_event_manager_t *self, size_t begin, size_t end)
+{
+    while (begin + 1 < end) {
+        kaa_event_t *first = kaa_event_queue_at(self, begin++);
+        kaa_event_t *last = kaa_event_queue_at(self, --end);
+        kaa_event_t event = *first;
+        *first = *last;
+        *last = event;
+    }
+}
+
+/*
+ * Makes the events sent in the request pending again, ahead of the events not sent yet.
+ * The lost events are rotated in place with the later requests in flight, so it takes
+ * no room in the queue however full it is.
+ */
+static size_t kaa_event_queue_resend_request(kaa_event_manager_t *self, size_t request_id)
+{
+    kaa_event_request_range_t *range = kaa_event_queue_find_request(self, request_id);
+    if (!range)
+        return 0;
+
+    size_t begin = range->begin;
+    size_t end = range->end;
+    size_t lost_count = end - begin;
+
+    if (end != self->events_pending) {
+        kaa_event_queue_reverse(self, begin, end);
+        kaa_event_queue_reverse(self, end, self->events_pending);
+        kaa_event_queue_reverse(self, begin, self->events_pending);
+
+        /* The later ranges are in order of positions */
+        kaa_event_request_range_t *later = range + 1;
+        for (; later < self->sent_requests + self->sent_requests_count; ++later) {
+            later->begin -= lost_count;
+            later->end -= lost_count;
+        }
+    }
+
+    self->events_pending -= lost_count;
+
+    size_t position = self->events_pending;
+    for (; position < self->events_pending + lost_count; ++position) {
+        kaa_event_t *event = kaa_event_queue_at(self, position);
+        event->state = KAA_EVENT_SLOT_PENDING;
+        ++self->pending_events_count;
+        self->pending_events_size += kaa_event_get_request_size(event);
+    }
+
+    kaa_event_queue_remove_request(self, range);
+    kaa_event_queue_trim(self);
+    return lost_count;
+}
+
 kaa_error_t kaa_event_manager_create(kaa_event_manager_t **event_manager_p
                                    , kaa_status_t *status
                                    , kaa_channel_manager_t *channel_manager
@@ -261,88 +745,140 @@ kaa_error_t kaa_event_manager_create(kaa_event_manager_t **event_manager_p
     *event_manager_p = (kaa_event_manager_t *) KAA_MALLOC(sizeof(kaa_event_manager_t));
     KAA_RETURN_IF_NIL(*event_manager_p, KAA_ERR_NOMEM);
 
-    (*event_manager_p)->pending_events = NULL;
-    (*event_manager_p)->events_awaiting_response.sent_events = NULL;
-    (*event_manager_p)->events_awaiting_response.request_id =  (size_t) -1;
+    (*event_manager_p)->events = (kaa_event_t *) KAA_CALLOC(KAA_EVENT_QUEUE_CAPACITY, sizeof(kaa_event_t));
+    (*event_manager_p)->sent_requests = (kaa_event_request_range_t *)
+                            KAA_MALLOC(KAA_EVENT_QUEUE_CAPACITY * sizeof(kaa_event_request_range_t));
+    if (!(*event_manager_p)->events || !(*event_manager_p)->sent_requests) {
+        if ((*event_manager_p)->events)
+            KAA_FREE((*event_manager_p)->events);
+        if ((*event_manager_p)->sent_requests)
+            KAA_FREE((*event_manager_p)->sent_requests);
+        KAA_FREE(*event_manager_p);
+        *event_manager_p = NULL;
+        return KAA_ERR_NOMEM;
+    }
+    (*event_manager_p)->events_capacity = KAA_EVENT_QUEUE_CAPACITY;
+    (*event_manager_p)->events_head = 0;
+    (*event_manager_p)->events_pending = 0;
+    (*event_manager_p)->events_tail = 0;
+    (*event_manager_p)->sent_requests_count = 0;
+    (*event_manager_p)->events_count = 0;
+    (*event_manager_p)->pending_events_count = 0;
+    (*event_manager_p)->pending_events_size = 0;
+    (*event_manager_p)->events_high_water_mark = KAA_EVENT_QUEUE_CAPACITY;
+    (*event_manager_p)->overflow_policy = KAA_EVENT_QUEUE_REJECT_NEW;
     (*event_manager_p)->event_callbacks = NULL;
+    (*event_manager_p)->event_callbacks_capacity = 0;
+    (*event_manager_p)->event_callbacks_count = 0;
+    (*event_manager_p)->event_fqn = NULL;
+    (*event_manager_p)->event_fqn_size = 0;
+    (*event_manager_p)->coalesced_fqns = NULL;
+    (*event_manager_p)->event_views = NULL;
+    (*event_manager_p)->event_views_capacity = 0;
+    (*event_manager_p)->event_views_count = 0;
+    (*event_manager_p)->batch_event_callback = NULL;
+    (*event_manager_p)->batch_event_context = NULL;
+    (*event_manager_p)->deferred_events = NULL;
+    (*event_manager_p)->deferred_notify = NULL;
+    (*event_manager_p)->deferred_notify_context = NULL;
     (*event_manager_p)->transactions = NULL;
     (*event_manager_p)->event_listeners_requests = NULL;
+    (*event_manager_p)->event_listeners_cache = NULL;
+    (*event_manager_p)->event_listeners_cache_ttl = 0;
+    (*event_manager_p)->loopback_group = NULL;
+    (*event_manager_p)->loopback_echoes = NULL;
+    (*event_manager_p)->loopback_echoes_count = 0;
     (*event_manager_p)->event_listeners_request_id = 0;
     (*event_manager_p)->trx_counter = 0;
     (*event_manager_p)->global_event_callback = NULL;
     (*event_manager_p)->event_sequence_number = status->event_seq_n;
 
     (*event_manager_p)->sequence_number_status = KAA_EVENT_SEQUENCE_NUMBER_UNSYNCHRONIZED;
+    (*event_manager_p)->need_resync = true;
 
     (*event_manager_p)->status = status;
     (*event_manager_p)->channel_manager = channel_manager;
     (*event_manager_p)->logger = logger;
 
-    (*event_manager_p)->event_source = (kaa_endpoint_id_p)KAA_MALLOC(sizeof(kaa_endpoint_id));
-    KAA_RETURN_IF_NIL((*event_manager_p)->event_source, KAA_ERR_NOMEM);
-
     return KAA_ERR_NONE;
 }
 
+static void kaa_event_destroy_deferred_events(kaa_event_manager_t *self)
+{
+    if (self->deferred_events) {
+        kaa_deferred_event_t *event;
+        while ((event = (kaa_deferred_event_t *) kaa_spsc_queue_pop(self->deferred_events)))
+            KAA_FREE(event);
+        kaa_spsc_queue_destroy(self->deferred_events);
+        self->deferred_events = NULL;
+    }
+}
+
 void kaa_event_manager_destroy(kaa_event_manager_t *self)
 {
     if (self) {
-        kaa_list_destroy(self->events_awaiting_response.sent_events, &kaa_event_destroy);
-        kaa_list_destroy(self->pending_events, &kaa_event_destroy);
-        kaa_list_destroy(self->event_callbacks, &kaa_event_destroy_callback_pair);
-        kaa_list_destroy(self->transactions, &destroy_transaction);
-        if (self->event_source) {
-            KAA_FREE((void*)self->event_source);
+        kaa_event_manager_join_loopback_group(self, NULL);
+        kaa_event_destroy_deferred_events(self);
+        size_t i = self->events_head;
+        for (; i < self->events_tail; ++i) {
+            kaa_event_release(kaa_event_queue_at(self, i));
+        }
+        KAA_FREE(self->events);
+        KAA_FREE(self->sent_requests);
+        for (i = 0; i < self->event_callbacks_capacity; ++i) {
+            if (self->event_callbacks[i].fqn)
+                KAA_FREE(self->event_callbacks[i].fqn);
         }
+        if (self->event_callbacks)
+            KAA_FREE(self->event_callbacks);
+        if (self->event_fqn)
+            KAA_FREE(self->event_fqn);
+        kaa_list_destroy(self->coalesced_fqns, NULL);
+        if (self->event_views)
+            KAA_FREE(self->event_views);
+        kaa_list_destroy(self->transactions, &destroy_transaction);
+        kaa_list_destroy(self->event_listeners_requests, &destroy_event_listener_request);
+        kaa_list_destroy(self->event_listeners_cache, &destroy_event_listeners_cache_entry);
+        kaa_list_destroy(self->loopback_echoes, NULL);
         KAA_FREE(self);
     }
 }
 
+/*
+ * Fills everything but the data. The data is set once nothing can fail anymore,
+ * so the caller keeps it on errors.
+ */
 static kaa_error_t kaa_fill_event_structure(kaa_event_t *event
                                           , size_t sequence_number
                                           , const char *fqn
-                                          , const char *event_data
-                                          , size_t event_data_size
                                           , kaa_endpoint_id_p target)
 {
     KAA_RETURN_IF_NIL2(event, fqn, KAA_ERR_BADPARAM);
 
+    size_t fqn_size = strlen(fqn);
+    if (fqn_size > UINT16_MAX)
+        return KAA_ERR_EVENT_BAD_FQN;
+
+    memset(event, 0, sizeof(kaa_event_t));
     event->seq_num = sequence_number;
-    event->event_class_fqn = kaa_bytes_copy_create((const uint8_t *)fqn
-                                                 , strlen(fqn));
-    KAA_RETURN_IF_NIL(event->event_class_fqn, KAA_ERR_NOMEM);
+    event->fqn_size = fqn_size;
 
-    if (event_data && event_data_size > 0) {
-        event->event_data = kaa_bytes_move_create((const uint8_t *) event_data
-                                                , event_data_size
-                                                , &kaa_data_destroy);
-        KAA_RETURN_IF_NIL(event->event_data, KAA_ERR_NOMEM);
+    if (fqn_size > KAA_EVENT_INLINE_SIZE) {
+        event->fqn_buffer = (char *) KAA_MALLOC(fqn_size);
+        KAA_RETURN_IF_NIL(event->fqn_buffer, KAA_ERR_NOMEM);
+        memcpy(event->fqn_buffer, fqn, fqn_size);
+    } else {
+        memcpy(event->inline_buffer, fqn, fqn_size);
     }
 
     if (target) {
-        event->target = kaa_bytes_copy_create(target, KAA_ENDPOINT_ID_LENGTH);
-        KAA_RETURN_IF_NIL(event->target, KAA_ERR_NOMEM);
+        memcpy(event->target, target, KAA_ENDPOINT_ID_LENGTH);
+        event->has_target = true;
     }
 
     return KAA_ERR_NONE;
 }
 
-/*
- * @brief Sends raw event
- *
- * It is not recommended to use this function directly. Instead you should use
- * functions contained in EventClassFamily auto-generated headers (placed at src/event/)
- *
- * @param[in]       self                Valid pointer to the event manager instance.
- * @param[in]       fqn                 Fully-qualified name of the event (null-terminated string).
- * @param[in]       event_data          Serialized event object.
- * @param[in]       event_data_size     Size of data in event_data parameter.
- * @param[in]       target              The target endpoint of the event (null-terminated string). The size of
- *                                      the target parameter should be equal to @link KAA_ENDPOINT_ID_LENGTH @endlink .
- *                                      If @code NULL @endcode event will be broadcasted.
- *
- * @return Error code.
- */
 kaa_error_t kaa_event_manager_send_event(kaa_event_manager_t *self
                                        , const char *fqn
                                        , const char *event_data
@@ -357,15 +893,30 @@ kaa_error_t kaa_event_manager_send_event(kaa_event_manager_t *self
 
     KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Adding a new event \"%s\"", fqn);
 
-    /**
-     * KAA_CALLOC is really needed there.
-     */
-    kaa_event_t *event = (kaa_event_t*)KAA_CALLOC(1, sizeof(kaa_event_t));
-    if (!event) {
-        KAA_LOG_ERROR(self->logger, KAA_ERR_NOMEM, "Failed to allocate a new event structure");
-        return KAA_ERR_NOMEM;
+    if (self->loopback_group) {
+        kaa_event_view_t event = { fqn, strlen(fqn), event_data_size ? event_data : NULL, event_data_size, NULL };
+        if (kaa_event_loopback_deliver(self, &event, target, false)) {
+            KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Event \"%s\" was delivered to the resident target only", fqn);
+            if (event_data)
+                KAA_FREE((char *) event_data);
+            return KAA_ERR_NONE;
+        }
+    }
+
+    if (kaa_event_queue_coalesce(self, fqn, event_data, event_data_size, target)) {
+        KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Event \"%s\" replaced the pending one", fqn);
+        kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_EVENT);
+        return KAA_ERR_NONE;
+    }
+
+    kaa_error_t error = kaa_event_queue_reserve(self, 1);
+    if (error) {
+        KAA_LOG_WARN(self->logger, error, "Event queue is full (%zu events), event \"%s\" is rejected"
+                                                                        , self->events_count, fqn);
+        return error;
     }
 
+    kaa_event_t event;
     size_t new_sequence_number = (self->sequence_number_status == KAA_EVENT_SEQUENCE_NUMBER_SYNCHRONIZED ?
                                         ++self->event_sequence_number :
                                         (size_t) -1);
@@ -381,68 +932,97 @@ kaa_error_t kaa_event_manager_send_event(kaa_event_manager_t *self
         KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Event target = %s", target_string);
     }
 # endif
-    kaa_error_t error = kaa_fill_event_structure(event
+    error = kaa_fill_event_structure(&event
                                                     , new_sequence_number
                                                     , fqn
-                                                    , event_data
-                                                    , event_data_size
                                                     , target);
     if (error) {
         KAA_LOG_ERROR(self->logger, error, "Failed to fill a new event (size=%u)", event_data_size);
-        kaa_event_destroy(event);
         return error;
     }
 
-    if (self->pending_events) {
-        if (!kaa_list_push_back(self->pending_events, event)) {
-            KAA_LOG_ERROR(self->logger, KAA_ERR_NOMEM, "Failed to save a new event");
-            kaa_event_destroy(event);
-            return KAA_ERR_NOMEM;
-        }
-    } else {
-        self->pending_events = kaa_list_create(event);
-        if (!self->pending_events) {
-            KAA_LOG_ERROR(self->logger, KAA_ERR_NOMEM, "Failed to save a new event");
-            kaa_event_destroy(event);
-            return KAA_ERR_NOMEM;
-        }
-    }
+    kaa_event_set_data(&event, event_data, event_data_size);
+    kaa_event_queue_push(self, &event);
 
-    kaa_transport_channel_interface_t *channel =
-            kaa_channel_manager_get_transport_channel(self->channel_manager, event_sync_services[0]);
-    if (channel)
-        channel->sync_handler(channel->context, event_sync_services, 1);
+    kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_EVENT);
 
     return KAA_ERR_NONE;
 }
 
-static size_t kaa_event_list_get_request_size(kaa_list_t *events)
+kaa_error_t kaa_event_manager_set_queue_limit(kaa_event_manager_t *self
+                                            , size_t high_water_mark
+                                            , kaa_event_overflow_policy_t policy)
 {
-    size_t expected_size = 0;
-    kaa_event_t *event = (kaa_event_t *)kaa_list_get_data(events);
-    while (event) {
-        expected_size  += sizeof(uint32_t) /*Event sequence number*/
-                        + sizeof(uint16_t) /*Event options*/
-                        + sizeof(uint16_t); /*Event class FQN length */
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    if (!high_water_mark || high_water_mark > self->events_capacity)
+        return KAA_ERR_BADPARAM;
 
-        if (event->event_data) {
-            expected_size  += sizeof(uint32_t); /*Event data size*/
-        }
+    self->events_high_water_mark = high_water_mark;
+    self->overflow_policy = policy;
+    return KAA_ERR_NONE;
+}
 
-        if (event->target /*have Target Endpoint ID*/) {
-            expected_size += KAA_ENDPOINT_ID_LENGTH; /*Target Endpoint ID*/
-        }
+kaa_error_t kaa_event_manager_set_coalescing_policy(kaa_event_manager_t *self
+                                                  , const char *fqn
+                                                  , kaa_event_coalescing_policy_t policy)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    KAA_RETURN_IF_NIL(fqn, KAA_ERR_EVENT_BAD_FQN);
+
+    kaa_list_t *it = kaa_list_find_next(self->coalesced_fqns, &find_fqn, (void *) fqn);
+    if (policy == KAA_EVENT_COALESCE_NONE) {
+        if (it)
+            kaa_list_remove_at(&self->coalesced_fqns, it, NULL);
+        return KAA_ERR_NONE;
+    }
+    if (it)
+        return KAA_ERR_NONE;
 
-        expected_size += kaa_aligned_size_get(event->event_class_fqn->size); /*Event class FQN + padding */
+    size_t fqn_length = strlen(fqn);
+    char *fqn_copy = (char *) KAA_MALLOC(fqn_length + 1);
+    KAA_RETURN_IF_NIL(fqn_copy, KAA_ERR_NOMEM);
+    memcpy(fqn_copy, fqn, fqn_length + 1);
+
+    it = self->coalesced_fqns ? kaa_list_push_front(self->coalesced_fqns, fqn_copy)
+                              : kaa_list_create(fqn_copy);
+    if (!it) {
+        KAA_FREE(fqn_copy);
+        return KAA_ERR_NOMEM;
+    }
+    self->coalesced_fqns = it;
 
-        if (event->event_data) {
-            expected_size += kaa_aligned_size_get(event->event_data->size);/*Event data + padding*/
-        }
+    KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Pending \"%s\" events will be replaced by newer ones", fqn);
+    return KAA_ERR_NONE;
+}
 
-        events = kaa_list_next(events);
-        event = (kaa_event_t *) kaa_list_get_data(events);
+static bool kaa_event_has_unsent_listeners_requests(kaa_event_manager_t *self)
+{
+    kaa_list_t *cursor = self->event_listeners_requests;
+    while (cursor) {
+        if (!((kaa_event_listeners_request_t *) kaa_list_get_data(cursor))->is_sent)
+            return true;
+        cursor = kaa_list_next(cursor);
     }
-    return expected_size;
+    return false;
+}
+
+kaa_error_t kaa_event_need_event_resync(kaa_event_manager_t *self, bool *result)
+{
+    KAA_RETURN_IF_NIL2(self, result, KAA_ERR_BADPARAM);
+    *result = self->need_resync
+           || self->sequence_number_status != KAA_EVENT_SEQUENCE_NUMBER_SYNCHRONIZED
+           || self->pending_events_count
+           || kaa_event_has_unsent_listeners_requests(self);
+    return KAA_ERR_NONE;
+}
+
+/*
+ * Called by the platform protocol when the connection to the server is closed.
+ */
+void kaa_event_on_connection_lost(kaa_event_manager_t *self)
+{
+    KAA_RETURN_IF_NIL(self,);
+    self->need_resync = true;
 }
 
 static kaa_error_t kaa_event_request_get_size_no_header(kaa_event_manager_t *self, size_t *expected_size)
@@ -451,16 +1031,12 @@ static kaa_error_t kaa_event_request_get_size_no_header(kaa_event_manager_t *sel
 
     *expected_size = 0;
     if (self->sequence_number_status == KAA_EVENT_SEQUENCE_NUMBER_SYNCHRONIZED) {
-        kaa_list_t *pending_events = self->pending_events;
-        kaa_list_t *resending_events = self->events_awaiting_response.sent_events;
-        bool have_events = (kaa_list_get_size(pending_events) > 0) || (kaa_list_get_size(resending_events) > 0);
-        if (have_events) {
+        if (self->pending_events_count) {
             *expected_size += sizeof(uint32_t); // field id(1) + reserved + events count
-            *expected_size += kaa_event_list_get_request_size(pending_events);
-            *expected_size += kaa_event_list_get_request_size(resending_events);
+            *expected_size += self->pending_events_size;
         }
     }
-    if (self->event_listeners_requests) {
+    if (kaa_event_has_unsent_listeners_requests(self)) {
         *expected_size += sizeof(uint32_t); // field id(0) + reserved + listeners count
 
         kaa_list_t *cursor = self->event_listeners_requests;
@@ -497,15 +1073,16 @@ kaa_error_t kaa_event_request_get_size(kaa_event_manager_t *self, size_t *expect
     return KAA_ERR_NONE;
 }
 
-static kaa_error_t kaa_event_list_serialize(kaa_event_manager_t *self, kaa_list_t *events, kaa_platform_message_writer_t *writer)
+static kaa_error_t kaa_event_list_serialize(kaa_event_manager_t *self, kaa_platform_message_writer_t *writer)
 {
-    kaa_event_t * event = (kaa_event_t *) kaa_list_get_data(events);
     kaa_error_t error = KAA_ERR_NONE;
 
     uint16_t temp_network_order_16 = 0;
     uint32_t temp_network_order_32 = 0;
 
-    while (event) {
+    size_t i = self->events_pending;
+    for (; i < self->events_tail; ++i) {
+        kaa_event_t *event = kaa_event_queue_at(self, i);
         if (event->seq_num == -1) {
             event->seq_num = ++self->event_sequence_number;
         }
@@ -520,8 +1097,8 @@ static kaa_error_t kaa_event_list_serialize(kaa_event_manager_t *self, kaa_list_
         /**
          * Event options
          */
-        temp_network_order_16 = (!event->target ? 0 : KAA_EVENT_OPTION_TARGET_ID_PRESENT)
-                              | (event->event_data ? KAA_EVENT_OPTION_EVENT_HAS_DATA : 0);
+        temp_network_order_16 = (!event->has_target ? 0 : KAA_EVENT_OPTION_TARGET_ID_PRESENT)
+                              | (event->data_size ? KAA_EVENT_OPTION_EVENT_HAS_DATA : 0);
         temp_network_order_16 = KAA_HTONS(temp_network_order_16);
 
         error = kaa_platform_message_write(writer, &temp_network_order_16, sizeof(uint16_t));
@@ -530,15 +1107,15 @@ static kaa_error_t kaa_event_list_serialize(kaa_event_manager_t *self, kaa_list_
             return error;
         }
 
-        temp_network_order_16 = KAA_HTONS(event->event_class_fqn->size);
+        temp_network_order_16 = KAA_HTONS(event->fqn_size);
         error = kaa_platform_message_write(writer, &temp_network_order_16, sizeof(uint16_t));
         if (error) {
             KAA_LOG_ERROR(self->logger, error, "Failed to write event class fqn length");
             return error;
         }
 
-        if (event->event_data) {
-            temp_network_order_32 = KAA_HTONL(event->event_data->size);
+        if (event->data_size) {
+            temp_network_order_32 = KAA_HTONL(event->data_size);
             error = kaa_platform_message_write(writer, &temp_network_order_32, sizeof(uint32_t));
             if (error) {
                 KAA_LOG_ERROR(self->logger, error, "Failed to write event data size");
@@ -546,9 +1123,9 @@ static kaa_error_t kaa_event_list_serialize(kaa_event_manager_t *self, kaa_list_
             }
         }
 
-        if (event->target) {
+        if (event->has_target) {
             error = kaa_platform_message_write_aligned(writer,
-                                                            event->target->buffer
+                                                            event->target
                                                           , KAA_ENDPOINT_ID_LENGTH);
             if (error) {
                 KAA_LOG_ERROR(self->logger, error, "Failed to write event target id");
@@ -557,30 +1134,28 @@ static kaa_error_t kaa_event_list_serialize(kaa_event_manager_t *self, kaa_list_
         }
 
         error = kaa_platform_message_write_aligned(writer
-                                                      , event->event_class_fqn->buffer
-                                                      , event->event_class_fqn->size);
+                                                      , kaa_event_get_fqn(event)
+                                                      , event->fqn_size);
         if (error) {
             KAA_LOG_ERROR(self->logger, error, "Failed to write event class fqn aligned");
             return error;
         }
 
-        if (event->event_data) {
+        if (event->data_size) {
             error = kaa_platform_message_write_aligned(writer
-                                                          , event->event_data->buffer
-                                                          , event->event_data->size);
+                                                          , kaa_event_get_data(event)
+                                                          , event->data_size);
             if (error) {
                 KAA_LOG_ERROR(self->logger, error, "Failed to write event data aligned");
                 return error;
             }
         }
-
-        events = kaa_list_next(events);
-        event = (kaa_event_t *) kaa_list_get_data(events);
     }
     return KAA_ERR_NONE;
 }
 
-static kaa_error_t kaa_event_listeners_request_serialize(kaa_event_manager_t *self, kaa_platform_message_writer_t *writer, uint16_t *listeners_count)
+static kaa_error_t kaa_event_listeners_request_serialize(kaa_event_manager_t *self, size_t request_id
+                                                        , kaa_platform_message_writer_t *writer, uint16_t *listeners_count)
 {
     uint16_t count = 0;
     kaa_list_t *cursor = self->event_listeners_requests;
@@ -604,6 +1179,7 @@ static kaa_error_t kaa_event_listeners_request_serialize(kaa_event_manager_t *se
             }
             ++count;
             request->is_sent = true;
+            request->sync_request_id = request_id;
         }
         cursor = kaa_list_next(cursor);
     }
@@ -634,50 +1210,34 @@ kaa_error_t kaa_event_request_serialize(kaa_event_manager_t *self, size_t reques
                                         , KAA_EVENT_EXTENSION_TYPE, extension_options, self->extension_payload_size);
         return error;
     }
+    self->need_resync = false;
 
     /* write events */
     if (self->extension_payload_size) {
-        uint16_t events_count = 0;
-        kaa_list_t *pending_events = self->pending_events;
-        kaa_list_t *resending_events = self->events_awaiting_response.sent_events;
-
-        ssize_t pending_events_count = kaa_list_get_size(pending_events);
-        ssize_t sent_events_count = kaa_list_get_size(resending_events);
-
-        events_count +=  pending_events_count > 0 ? pending_events_count : 0;
-        events_count +=  sent_events_count > 0 ? sent_events_count : 0;
-
+        uint16_t events_count = self->pending_events_count;
         if (events_count) {
             *((uint8_t *) writer->current) = EVENTS_FIELD;
             writer->current += sizeof(uint16_t); // field id + reserved
             *((uint16_t *) writer->current) = KAA_HTONS(events_count);
             writer->current += sizeof(uint16_t);
 
-            error = kaa_event_list_serialize(self, resending_events, writer);
-            if (error) {
-                KAA_LOG_ERROR(self->logger, error, "Failed to write events");
-                return error;
-            }
-
-            error = kaa_event_list_serialize(self, pending_events, writer);
+            error = kaa_event_list_serialize(self, writer);
             if (error) {
                 KAA_LOG_ERROR(self->logger, error, "Failed to write events");
                 return error;
             }
 
-            self->events_awaiting_response.request_id = request_id;
-            self->events_awaiting_response.sent_events = kaa_lists_merge(self->events_awaiting_response.sent_events
-                                                                       , self->pending_events);
-            self->pending_events = NULL;
+            /* The events wait for the server sync of this request */
+            kaa_event_queue_send(self, request_id);
         }
-        if (self->event_listeners_requests) {
+        if (kaa_event_has_unsent_listeners_requests(self)) {
             *((uint8_t *) writer->current) = EVENT_LISTENERS_FIELD;
             writer->current += sizeof(uint16_t); // field id + reserved
             char *listeners_count_p = writer->current; // Pointer to the listeners count. Will be filled in later
             writer->current += sizeof(uint16_t);
 
             uint16_t listeners_count = 0;
-            error = kaa_event_listeners_request_serialize(self, writer, &listeners_count);
+            error = kaa_event_listeners_request_serialize(self, request_id, writer, &listeners_count);
             if (error) {
                 KAA_LOG_ERROR(self->logger, error, "Failed to serialize event listeners request");
                 return error;
@@ -688,10 +1248,195 @@ kaa_error_t kaa_event_request_serialize(kaa_event_manager_t *self, size_t reques
     return KAA_ERR_NONE;
 }
 
-static kaa_error_t kaa_event_read_event(kaa_event_manager_t *self, kaa_platform_message_reader_t *reader)
+static kaa_error_t kaa_event_views_reserve(kaa_event_manager_t *self, size_t count)
 {
+    if (count <= self->event_views_capacity)
+        return KAA_ERR_NONE;
 
-    KAA_RETURN_IF_NIL2(self, reader, KAA_ERR_BADPARAM);
+    size_t new_capacity = 2 * self->event_views_capacity;
+    if (new_capacity < count)
+        new_capacity = count;
+
+    kaa_event_view_t *new_views = (kaa_event_view_t *) KAA_MALLOC(new_capacity * sizeof(kaa_event_view_t));
+    KAA_RETURN_IF_NIL(new_views, KAA_ERR_NOMEM);
+
+    if (self->event_views) {
+        memcpy(new_views, self->event_views, self->event_views_count * sizeof(kaa_event_view_t));
+        KAA_FREE(self->event_views);
+    }
+    self->event_views = new_views;
+    self->event_views_capacity = new_capacity;
+    return KAA_ERR_NONE;
+}
+
+static kaa_error_t kaa_event_dispatch(kaa_event_manager_t *self, const kaa_event_view_t *event)
+{
+    kaa_event_callback_t callback = NULL;
+    const char *callback_fqn = NULL;
+
+    event_callback_pair_t *pair = find_event_callback(self, event->fqn, event->fqn_length
+                                                    , kaa_event_fqn_hash(event->fqn, event->fqn_length));
+    if (pair && pair->fqn) {
+        callback = pair->cb;
+        callback_fqn = pair->fqn;
+    } else if (self->global_event_callback) {
+        if (self->event_fqn_size <= event->fqn_length) {
+            if (self->event_fqn)
+                KAA_FREE(self->event_fqn);
+            self->event_fqn_size = 0;
+            self->event_fqn = (char *) KAA_MALLOC(event->fqn_length + 1);
+            KAA_RETURN_IF_NIL(self->event_fqn, KAA_ERR_NOMEM);
+            self->event_fqn_size = event->fqn_length + 1;
+        }
+        memcpy(self->event_fqn, event->fqn, event->fqn_length);
+        self->event_fqn[event->fqn_length] = '\0';
+
+        callback = self->global_event_callback;
+        callback_fqn = self->event_fqn;
+    }
+
+    if (callback && self->deferred_events) {
+        kaa_deferred_event_t *deferred = (kaa_deferred_event_t *)
+                KAA_MALLOC(sizeof(kaa_deferred_event_t) + event->fqn_length + 1 + event->data_size);
+        KAA_RETURN_IF_NIL(deferred, KAA_ERR_NOMEM);
+
+        deferred->callback = callback;
+        memcpy(deferred->source, event->source, KAA_ENDPOINT_ID_LENGTH);
+        memcpy(deferred->fqn, callback_fqn, event->fqn_length + 1);
+        deferred->data = NULL;
+        deferred->data_size = event->data_size;
+        if (event->data) {
+            deferred->data = deferred->fqn + event->fqn_length + 1;
+            memcpy((char *) deferred->data, event->data, event->data_size);
+        }
+
+        if (kaa_spsc_queue_push(self->deferred_events, deferred)) {
+            KAA_LOG_WARN(self->logger, KAA_ERR_EVENT_QUEUE_FULL, "Deferred event queue is full, dropping event with FQN=\"%s\"", callback_fqn);
+            KAA_FREE(deferred);
+            return KAA_ERR_EVENT_QUEUE_FULL;
+        }
+        if (self->deferred_notify)
+            self->deferred_notify(self->deferred_notify_context);
+    } else if (callback) {
+        (*callback)(callback_fqn, event->data, event->data_size, event->source);
+    }
+    return KAA_ERR_NONE;
+}
+
+static kaa_event_manager_t *kaa_event_loopback_find(kaa_event_loopback_group_t *group, const uint8_t *endpoint_id)
+{
+    kaa_list_t *cursor = group->members;
+    while (cursor) {
+        kaa_event_manager_t *member = (kaa_event_manager_t *) kaa_list_get_data(cursor);
+        if (!memcmp(member->status->endpoint_public_key_hash, endpoint_id, KAA_ENDPOINT_ID_LENGTH))
+            return member;
+        cursor = kaa_list_next(cursor);
+    }
+    return NULL;
+}
+
+static uint32_t kaa_event_loopback_fingerprint(const kaa_event_view_t *event)
+{
+    return kaa_event_fqn_hash(event->fqn, event->fqn_length) * 31 + kaa_event_fqn_hash(event->data, event->data_size);
+}
+
+static bool kaa_event_loopback_echo_matches(void *data, void *context)
+{
+    const kaa_event_loopback_echo_t *echo = (const kaa_event_loopback_echo_t *) data;
+    const kaa_event_loopback_echo_t *event = (const kaa_event_loopback_echo_t *) context;
+    return echo->fingerprint == event->fingerprint && !memcmp(echo->source, event->source, KAA_ENDPOINT_ID_LENGTH);
+}
+
+/*
+ * Remembers the event the member got from the group which the server is going to deliver to it as well.
+ * At most KAA_EVENT_QUEUE_CAPACITY echoes are remembered, the oldest one is forgotten first.
+ */
+static void kaa_event_loopback_expect_echo(kaa_event_manager_t *member, const kaa_event_view_t *event)
+{
+    if (member->loopback_echoes_count == KAA_EVENT_QUEUE_CAPACITY) {
+        kaa_list_remove_at(&member->loopback_echoes, member->loopback_echoes, NULL);
+        --member->loopback_echoes_count;
+    }
+
+    kaa_event_loopback_echo_t *echo = (kaa_event_loopback_echo_t *) KAA_MALLOC(sizeof(kaa_event_loopback_echo_t));
+    KAA_RETURN_IF_NIL(echo,);
+    memcpy(echo->source, event->source, KAA_ENDPOINT_ID_LENGTH);
+    echo->fingerprint = kaa_event_loopback_fingerprint(event);
+
+    kaa_list_t *it = member->loopback_echoes ?
+                        kaa_list_push_back(member->loopback_echoes, echo) :
+                        kaa_list_create(echo);
+    if (!it) {
+        KAA_FREE(echo);
+        return;
+    }
+    if (!member->loopback_echoes)
+        member->loopback_echoes = it;
+    ++member->loopback_echoes_count;
+}
+
+/*
+ * Returns true if the event received from the server was already delivered by the group.
+ */
+static bool kaa_event_loopback_take_echo(kaa_event_manager_t *self, const kaa_event_view_t *event)
+{
+    kaa_event_loopback_echo_t key;
+    memcpy(key.source, event->source, KAA_ENDPOINT_ID_LENGTH);
+    key.fingerprint = kaa_event_loopback_fingerprint(event);
+
+    if (kaa_list_remove_first(&self->loopback_echoes, &kaa_event_loopback_echo_matches, &key, NULL))
+        return false;
+    --self->loopback_echoes_count;
+    return true;
+}
+
+static void kaa_event_loopback_dispatch(kaa_event_manager_t *member, const kaa_event_view_t *event, bool is_forwarded)
+{
+    if (is_forwarded)
+        kaa_event_loopback_expect_echo(member, event);
+
+    if (member->batch_event_callback)
+        member->batch_event_callback(member->batch_event_context, event, 1);
+    else
+        kaa_event_dispatch(member, event);
+}
+
+/*
+ * Passes the event sent by the endpoint to the attached members of its loopback group
+ * it is meant for. is_forwarded tells the event is sent to the server whatever the policy is.
+ * Returns true if the event must not be sent to the server.
+ */
+static bool kaa_event_loopback_deliver(kaa_event_manager_t *self, kaa_event_view_t *event
+                                     , kaa_endpoint_id_p target, bool is_forwarded)
+{
+    if (!self->status->is_attached)
+        return false;
+
+    event->source = self->status->endpoint_public_key_hash;
+
+    if (target) {
+        kaa_event_manager_t *member = kaa_event_loopback_find(self->loopback_group, target);
+        if (!member || member == self || !member->status->is_attached)
+            return false;
+        bool is_local = !is_forwarded && self->loopback_group->policy == KAA_EVENT_LOOPBACK_FORWARD_NON_LOCAL;
+        kaa_event_loopback_dispatch(member, event, !is_local);
+        return is_local;
+    }
+
+    kaa_list_t *cursor = self->loopback_group->members;
+    while (cursor) {
+        kaa_event_manager_t *member = (kaa_event_manager_t *) kaa_list_get_data(cursor);
+        cursor = kaa_list_next(cursor);
+        if (member != self && member->status->is_attached)
+            kaa_event_loopback_dispatch(member, event, true);
+    }
+    return false;
+}
+
+static kaa_error_t kaa_event_read_event(kaa_event_manager_t *self, kaa_platform_message_reader_t *reader, kaa_event_view_t *event)
+{
+
+    KAA_RETURN_IF_NIL3(self, reader, event, KAA_ERR_BADPARAM);
 
     KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Event received");
 
@@ -721,8 +1466,9 @@ static kaa_error_t kaa_event_read_event(kaa_event_manager_t *self, kaa_platform_
         event_data_size = KAA_NTOHL(event_data_size);
     }
 
-    error = kaa_platform_message_read(reader, (void*)self->event_source, sizeof(kaa_endpoint_id));
-
+    /* The source, the FQN and the data are referenced right in the reader's buffer */
+    event->source = (kaa_endpoint_id_p) reader->current;
+    error = kaa_platform_message_skip(reader, sizeof(kaa_endpoint_id));
     if (error) {
         KAA_LOG_ERROR(self->logger, error, "Failed to read event source endpoint id field");
         return error;
@@ -734,43 +1480,65 @@ static kaa_error_t kaa_event_read_event(kaa_event_manager_t *self, kaa_platform_
         KAA_LOG_ERROR(self->logger, KAA_ERR_READ_FAILED, "Buffer size is less than event class fqn length value");
         return KAA_ERR_READ_FAILED;
     }
-    char* event_fqn = (char *)KAA_MALLOC(event_class_fqn_length + 1);
-
-    KAA_RETURN_IF_NIL(event_fqn, KAA_ERR_NOMEM);
-
-    error = kaa_platform_message_read_aligned(reader, event_fqn, event_class_fqn_length);
-
-    if (error) {
-        KAA_LOG_ERROR(self->logger, error, "Failed to read event class fqn field");
-        KAA_FREE(event_fqn);
-        return error;
-    }
-    event_fqn[event_class_fqn_length] = '\0';
 
-    KAA_LOG_DEBUG(self->logger, KAA_ERR_NONE, "Processing event with FQN=\"%s\"", event_fqn);
+    event->fqn = reader->current;
+    event->fqn_length = event_class_fqn_length;
+    reader->current += kaa_aligned_size_get(event_class_fqn_length);
 
-    kaa_event_callback_t callback = find_event_callback(self->event_callbacks, event_fqn);
-    if (!callback)
-        callback = self->global_event_callback;
+    KAA_LOG_DEBUG(self->logger, KAA_ERR_NONE, "Processing event with FQN=\"%.*s\""
+                                                    , (int) event->fqn_length, event->fqn);
 
+    event->data = NULL;
+    event->data_size = 0;
     if (event_options & KAA_EVENT_OPTION_EVENT_HAS_DATA) {
-        const char* event_data = reader->current;
-        kaa_error_t error = kaa_platform_message_skip(reader, kaa_aligned_size_get(event_data_size));
+        event->data = reader->current;
+        event->data_size = event_data_size;
+        error = kaa_platform_message_skip(reader, kaa_aligned_size_get(event_data_size));
         if (error) {
              KAA_LOG_ERROR(self->logger, error, "Failed to read event data, size %u", event_data_size);
-             KAA_FREE(event_fqn);
              return error;
         }
         KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Successfully retrieved event data size=%u", event_data_size);
-        if (callback)
-            (*callback)(event_fqn, event_data, event_data_size, self->event_source);
-    } else if (callback) {
-        (*callback)(event_fqn, NULL, 0, self->event_source);
     }
-    KAA_FREE(event_fqn);
     return KAA_ERR_NONE;
 }
 
+/*
+ * Caches the listeners found by the request. The request gives its FQNs away to the cache entry.
+ */
+static void kaa_event_listeners_cache_put(kaa_event_manager_t *self, kaa_event_listeners_request_t *request
+                                        , const kaa_endpoint_id *listeners, size_t listeners_count)
+{
+    kaa_event_listeners_cache_entry_t *entry =
+            (kaa_event_listeners_cache_entry_t *) KAA_CALLOC(1, sizeof(kaa_event_listeners_cache_entry_t));
+    KAA_RETURN_IF_NIL(entry,);
+
+    if (listeners_count) {
+        entry->listeners = (kaa_endpoint_id *) KAA_MALLOC(listeners_count * sizeof(kaa_endpoint_id));
+        if (!entry->listeners) {
+            destroy_event_listeners_cache_entry(entry);
+            return;
+        }
+        memcpy(entry->listeners, listeners, listeners_count * sizeof(kaa_endpoint_id));
+    }
+    entry->listeners_count = listeners_count;
+    entry->expires_at = KAA_TIME_MS() + self->event_listeners_cache_ttl;
+
+    kaa_list_t *entry_it = self->event_listeners_cache ?
+                           kaa_list_push_front(self->event_listeners_cache, entry) :
+                           kaa_list_create(entry);
+    if (!entry_it) {
+        destroy_event_listeners_cache_entry(entry);
+        return;
+    }
+    self->event_listeners_cache = entry_it;
+
+    entry->fqns = request->fqns;
+    entry->fqns_count = request->fqns_count;
+    entry->fqns_hash = request->fqns_hash;
+    request->fqns = NULL;
+}
+
 static kaa_error_t kaa_event_read_listeners_response(kaa_event_manager_t *self, kaa_platform_message_reader_t *reader)
 {
     uint16_t request_id = KAA_NTOHS(*(uint16_t *) reader->current);
@@ -792,14 +1560,32 @@ static kaa_error_t kaa_event_read_listeners_response(kaa_event_manager_t *self,
             return KAA_ERR_READ_FAILED;
         }
         kaa_event_listeners_request_t *request = (kaa_event_listeners_request_t *) kaa_list_get_data(request_node);
+        /* Unlinked first, so searches made from the callbacks don't join the finished request */
+        kaa_list_remove_at(&self->event_listeners_requests, request_node, &keep_list_data);
+
+        const kaa_endpoint_id *listeners = (const kaa_endpoint_id *) reader->current;
         if (listeners_result == EVENT_LISTENERS_SUCCESS) {
-            request->callback.on_event_listeners(request->callback.context, (const kaa_endpoint_id *) reader->current, listeners_count);
+            if (self->event_listeners_cache_ttl)
+                kaa_event_listeners_cache_put(self, request, listeners, listeners_count);
+            request->callback.on_event_listeners(request->callback.context, listeners, listeners_count);
+            kaa_list_t *cursor = request->waiters;
+            while (cursor) {
+                kaa_event_listeners_callback_t *waiter = (kaa_event_listeners_callback_t *) kaa_list_get_data(cursor);
+                waiter->on_event_listeners(waiter->context, listeners, listeners_count);
+                cursor = kaa_list_next(cursor);
+            }
             KAA_LOG_DEBUG(self->logger, KAA_ERR_NONE, "Success event listeners response for request id %u", request_id);
         } else {
             request->callback.on_event_listeners_failed(request->callback.context);
+            kaa_list_t *cursor = request->waiters;
+            while (cursor) {
+                kaa_event_listeners_callback_t *waiter = (kaa_event_listeners_callback_t *) kaa_list_get_data(cursor);
+                waiter->on_event_listeners_failed(waiter->context);
+                cursor = kaa_list_next(cursor);
+            }
             KAA_LOG_DEBUG(self->logger, KAA_ERR_NONE, "Failed to find event listeners, request id %u", request_id);
         }
-        kaa_list_remove_at(&self->event_listeners_requests, request_node, &destroy_event_listener_request);
+        destroy_event_listener_request(request);
     } else {
         KAA_LOG_WARN(self->logger, KAA_ERR_NOT_FOUND, "Failed to find event listeners callback with request id %u", request_id);
     }
@@ -835,27 +1621,20 @@ kaa_error_t kaa_event_handle_server_sync(kaa_event_manager_t *self
             if (self->event_sequence_number != event_sequence_number) {
                 KAA_LOG_WARN(self->logger, KAA_ERR_BAD_STATE, "Stored event sequence number is not correct (stored %u, received %u).", self->event_sequence_number, event_sequence_number);
                 self->event_sequence_number = event_sequence_number;
-                kaa_list_t *events = self->pending_events;
-                kaa_event_t *event = (kaa_event_t *)kaa_list_get_data(events);
-                while (event) {
-                    event->seq_num = ++self->event_sequence_number;
-                    events = kaa_list_next(events);
-                    event = (kaa_event_t *)kaa_list_get_data(events);
-                }
+                size_t i = self->events_pending;
+                for (; i < self->events_tail; ++i)
+                    kaa_event_queue_at(self, i)->seq_num = ++self->event_sequence_number;
             }
         }
-        if (kaa_list_get_size(self->pending_events) > 0) {
-            kaa_transport_channel_interface_t *channel =
-                    kaa_channel_manager_get_transport_channel(self->channel_manager, event_sync_services[0]);
-            if (channel)
-                channel->sync_handler(channel->context, event_sync_services, 1);
+        if (self->pending_events_count) {
+            kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_EVENT);
         }
     }
 
-    if (request_id == self->events_awaiting_response.request_id) {
-        kaa_list_destroy(self->events_awaiting_response.sent_events, &kaa_event_destroy);
-        self->events_awaiting_response.sent_events = NULL;
-        self->events_awaiting_response.request_id = (size_t) -1;
+    self->event_views_count = 0;
+
+    if (kaa_event_queue_release_request(self, request_id)) {
+        KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Events sent in request %zu are delivered", request_id);
     }
 
     while (extension_length > 0) {
@@ -883,12 +1662,28 @@ kaa_error_t kaa_event_handle_server_sync(kaa_event_manager_t *self
                 }
 
                 events_count = KAA_NTOHS(events_count);
+                if (self->batch_event_callback) {
+                    error = kaa_event_views_reserve(self, self->event_views_count + events_count);
+                    if (error) {
+                        KAA_LOG_ERROR(self->logger, error, "Failed to allocate %u event views", events_count);
+                        return error;
+                    }
+                }
                 while (events_count--) {
-                    error = kaa_event_read_event(self, reader);
+                    kaa_event_view_t event;
+                    error = kaa_event_read_event(self, reader, &event);
                     if (error) {
                         KAA_LOG_ERROR(self->logger, error, "Failed to read event from server sync");
                         return error;
                     }
+                    if (self->loopback_echoes && kaa_event_loopback_take_echo(self, &event)) {
+                        KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Skipping event from a resident endpoint, it was delivered locally");
+                        continue;
+                    }
+                    if (self->batch_event_callback)
+                        self->event_views[self->event_views_count++] = event;
+                    else
+                        kaa_event_dispatch(self, &event);
                 }
                 break;
             }
@@ -921,6 +1716,42 @@ kaa_error_t kaa_event_handle_server_sync(kaa_event_manager_t *self
         extension_length -= (reader->current - field_id_pos);
     }
 
+    if (self->event_views_count) {
+        KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Delivering %zu event(s) to the batch callback", self->event_views_count);
+        self->batch_event_callback(self->batch_event_context, self->event_views, self->event_views_count);
+        self->event_views_count = 0;
+    }
+
+    return KAA_ERR_NONE;
+}
+
+/*
+ * Called by the platform protocol when the server sync for the request will
+ * never arrive. Events sent in it go out again with the next event sync.
+ */
+kaa_error_t kaa_event_on_sync_lost(kaa_event_manager_t *self, size_t request_id)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+
+    size_t lost_requests_count = 0;
+    kaa_list_t *cursor = self->event_listeners_requests;
+    while (cursor) {
+        kaa_event_listeners_request_t *request = (kaa_event_listeners_request_t *) kaa_list_get_data(cursor);
+        if (request->is_sent && request->sync_request_id == request_id) {
+            request->is_sent = false;
+            ++lost_requests_count;
+        }
+        cursor = kaa_list_next(cursor);
+    }
+
+    size_t lost_count = kaa_event_queue_resend_request(self, request_id);
+
+    if (!lost_count && !lost_requests_count)
+        return KAA_ERR_NOT_FOUND;
+
+    KAA_LOG_WARN(self->logger, KAA_ERR_NONE, "%zu events and %zu listener searches sent in request %zu are lost, "
+                                "going to resend them", lost_count, lost_requests_count, request_id);
+    kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_EVENT);
     return KAA_ERR_NONE;
 }
 
@@ -928,6 +1759,51 @@ kaa_error_t kaa_event_manager_find_event_listeners(kaa_event_manager_t *self, co
 {
     KAA_RETURN_IF_NIL5(self, fqns_count, callback, callback->on_event_listeners, callback->on_event_listeners_failed, KAA_ERR_BADPARAM);
 
+    uint32_t fqns_hash = kaa_event_fqns_hash(fqns, fqns_count);
+
+    kaa_time_ms_t now = KAA_TIME_MS();
+    kaa_list_t *cursor = self->event_listeners_cache;
+    while (cursor) {
+        kaa_event_listeners_cache_entry_t *entry = (kaa_event_listeners_cache_entry_t *) kaa_list_get_data(cursor);
+        if (entry->expires_at <= now) {
+            kaa_list_t *expired = cursor;
+            cursor = kaa_list_next(cursor);
+            kaa_list_remove_at(&self->event_listeners_cache, expired, &destroy_event_listeners_cache_entry);
+            continue;
+        }
+        if (kaa_event_fqns_match(entry->fqns, entry->fqns_count, entry->fqns_hash, fqns, fqns_count, fqns_hash)) {
+            KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Found %zu cached event listener(s)", entry->listeners_count);
+            callback->on_event_listeners(callback->context, (const kaa_endpoint_id *) entry->listeners, entry->listeners_count);
+            return KAA_ERR_NONE;
+        }
+        cursor = kaa_list_next(cursor);
+    }
+
+    cursor = self->event_listeners_requests;
+    while (cursor) {
+        kaa_event_listeners_request_t *request = (kaa_event_listeners_request_t *) kaa_list_get_data(cursor);
+        if (kaa_event_fqns_match(request->fqns, request->fqns_count, request->fqns_hash, fqns, fqns_count, fqns_hash)) {
+            kaa_event_listeners_callback_t *waiter =
+                    (kaa_event_listeners_callback_t *) KAA_MALLOC(sizeof(kaa_event_listeners_callback_t));
+            KAA_RETURN_IF_NIL(waiter, KAA_ERR_NOMEM);
+            *waiter = *callback;
+
+            kaa_list_t *waiter_it = request->waiters ?
+                                    kaa_list_push_back(request->waiters, waiter) :
+                                    kaa_list_create(waiter);
+            if (!waiter_it) {
+                KAA_FREE(waiter);
+                return KAA_ERR_NOMEM;
+            }
+            if (!request->waiters)
+                request->waiters = waiter_it;
+
+            KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Joined event listeners request %u", request->request_id);
+            return KAA_ERR_NONE;
+        }
+        cursor = kaa_list_next(cursor);
+    }
+
     kaa_event_listeners_request_t *subscriber = create_event_listener_request(++self->event_listeners_request_id
                                                                                , fqns, fqns_count
                                                                                , callback);
@@ -944,13 +1820,76 @@ kaa_error_t kaa_event_manager_find_event_listeners(kaa_event_manager_t *self, co
     }
     self->event_listeners_requests = request_it;
 
-    kaa_transport_channel_interface_t *channel = kaa_channel_manager_get_transport_channel(self->channel_manager, event_sync_services[0]);
-    if (channel)
-        channel->sync_handler(channel->context, event_sync_services, 1);
+    kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_EVENT);
 
     return KAA_ERR_NONE;
 }
 
+/*
+ * Called by the user manager when the endpoint is attached to or detached from a user,
+ * which changes the set of the event listeners.
+ */
+void kaa_event_manager_invalidate_listeners_cache(kaa_event_manager_t *self)
+{
+    KAA_RETURN_IF_NIL(self,);
+    kaa_list_destroy(self->event_listeners_cache, &destroy_event_listeners_cache_entry);
+    self->event_listeners_cache = NULL;
+}
+
+kaa_error_t kaa_event_manager_set_listeners_cache_ttl(kaa_event_manager_t *self, uint32_t ttl_ms)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+
+    self->event_listeners_cache_ttl = ttl_ms;
+    if (!ttl_ms)
+        kaa_event_manager_invalidate_listeners_cache(self);
+    return KAA_ERR_NONE;
+}
+
+kaa_error_t kaa_event_loopback_group_create(kaa_event_loopback_group_t **group_p, kaa_event_loopback_policy_t policy)
+{
+    KAA_RETURN_IF_NIL(group_p, KAA_ERR_BADPARAM);
+
+    *group_p = (kaa_event_loopback_group_t *) KAA_MALLOC(sizeof(kaa_event_loopback_group_t));
+    KAA_RETURN_IF_NIL(*group_p, KAA_ERR_NOMEM);
+
+    (*group_p)->members = NULL;
+    (*group_p)->policy = policy;
+    return KAA_ERR_NONE;
+}
+
+void kaa_event_loopback_group_destroy(kaa_event_loopback_group_t *group)
+{
+    KAA_RETURN_IF_NIL(group,);
+    while (group->members)
+        kaa_event_manager_join_loopback_group((kaa_event_manager_t *) kaa_list_get_data(group->members), NULL);
+    KAA_FREE(group);
+}
+
+kaa_error_t kaa_event_manager_join_loopback_group(kaa_event_manager_t *self, kaa_event_loopback_group_t *group)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+
+    if (self->loopback_group == group)
+        return KAA_ERR_NONE;
+
+    if (self->loopback_group) {
+        kaa_list_remove_first(&self->loopback_group->members, &find_by_pointer, self, &keep_list_data);
+        self->loopback_group = NULL;
+    }
+
+    if (group) {
+        kaa_list_t *member_it = group->members ?
+                                kaa_list_push_back(group->members, self) :
+                                kaa_list_create(self);
+        KAA_RETURN_IF_NIL(member_it, KAA_ERR_NOMEM);
+        if (!group->members)
+            group->members = member_it;
+        self->loopback_group = group;
+    }
+    return KAA_ERR_NONE;
+}
+
 /*
  * @brief Register listener to an event.
  *
@@ -970,29 +1909,26 @@ kaa_error_t kaa_event_manager_add_on_event_callback(kaa_event_manager_t *self, c
     KAA_RETURN_IF_NIL2(self, callback, KAA_ERR_BADPARAM);
     if (fqn) {
         KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Adding callback for events with fqn '%s'", fqn);
-        event_callback_pair_t *pair = create_event_callback_pair(fqn, callback);
-        KAA_RETURN_IF_NIL(pair, KAA_ERR_NOMEM);
-        if (!self->event_callbacks) {
-            self->event_callbacks = kaa_list_create(pair);
-            if (!self->event_callbacks) {
-                kaa_event_destroy_callback_pair(pair);
-                return KAA_ERR_NOMEM;
-            }
-        } else {
-            kaa_list_t *head = self->event_callbacks;
-            while (head) {
-                event_callback_pair_t *data = (event_callback_pair_t *) kaa_list_get_data(head);
-                if (strcmp(fqn, data->fqn) == 0) {
-                    kaa_list_set_data_at(head, pair, &kaa_event_destroy_callback_pair);
-                    return KAA_ERR_NONE;
-                }
-                head = kaa_list_next(head);
-            }
-            if (!kaa_list_push_back(self->event_callbacks, pair)) {
-                kaa_event_destroy_callback_pair(pair);
-                return KAA_ERR_NOMEM;
-            }
+
+        /* Keep the load factor under 3/4 */
+        if ((self->event_callbacks_count + 1) * 4 > self->event_callbacks_capacity * 3) {
+            kaa_error_t error = resize_event_callbacks(self, self->event_callbacks_capacity ?
+                                    2 * self->event_callbacks_capacity : KAA_EVENT_CALLBACKS_INITIAL_CAPACITY);
+            KAA_RETURN_IF_ERR(error);
+        }
+
+        size_t fqn_length = strlen(fqn);
+        uint32_t hash = kaa_event_fqn_hash(fqn, fqn_length);
+        event_callback_pair_t *pair = find_event_callback(self, fqn, fqn_length, hash);
+        if (!pair->fqn) {
+            pair->fqn = (char *) KAA_MALLOC(fqn_length + 1);
+            KAA_RETURN_IF_NIL(pair->fqn, KAA_ERR_NOMEM);
+            memcpy(pair->fqn, fqn, fqn_length + 1);
+            pair->fqn_length = fqn_length;
+            pair->hash = hash;
+            ++self->event_callbacks_count;
         }
+        pair->cb = callback;
     } else {
         KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Adding global event callback");
         self->global_event_callback = callback;
@@ -1000,6 +1936,69 @@ kaa_error_t kaa_event_manager_add_on_event_callback(kaa_event_manager_t *self, c
     return KAA_ERR_NONE;
 }
 
+kaa_error_t kaa_event_manager_set_batch_callback(kaa_event_manager_t *self, kaa_event_batch_callback_t callback, void *context)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "%s batch event callback", callback ? "Setting" : "Removing");
+    self->batch_event_callback = callback;
+    self->batch_event_context = context;
+    return KAA_ERR_NONE;
+}
+
+kaa_error_t kaa_event_manager_set_deferred_dispatch(kaa_event_manager_t *self, size_t capacity)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+
+    kaa_event_destroy_deferred_events(self);
+    if (!capacity) {
+        KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Event callbacks are called from the network thread");
+        return KAA_ERR_NONE;
+    }
+
+    kaa_error_t error = kaa_spsc_queue_create(&self->deferred_events, capacity);
+    if (error) {
+        KAA_LOG_ERROR(self->logger, error, "Failed to create deferred event queue (capacity %zu)", capacity);
+        return error;
+    }
+    KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Event callbacks are deferred (queue capacity %zu)", capacity);
+    return KAA_ERR_NONE;
+}
+
+kaa_error_t kaa_event_manager_set_deferred_notify(kaa_event_manager_t *self, kaa_event_deferred_notify_t notify, void *context)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    self->deferred_notify = notify;
+    self->deferred_notify_context = context;
+    return KAA_ERR_NONE;
+}
+
+kaa_error_t kaa_event_manager_process_deferred_events(kaa_event_manager_t *self, size_t max_count, size_t *processed_count)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    KAA_RETURN_IF_NIL(self->deferred_events, KAA_ERR_BAD_STATE);
+
+    /* Runs in the worker thread, so nothing but the queue is touched here */
+    size_t count = 0;
+    kaa_deferred_event_t *event;
+    while ((!max_count || count < max_count)
+            && (event = (kaa_deferred_event_t *) kaa_spsc_queue_pop(self->deferred_events))) {
+        (*event->callback)(event->fqn, event->data, event->data_size, event->source);
+        KAA_FREE(event);
+        ++count;
+    }
+
+    if (processed_count)
+        *processed_count = count;
+    return KAA_ERR_NONE;
+}
+
+kaa_error_t kaa_event_manager_get_deferred_stats(kaa_event_manager_t *self, size_t *queued_count, size_t *overflow_count)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+    KAA_RETURN_IF_NIL(self->deferred_events, KAA_ERR_BAD_STATE);
+    return kaa_spsc_queue_get_stats(self->deferred_events, queued_count, overflow_count);
+}
+
 kaa_error_t kaa_event_create_transaction(kaa_event_manager_t *self, kaa_event_block_id *trx_id)
 {
     KAA_RETURN_IF_NIL2(self, trx_id, KAA_ERR_NOT_INITIALIZED);
@@ -1049,16 +2048,32 @@ kaa_error_t kaa_event_finish_transaction(kaa_event_manager_t *self, kaa_event_bl
             if (kaa_get_max_log_level(self->logger) >= KAA_LOG_LEVEL_TRACE) {
                 KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Events batch with id %zu has %zu events", trx_id, kaa_list_get_size(trx->events));
             }
-            if (trx->events && kaa_list_get_size(trx->events) > 0) {
-                self->pending_events = kaa_lists_merge(self->pending_events, trx->events);
+            ssize_t events_count = kaa_list_get_size(trx->events);
+            if (events_count > 0) {
+                kaa_error_t error = kaa_event_queue_reserve(self, events_count);
+                if (error) {
+                    KAA_LOG_WARN(self->logger, error, "Event queue has no room for %zd events of batch with id %zu"
+                                                                                    , events_count, trx_id);
+                    return error;
+                }
+
+                kaa_list_t *events = trx->events;
+                while (events) {
+                    kaa_event_t *event = (kaa_event_t *) kaa_list_get_data(events);
+                    if (self->loopback_group) {
+                        /* Events of a block are always sent to the server, they must arrive together */
+                        kaa_event_view_t view = { kaa_event_get_fqn(event), event->fqn_size
+                                                , kaa_event_get_data(event), event->data_size, NULL };
+                        kaa_event_loopback_deliver(self, &view, event->has_target ? event->target : NULL, true);
+                    }
+                    kaa_event_queue_push(self, event);
+                    events = kaa_list_next(events);
+                }
                 need_sync = true;
-                trx->events = NULL;
             }
             kaa_list_remove_at(&self->transactions, it, &destroy_transaction);
-            kaa_transport_channel_interface_t *channel =
-                    kaa_channel_manager_get_transport_channel(self->channel_manager, event_sync_services[0]);
-            if (need_sync && channel)
-                channel->sync_handler(channel->context, event_sync_services, 1);
+            if (need_sync)
+                kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_EVENT);
 
             return KAA_ERR_NONE;
         }
@@ -1102,7 +2117,7 @@ kaa_error_t kaa_event_remove_transaction(kaa_event_manager_t *self, kaa_event_bl
  * @param[in]       target              The target endpoint of the event. If @code NULL @endcode event will be broadcasted.
  * @param[in]       target_size         Size of data in target parameter.
  *
- * @return Error code.
+ * @return Error code. The event data is taken over on success only, on any error it is left to the caller.
  */
 kaa_error_t kaa_event_manager_add_event_to_transaction(kaa_event_manager_t *self
                                                      , kaa_event_block_id trx_id
@@ -1129,8 +2144,6 @@ kaa_error_t kaa_event_manager_add_event_to_transaction(kaa_event_manager_t *self
             kaa_error_t error = kaa_fill_event_structure(event
                                                             , (size_t)-1
                                                             , fqn
-                                                            , event_data
-                                                            , event_data_size
                                                             , target);
             if (error) {
                 kaa_event_destroy(event);
@@ -1149,6 +2162,7 @@ kaa_error_t kaa_event_manager_add_event_to_transaction(kaa_event_manager_t *self
                 return KAA_ERR_NOMEM;
             }
 
+            kaa_event_set_data(event, event_data, event_data_size);
             return KAA_ERR_NONE;
         }
     }
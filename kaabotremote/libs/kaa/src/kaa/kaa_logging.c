@@ -32,17 +32,18 @@
 #include "kaa_platform_common.h"
 #include "utilities/kaa_mem.h"
 #include "utilities/kaa_log.h"
+#include "utilities/kaa_timer_queue.h"
 #include "avro_src/avro/io.h"
 
 
 
 #define KAA_LOGGING_RECEIVE_UPDATES_FLAG   0x01
 #define KAA_MAX_PADDING_LENGTH             (KAA_ALIGNMENT - 1)
+#define KAA_LOGGING_DRAIN_RATE_PERIOD      1000 /* ms */
 
 
 
-extern kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa_channel_manager_t *self
-                                                                                  , kaa_service_t service_type);
+extern kaa_error_t kaa_channel_manager_request_sync(kaa_channel_manager_t *self, kaa_service_t service_type);
 
 
 
@@ -52,8 +53,11 @@ typedef enum {
 } logging_sync_result_t;
 
 typedef struct {
-    uint16_t     log_bucket_id;
-    kaa_time_t   timeout;
+    uint16_t         log_bucket_id;
+    uint32_t         request_id;
+    size_t           size;
+    kaa_time_ms_t    request_time;
+    kaa_time_ms_t    timeout;
 } timeout_info_t;
 
 struct kaa_log_collector {
@@ -64,26 +68,89 @@ struct kaa_log_collector {
     kaa_channel_manager_t      *channel_manager;
     kaa_logger_t               *logger;
     kaa_list_t                 *timeouts;
+    kaa_timer_queue_t          *timer_queue;
+    kaa_timer_t                 timeout_timer;
+    kaa_timer_t                 retry_timer;
+    kaa_timer_t                 upload_timer;
     bool                        is_sync_ignored;
+    size_t                      drain_period_size;
+    kaa_time_ms_t               drain_period_start;
+    size_t                      drain_rate;
 };
 
 
 
-static const kaa_service_t logging_sync_services[1] = {KAA_SERVICE_LOGGING};
+/*
+ * Each bucket waiting for its delivery status has an entry in the timeouts.
+ */
+static bool is_upload_window_full(kaa_log_collector_t *self)
+{
+    return kaa_list_get_size(self->timeouts)
+            >= ext_log_upload_strategy_get_max_parallel_uploads(self->log_upload_strategy_context);
+}
+
+
+
+/*
+ * The drain rate is the volume of delivered records per second over the last
+ * period of at least KAA_LOGGING_DRAIN_RATE_PERIOD.
+ */
+static void update_drain_rate(kaa_log_collector_t *self, size_t delivered_size)
+{
+    kaa_time_ms_t now = KAA_TIME_MS();
+    self->drain_period_size += delivered_size;
+
+    kaa_time_ms_t elapsed = now - self->drain_period_start;
+    if (elapsed >= KAA_LOGGING_DRAIN_RATE_PERIOD) {
+        self->drain_rate = (size_t)((self->drain_period_size * 1000) / elapsed);
+        self->drain_period_size = 0;
+        self->drain_period_start = now;
+    }
+}
+
 
 
 kaa_error_t kaa_logging_need_logging_resync(kaa_log_collector_t *self, bool *result)
 {
     KAA_RETURN_IF_NIL2(self, result, KAA_ERR_BADPARAM);
-    if (self->is_sync_ignored) {
+    if (!self->log_storage_context) {
         *result = false;
         return KAA_ERR_NONE;
     }
-    *result = true;
+    *result = ext_log_storage_get_records_count(self->log_storage_context)
+           && ext_log_storage_get_total_size(self->log_storage_context)
+           && !is_upload_window_full(self);
     return KAA_ERR_NONE;
 }
 
-static kaa_error_t remember_request(kaa_log_collector_t *self, uint16_t bucket_id)
+/*
+ * Arms the delivery timer to the earliest timeout of the pending buckets.
+ */
+static void update_timeout_timer(kaa_log_collector_t *self)
+{
+    KAA_RETURN_IF_NIL(self->timer_queue,);
+
+    kaa_list_t *it = self->timeouts;
+    if (!it) {
+        kaa_timer_queue_cancel(self->timer_queue, &self->timeout_timer);
+        return;
+    }
+
+    kaa_time_ms_t deadline = ((timeout_info_t *)kaa_list_get_data(it))->timeout;
+    while ((it = kaa_list_next(it))) {
+        timeout_info_t *info = (timeout_info_t *)kaa_list_get_data(it);
+        if (info->timeout < deadline)
+            deadline = info->timeout;
+    }
+
+    kaa_error_t error = kaa_timer_queue_schedule(self->timer_queue, &self->timeout_timer, deadline);
+    if (error)
+        KAA_LOG_WARN(self->logger, error, "Failed to schedule log delivery timeout");
+}
+
+
+
+static kaa_error_t remember_request(kaa_log_collector_t *self, uint16_t bucket_id, uint32_t request_id, size_t size)
 {
     KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
 
@@ -91,12 +158,17 @@ static kaa_error_t remember_request(kaa_log_collector_t *self, uint16_t bucket_i
     KAA_RETURN_IF_NIL(info, KAA_ERR_NOMEM);
 
     info->log_bucket_id = bucket_id;
-    info->timeout = KAA_TIME() + (kaa_time_t)ext_log_upload_strategy_get_timeout(self->log_upload_strategy_context);
+    info->request_id = request_id;
+    info->size = size;
+    info->request_time = KAA_TIME_MS();
+    info->timeout = info->request_time
+                  + (kaa_time_ms_t)ext_log_upload_strategy_get_timeout(self->log_upload_strategy_context) * 1000;
 
     kaa_list_t *it = self->timeouts ? kaa_list_push_front(self->timeouts, info) : kaa_list_create(info);
     KAA_RETURN_IF_NIL(it, KAA_ERR_NOMEM);
 
     self->timeouts = it;
+    update_timeout_timer(self);
 
     return KAA_ERR_NONE;
 }
@@ -105,58 +177,103 @@ static kaa_error_t remember_request(kaa_log_collector_t *self, uint16_t bucket_i
 
 static bool find_by_bucket_id(void *data, void *context)
 {
-    KAA_RETURN_IF_NIL2(data, context, KAA_ERR_BADPARAM);
-    return (((timeout_info_t *)data)->log_bucket_id = *((uint16_t *)context));
+    KAA_RETURN_IF_NIL2(data, context, false);
+    return (((timeout_info_t *)data)->log_bucket_id == *((uint16_t *)context));
 }
 
 
 
-static kaa_error_t remove_request(kaa_log_collector_t *self, uint16_t bucket_id)
+static kaa_error_t remove_request(kaa_log_collector_t *self, uint16_t bucket_id, timeout_info_t *removed_info)
 {
-    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
-    kaa_list_remove_first(&self->timeouts, &find_by_bucket_id, &bucket_id, NULL);
+    KAA_RETURN_IF_NIL2(self, removed_info, KAA_ERR_BADPARAM);
+
+    kaa_list_t *it = kaa_list_find_next(self->timeouts, &find_by_bucket_id, &bucket_id);
+    if (!it)
+        return KAA_ERR_NOT_FOUND;
+
+    *removed_info = *(timeout_info_t *)kaa_list_get_data(it);
+    kaa_list_remove_at(&self->timeouts, it, NULL);
+    update_timeout_timer(self);
     return KAA_ERR_NONE;
 }
 
 
 
+static bool find_by_request_id(void *data, void *context)
+{
+    KAA_RETURN_IF_NIL2(data, context, false);
+    return (((timeout_info_t *)data)->request_id == *((uint32_t *)context));
+}
+
+
+
+static bool is_expired(void *data, void *context)
+{
+    KAA_RETURN_IF_NIL2(data, context, false);
+    return *((kaa_time_ms_t *)context) >= ((timeout_info_t *)data)->timeout;
+}
+
+
+
+/*
+ * Returns the buckets past their deadline to the storage. The buckets still
+ * within their timeout stay in flight and their delivery statuses are matched.
+ */
 static bool is_timeout(kaa_log_collector_t *self)
 {
     KAA_RETURN_IF_NIL2(self, self->timeouts, false);
 
     bool is_timeout = false;
-    kaa_list_t *it = self->timeouts;
-    kaa_time_t now = KAA_TIME();
+    kaa_time_ms_t now = KAA_TIME_MS();
+    kaa_list_t *it = NULL;
 
-    while (it) {
+    while ((it = kaa_list_find_next(self->timeouts, &is_expired, &now))) {
         timeout_info_t *info = (timeout_info_t *)kaa_list_get_data(it);
-        if (now >= info->timeout) {
-            KAA_LOG_WARN(self->logger, KAA_ERR_TIMEOUT, "Log delivery timeout occurred (bucket_id %u)", info->log_bucket_id);
-            is_timeout = true;
-            break;
-        }
-        it = kaa_list_next(it);
+        KAA_LOG_WARN(self->logger, KAA_ERR_TIMEOUT, "Log delivery timeout occurred (bucket_id %u)", info->log_bucket_id);
+        ext_log_storage_unmark_by_bucket_id(self->log_storage_context, info->log_bucket_id);
+        kaa_list_remove_at(&self->timeouts, it, NULL);
+        is_timeout = true;
     }
 
     if (is_timeout) {
-        kaa_list_t *it = self->timeouts;
-        while (it) {
-            timeout_info_t *info = (timeout_info_t *)kaa_list_get_data(it);
-            ext_log_storage_unmark_by_bucket_id(self->log_storage_context, info->log_bucket_id);
-            it = kaa_list_next(it);
-        }
-
-        kaa_list_destroy(self->timeouts, NULL);
-        self->timeouts = NULL;
+        update_timeout_timer(self);
         ext_log_upload_strategy_on_timeout(self->log_upload_strategy_context);
     }
 
     return is_timeout;
 }
 
+
+
+static void update_storage(kaa_log_collector_t *self);
+
+
+
+static void on_timeout_timer(void *context)
+{
+    is_timeout((kaa_log_collector_t *)context);
+}
+
+
+
+static void on_retry_timer(void *context)
+{
+    update_storage((kaa_log_collector_t *)context);
+}
+
+
+
+static void on_upload_timer(void *context)
+{
+    update_storage((kaa_log_collector_t *)context);
+}
+
+
+
 kaa_error_t kaa_log_collector_create(kaa_log_collector_t **log_collector_p
                                    , kaa_status_t *status
                                    , kaa_channel_manager_t *channel_manager
+                                   , kaa_timer_queue_t *timer_queue
                                    , kaa_logger_t *logger)
 {
     KAA_RETURN_IF_NIL(log_collector_p, KAA_ERR_BADPARAM);
@@ -170,7 +287,15 @@ kaa_error_t kaa_log_collector_create(kaa_log_collector_t **log_collector_p
     collector->channel_manager             = channel_manager;
     collector->logger                      = logger;
     collector->timeouts                    = NULL;
+    collector->timer_queue                 = timer_queue;
     collector->is_sync_ignored             = false;
+    collector->drain_period_size           = 0;
+    collector->drain_period_start          = KAA_TIME_MS();
+    collector->drain_rate                  = 0;
+
+    kaa_timer_init(&collector->timeout_timer, &on_timeout_timer, collector);
+    kaa_timer_init(&collector->retry_timer, &on_retry_timer, collector);
+    kaa_timer_init(&collector->upload_timer, &on_upload_timer, collector);
 
     *log_collector_p = collector;
     return KAA_ERR_NONE;
@@ -181,6 +306,11 @@ kaa_error_t kaa_log_collector_create(kaa_log_collector_t **log_collector_p
 void kaa_log_collector_destroy(kaa_log_collector_t *self)
 {
     if (self) {
+        if (self->timer_queue) {
+            kaa_timer_queue_cancel(self->timer_queue, &self->timeout_timer);
+            kaa_timer_queue_cancel(self->timer_queue, &self->retry_timer);
+            kaa_timer_queue_cancel(self->timer_queue, &self->upload_timer);
+        }
         ext_log_upload_strategy_destroy(self->log_upload_strategy_context);
         ext_log_storage_destroy(self->log_storage_context);
         kaa_list_destroy(self->timeouts, NULL);
@@ -209,13 +339,15 @@ kaa_error_t kaa_logging_init(kaa_log_collector_t *self, void *log_storage_contex
 
 static void update_storage(kaa_log_collector_t *self)
 {
+    if (is_upload_window_full(self)) {
+        KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Upload will be triggered once a log bucket is delivered.");
+        return;
+    }
+
     switch (ext_log_upload_strategy_decide(self->log_upload_strategy_context, self->log_storage_context)) {
         case UPLOAD:
             KAA_LOG_INFO(self->logger, KAA_ERR_NONE, "Initiating log upload...");
-            kaa_transport_channel_interface_t *channel =
-                    kaa_channel_manager_get_transport_channel(self->channel_manager, logging_sync_services[0]);
-            if (channel)
-                channel->sync_handler(channel->context, logging_sync_services, 1);
+            kaa_channel_manager_request_sync(self->channel_manager, KAA_SERVICE_LOGGING);
             break;
         default:
             KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Upload will not be triggered now.");
@@ -225,13 +357,13 @@ static void update_storage(kaa_log_collector_t *self)
 
 
 
-kaa_error_t kaa_logging_add_record(kaa_log_collector_t *self, kaa_user_log_record_t *entry)
+/*
+ * Serializes the entry straight into the buffer allocated by the storage.
+ * The memory writer lives on the stack, so no allocation is made per record
+ * besides the storage's own one.
+ */
+static kaa_error_t add_entry_to_storage(kaa_log_collector_t *self, kaa_user_log_record_t *entry)
 {
-    KAA_RETURN_IF_NIL2(self, entry, KAA_ERR_BADPARAM);
-    KAA_RETURN_IF_NIL(self->log_storage_context, KAA_ERR_NOT_INITIALIZED);
-
-    KAA_LOG_DEBUG(self->logger, KAA_ERR_NONE, "Adding new log record {%p}", entry);
-
     kaa_log_record_t record = { NULL, entry->get_size(entry) };
     if (!record.size) {
         KAA_LOG_ERROR(self->logger, KAA_ERR_BADDATA, "Failed to add log record: serialized record size is null."
@@ -245,14 +377,8 @@ kaa_error_t kaa_logging_add_record(kaa_log_collector_t *self, kaa_user_log_recor
     if (error)
         return error;
 
-    avro_writer_t writer = avro_writer_memory((char *)record.data, record.size);
-    if (!writer) {
-        ext_log_storage_deallocate_log_record_buffer(self->log_storage_context, &record);
-        return KAA_ERR_NOMEM;
-    }
-
-    entry->serialize(writer, entry);
-    avro_writer_free(writer);
+    struct avro_writer_t_ writer = { record.data, (int64_t)record.size, 0 };
+    entry->serialize(&writer, entry);
 
     KAA_LOG_TRACE(self->logger, KAA_ERR_NONE, "Adding serialized record to the log storage");
     error = ext_log_storage_add_log_record(self->log_storage_context, &record);
@@ -262,6 +388,22 @@ kaa_error_t kaa_logging_add_record(kaa_log_collector_t *self, kaa_user_log_recor
         return error;
     }
 
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t kaa_logging_add_record(kaa_log_collector_t *self, kaa_user_log_record_t *entry)
+{
+    KAA_RETURN_IF_NIL2(self, entry, KAA_ERR_BADPARAM);
+    KAA_RETURN_IF_NIL(self->log_storage_context, KAA_ERR_NOT_INITIALIZED);
+
+    KAA_LOG_DEBUG(self->logger, KAA_ERR_NONE, "Adding new log record {%p}", entry);
+
+    kaa_error_t error = add_entry_to_storage(self, entry);
+    if (error)
+        return error;
+
     if (!is_timeout(self))
         update_storage(self);
 
@@ -270,6 +412,40 @@ kaa_error_t kaa_logging_add_record(kaa_log_collector_t *self, kaa_user_log_recor
 
 
 
+kaa_error_t kaa_logging_add_records(kaa_log_collector_t *self, kaa_user_log_record_t *entries[], size_t count)
+{
+    KAA_RETURN_IF_NIL3(self, entries, count, KAA_ERR_BADPARAM);
+    KAA_RETURN_IF_NIL(self->log_storage_context, KAA_ERR_NOT_INITIALIZED);
+
+    KAA_LOG_DEBUG(self->logger, KAA_ERR_NONE, "Adding %zu new log records", count);
+
+    kaa_error_t error = KAA_ERR_NONE;
+    size_t added_count = 0;
+
+    while (added_count < count) {
+        if (!entries[added_count]) {
+            error = KAA_ERR_BADPARAM;
+            break;
+        }
+
+        error = add_entry_to_storage(self, entries[added_count]);
+        if (error)
+            break;
+
+        ++added_count;
+    }
+
+    if (error)
+        KAA_LOG_WARN(self->logger, error, "Added %zu of %zu log records", added_count, count);
+
+    if (added_count && !is_timeout(self))
+        update_storage(self);
+
+    return error;
+}
+
+
+
 kaa_error_t kaa_logging_request_get_size(kaa_log_collector_t *self, size_t *expected_size)
 {
     KAA_RETURN_IF_NIL2(self, expected_size, KAA_ERR_BADPARAM);
@@ -278,7 +454,7 @@ kaa_error_t kaa_logging_request_get_size(kaa_log_collector_t *self, size_t *expe
     size_t records_count = ext_log_storage_get_records_count(self->log_storage_context);
     size_t total_size = ext_log_storage_get_total_size(self->log_storage_context);
 
-    self->is_sync_ignored = (!records_count || !total_size);
+    self->is_sync_ignored = (!records_count || !total_size || is_upload_window_full(self));
 
     if (!self->is_sync_ignored) {
         *expected_size = KAA_EXTENSION_HEADER_SIZE;
@@ -297,7 +473,7 @@ kaa_error_t kaa_logging_request_get_size(kaa_log_collector_t *self, size_t *expe
 
 
 
-kaa_error_t kaa_logging_request_serialize(kaa_log_collector_t *self, kaa_platform_message_writer_t *writer)
+kaa_error_t kaa_logging_request_serialize(kaa_log_collector_t *self, uint32_t request_id, kaa_platform_message_writer_t *writer)
 {
     KAA_RETURN_IF_NIL2(self, writer, KAA_ERR_BADPARAM);
     KAA_RETURN_IF_NIL(self->log_storage_context, KAA_ERR_NOT_INITIALIZED);
@@ -372,11 +548,17 @@ kaa_error_t kaa_logging_request_serialize(kaa_log_collector_t *self, kaa_platfor
     *((uint16_t *) records_count_p) = KAA_HTONS(records_count);
     *writer = tmp_writer;
 
-    error = remember_request(self, self->log_bucket_id);
+    error = remember_request(self, self->log_bucket_id, request_id, payload_size);
     if (error) {
         KAA_LOG_WARN(self->logger, error, "Failed to remember request time stamp");
     }
 
+    // The next bucket may be sent without waiting for the delivery status of this one. Its sync
+    // is requested from the timer queue rather than from here: with a zero sync latency it would
+    // be flushed right away and re-enter the channel which is serializing this request.
+    if (self->timer_queue)
+        kaa_timer_queue_schedule(self->timer_queue, &self->upload_timer, KAA_TIME_MS());
+
     return KAA_ERR_NONE;
 }
 
@@ -416,10 +598,15 @@ kaa_error_t kaa_logging_handle_server_sync(kaa_log_collector_t *self
                 , (delivery_result == LOGGING_RESULT_SUCCESS ? "uploaded successfully" : "upload failed")
                 , delivery_error_code);
 
-        remove_request(self, bucket_id);
+        timeout_info_t info;
+        bool is_pending = !remove_request(self, bucket_id, &info);
 
         if (delivery_result == LOGGING_RESULT_SUCCESS) {
             ext_log_storage_remove_by_bucket_id(self->log_storage_context, bucket_id);
+            if (is_pending) {
+                ext_log_upload_strategy_on_success(self->log_upload_strategy_context, KAA_TIME_MS() - info.request_time);
+                update_drain_rate(self, info.size);
+            }
         } else {
             ext_log_storage_unmark_by_bucket_id(self->log_storage_context, bucket_id);
             ext_log_upload_strategy_on_failure(self->log_upload_strategy_context
@@ -427,11 +614,60 @@ kaa_error_t kaa_logging_handle_server_sync(kaa_log_collector_t *self
         }
     }
 
+    kaa_time_ms_t retry_deadline = ext_log_upload_strategy_get_retry_deadline(self->log_upload_strategy_context);
+    if (retry_deadline && self->timer_queue)
+        kaa_timer_queue_schedule(self->timer_queue, &self->retry_timer, retry_deadline);
+
     update_storage(self);
 
     return error_code;
 
 }
 
+
+
+/*
+ * Called by the platform protocol when the server sync for the request will
+ * never arrive. Its buckets are returned to the storage without waiting for
+ * the delivery timeout.
+ */
+kaa_error_t kaa_logging_on_sync_lost(kaa_log_collector_t *self, uint32_t request_id)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+
+    bool is_found = false;
+    kaa_list_t *it = NULL;
+    while ((it = kaa_list_find_next(self->timeouts, &find_by_request_id, &request_id))) {
+        timeout_info_t *info = (timeout_info_t *)kaa_list_get_data(it);
+        KAA_LOG_WARN(self->logger, KAA_ERR_NONE, "Log bucket %u sent in request %u is lost", info->log_bucket_id, request_id);
+        ext_log_storage_unmark_by_bucket_id(self->log_storage_context, info->log_bucket_id);
+        kaa_list_remove_at(&self->timeouts, it, NULL);
+        is_found = true;
+    }
+    if (!is_found)
+        return KAA_ERR_NOT_FOUND;
+
+    update_timeout_timer(self);
+    update_storage(self);
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t kaa_logging_get_upload_stats(kaa_log_collector_t *self, size_t *in_flight_count, size_t *drain_rate)
+{
+    KAA_RETURN_IF_NIL(self, KAA_ERR_BADPARAM);
+
+    if (in_flight_count)
+        *in_flight_count = kaa_list_get_size(self->timeouts);
+
+    if (drain_rate) {
+        update_drain_rate(self, 0);
+        *drain_rate = self->drain_rate;
+    }
+
+    return KAA_ERR_NONE;
+}
+
 #endif
 
@@ -69,6 +69,43 @@ kaa_error_t kaa_logging_init(kaa_log_collector_t *self, void *log_storage_contex
  */
 kaa_error_t kaa_logging_add_record(kaa_log_collector_t *self, kaa_user_log_record_t *entry);
 
+
+
+/**
+ * @brief Serializes and adds a batch of log records to the log storage.
+ *
+ * Cheaper than adding the records one by one: the delivery timeouts are checked
+ * and the upload strategy is consulted once for the whole batch.
+ *
+ * If a record fails to be added, the records before it stay in the storage
+ * and the rest of the batch is skipped.
+ *
+ * @param[in] self       Pointer to a @link kaa_log_collector_t @endlink instance.
+ * @param[in] entries    Array of pointers to log entries to be added to the storage.
+ * @param[in] count      Number of entries in the array.
+ *
+ * @return  Error code.
+ *
+ */
+kaa_error_t kaa_logging_add_records(kaa_log_collector_t *self, kaa_user_log_record_t *entries[], size_t count);
+
+
+
+/**
+ * @brief Retrieves the state of the log upload.
+ *
+ * Up to @link ext_log_upload_strategy_get_max_parallel_uploads @endlink log buckets may wait
+ * for their delivery status at the same time.
+ *
+ * @param[in]  self               Pointer to a @link kaa_log_collector_t @endlink instance.
+ * @param[out] in_flight_count    Number of log buckets waiting for the delivery status. May be NULL.
+ * @param[out] drain_rate         Volume of delivered log buckets in bytes per second,
+ *                                measured over the last second or longer. May be NULL.
+ *
+ * @return  Error code.
+ */
+kaa_error_t kaa_logging_get_upload_stats(kaa_log_collector_t *self, size_t *in_flight_count, size_t *drain_rate);
+
 # ifdef __cplusplus
 }      /* extern "C" */
 # endif
@@ -54,6 +54,7 @@ typedef struct {
     size_t services_count;          /**< Number of elements in @c services */
     kaa_buffer_alloc_fn allocator;  /**< Pointer to a buffer memory allocation function */
     void *allocator_context;        /**< Context to be passed to the @c allocator callback as @c context parameter */
+    void *channel;                  /**< Channel sending the sync. Server syncs are expected in the order of its client syncs */
 } kaa_serialize_info_t;
 
 /**
@@ -89,6 +90,19 @@ kaa_error_t kaa_platform_protocol_process_server_sync(kaa_platform_protocol_t *s
                                                     , const char *buffer
                                                     , size_t buffer_size);
 
+/**
+ * @brief Notifies that server syncs for the client syncs sent through the channel will never arrive,
+ * e.g. because its connection was closed.
+ *
+ * Events and log buckets carried by these client syncs are scheduled for resending.
+ *
+ * @param[in] self              Pointer to a @link kaa_platform_protocol_t @endlink instance.
+ * @param[in] channel           The channel passed in @link kaa_serialize_info_t @endlink.
+ *
+ * @return Error code.
+ */
+kaa_error_t kaa_platform_protocol_drop_pending_syncs(kaa_platform_protocol_t *self, void *channel);
+
 #ifdef __cplusplus
 }      /* extern "C" */
 #endif
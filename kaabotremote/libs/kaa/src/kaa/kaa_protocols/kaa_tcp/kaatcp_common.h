@@ -48,6 +48,9 @@ extern "C" {
 #define KAA_CONNECT_KEY_AES_RSA    0x11
 #define KAA_CONNECT_SIGNATURE_SHA1 0x01
 
+#define KAA_CONNACK_LENGTH     2
+#define KAA_DISCONNECT_LENGTH  2
+
 #define KAA_TCP_NAME        "Kaatcp"
 #define KAA_TCP_NAME_LENGTH 6
 
@@ -133,7 +136,7 @@ typedef struct {
     kaatcp_kaasync_header_t sync_header;
 
     size_t sync_request_size;
-    char *sync_request;
+    const char *sync_request;
 } kaatcp_kaasync_t;
 
 #ifdef __cplusplus
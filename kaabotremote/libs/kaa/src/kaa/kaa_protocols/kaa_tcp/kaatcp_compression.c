@@ -0,0 +1,193 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zlib.h>
+
+#include "kaatcp_compression.h"
+
+#include "../../kaa_common.h"
+#include "../../utilities/kaa_mem.h"
+
+
+
+typedef struct {
+    char      *data;
+    size_t    size;
+} kaatcp_compression_buffer_t;
+
+struct kaatcp_compression_t {
+    z_stream                       deflate_stream;
+    z_stream                       inflate_stream;
+    bool                           deflate_initialized;
+    bool                           inflate_initialized;
+    kaatcp_compression_buffer_t    deflate_buffer;
+    kaatcp_compression_buffer_t    inflate_buffer;
+};
+
+
+
+/*
+ * The current buffer content is not preserved.
+ */
+static kaatcp_error_t kaatcp_compression_reserve(kaatcp_compression_buffer_t *buffer, size_t size)
+{
+    if (buffer->size >= size) {
+        return KAATCP_ERR_NONE;
+    }
+
+    char *data = (char *) KAA_MALLOC(size);
+    KAA_RETURN_IF_NIL(data, KAATCP_ERR_NOMEM);
+
+    if (buffer->data) {
+        KAA_FREE(buffer->data);
+    }
+    buffer->data = data;
+    buffer->size = size;
+    return KAATCP_ERR_NONE;
+}
+
+kaatcp_error_t kaatcp_compression_create(kaatcp_compression_t **compression_p)
+{
+    KAA_RETURN_IF_NIL(compression_p, KAATCP_ERR_BAD_PARAM);
+
+    kaatcp_compression_t *compression = (kaatcp_compression_t *) KAA_CALLOC(1, sizeof(kaatcp_compression_t));
+    KAA_RETURN_IF_NIL(compression, KAATCP_ERR_NOMEM);
+
+    *compression_p = compression;
+    return KAATCP_ERR_NONE;
+}
+
+void kaatcp_compression_destroy(kaatcp_compression_t *compression)
+{
+    KAA_RETURN_IF_NIL(compression,);
+
+    if (compression->deflate_initialized) {
+        deflateEnd(&compression->deflate_stream);
+    }
+    if (compression->inflate_initialized) {
+        inflateEnd(&compression->inflate_stream);
+    }
+    if (compression->deflate_buffer.data) {
+        KAA_FREE(compression->deflate_buffer.data);
+    }
+    if (compression->inflate_buffer.data) {
+        KAA_FREE(compression->inflate_buffer.data);
+    }
+    KAA_FREE(compression);
+}
+
+kaatcp_error_t kaatcp_compression_deflate(kaatcp_compression_t *compression
+                                        , const char *data
+                                        , size_t data_size
+                                        , const char **out
+                                        , size_t *out_size)
+{
+    KAA_RETURN_IF_NIL5(compression, data, data_size, out, out_size, KAATCP_ERR_BAD_PARAM);
+
+    z_stream *stream = &compression->deflate_stream;
+    if (!compression->deflate_initialized) {
+        if (deflateInit(stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            return KAATCP_ERR_NOMEM;
+        }
+        compression->deflate_initialized = true;
+    } else if (deflateReset(stream) != Z_OK) {
+        return KAATCP_ERR_INVALID_STATE;
+    }
+
+    kaatcp_error_t error_code = kaatcp_compression_reserve(&compression->deflate_buffer
+                                                         , deflateBound(stream, data_size));
+    KAA_RETURN_IF_ERR(error_code);
+
+    stream->next_in = (Bytef *) data;
+    stream->avail_in = data_size;
+    stream->next_out = (Bytef *) compression->deflate_buffer.data;
+    stream->avail_out = compression->deflate_buffer.size;
+
+    if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+        return KAATCP_ERR_INVALID_STATE;
+    }
+
+    *out = compression->deflate_buffer.data;
+    *out_size = stream->total_out;
+    return KAATCP_ERR_NONE;
+}
+
+kaatcp_error_t kaatcp_compression_inflate(kaatcp_compression_t *compression
+                                        , const char *data
+                                        , size_t data_size
+                                        , size_t max_size
+                                        , const char **out
+                                        , size_t *out_size)
+{
+    KAA_RETURN_IF_NIL5(compression, data, data_size, out, out_size, KAATCP_ERR_BAD_PARAM);
+
+    z_stream *stream = &compression->inflate_stream;
+    if (!compression->inflate_initialized) {
+        if (inflateInit(stream) != Z_OK) {
+            return KAATCP_ERR_NOMEM;
+        }
+        compression->inflate_initialized = true;
+    } else if (inflateReset(stream) != Z_OK) {
+        return KAATCP_ERR_INVALID_STATE;
+    }
+
+    kaatcp_compression_buffer_t *buffer = &compression->inflate_buffer;
+    if (!buffer->size) {
+        size_t size = 4 * data_size;
+        kaatcp_error_t error_code = kaatcp_compression_reserve(buffer, (size < max_size) ? size : max_size);
+        KAA_RETURN_IF_ERR(error_code);
+    }
+
+    stream->next_in = (Bytef *) data;
+    stream->avail_in = data_size;
+    stream->next_out = (Bytef *) buffer->data;
+    stream->avail_out = (buffer->size < max_size) ? buffer->size : max_size;
+
+    int zlib_code = Z_OK;
+    while ((zlib_code = inflate(stream, Z_NO_FLUSH)) != Z_STREAM_END) {
+        if (zlib_code != Z_OK && zlib_code != Z_BUF_ERROR) {
+            return KAATCP_ERR_INVALID_PROTOCOL;
+        }
+        if (stream->avail_out) {
+            // The input ended before the end of the deflate stream.
+            return KAATCP_ERR_INVALID_PROTOCOL;
+        }
+        if (stream->total_out >= max_size) {
+            return KAATCP_ERR_BUFFER_NOT_ENOUGH;
+        }
+
+        size_t new_size = (2 * buffer->size < max_size) ? 2 * buffer->size : max_size;
+        char *new_data = (char *) KAA_MALLOC(new_size);
+        KAA_RETURN_IF_NIL(new_data, KAATCP_ERR_NOMEM);
+
+        memcpy(new_data, buffer->data, stream->total_out);
+        KAA_FREE(buffer->data);
+        buffer->data = new_data;
+        buffer->size = new_size;
+
+        stream->next_out = (Bytef *) (buffer->data + stream->total_out);
+        stream->avail_out = buffer->size - stream->total_out;
+    }
+
+    *out = buffer->data;
+    *out_size = stream->total_out;
+    return KAATCP_ERR_NONE;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef KAATCP_COMPRESSION_H_
+#define KAATCP_COMPRESSION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "kaatcp_common.h"
+
+
+/*
+ * Deflate/inflate state for the payloads of zipped KAASYNC messages. The zlib
+ * streams and output buffers are kept between messages so that every message
+ * costs only a stream reset.
+ */
+typedef struct kaatcp_compression_t kaatcp_compression_t;
+
+kaatcp_error_t kaatcp_compression_create(kaatcp_compression_t **compression_p);
+
+void kaatcp_compression_destroy(kaatcp_compression_t *compression);
+
+/*
+ * The output buffer is owned by the compression instance and stays valid
+ * until the next call to kaatcp_compression_deflate().
+ */
+kaatcp_error_t kaatcp_compression_deflate(kaatcp_compression_t *compression
+                                        , const char *data
+                                        , size_t data_size
+                                        , const char **out
+                                        , size_t *out_size);
+
+/*
+ * Fails with KAATCP_ERR_BUFFER_NOT_ENOUGH if the inflated data exceeds max_size.
+ * The output buffer stays valid until the next call to kaatcp_compression_inflate().
+ */
+kaatcp_error_t kaatcp_compression_inflate(kaatcp_compression_t *compression
+                                        , const char *data
+                                        , size_t data_size
+                                        , size_t max_size
+                                        , const char **out
+                                        , size_t *out_size);
+
+#ifdef __cplusplus
+}      /* extern "C" */
+#endif
+#endif /* KAATCP_COMPRESSION_H_ */
@@ -28,20 +28,30 @@
 
 
 
-static kaatcp_error_t kaatcp_parser_message_done(kaatcp_parser_t *parser)
+/*
+ * payload points either to the parser's own buffer or directly into the buffer
+ * passed to kaatcp_parser_process_buffer() when it holds the whole frame.
+ */
+static kaatcp_error_t kaatcp_parser_message_done(kaatcp_parser_t *parser, const char *payload)
 {
     KAA_RETURN_IF_NIL(parser, KAATCP_ERR_BAD_PARAM);
 
     switch (parser->message_type) {
         case KAATCP_MESSAGE_CONNACK:
+            if (parser->message_length < KAA_CONNACK_LENGTH) {
+                return KAATCP_ERR_INVALID_PROTOCOL;
+            }
             if (parser->handlers.connack_handler) {
-                kaatcp_connack_t connack = { *(parser->payload + 1) };
+                kaatcp_connack_t connack = { *(payload + 1) };
                 parser->handlers.connack_handler(parser->handlers.handlers_context, connack);
             }
             break;
         case KAATCP_MESSAGE_DISCONNECT:
+            if (parser->message_length < KAA_DISCONNECT_LENGTH) {
+                return KAATCP_ERR_INVALID_PROTOCOL;
+            }
             if (parser->handlers.disconnect_handler) {
-                kaatcp_disconnect_t disconnect = { *(parser->payload + 1) };
+                kaatcp_disconnect_t disconnect = { *(payload + 1) };
                 parser->handlers.disconnect_handler(parser->handlers.handlers_context, disconnect);
             }
             break;
@@ -53,10 +63,15 @@ static kaatcp_error_t kaatcp_parser_message_done(kaatcp_parser_t *parser)
         case KAATCP_MESSAGE_KAASYNC:
         {
             kaatcp_kaasync_header_t sync_header;
-            const char *cursor = parser->payload;
+            const char *cursor = payload;
 
+            if (parser->message_length < KAA_SYNC_HEADER_LENGTH) {
+                return KAATCP_ERR_INVALID_PROTOCOL;
+            }
+
+            // The header length is fixed, so the name must be exactly the Kaa TCP one.
             sync_header.protocol_name_length = KAA_NTOHS(*((uint16_t *) cursor));
-            if (sync_header.protocol_name_length > KAATCP_PROTOCOL_NAME_MAX_SIZE) {
+            if (sync_header.protocol_name_length != KAA_TCP_NAME_LENGTH) {
                 return KAATCP_ERR_INVALID_PROTOCOL;
             }
 
@@ -81,24 +96,12 @@ static kaatcp_error_t kaatcp_parser_message_done(kaatcp_parser_t *parser)
             sync_header.flags = *(cursor++);
 
             if ((sync_header.flags & KAA_SYNC_SYNC_BIT) && parser->handlers.kaasync_handler) {
-                kaatcp_kaasync_t *kaasync = (kaatcp_kaasync_t *) KAA_MALLOC(sizeof(kaatcp_kaasync_t));
-                KAA_RETURN_IF_NIL(kaasync, KAATCP_ERR_NOMEM);
-
-                kaasync->sync_header = sync_header;
-                kaasync->sync_request_size = parser->message_length - KAA_SYNC_HEADER_LENGTH;
-
-                if (kaasync->sync_request_size) {
-                    kaasync->sync_request = (char *) KAA_MALLOC(kaasync->sync_request_size);
-                    if (!kaasync->sync_request) {
-                        KAA_FREE(kaasync);
-                        return KAATCP_ERR_NOMEM;
-                    }
-                    memcpy(kaasync->sync_request, cursor, kaasync->sync_request_size);
-                } else {
-                    kaasync->sync_request = NULL;
-                }
+                kaatcp_kaasync_t kaasync;
+                kaasync.sync_header = sync_header;
+                kaasync.sync_request_size = parser->message_length - KAA_SYNC_HEADER_LENGTH;
+                kaasync.sync_request = kaasync.sync_request_size ? cursor : NULL;
 
-                parser->handlers.kaasync_handler(parser->handlers.handlers_context, kaasync);
+                parser->handlers.kaasync_handler(parser->handlers.handlers_context, &kaasync);
             }
             break;
         }
@@ -108,6 +111,44 @@ static kaatcp_error_t kaatcp_parser_message_done(kaatcp_parser_t *parser)
     return kaatcp_parser_reset(parser);
 }
 
+/*
+ * The current payload content is not preserved.
+ */
+static kaatcp_error_t kaatcp_parser_resize_payload(kaatcp_parser_t *parser, size_t size)
+{
+    char *payload = (char *) KAA_MALLOC(size);
+    KAA_RETURN_IF_NIL(payload, KAATCP_ERR_NOMEM);
+
+    if (parser->payload) {
+        KAA_FREE(parser->payload);
+    }
+
+    parser->payload = payload;
+    parser->payload_size = size;
+    parser->small_frame_count = 0;
+    if (parser->payload_high_water_mark < size) {
+        parser->payload_high_water_mark = size;
+    }
+    return KAATCP_ERR_NONE;
+}
+
+static kaatcp_error_t kaatcp_parser_reserve_payload(kaatcp_parser_t *parser)
+{
+    if (parser->payload_size >= parser->message_length) {
+        return KAATCP_ERR_NONE;
+    }
+
+    size_t size = parser->payload_size ? parser->payload_size : KAATCP_PARSER_INITIAL_BUFFER_SIZE;
+    while (size < parser->message_length) {
+        size *= 2;
+    }
+    if (size > KAATCP_PARSER_MAX_MESSAGE_LENGTH) {
+        size = KAATCP_PARSER_MAX_MESSAGE_LENGTH;
+    }
+
+    return kaatcp_parser_resize_payload(parser, size);
+}
+
 static void kaatcp_parser_retrieve_message_type(kaatcp_parser_t *parser, uint8_t byte)
 {
     KAA_RETURN_IF_NIL(parser, );
@@ -124,13 +165,19 @@ static kaatcp_error_t kaatcp_parser_process_byte(kaatcp_parser_t *parser, uint8_
             parser->state = KAATCP_PARSER_STATE_PROCESSING_LENGTH;
             break;
         case KAATCP_PARSER_STATE_PROCESSING_LENGTH:
+            if (parser->length_multiplier > FIRST_BIT * FIRST_BIT * FIRST_BIT) {
+                return KAATCP_ERR_INVALID_PROTOCOL;
+            }
             parser->message_length += ((byte & ~FIRST_BIT) * parser->length_multiplier);
             parser->length_multiplier *= FIRST_BIT;
             if (!(byte & FIRST_BIT)) {
+                if (parser->message_length > KAATCP_PARSER_MAX_MESSAGE_LENGTH) {
+                    return KAATCP_ERR_BUFFER_NOT_ENOUGH;
+                }
                 if (parser->message_length) {
                     parser->state = KAATCP_PARSER_STATE_PROCESSING_PAYLOAD;
                 } else {
-                    return kaatcp_parser_message_done(parser);
+                    return kaatcp_parser_message_done(parser, parser->payload);
                 }
             }
             break;
@@ -145,6 +192,16 @@ kaatcp_error_t kaatcp_parser_reset(kaatcp_parser_t *parser)
 {
     KAA_RETURN_IF_NIL(parser, KAATCP_ERR_BAD_PARAM);
 
+    if (parser->payload_size > KAATCP_PARSER_INITIAL_BUFFER_SIZE) {
+        // Large frames tend to come in bursts, so don't reallocate the buffer after each of them.
+        if (parser->message_length > KAATCP_PARSER_INITIAL_BUFFER_SIZE) {
+            parser->small_frame_count = 0;
+        } else if (++parser->small_frame_count >= KAATCP_PARSER_SHRINK_AFTER_FRAMES) {
+            // Keeping the larger buffer is fine if the smaller one can't be allocated.
+            kaatcp_parser_resize_payload(parser, KAATCP_PARSER_INITIAL_BUFFER_SIZE);
+        }
+    }
+
     parser->state                    = KAATCP_PARSER_STATE_NONE;
     parser->message_type             = KAATCP_MESSAGE_UNKNOWN;
     parser->message_length           = 0;
@@ -159,9 +216,17 @@ kaatcp_error_t kaatcp_parser_init(kaatcp_parser_t *parser
 {
     KAA_RETURN_IF_NIL2(parser, handlers, KAATCP_ERR_BAD_PARAM);
 
+    parser->payload = NULL;
+    parser->payload_size = 0;
+    parser->payload_high_water_mark = 0;
+    parser->small_frame_count = 0;
+
     kaatcp_error_t rval = kaatcp_parser_reset(parser);
     KAA_RETURN_IF_ERR(rval);
 
+    rval = kaatcp_parser_resize_payload(parser, KAATCP_PARSER_INITIAL_BUFFER_SIZE);
+    KAA_RETURN_IF_ERR(rval);
+
     parser->handlers = *handlers;
     return rval;
 }
@@ -177,14 +242,28 @@ kaatcp_error_t kaatcp_parser_process_buffer(kaatcp_parser_t *parser, const char
         if (parser->state == KAATCP_PARSER_STATE_PROCESSING_PAYLOAD) {
             uint32_t remaining_size = parser->message_length - parser->processed_payload_length;
             uint32_t buffer_remaining_size = buf + buf_size - buf_cursor;
+
+            if (!parser->processed_payload_length && buffer_remaining_size >= remaining_size) {
+                const char *payload = buf_cursor;
+                buf_cursor += remaining_size;
+                rval = kaatcp_parser_message_done(parser, payload);
+                KAA_RETURN_IF_ERR(rval);
+                continue;
+            }
+
             uint32_t bytes_to_read = (remaining_size > buffer_remaining_size) ? buffer_remaining_size : remaining_size;
 
+            if (!parser->processed_payload_length) {
+                rval = kaatcp_parser_reserve_payload(parser);
+                KAA_RETURN_IF_ERR(rval);
+            }
+
             memcpy(parser->payload + parser->processed_payload_length, buf_cursor, bytes_to_read);
             parser->processed_payload_length += bytes_to_read;
             buf_cursor += bytes_to_read;
 
             if (parser->message_length == parser->processed_payload_length) {
-                rval = kaatcp_parser_message_done(parser);
+                rval = kaatcp_parser_message_done(parser, parser->payload);
                 KAA_RETURN_IF_ERR(rval);
             }
         } else {
@@ -196,14 +275,19 @@ kaatcp_error_t kaatcp_parser_process_buffer(kaatcp_parser_t *parser, const char
     return rval;
 }
 
-void kaatcp_parser_kaasync_destroy(kaatcp_kaasync_t *message)
+void kaatcp_parser_deinit(kaatcp_parser_t *parser)
 {
-    KAA_RETURN_IF_NIL(message,);
+    KAA_RETURN_IF_NIL(parser,);
 
-    if (message->sync_request) {
-        KAA_FREE(message->sync_request);
+    if (parser->payload) {
+        KAA_FREE(parser->payload);
+        parser->payload = NULL;
     }
-
-    KAA_FREE(message);
+    parser->payload_size = 0;
 }
 
+size_t kaatcp_parser_get_high_water_mark(const kaatcp_parser_t *parser)
+{
+    KAA_RETURN_IF_NIL(parser, 0);
+    return parser->payload_high_water_mark;
+}
@@ -26,6 +26,9 @@ extern "C" {
 
 typedef void (*on_connack_message_fn)(void *context, kaatcp_connack_t message);
 typedef void (*on_disconnect_message_fn)(void *context, kaatcp_disconnect_t message);
+/*
+ * The message and its sync_request are only valid until the handler returns.
+ */
 typedef void (*on_kaasync_message_fn)(void *context, kaatcp_kaasync_t *message);
 typedef void (*on_pingresp_message_fn)(void *context);
 
@@ -51,7 +54,10 @@ typedef struct {
     uint32_t                 message_length;
     uint32_t                 processed_payload_length;
     uint32_t                 length_multiplier;
-    char                     payload[KAATCP_PARSER_MAX_MESSAGE_LENGTH];
+    char                     *payload;
+    size_t                   payload_size;
+    size_t                   payload_high_water_mark;    /* The largest payload buffer allocated so far */
+    size_t                   small_frame_count;          /* Frames fitting the initial size since the last resize */
 
     kaatcp_parser_handlers_t handlers;
 } kaatcp_parser_t;
@@ -61,14 +67,27 @@ typedef struct {
 kaatcp_error_t kaatcp_parser_init(kaatcp_parser_t *parser
                                 , const kaatcp_parser_handlers_t *handlers);
 
+/*
+ * Also shrinks the payload buffer back to KAATCP_PARSER_INITIAL_BUFFER_SIZE
+ * once KAATCP_PARSER_SHRINK_AFTER_FRAMES frames in a row fit into it.
+ */
 kaatcp_error_t kaatcp_parser_reset(kaatcp_parser_t *parser);
 
+void kaatcp_parser_deinit(kaatcp_parser_t *parser);
+
+/*
+ * Returns the largest payload buffer the parser has allocated so far.
+ */
+size_t kaatcp_parser_get_high_water_mark(const kaatcp_parser_t *parser);
+
+/*
+ * Frames longer than KAATCP_PARSER_MAX_MESSAGE_LENGTH are rejected with
+ * KAATCP_ERR_BUFFER_NOT_ENOUGH.
+ */
 kaatcp_error_t kaatcp_parser_process_buffer(kaatcp_parser_t *parser
                                           , const char *buf
                                           , size_t buf_size);
 
-void kaatcp_parser_kaasync_destroy(kaatcp_kaasync_t *message);
-
 #ifdef __cplusplus
 }      /* extern "C" */
 #endif
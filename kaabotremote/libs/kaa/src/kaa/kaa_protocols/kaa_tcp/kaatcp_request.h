@@ -46,10 +46,17 @@ kaatcp_error_t kaatcp_fill_kaasync_message(char *sync_request, size_t sync_reque
                                          , uint16_t message_id, uint8_t zipped, uint8_t encrypted
                                          , kaatcp_kaasync_t *message);
 
+/*
+ * If message->sync_request already points right past the KAASYNC header
+ * within buf (see kaatcp_get_request_kaasync_header_size()), only the header
+ * is written and the payload is left in place.
+ */
 kaatcp_error_t kaatcp_get_request_kaasync(const kaatcp_kaasync_t *message
                                         , char *buf
                                         , size_t *buf_size);
 
+kaatcp_error_t kaatcp_get_request_kaasync_header_size(size_t sync_request_size, size_t *header_size);
+
 kaatcp_error_t kaatcp_get_request_ping(char *buf, size_t *buf_size);
 
 #ifdef __cplusplus
@@ -24,4 +24,9 @@ kaa_time_t ext_get_systime();
 
 #define KAA_TIME() ext_get_systime()
 
+/* Milliseconds for SDK deadlines, with the resolution of KAA_TIME() */
+typedef uint64_t kaa_time_ms_t;
+
+#define KAA_TIME_MS() ((kaa_time_ms_t)KAA_TIME() * 1000)
+
 #endif /* ECONAIS_EC19D_TIME_H_ */
@@ -20,28 +20,47 @@
 
 #include "../platform/ext_log_storage.h"
 
-#include "../collections/kaa_list.h"
+#include "../kaa_common.h"
+
 #include "../utilities/kaa_mem.h"
 #include "../utilities/kaa_log.h"
 
 
 
-typedef struct {
-    char       *data;       /**< Serialized data */
-    size_t      size;       /**< Size of data */
-    uint16_t    bucket_id;  /**< Bucket ID */
+typedef struct ext_log_record_s {
+    char                      *data;       /**< Serialized data */
+    size_t                     size;       /**< Size of data */
+    size_t                     id;         /**< Sequence number keeping the order in which records were added */
+    uint16_t                   bucket_id;  /**< Bucket ID */
+    struct ext_log_record_s   *next;       /**< Next record in the same chain */
 } ext_log_record_t;
 
+/**
+ * Records taken into a bucket which is not delivered yet. The records are chained
+ * in the order they were added, so a nack merges them back into the unmarked ones
+ * without touching records of the other buckets.
+ */
+typedef struct ext_log_bucket_s {
+    uint16_t                   bucket_id;  /**< Bucket ID */
+    ext_log_record_t          *first;      /**< The eldest record of the bucket */
+    ext_log_record_t          *last;       /**< The latest record of the bucket */
+    size_t                     count;      /**< Number of records in the bucket */
+    size_t                     size;       /**< Volume occupied by the records of the bucket */
+    struct ext_log_bucket_s   *next;       /**< Next bucket in the index */
+} ext_log_bucket_t;
+
 typedef struct {
-    kaa_list_t     *logs;                  /**< List of @link ext_log_record_t @endlink */
-    kaa_list_t     *last_log_it;           /**< Point to the last record in the storage */
-    kaa_list_t     *first_unmarked;        /**< Pointer to the first unmarked record position (with zero bucket_id) */
-    size_t          max_storage_size;      /**< Max size of the log storage */
-    size_t          total_occupied_size;   /**< Volume occupied by all logs */
-    size_t          unmarked_occupied_size;/**< Volume occupied by unmarked logs */
-    size_t          unmarked_record_count; /**< Number of unmarked logs */
-    size_t          force_removal_to_size; /**< Percent of elder logs to delete in case max log storage size will be exceeded. */
-    kaa_logger_t   *logger;                /**< Logger instance */
+    ext_log_record_t   *first_unmarked;        /**< The eldest unmarked record (with zero bucket_id) */
+    ext_log_record_t   *last_unmarked;         /**< The latest unmarked record */
+    ext_log_bucket_t   *buckets;               /**< Index of the buckets in flight */
+    ext_log_bucket_t   *last_bucket;           /**< The latest bucket the records were taken into */
+    size_t              next_record_id;        /**< Sequence number for the next added record */
+    size_t              max_storage_size;      /**< Max size of the log storage */
+    size_t              total_occupied_size;   /**< Volume occupied by all logs */
+    size_t              unmarked_occupied_size;/**< Volume occupied by unmarked logs */
+    size_t              unmarked_record_count; /**< Number of unmarked logs */
+    size_t              force_removal_to_size; /**< Percent of elder logs to delete in case max log storage size will be exceeded. */
+    kaa_logger_t       *logger;                /**< Logger instance */
 } ext_log_storage_memory_t;
 
 
@@ -85,12 +104,55 @@ kaa_error_t ext_log_storage_destroy(void *context);
 
 
 
-static void log_record_destroy(void *record_p)
+static void log_record_destroy(ext_log_record_t *record)
+{
+    if (record) {
+        KAA_FREE(record->data);
+        KAA_FREE(record);
+    }
+}
+
+
+
+static void log_records_destroy(ext_log_record_t *record)
+{
+    while (record) {
+        ext_log_record_t *next = record->next;
+        log_record_destroy(record);
+        record = next;
+    }
+}
+
+
+
+static ext_log_bucket_t *find_bucket(ext_log_storage_memory_t *self, uint16_t bucket_id, ext_log_bucket_t **prev)
 {
-    if (record_p) {
-        KAA_FREE(((ext_log_record_t*)record_p)->data);
-        KAA_FREE(record_p);
+    ext_log_bucket_t *prev_bucket = NULL;
+    ext_log_bucket_t *bucket = self->buckets;
+
+    while (bucket && bucket->bucket_id != bucket_id) {
+        prev_bucket = bucket;
+        bucket = bucket->next;
     }
+
+    if (prev)
+        *prev = prev_bucket;
+    return bucket;
+}
+
+
+
+static void remove_bucket(ext_log_storage_memory_t *self, ext_log_bucket_t *bucket, ext_log_bucket_t *prev)
+{
+    if (prev)
+        prev->next = bucket->next;
+    else
+        self->buckets = bucket->next;
+
+    if (self->last_bucket == bucket)
+        self->last_bucket = prev;
+
+    KAA_FREE(bucket);
 }
 
 
@@ -103,9 +165,11 @@ kaa_error_t ext_unlimited_log_storage_create(void **log_storage_context_p, kaa_l
     KAA_RETURN_IF_NIL(log_storage, KAA_ERR_NOMEM);
 
     log_storage->logger                 = logger;
-    log_storage->logs                   = NULL;
-    log_storage->last_log_it            = NULL;
     log_storage->first_unmarked         = NULL;
+    log_storage->last_unmarked          = NULL;
+    log_storage->buckets                = NULL;
+    log_storage->last_bucket            = NULL;
+    log_storage->next_record_id         = 0;
     log_storage->max_storage_size       = 0;
     log_storage->total_occupied_size    = 0;
     log_storage->unmarked_occupied_size = 0;
@@ -163,25 +227,40 @@ static kaa_error_t shrink_to_size(void *context, size_t size)
     ext_log_storage_memory_t *self = (ext_log_storage_memory_t *)context;
     size_t removed_record_count = 0;
 
-    while (self->total_occupied_size > size && self->logs) {
+    while (self->total_occupied_size > size) {
         // May delete records already marked with bucket_id. C'est la vie...
-        ext_log_record_t *log_record = (ext_log_record_t *)kaa_list_get_data(self->logs);
-
-        self->total_occupied_size -= log_record->size;
-        ++removed_record_count;
+        ext_log_bucket_t *eldest_bucket = NULL;
+        ext_log_bucket_t *eldest_bucket_prev = NULL;
+        ext_log_bucket_t *prev = NULL;
+        ext_log_bucket_t *bucket = self->buckets;
+        for (; bucket; prev = bucket, bucket = bucket->next) {
+            if (!eldest_bucket || bucket->first->id < eldest_bucket->first->id) {
+                eldest_bucket = bucket;
+                eldest_bucket_prev = prev;
+            }
+        }
 
-        if (!log_record->bucket_id) {
+        ext_log_record_t *log_record = NULL;
+        if (self->first_unmarked && (!eldest_bucket || self->first_unmarked->id < eldest_bucket->first->id)) {
+            log_record = self->first_unmarked;
+            self->first_unmarked = log_record->next;
+            if (!self->first_unmarked)
+                self->last_unmarked = NULL;
             self->unmarked_occupied_size -= log_record->size;
             self->unmarked_record_count--;
-            self->first_unmarked = kaa_list_next(self->logs);
+        } else if (eldest_bucket) {
+            log_record = eldest_bucket->first;
+            eldest_bucket->first = log_record->next;
+            eldest_bucket->size -= log_record->size;
+            if (!--eldest_bucket->count)
+                remove_bucket(self, eldest_bucket, eldest_bucket_prev);
+        } else {
+            break;
         }
 
-        kaa_list_remove_at(&self->logs, self->logs, &log_record_destroy);
-    }
-
-    if (!self->logs) {
-        self->first_unmarked = NULL;
-        self->last_log_it = NULL;
+        self->total_occupied_size -= log_record->size;
+        ++removed_record_count;
+        log_record_destroy(log_record);
     }
 
     KAA_LOG_INFO(self->logger, KAA_ERR_NONE, "%zu records forcibly removed", removed_record_count);
@@ -208,24 +287,16 @@ kaa_error_t ext_log_storage_add_log_record(void *context, kaa_log_record_t *reco
 
     new_record->data = record->data;
     new_record->size = record->size;
+    new_record->id = self->next_record_id++;
     new_record->bucket_id = 0;
+    new_record->next = NULL;
 
-    kaa_list_t *it = NULL;
-
-    if (self->last_log_it) {
-        it = kaa_list_insert_after(self->last_log_it, new_record);
-    } else if (self->logs) {
-        it = kaa_list_push_back(self->logs, new_record);
-    } else {
-        self->logs = it = kaa_list_create(new_record);
-    }
-
-    if (!it) {
-        KAA_FREE(new_record);
-        return KAA_ERR_NOMEM;
-    }
+    if (self->last_unmarked)
+        self->last_unmarked->next = new_record;
+    else
+        self->first_unmarked = new_record;
 
-    self->last_log_it = it;
+    self->last_unmarked = new_record;
     self->total_occupied_size += new_record->size;
     self->unmarked_occupied_size += new_record->size;
     self->unmarked_record_count++;
@@ -249,13 +320,6 @@ kaa_error_t ext_log_storage_deallocate_log_record_buffer(void *context, kaa_log_
 
 
 
-bool find_by_bucket_id(void *log_record_p, void *bucket_id_p)
-{
-    return ((ext_log_record_t *)log_record_p)->bucket_id == *((uint16_t *)bucket_id_p);
-}
-
-
-
 kaa_error_t ext_log_storage_write_next_record(void *context
                                             , char *buffer
                                             , size_t buffer_len
@@ -265,27 +329,63 @@ kaa_error_t ext_log_storage_write_next_record(void *context
     KAA_RETURN_IF_NIL5(context, buffer, buffer_len, bucket_id, record_len, KAA_ERR_BADPARAM);
     ext_log_storage_memory_t *self = (ext_log_storage_memory_t *)context;
 
-    uint16_t zero_bucket_id = 0;
-    kaa_list_t *record_position = kaa_list_find_next(self->first_unmarked ? self->first_unmarked : self->logs
-                                                   , &find_by_bucket_id
-                                                   , &zero_bucket_id);
-    if (!record_position) {
+    ext_log_record_t *record = self->first_unmarked;
+    if (!record) {
         *record_len = 0;
         return KAA_ERR_NOT_FOUND;
     }
 
-    ext_log_record_t *record = (ext_log_record_t *) kaa_list_get_data(record_position);
     *record_len = record->size;
     if (*record_len > buffer_len)
         return KAA_ERR_INSUFFICIENT_BUFFER;
 
+    ext_log_bucket_t *bucket = self->last_bucket;
+    if (!bucket || bucket->bucket_id != bucket_id)
+        bucket = find_bucket(self, bucket_id, NULL);
+
+    if (!bucket) {
+        bucket = (ext_log_bucket_t *) KAA_CALLOC(1, sizeof(ext_log_bucket_t));
+        KAA_RETURN_IF_NIL(bucket, KAA_ERR_NOMEM);
+
+        bucket->bucket_id = bucket_id;
+        if (self->last_bucket)
+            self->last_bucket->next = bucket;
+        else
+            self->buckets = bucket;
+        self->last_bucket = bucket;
+    }
+
     memcpy((void *)buffer, record->data, record->size);
     record->bucket_id = bucket_id;
 
-    self->first_unmarked = kaa_list_next(record_position);
+    self->first_unmarked = record->next;
+    if (!self->first_unmarked)
+        self->last_unmarked = NULL;
     self->unmarked_record_count--;
     self->unmarked_occupied_size -= record->size;
 
+    /* Keeps the records of the bucket in the order they were added */
+    if (!bucket->last || bucket->last->id < record->id) {
+        record->next = NULL;
+        if (bucket->last)
+            bucket->last->next = record;
+        else
+            bucket->first = record;
+        bucket->last = record;
+    } else if (record->id < bucket->first->id) {
+        record->next = bucket->first;
+        bucket->first = record;
+    } else {
+        ext_log_record_t *it = bucket->first;
+        while (it->next->id < record->id)
+            it = it->next;
+        record->next = it->next;
+        it->next = record;
+    }
+
+    bucket->count++;
+    bucket->size += record->size;
+
     return KAA_ERR_NONE;
 }
 
@@ -296,23 +396,14 @@ kaa_error_t ext_log_storage_remove_by_bucket_id(void *context, uint16_t bucket_i
     KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
     ext_log_storage_memory_t *self = (ext_log_storage_memory_t *)context;
 
-    kaa_list_t *record_position = kaa_list_find_next(self->logs, find_by_bucket_id, &bucket_id);
-    if (!record_position)
+    ext_log_bucket_t *prev = NULL;
+    ext_log_bucket_t *bucket = find_bucket(self, bucket_id, &prev);
+    if (!bucket)
         return KAA_ERR_NOT_FOUND;
 
-    while (record_position) {
-        self->total_occupied_size -= ((ext_log_record_t *)kaa_list_get_data(record_position))->size;
-
-        record_position = kaa_list_remove_at(&self->logs, record_position, &log_record_destroy);
-        record_position = kaa_list_find_next(record_position, &find_by_bucket_id, &bucket_id);
-    }
-
-    // It's need to add a new element in the right place.
-    self->last_log_it = NULL;
-
-    if (!self->logs) {
-        self->first_unmarked = NULL;
-    }
+    self->total_occupied_size -= bucket->size;
+    log_records_destroy(bucket->first);
+    remove_bucket(self, bucket, prev);
 
     return KAA_ERR_NONE;
 }
@@ -324,21 +415,48 @@ kaa_error_t ext_log_storage_unmark_by_bucket_id(void *context, uint16_t bucket_i
     KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
     ext_log_storage_memory_t *self = (ext_log_storage_memory_t *)context;
 
-    kaa_list_t *record_position = kaa_list_find_next(self->logs, find_by_bucket_id, &bucket_id);
-    if (!record_position)
+    ext_log_bucket_t *prev = NULL;
+    ext_log_bucket_t *bucket = find_bucket(self, bucket_id, &prev);
+    if (!bucket)
         return KAA_ERR_NOT_FOUND;
 
-    while (record_position) {
-        ext_log_record_t *log_record = (ext_log_record_t *)kaa_list_get_data(record_position);
-
-        log_record->bucket_id = 0;
-        self->unmarked_record_count++;
-        self->unmarked_occupied_size += log_record->size;
-
-        record_position = kaa_list_find_next(record_position, &find_by_bucket_id, &bucket_id);
+    ext_log_record_t *record = bucket->first;
+    for (; record; record = record->next)
+        record->bucket_id = 0;
+
+    if (!self->first_unmarked) {
+        self->first_unmarked = bucket->first;
+        self->last_unmarked = bucket->last;
+    } else if (bucket->last->id < self->first_unmarked->id) {
+        /* The usual case: the bucket holds records elder than all the unmarked ones */
+        bucket->last->next = self->first_unmarked;
+        self->first_unmarked = bucket->first;
+    } else if (self->last_unmarked->id < bucket->first->id) {
+        self->last_unmarked->next = bucket->first;
+        self->last_unmarked = bucket->last;
+    } else {
+        /* Merges the records of the bucket into the unmarked ones up to the last record of the bucket */
+        ext_log_record_t **it = &self->first_unmarked;
+        record = bucket->first;
+        while (record) {
+            if (*it && (*it)->id < record->id) {
+                it = &(*it)->next;
+                continue;
+            }
+
+            ext_log_record_t *next = record->next;
+            record->next = *it;
+            if (!*it)
+                self->last_unmarked = record;
+            *it = record;
+            it = &record->next;
+            record = next;
+        }
     }
 
-    self->first_unmarked = NULL;
+    self->unmarked_record_count += bucket->count;
+    self->unmarked_occupied_size += bucket->size;
+    remove_bucket(self, bucket, prev);
 
     return KAA_ERR_NONE;
 }
@@ -366,7 +484,11 @@ kaa_error_t ext_log_storage_destroy(void *context)
     KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
     ext_log_storage_memory_t *self = (ext_log_storage_memory_t *)context;
     if (self) {
-        kaa_list_destroy(self->logs, &log_record_destroy);
+        log_records_destroy(self->first_unmarked);
+        while (self->buckets) {
+            log_records_destroy(self->buckets->first);
+            remove_bucket(self, self->buckets, NULL);
+        }
         KAA_FREE(self);
     }
     return KAA_ERR_NONE;
@@ -18,6 +18,10 @@
  * @file ext_log_upload_strategy_by_volume.h
  * @brief Simple sample implementation of the log upload strategy interface defined in ext_log_upload_strategy.h.
  * Makes decisions purely based on the amount of logs collected in the storage.
+ *
+ * The bucket size adapts to the delivery conditions: it is halved on each timeout or
+ * failure and grows back by the minimum bucket size with each delivery which is not
+ * notably slower than the average one, up to the configured batch size.
  */
 
 #ifndef KAA_DISABLE_FEATURE_LOGGING
@@ -60,6 +64,18 @@
  */
 #define KAA_DEFAULT_BATCH_SIZE                 8 * 1024
 
+/**
+ * @brief The default value (in bytes) for the size the report pack shrinks to at most
+ * after delivery timeouts and failures.
+ */
+#define KAA_DEFAULT_MIN_BATCH_SIZE             1024
+
+/**
+ * @brief The default value for the number of report packs waiting for a delivery response
+ * at the same time. The transport channel may limit the number of outstanding syncs further.
+ */
+#define KAA_DEFAULT_MAX_PARALLEL_UPLOADS       4
+
 
 
 extern kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa_channel_manager_t *self
@@ -71,10 +87,14 @@ typedef struct {
     size_t    threshold_volume;
     size_t    threshold_count;
     size_t    log_batch_size;
+    size_t    min_log_batch_size;
+    size_t    current_log_batch_size;
+    size_t    max_parallel_uploads;
     size_t    upload_timeout;
     size_t    upload_retry_period;
 
-    time_t    upload_retry_ts;
+    kaa_time_ms_t    upload_retry_deadline;
+    kaa_time_ms_t    average_delivery_time;
 
     kaa_channel_manager_t   *channel_manager;
     kaa_bootstrap_manager_t *bootstrap_manager;
@@ -129,6 +149,28 @@ kaa_error_t ext_log_upload_strategy_by_volume_set_batch_size(void *strategy, siz
 
 
 
+/**
+ * @brief Sets the size the log batch shrinks to at most after delivery timeouts and failures.
+ *
+ * @param   strategy              The strategy instance.
+ * @param   min_log_batch_size    The new minimum log batch size in bytes.
+ * @return Error code.
+ */
+kaa_error_t ext_log_upload_strategy_by_volume_set_min_batch_size(void *strategy, size_t min_log_batch_size);
+
+
+
+/**
+ * @brief Sets the number of log batches which may wait for a delivery response at the same time.
+ *
+ * @param   strategy                The strategy instance.
+ * @param   max_parallel_uploads    The new number of log batches.
+ * @return Error code.
+ */
+kaa_error_t ext_log_upload_strategy_by_volume_set_max_parallel_uploads(void *strategy, size_t max_parallel_uploads);
+
+
+
 /**
  * @brief Sets the new upload timeout to the strategy.
  *
@@ -161,7 +203,7 @@ kaa_error_t ext_log_upload_strategy_by_volume_create(void **strategy_p
 {
     KAA_RETURN_IF_NIL3(strategy_p, channel_manager, bootstrap_manager, KAA_ERR_BADPARAM);
 
-    ext_log_upload_strategy_t *strategy = (ext_log_upload_strategy_t *) KAA_MALLOC(sizeof(ext_log_upload_strategy_t));
+    ext_log_upload_strategy_t *strategy = (ext_log_upload_strategy_t *) KAA_CALLOC(1, sizeof(ext_log_upload_strategy_t));
     KAA_RETURN_IF_NIL(strategy, KAA_ERR_NOMEM);
 
     kaa_error_t error_code = KAA_ERR_NONE;
@@ -170,14 +212,19 @@ kaa_error_t ext_log_upload_strategy_by_volume_create(void **strategy_p
     KAA_RETURN_IF_ERR(error_code);
     error_code = ext_log_upload_strategy_by_volume_set_threshold_count(strategy, KAA_DEFAULT_UPLOAD_COUNT_THRESHOLD);
     KAA_RETURN_IF_ERR(error_code);
+    error_code = ext_log_upload_strategy_by_volume_set_min_batch_size(strategy, KAA_DEFAULT_MIN_BATCH_SIZE);
+    KAA_RETURN_IF_ERR(error_code);
     error_code = ext_log_upload_strategy_by_volume_set_batch_size(strategy, KAA_DEFAULT_BATCH_SIZE);
     KAA_RETURN_IF_ERR(error_code);
+    error_code = ext_log_upload_strategy_by_volume_set_max_parallel_uploads(strategy, KAA_DEFAULT_MAX_PARALLEL_UPLOADS);
+    KAA_RETURN_IF_ERR(error_code);
     error_code = ext_log_upload_strategy_by_volume_set_upload_timeout(strategy, KAA_DEFAULT_UPLOAD_TIMEOUT);
     KAA_RETURN_IF_ERR(error_code);
     error_code = ext_log_upload_strategy_by_volume_set_upload_retry_period(strategy, KAA_DEFAULT_RETRY_PERIOD);
     KAA_RETURN_IF_ERR(error_code);
 
-    strategy->upload_retry_ts = 0;
+    strategy->upload_retry_deadline = 0;
+    strategy->average_delivery_time = 0;
 
     strategy->bootstrap_manager = bootstrap_manager;
     strategy->channel_manager   = channel_manager;
@@ -197,6 +244,21 @@ void ext_log_upload_strategy_destroy(void *self)
 
 
 
+/*
+ * Keeps the current batch size within [min_log_batch_size, log_batch_size],
+ * the configured batch size taking precedence.
+ */
+static void set_current_batch_size(ext_log_upload_strategy_t *self, size_t batch_size)
+{
+    if (batch_size < self->min_log_batch_size)
+        batch_size = self->min_log_batch_size;
+    if (batch_size > self->log_batch_size)
+        batch_size = self->log_batch_size;
+    self->current_log_batch_size = batch_size;
+}
+
+
+
 ext_log_upload_decision_t ext_log_upload_strategy_decide(void *context, const void *log_storage_context)
 {
     KAA_RETURN_IF_NIL2(context, log_storage_context, NOOP);
@@ -204,10 +266,10 @@ ext_log_upload_decision_t ext_log_upload_strategy_decide(void *context, const vo
     ext_log_upload_decision_t decision = NOOP;
     ext_log_upload_strategy_t *self = (ext_log_upload_strategy_t *)context;
 
-    if (self->upload_retry_ts) {
-        if (KAA_TIME() >= self->upload_retry_ts) {
+    if (self->upload_retry_deadline) {
+        if (KAA_TIME_MS() >= self->upload_retry_deadline) {
             // force upload after retry timeout has elapsed
-            self->upload_retry_ts = 0;
+            self->upload_retry_deadline = 0;
             decision = UPLOAD;
         }
         return decision;
@@ -227,7 +289,15 @@ ext_log_upload_decision_t ext_log_upload_strategy_decide(void *context, const vo
 size_t ext_log_upload_strategy_get_bucket_size(void *context)
 {
     KAA_RETURN_IF_NIL(context, 0);
-    return ((ext_log_upload_strategy_t *)context)->log_batch_size;
+    return ((ext_log_upload_strategy_t *)context)->current_log_batch_size;
+}
+
+
+
+size_t ext_log_upload_strategy_get_max_parallel_uploads(void *context)
+{
+    KAA_RETURN_IF_NIL(context, 1);
+    return ((ext_log_upload_strategy_t *)context)->max_parallel_uploads;
 }
 
 
@@ -240,15 +310,25 @@ size_t ext_log_upload_strategy_get_timeout(void *context)
 
 
 
+kaa_time_ms_t ext_log_upload_strategy_get_retry_deadline(void *context)
+{
+    KAA_RETURN_IF_NIL(context, 0);
+    return ((ext_log_upload_strategy_t *)context)->upload_retry_deadline;
+}
+
+
+
 kaa_error_t ext_log_upload_strategy_on_timeout(void *context)
 {
     KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
 
     ext_log_upload_strategy_t *self = (ext_log_upload_strategy_t *)context;
+    set_current_batch_size(self, self->current_log_batch_size / 2);
+
     kaa_transport_channel_interface_t *channel = kaa_channel_manager_get_transport_channel(self->channel_manager
                                                                                          , KAA_SERVICE_LOGGING);
     if (channel) {
-        self->upload_retry_ts = 0;
+        self->upload_retry_deadline = 0;
         kaa_transport_protocol_id_t protocol_id;
         kaa_error_t error_code = channel->get_protocol_id(channel->context, &protocol_id);
         KAA_RETURN_IF_ERR(error_code);
@@ -263,17 +343,37 @@ kaa_error_t ext_log_upload_strategy_on_timeout(void *context)
 
 
 
+kaa_error_t ext_log_upload_strategy_on_success(void *context, kaa_time_ms_t delivery_time)
+{
+    KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
+    ext_log_upload_strategy_t *self = (ext_log_upload_strategy_t *)context;
+
+    // A delivery twice as slow as the average one means the buckets are queued somewhere
+    if (!self->average_delivery_time || delivery_time <= 2 * self->average_delivery_time)
+        set_current_batch_size(self, self->current_log_batch_size + self->min_log_batch_size);
+
+    if (self->average_delivery_time)
+        self->average_delivery_time = (7 * self->average_delivery_time + delivery_time) / 8;
+    else
+        self->average_delivery_time = delivery_time ? delivery_time : 1;
+
+    return KAA_ERR_NONE;
+}
+
+
+
 kaa_error_t ext_log_upload_strategy_on_failure(void *context, logging_delivery_error_code_t error_code)
 {
     KAA_RETURN_IF_NIL(context, KAA_ERR_BADPARAM);
     ext_log_upload_strategy_t *self = (ext_log_upload_strategy_t *)context;
+    set_current_batch_size(self, self->current_log_batch_size / 2);
 
     switch (error_code) {
     case NO_APPENDERS_CONFIGURED:
     case APPENDER_INTERNAL_ERROR:
     case REMOTE_CONNECTION_ERROR:
     case REMOTE_INTERNAL_ERROR:
-        self->upload_retry_ts = KAA_TIME() + self->upload_retry_period;
+        self->upload_retry_deadline = KAA_TIME_MS() + (kaa_time_ms_t)self->upload_retry_period * 1000;
         break;
     default:
         break;
@@ -305,7 +405,29 @@ kaa_error_t ext_log_upload_strategy_by_volume_set_threshold_count(void *strategy
 kaa_error_t ext_log_upload_strategy_by_volume_set_batch_size(void *strategy, size_t log_batch_size)
 {
     KAA_RETURN_IF_NIL2(strategy, log_batch_size, KAA_ERR_BADPARAM);
-    ((ext_log_upload_strategy_t *)strategy)->log_batch_size = log_batch_size;
+    ext_log_upload_strategy_t *self = (ext_log_upload_strategy_t *)strategy;
+    self->log_batch_size = log_batch_size;
+    set_current_batch_size(self, log_batch_size);
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_upload_strategy_by_volume_set_min_batch_size(void *strategy, size_t min_log_batch_size)
+{
+    KAA_RETURN_IF_NIL2(strategy, min_log_batch_size, KAA_ERR_BADPARAM);
+    ext_log_upload_strategy_t *self = (ext_log_upload_strategy_t *)strategy;
+    self->min_log_batch_size = min_log_batch_size;
+    set_current_batch_size(self, self->current_log_batch_size);
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t ext_log_upload_strategy_by_volume_set_max_parallel_uploads(void *strategy, size_t max_parallel_uploads)
+{
+    KAA_RETURN_IF_NIL2(strategy, max_parallel_uploads, KAA_ERR_BADPARAM);
+    ((ext_log_upload_strategy_t *)strategy)->max_parallel_uploads = max_parallel_uploads;
     return KAA_ERR_NONE;
 }
 
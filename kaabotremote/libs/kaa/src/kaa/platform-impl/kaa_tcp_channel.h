@@ -42,6 +42,18 @@ typedef enum {
 } kaa_tcp_channel_event_t;
 
 
+/**
+ * Bytes saved by compression: unzipped_bytes_sent - zipped_bytes_sent
+ * uplink and unzipped_bytes_received - zipped_bytes_received downlink.
+ */
+typedef struct {
+    size_t    unzipped_bytes_sent;        /**< Size of the client syncs which were sent zipped, before deflating */
+    size_t    zipped_bytes_sent;
+    size_t    zipped_bytes_received;
+    size_t    unzipped_bytes_received;    /**< Size of the zipped server syncs after inflating */
+} kaa_tcp_channel_compression_stats_t;
+
+
 /**
  * @brief Notifies about the current channel's state.
  * Used by @link kaa_tcp_channel_set_socket_events_callback @endlink .
@@ -140,6 +152,17 @@ kaa_error_t kaa_tcp_channel_get_max_timeout(kaa_transport_channel_interface_t *s
 kaa_error_t kaa_tcp_channel_check_keepalive(kaa_transport_channel_interface_t *self);
 
 
+/**
+ * @brief Checks whether the channel has a new access point which
+ * @link kaa_tcp_channel_check_keepalive @endlink has yet to resolve and connect.
+ *
+ * @param[in]   channel    The channel instance.
+ *
+ * @return true if the access point is waiting to be resolved.
+ */
+bool kaa_tcp_channel_is_access_point_pending(kaa_transport_channel_interface_t *self);
+
+
 /**
  * @brief Sets the callback for the current channel connection state.
  *
@@ -169,6 +192,45 @@ kaa_error_t kaa_tcp_channel_set_keepalive_timeout(kaa_transport_channel_interfac
                                                 , uint16_t keepalive);
 
 
+/**
+ * @brief Sets how many client syncs the channel may send before the server
+ * syncs for them arrive. Pending services wait until the window has room.
+ *
+ * @param[in]    channel      The channel instance.
+ * @param[in]    max_syncs    The window size, at least 1.
+ *
+ * @return Error code
+ */
+kaa_error_t kaa_tcp_channel_set_max_inflight_syncs(kaa_transport_channel_interface_t *self
+                                                 , size_t max_syncs);
+
+
+/**
+ * @brief Sets the minimum size of a client sync (in bytes) starting from which
+ * the channel sends it zipped. Zipped server syncs are always accepted.
+ *
+ * @param[in]    channel      The channel instance.
+ * @param[in]    threshold    The threshold in bytes.
+ *                            0 - indicates that client syncs are never zipped.
+ *
+ * @return Error code. KAA_ERR_UNSUPPORTED if the SDK is built without compression support.
+ */
+kaa_error_t kaa_tcp_channel_set_compression_threshold(kaa_transport_channel_interface_t *self
+                                                    , size_t threshold);
+
+
+/**
+ * @brief Retrieves the compression counters of the current channel.
+ *
+ * @param[in]    channel    The channel instance.
+ * @param[out]   stats      The compression counters.
+ *
+ * @return Error code. KAA_ERR_UNSUPPORTED if the SDK is built without compression support.
+ */
+kaa_error_t kaa_tcp_channel_get_compression_stats(kaa_transport_channel_interface_t *self
+                                                , kaa_tcp_channel_compression_stats_t *stats);
+
+
 /**
  * @brief Disconnects the current channel.
  *
@@ -28,8 +28,42 @@
 
 #define KAA_TCP_CHANNEL_KEEPALIVE           300
 
-#define KAATCP_PARSER_MAX_MESSAGE_LENGTH    1024 * 1024
+/* Client syncs a channel may send before the server syncs for them arrive */
+#define KAA_TCP_CHANNEL_MAX_INFLIGHT_SYNCS  4
+
+/* Delay in seconds before the Kaa client retries an access point which failed to resolve or connect */
+#define KAA_CLIENT_ACCESS_POINT_RETRY_DELAY 3
+
+/* Commands other threads may queue for the Kaa client IO loop */
+#define KAA_CLIENT_COMMAND_QUEUE_CAPACITY   64
+
+/* Client syncs of at least this size are zipped. 0 - outgoing syncs are never zipped. */
+#define KAA_TCP_CHANNEL_COMPRESSION_THRESHOLD 0
+
+#define KAATCP_PARSER_MAX_MESSAGE_LENGTH    (1024 * 1024)
+#define KAATCP_PARSER_INITIAL_BUFFER_SIZE   256
+/* A grown parser buffer shrinks back after this many frames that fit the initial size */
+#define KAATCP_PARSER_SHRINK_AFTER_FRAMES   8
 
 #define KAA_MAX_LOG_MESSAGE_LENGTH          512
 
+/* Events waiting to be sent or delivered to the server */
+#define KAA_EVENT_QUEUE_CAPACITY            64
+
+/* Bytes of the event FQN and data stored right in a queue slot, larger ones are allocated */
+#define KAA_EVENT_INLINE_SIZE               128
+
+/* Ranges of log records the ring log storage tracks: unmarked records, in-flight and acknowledged buckets */
+#define KAA_RING_LOG_STORAGE_MAX_RANGES     32
+
+/*
+ * Latency budgets in milliseconds. Sync requests of a service may wait that long
+ * to be merged with requests of other services into a single client sync.
+ */
+#define KAA_SYNC_LATENCY_PROFILE            10
+#define KAA_SYNC_LATENCY_USER               10
+#define KAA_SYNC_LATENCY_EVENT              5
+#define KAA_SYNC_LATENCY_LOGGING            1000
+#define KAA_SYNC_LATENCY_CONFIGURATION      10
+
 #endif /* POSIX_DEFAULTS_H_ */
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @file posix_log_storage.h
+ * @brief Log storage persisting the records in a memory-mapped file, so the records
+ * which are not delivered yet survive a restart of the application or the device.
+ */
+
+#ifndef POSIX_LOG_STORAGE_H_
+#define POSIX_LOG_STORAGE_H_
+
+#include <stddef.h>
+
+#include "../../kaa_error.h"
+#include "../../platform/time.h"
+#include "../../utilities/kaa_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * When the records written to the file are flushed to the disk.
+ */
+typedef enum {
+    EXT_LOG_STORAGE_SYNC_PER_RECORD,    /**< Each record is flushed once added */
+    EXT_LOG_STORAGE_SYNC_PER_BUCKET,    /**< Records are flushed when they are taken into a bucket and when a bucket is delivered */
+    EXT_LOG_STORAGE_SYNC_ON_TIMER       /**< Records are flushed at most once per sync period */
+} ext_log_storage_sync_policy_t;
+
+/**
+ * @brief Creates the file log storage or reopens an existing one.
+ *
+ * The records found in the file are recovered as unmarked, except the ones
+ * which belong to delivered buckets. A file of another size is reinitialized.
+ * The eldest records are evicted when a new one does not fit into the storage.
+ *
+ * @param[out]    log_storage_context_p    The pointer to the new storage instance.
+ * @param[in]     logger                   The logger.
+ * @param[in]     file_name                The storage file.
+ * @param[in]     storage_size             The space for the records, including 20 bytes per record.
+ * @param[in]     sync_policy              When the records are flushed to the disk.
+ * @param[in]     sync_period              Sync period in milliseconds for @link EXT_LOG_STORAGE_SYNC_ON_TIMER @endlink.
+ *
+ * @return    Error code.
+ */
+kaa_error_t ext_file_log_storage_create(void **log_storage_context_p
+                                      , kaa_logger_t *logger
+                                      , const char *file_name
+                                      , size_t storage_size
+                                      , ext_log_storage_sync_policy_t sync_policy
+                                      , kaa_time_ms_t sync_period);
+
+/**
+ * @brief Flushes the records to the disk.
+ *
+ * With @link EXT_LOG_STORAGE_SYNC_ON_TIMER @endlink the storage flushes the records
+ * only when it is used, so an application may call this function from its own timer
+ * to bound the time records stay unflushed.
+ *
+ * @param[in]     context    The log storage context.
+ *
+ * @return    Error code.
+ */
+kaa_error_t ext_file_log_storage_sync(void *context);
+
+#ifdef __cplusplus
+}      /* extern "C" */
+#endif
+#endif /* POSIX_LOG_STORAGE_H_ */
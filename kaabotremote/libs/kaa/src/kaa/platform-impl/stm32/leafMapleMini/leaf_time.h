@@ -19,9 +19,15 @@
 #define LEAF_TIME_H_
 
 #include <time.h>
+#include <stdint.h>
 
 typedef time_t kaa_time_t;
 
 #define KAA_TIME() (kaa_time_t)ext_get_systime()
 
+/* Milliseconds for SDK deadlines, with the resolution of KAA_TIME() */
+typedef uint64_t kaa_time_ms_t;
+
+#define KAA_TIME_MS() ((kaa_time_ms_t)KAA_TIME() * 1000)
+
 #endif /* LEAF_TIME_H_ */
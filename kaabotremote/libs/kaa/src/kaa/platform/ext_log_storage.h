@@ -135,7 +135,7 @@ kaa_error_t ext_log_storage_unmark_by_bucket_id(void *context, uint16_t bucket_i
  *
  * @param[in]       context     Log storage context.
  *
- * @return Total log storage size in bytes, occupied by log records. Zero in case of errors.
+ * @return Size in bytes of the log records not yet written to a bucket. Zero in case of errors.
  */
 size_t ext_log_storage_get_total_size(const void *context);
 
@@ -146,7 +146,7 @@ size_t ext_log_storage_get_total_size(const void *context);
  *
  * @param[in]       context     Log storage context.
  *
- * @return Total amount of log records in the storage. Zero in case of errors.
+ * @return Amount of log records not yet written to a bucket. Zero in case of errors.
  */
 size_t ext_log_storage_get_records_count(const void *context);
 
@@ -25,6 +25,7 @@
 #define EXT_LOG_UPLOAD_STRATEGY_H_
 
 #include "../platform/ext_log_storage.h"
+#include "../platform/time.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -74,6 +75,15 @@ size_t ext_log_upload_strategy_get_bucket_size(void *context);
 
 
 
+/**
+ * @brief Retrieves the maximum number of log buckets which may wait for a delivery response at the same time.
+ * @param[in]   context    Log upload strategy context.
+ * @return                 The number of buckets, at least 1.
+ */
+size_t ext_log_upload_strategy_get_max_parallel_uploads(void *context);
+
+
+
 /**
  * @brief The maximum time to wait a log delivery response.
  *
@@ -84,6 +94,16 @@ size_t ext_log_upload_strategy_get_timeout(void *context);
 
 
 
+/**
+ * @brief Retrieves the moment when a postponed log upload should be retried.
+ *
+ * @param[in]   context    Log upload strategy context.
+ * @return                 Deadline on the @link KAA_TIME_MS @endlink clock, 0 if no retry is pending.
+ */
+kaa_time_ms_t ext_log_upload_strategy_get_retry_deadline(void *context);
+
+
+
 /**
  * @brief Handles timeout of a log delivery.
  *
@@ -94,6 +114,16 @@ kaa_error_t ext_log_upload_strategy_on_timeout(void *context);
 
 
 
+/**
+ * @brief Handles successful log delivery.
+ * @param[in]   context          Log upload strategy context.
+ * @param[in]   delivery_time    Time in milliseconds between sending the bucket and receiving its delivery status.
+ * @return Error code.
+ */
+kaa_error_t ext_log_upload_strategy_on_success(void *context, kaa_time_ms_t delivery_time);
+
+
+
 /**
  * @brief Handles failure of a log delivery.
  *
@@ -16,19 +16,30 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
 #include "kaa_buffer.h"
 #include "kaa_mem.h"
 #include "../kaa_common.h"
 
 
+/*
+ * Unprocessed data live in [read, current) or, if the circular buffer wrapped,
+ * in [read, wrap) followed by [begin, current).
+ */
 struct kaa_buffer_t {
     char    *begin;
     char    *end;
+    char    *read;
     char    *current;
+    char    *wrap;
+    char    *reserved;
+    bool    circular;
 };
 
 
-kaa_error_t kaa_buffer_create_buffer(kaa_buffer_t **buffer_p, size_t buffer_size)
+
+static kaa_error_t kaa_buffer_create(kaa_buffer_t **buffer_p, size_t buffer_size, bool circular)
 {
     KAA_RETURN_IF_NIL2(buffer_p, buffer_size, KAA_ERR_BADPARAM);
 
@@ -42,12 +53,27 @@ kaa_error_t kaa_buffer_create_buffer(kaa_buffer_t **buffer_p, size_t buffer_size
     }
 
     buffer->end = buffer->begin + buffer_size;
-    buffer->current = buffer->begin;
+    buffer->circular = circular;
+    kaa_buffer_reset(buffer);
     *buffer_p = buffer;
     return KAA_ERR_NONE;
 }
 
 
+
+kaa_error_t kaa_buffer_create_buffer(kaa_buffer_t **buffer_p, size_t buffer_size)
+{
+    return kaa_buffer_create(buffer_p, buffer_size, false);
+}
+
+
+
+kaa_error_t kaa_buffer_create_circular_buffer(kaa_buffer_t **buffer_p, size_t buffer_size)
+{
+    return kaa_buffer_create(buffer_p, buffer_size, true);
+}
+
+
 kaa_error_t kaa_buffer_destroy(kaa_buffer_t *buffer_p)
 {
     KAA_RETURN_IF_NIL(buffer_p, KAA_ERR_BADPARAM);
@@ -61,12 +87,52 @@ kaa_error_t kaa_buffer_destroy(kaa_buffer_t *buffer_p)
 }
 
 
+
+static size_t kaa_buffer_get_occupied_size(const kaa_buffer_t *buffer_p)
+{
+    if (buffer_p->wrap)
+        return (buffer_p->wrap - buffer_p->read) + (buffer_p->current - buffer_p->begin);
+    return buffer_p->current - buffer_p->read;
+}
+
+
+
+/*
+ * Finds the largest contiguous free region. If it is at the beginning of
+ * the circular buffer, the next lock will wrap the write position.
+ */
+static char *kaa_buffer_get_free_region(kaa_buffer_t *buffer_p, size_t *free_size)
+{
+    if (buffer_p->wrap) {
+        *free_size = buffer_p->read - buffer_p->current;
+        return buffer_p->current;
+    }
+
+    size_t tail_size = buffer_p->end - buffer_p->current;
+    if (buffer_p->circular) {
+        size_t head_size = buffer_p->read - buffer_p->begin;
+        if (head_size > tail_size) {
+            *free_size = head_size;
+            return buffer_p->begin;
+        }
+    }
+
+    *free_size = tail_size;
+    return buffer_p->current;
+}
+
+
+
 kaa_error_t kaa_buffer_allocate_space(kaa_buffer_t *buffer_p, char **buffer, size_t *free_size)
 {
     KAA_RETURN_IF_NIL3(buffer_p, buffer, free_size, KAA_ERR_BADPARAM);
 
-    *buffer = buffer_p->current;
-    *free_size = buffer_p->end - buffer_p->current;
+    if (buffer_p->circular && buffer_p->read == buffer_p->current && !buffer_p->wrap) {
+        buffer_p->read = buffer_p->current = buffer_p->begin;
+    }
+
+    buffer_p->reserved = kaa_buffer_get_free_region(buffer_p, free_size);
+    *buffer = buffer_p->reserved;
 
     return KAA_ERR_NONE;
 }
@@ -76,9 +142,16 @@ kaa_error_t kaa_buffer_lock_space(kaa_buffer_t *buffer_p, size_t lock_size)
 {
     KAA_RETURN_IF_NIL2(buffer_p, lock_size, KAA_ERR_BADPARAM);
 
-    if (buffer_p->current + lock_size > buffer_p->end)
+    size_t free_size = 0;
+    char *region = kaa_buffer_get_free_region(buffer_p, &free_size);
+    if (buffer_p->reserved != region || lock_size > free_size)
         return KAA_ERR_BUFFER_IS_NOT_ENOUGH;
 
+    if (region != buffer_p->current) {
+        buffer_p->wrap = buffer_p->current;
+        buffer_p->current = region;
+    }
+
     buffer_p->current += lock_size;
     return KAA_ERR_NONE;
 }
@@ -88,15 +161,22 @@ kaa_error_t kaa_buffer_free_allocated_space(kaa_buffer_t *buffer_p, size_t size)
 {
     KAA_RETURN_IF_NIL2(buffer_p, size, KAA_ERR_BADPARAM);
 
-    if (buffer_p->begin + size > buffer_p->current)
+    if (size > kaa_buffer_get_occupied_size(buffer_p))
         return KAA_ERR_BUFFER_INVALID_SIZE;
 
-    char *byte_to_copy = buffer_p->begin + size;
-    char *it = buffer_p->begin;
-    for (; byte_to_copy != buffer_p->current; ++byte_to_copy, ++it)
-        *it = *byte_to_copy;
+    if (!buffer_p->circular) {
+        memmove(buffer_p->begin, buffer_p->begin + size, buffer_p->current - buffer_p->begin - size);
+        buffer_p->current -= size;
+        return KAA_ERR_NONE;
+    }
+
+    if (buffer_p->wrap && size >= (size_t)(buffer_p->wrap - buffer_p->read)) {
+        size -= buffer_p->wrap - buffer_p->read;
+        buffer_p->read = buffer_p->begin;
+        buffer_p->wrap = NULL;
+    }
 
-    buffer_p->current -= size;
+    buffer_p->read += size;
 
     return KAA_ERR_NONE;
 }
@@ -108,8 +188,39 @@ kaa_error_t kaa_buffer_get_unprocessed_space(kaa_buffer_t *buffer_p
 {
     KAA_RETURN_IF_NIL3(buffer_p, buffer, available_size, KAA_ERR_BADPARAM);
 
-    *buffer = buffer_p->begin;
-    *available_size = buffer_p->current - buffer_p->begin;
+    *buffer = buffer_p->read;
+    *available_size = (buffer_p->wrap ? buffer_p->wrap : buffer_p->current) - buffer_p->read;
+
+    return KAA_ERR_NONE;
+}
+
+
+
+kaa_error_t kaa_buffer_get_unprocessed_segments(kaa_buffer_t *buffer_p
+                                              , kaa_buffer_segment_t *segments
+                                              , size_t *segment_count
+                                              , size_t *available_size)
+{
+    KAA_RETURN_IF_NIL3(buffer_p, segments, segment_count, KAA_ERR_BADPARAM);
+
+    size_t count = 0;
+    char *first_end = buffer_p->wrap ? buffer_p->wrap : buffer_p->current;
+
+    if (first_end != buffer_p->read) {
+        segments[count].data = buffer_p->read;
+        segments[count].size = first_end - buffer_p->read;
+        ++count;
+    }
+
+    if (buffer_p->wrap && buffer_p->current != buffer_p->begin) {
+        segments[count].data = buffer_p->begin;
+        segments[count].size = buffer_p->current - buffer_p->begin;
+        ++count;
+    }
+
+    *segment_count = count;
+    if (available_size)
+        *available_size = kaa_buffer_get_occupied_size(buffer_p);
 
     return KAA_ERR_NONE;
 }
@@ -118,7 +229,9 @@ kaa_error_t kaa_buffer_get_unprocessed_space(kaa_buffer_t *buffer_p
 kaa_error_t kaa_buffer_reset(kaa_buffer_t *buffer_p)
 {
     KAA_RETURN_IF_NIL(buffer_p, KAA_ERR_BADPARAM);
+    buffer_p->read = buffer_p->begin;
     buffer_p->current = buffer_p->begin;
+    buffer_p->wrap = NULL;
+    buffer_p->reserved = NULL;
     return KAA_ERR_NONE;
 }
-
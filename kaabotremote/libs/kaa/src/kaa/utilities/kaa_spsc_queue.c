@@ -0,0 +1,123 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include "kaa_spsc_queue.h"
+#include "kaa_mem.h"
+#include "../kaa_common.h"
+
+#define KAA_SPSC_CACHE_LINE_SIZE    64
+
+/*
+ * The producer owns the tail and the consumer owns the head. Each side
+ * publishes its index with a release store and reads the other one with
+ * an acquire load, so a slot is never read before it's written.
+ */
+struct kaa_spsc_queue_t {
+    void      **items;
+    size_t      mask;
+    size_t      head;
+    char        head_pad[KAA_SPSC_CACHE_LINE_SIZE - sizeof(size_t)];
+    size_t      tail;
+    size_t      overflow_count;
+    char        tail_pad[KAA_SPSC_CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+};
+
+#define KAA_SPSC_LOAD(index)              __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+#define KAA_SPSC_STORE(index, value)      __atomic_store_n(&(index), (value), __ATOMIC_RELEASE)
+
+
+
+kaa_error_t kaa_spsc_queue_create(kaa_spsc_queue_t **queue_p, size_t capacity)
+{
+    KAA_RETURN_IF_NIL2(queue_p, capacity, KAA_ERR_BADPARAM);
+
+    size_t rounded_capacity = 1;
+    while (rounded_capacity < capacity) {
+        rounded_capacity <<= 1;
+        if (!rounded_capacity)
+            return KAA_ERR_BADPARAM;
+    }
+
+    kaa_spsc_queue_t *queue = (kaa_spsc_queue_t *) KAA_CALLOC(1, sizeof(kaa_spsc_queue_t));
+    KAA_RETURN_IF_NIL(queue, KAA_ERR_NOMEM);
+
+    queue->items = (void **) KAA_CALLOC(rounded_capacity, sizeof(void *));
+    if (!queue->items) {
+        KAA_FREE(queue);
+        return KAA_ERR_NOMEM;
+    }
+
+    queue->mask = rounded_capacity - 1;
+    *queue_p = queue;
+    return KAA_ERR_NONE;
+}
+
+
+
+void kaa_spsc_queue_destroy(kaa_spsc_queue_t *queue)
+{
+    KAA_RETURN_IF_NIL(queue,);
+    KAA_FREE(queue->items);
+    KAA_FREE(queue);
+}
+
+
+
+kaa_error_t kaa_spsc_queue_push(kaa_spsc_queue_t *queue, void *item)
+{
+    KAA_RETURN_IF_NIL2(queue, item, KAA_ERR_BADPARAM);
+
+    size_t tail = queue->tail;
+    if (tail - KAA_SPSC_LOAD(queue->head) > queue->mask) {
+        __atomic_store_n(&queue->overflow_count, queue->overflow_count + 1, __ATOMIC_RELAXED);
+        return KAA_ERR_BUFFER_IS_NOT_ENOUGH;
+    }
+
+    queue->items[tail & queue->mask] = item;
+    KAA_SPSC_STORE(queue->tail, tail + 1);
+    return KAA_ERR_NONE;
+}
+
+
+
+void *kaa_spsc_queue_pop(kaa_spsc_queue_t *queue)
+{
+    KAA_RETURN_IF_NIL(queue, NULL);
+
+    size_t head = queue->head;
+    if (head == KAA_SPSC_LOAD(queue->tail))
+        return NULL;
+
+    void *item = queue->items[head & queue->mask];
+    KAA_SPSC_STORE(queue->head, head + 1);
+    return item;
+}
+
+
+
+kaa_error_t kaa_spsc_queue_get_stats(kaa_spsc_queue_t *queue, size_t *size, size_t *overflow_count)
+{
+    KAA_RETURN_IF_NIL(queue, KAA_ERR_BADPARAM);
+
+    if (size) {
+        size_t head = KAA_SPSC_LOAD(queue->head);
+        *size = KAA_SPSC_LOAD(queue->tail) - head;
+    }
+    if (overflow_count)
+        *overflow_count = __atomic_load_n(&queue->overflow_count, __ATOMIC_RELAXED);
+    return KAA_ERR_NONE;
+}
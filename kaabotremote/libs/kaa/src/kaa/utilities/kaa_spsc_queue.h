@@ -0,0 +1,76 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file kaa_spsc_queue.h
+ * @brief Bounded lock-free single-producer/single-consumer queue
+ *
+ * A ring of pointers. One thread may push while another one pops, with no
+ * locks on either side. The queue never owns the items it holds.
+ */
+
+#ifndef KAA_SPSC_QUEUE_H_
+#define KAA_SPSC_QUEUE_H_
+
+#include <stddef.h>
+#include "../kaa_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef KAA_SPSC_QUEUE_T
+# define KAA_SPSC_QUEUE_T
+    typedef struct kaa_spsc_queue_t        kaa_spsc_queue_t;
+#endif
+
+
+
+/**
+ * @brief Creates a queue. The capacity is rounded up to a power of two.
+ */
+kaa_error_t kaa_spsc_queue_create(kaa_spsc_queue_t **queue_p, size_t capacity);
+
+/**
+ * @brief Destroys the queue. Items still in it are not freed.
+ */
+void kaa_spsc_queue_destroy(kaa_spsc_queue_t *queue);
+
+/**
+ * @brief Adds an item. Called from the producer thread only.
+ *
+ * @return Error code. KAA_ERR_BUFFER_IS_NOT_ENOUGH if the queue is full,
+ * the overflow is counted then.
+ */
+kaa_error_t kaa_spsc_queue_push(kaa_spsc_queue_t *queue, void *item);
+
+/**
+ * @brief Removes the oldest item. Called from the consumer thread only.
+ *
+ * @return The item or NULL if the queue is empty.
+ */
+void *kaa_spsc_queue_pop(kaa_spsc_queue_t *queue);
+
+/**
+ * @brief Retrieves the number of queued items and of the rejected pushes.
+ * May be called from any thread, the values are a snapshot.
+ */
+kaa_error_t kaa_spsc_queue_get_stats(kaa_spsc_queue_t *queue, size_t *size, size_t *overflow_count);
+
+#ifdef __cplusplus
+}      /* extern "C" */
+#endif
+#endif /* KAA_SPSC_QUEUE_H_ */
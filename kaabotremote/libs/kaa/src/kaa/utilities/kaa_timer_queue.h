@@ -0,0 +1,102 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file kaa_timer_queue.h
+ * @brief Deadline timers of the Kaa endpoint SDK
+ *
+ * A binary min-heap of timers ordered by their deadlines on the
+ * @link KAA_TIME_MS @endlink clock. The queue is owned by the Kaa context
+ * and is driven by @link kaa_process_deadlines @endlink.
+ */
+
+#ifndef KAA_TIMER_QUEUE_H_
+#define KAA_TIMER_QUEUE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "../kaa_error.h"
+#include "../platform/time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KAA_TIMER_NOT_SCHEDULED    ((size_t) -1)
+
+#ifndef KAA_TIMER_QUEUE_T
+# define KAA_TIMER_QUEUE_T
+    typedef struct kaa_timer_queue_t        kaa_timer_queue_t;
+#endif
+
+/**
+ * @brief Called from @link kaa_timer_queue_process @endlink when the timer expires.
+ * The timer is already removed from the queue and may be rescheduled.
+ */
+typedef void (*kaa_timer_fn)(void *context);
+
+/**
+ * A timer is embedded into its owner, the queue never allocates timers.
+ * Must be initialized with @link kaa_timer_init @endlink.
+ */
+typedef struct {
+    kaa_time_ms_t    deadline;
+    kaa_timer_fn     callback;
+    void             *context;
+    size_t           heap_index;
+} kaa_timer_t;
+
+
+
+void kaa_timer_init(kaa_timer_t *timer, kaa_timer_fn callback, void *context);
+
+bool kaa_timer_is_scheduled(const kaa_timer_t *timer);
+
+kaa_error_t kaa_timer_queue_create(kaa_timer_queue_t **queue_p);
+
+void kaa_timer_queue_destroy(kaa_timer_queue_t *queue);
+
+/**
+ * @brief Schedules the timer to expire at @c deadline. An already scheduled
+ * timer is moved to the new deadline.
+ */
+kaa_error_t kaa_timer_queue_schedule(kaa_timer_queue_t *queue, kaa_timer_t *timer, kaa_time_ms_t deadline);
+
+/**
+ * @brief Removes the timer from the queue. Cancelling a timer which is not
+ * scheduled is not an error.
+ */
+kaa_error_t kaa_timer_queue_cancel(kaa_timer_queue_t *queue, kaa_timer_t *timer);
+
+/**
+ * @brief Retrieves the earliest deadline.
+ *
+ * @return Error code. KAA_ERR_NOT_FOUND if no timer is scheduled.
+ */
+kaa_error_t kaa_timer_queue_get_next_deadline(kaa_timer_queue_t *queue, kaa_time_ms_t *deadline);
+
+/**
+ * @brief Fires all timers whose deadlines are not later than @c now.
+ *
+ * At most as many timers as were scheduled on entry are fired, so a callback
+ * which reschedules its timer into the past can't make the call loop forever.
+ */
+kaa_error_t kaa_timer_queue_process(kaa_timer_queue_t *queue, kaa_time_ms_t now);
+
+#ifdef __cplusplus
+}      /* extern "C" */
+#endif
+#endif /* KAA_TIMER_QUEUE_H_ */
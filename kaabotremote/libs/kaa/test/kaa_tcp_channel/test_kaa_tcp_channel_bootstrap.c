@@ -452,6 +452,7 @@ void test_set_access_point(kaa_transport_channel_interface_t *channel)
     kaa_transport_context_t transport_context;
     transport_context.platform_protocol = (kaa_platform_protocol_t *)CONNECTION_DATA;
     transport_context.bootstrap_manager = (kaa_bootstrap_manager_t *)CONNECTION_DATA;
+    transport_context.timer_queue = NULL;
 
     kaa_error_t error_code = channel->init(channel->context, &transport_context);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
@@ -688,6 +689,11 @@ kaatcp_error_t kaatcp_fill_connect_message(uint16_t keepalive, uint32_t next_pro
 }
 
 
+kaa_error_t kaa_platform_protocol_drop_pending_syncs(kaa_platform_protocol_t *self, void *channel)
+{
+    return KAA_ERR_NONE;
+}
+
 kaa_error_t kaa_platform_protocol_serialize_client_sync(kaa_platform_protocol_t *self
                                                       , const kaa_serialize_info_t *info
                                                       , char **buffer
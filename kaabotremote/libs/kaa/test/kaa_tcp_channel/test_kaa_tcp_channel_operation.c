@@ -58,6 +58,7 @@ typedef struct {
     bool        socket_disconnected_closed;
     bool        socket_disconnected_callback;
     bool        bootstrap_manager_on_access_point_failed;
+    bool        pending_syncs_dropped;
     kaa_fd_t    fd;
 } set_access_point_info_t;
 
@@ -458,6 +459,69 @@ void test_kaa_tcp_channel_auth_double_sync_flow()
 }
 
 
+/**
+ * Test the window of in-flight syncs:
+ *  1. Authorize with a window of one sync.
+ *  2. Send KAASYNC and request another sync, check that it waits for the response.
+ *  3. Receive KAASYNC, check that the pending sync may be sent.
+ *  4. Imitate IO error, check that the in-flight syncs are dropped.
+ */
+void test_kaa_tcp_channel_inflight_window_flow()
+{
+    KAA_TRACE_IN(logger);
+
+    kaa_transport_channel_interface_t *channel = NULL;
+    channel = KAA_CALLOC(1, sizeof(kaa_transport_channel_interface_t));
+
+    kaa_service_t operation_services[] = {
+            KAA_SERVICE_PROFILE,
+            KAA_SERVICE_USER,
+            KAA_SERVICE_EVENT,
+            KAA_SERVICE_LOGGING};
+
+    kaa_error_t error_code = kaa_tcp_channel_create(channel, logger, operation_services, 4);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_tcp_channel_set_max_inflight_syncs(channel, 0);
+    ASSERT_EQUAL(error_code, KAA_ERR_BADPARAM);
+    error_code = kaa_tcp_channel_set_max_inflight_syncs(channel, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_set_access_point(channel);
+
+    test_check_channel_auth(channel);
+
+    channel->sync_handler(channel->context, operation_services, 4);
+    CHECK_SOCKET_RW(channel, true, true);
+
+    access_point_test_info.kaasync_read_scenario = true;
+    error_code = kaa_tcp_channel_process_event(channel, FD_WRITE);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(access_point_test_info.kaasync_write, true);
+
+    //The window is full, the next sync waits for the server sync
+    channel->sync_handler(channel->context, operation_services, 4);
+    CHECK_SOCKET_RW(channel, true, false);
+
+    error_code = kaa_tcp_channel_process_event(channel, FD_READ);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(access_point_test_info.kaasync_processed, true);
+    CHECK_SOCKET_RW(channel, true, true);
+
+    access_point_test_info.pending_syncs_dropped = false;
+    access_point_test_info.socket_connecting_error_scenario = true;
+    error_code = kaa_tcp_channel_process_event(channel, FD_READ);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(access_point_test_info.pending_syncs_dropped, true);
+
+    channel->destroy(channel->context);
+
+    KAA_FREE(channel);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
 void test_sync_exchange(kaa_transport_channel_interface_t *channel)
 {
     ASSERT_NOT_NULL(channel);
@@ -561,6 +625,7 @@ void test_set_access_point(kaa_transport_channel_interface_t *channel)
     kaa_transport_context_t transport_context;
     transport_context.platform_protocol = (kaa_platform_protocol_t *)CONNECTION_DATA;
     transport_context.bootstrap_manager = (kaa_bootstrap_manager_t *)CONNECTION_DATA;
+    transport_context.timer_queue = NULL;
 
     kaa_error_t error_code = channel->init(channel->context, &transport_context);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
@@ -726,6 +791,12 @@ kaa_error_t kaa_platform_protocol_process_server_sync(kaa_platform_protocol_t *s
     return KAA_ERR_BADPARAM;
 }
 
+kaa_error_t kaa_platform_protocol_drop_pending_syncs(kaa_platform_protocol_t *self, void *channel)
+{
+    access_point_test_info.pending_syncs_dropped = true;
+    return KAA_ERR_NONE;
+}
+
 kaa_error_t kaa_platform_protocol_serialize_client_sync(kaa_platform_protocol_t *self
                                                       , const kaa_serialize_info_t *info
                                                       , char **buffer
@@ -934,4 +1005,5 @@ KAA_SUITE_MAIN(Log, test_init, test_deinit,
         KAA_TEST_CASE(create_kaa_tcp_channel_sync_flow, test_kaa_tcp_channel_sync_flow)
         KAA_TEST_CASE(create_kaa_tcp_channel_io_error_flow, test_kaa_tcp_channel_io_error_flow)
         KAA_TEST_CASE(create_kaa_tcp_channel_auth_double_sync_flow, test_kaa_tcp_channel_auth_double_sync_flow)
+        KAA_TEST_CASE(create_kaa_tcp_channel_inflight_window_flow, test_kaa_tcp_channel_inflight_window_flow)
         )
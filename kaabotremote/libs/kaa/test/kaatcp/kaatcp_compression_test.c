@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "../kaa_test.h"
+#include "utilities/kaa_log.h"
+#include "kaa_protocols/kaa_tcp/kaatcp_compression.h"
+
+
+static kaa_logger_t *logger = NULL;
+
+#define TEST_DATA_SIZE 4096
+
+
+
+void test_kaatcp_compression_round_trip()
+{
+    KAA_TRACE_IN(logger);
+
+    kaatcp_compression_t *compression = NULL;
+    kaatcp_error_t rval = kaatcp_compression_create(&compression);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+
+    char data[TEST_DATA_SIZE];
+    size_t i = 0;
+    for (; i < TEST_DATA_SIZE; ++i) {
+        data[i] = "log record "[i % 11];
+    }
+
+    /* The second pass reuses the zlib streams and the output buffers. */
+    int pass = 0;
+    for (; pass < 2; ++pass) {
+        const char *zipped = NULL;
+        size_t zipped_size = 0;
+        rval = kaatcp_compression_deflate(compression, data, TEST_DATA_SIZE, &zipped, &zipped_size);
+        ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+        ASSERT_TRUE(zipped_size < TEST_DATA_SIZE / 4);
+
+        char zipped_copy[TEST_DATA_SIZE];
+        memcpy(zipped_copy, zipped, zipped_size);
+
+        const char *unzipped = NULL;
+        size_t unzipped_size = 0;
+        rval = kaatcp_compression_inflate(compression, zipped_copy, zipped_size, TEST_DATA_SIZE, &unzipped, &unzipped_size);
+        ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+        ASSERT_EQUAL(unzipped_size, TEST_DATA_SIZE);
+        ASSERT_EQUAL(memcmp(unzipped, data, TEST_DATA_SIZE), 0);
+
+        rval = kaatcp_compression_inflate(compression, zipped_copy, zipped_size, TEST_DATA_SIZE - 1, &unzipped, &unzipped_size);
+        ASSERT_EQUAL(rval, KAATCP_ERR_BUFFER_NOT_ENOUGH);
+    }
+
+    kaatcp_compression_destroy(compression);
+
+    KAA_TRACE_OUT(logger);
+}
+
+void test_kaatcp_compression_bad_data()
+{
+    KAA_TRACE_IN(logger);
+
+    kaatcp_compression_t *compression = NULL;
+    kaatcp_error_t rval = kaatcp_compression_create(&compression);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+
+    const char *zipped = NULL;
+    size_t zipped_size = 0;
+    rval = kaatcp_compression_deflate(compression, "payload", 7, &zipped, &zipped_size);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+
+    char truncated[64];
+    memcpy(truncated, zipped, zipped_size - 2);
+
+    const char *unzipped = NULL;
+    size_t unzipped_size = 0;
+    rval = kaatcp_compression_inflate(compression, truncated, zipped_size - 2, 1024, &unzipped, &unzipped_size);
+    ASSERT_EQUAL(rval, KAATCP_ERR_INVALID_PROTOCOL);
+
+    char garbage[] = { 0x01, 0x02, 0x03, 0x04 };
+    rval = kaatcp_compression_inflate(compression, garbage, sizeof(garbage), 1024, &unzipped, &unzipped_size);
+    ASSERT_EQUAL(rval, KAATCP_ERR_INVALID_PROTOCOL);
+
+    kaatcp_compression_destroy(compression);
+
+    KAA_TRACE_OUT(logger);
+}
+
+int test_init(void)
+{
+    kaa_error_t error = kaa_log_create(&logger, KAA_MAX_LOG_MESSAGE_LENGTH, KAA_MAX_LOG_LEVEL, NULL);
+    if (error || !logger) {
+        return error;
+    }
+
+    return 0;
+}
+
+int test_deinit(void)
+{
+    kaa_log_destroy(logger);
+    return 0;
+}
+
+KAA_SUITE_MAIN(Compression, test_init, test_deinit
+       ,
+       KAA_TEST_CASE(kaatcp_compression_round_trip, test_kaatcp_compression_round_trip)
+       KAA_TEST_CASE(kaatcp_compression_bad_data, test_kaatcp_compression_bad_data)
+)
@@ -123,6 +123,41 @@ void test_kaatcp_kaasync()
     KAA_TRACE_OUT(logger);
 }
 
+void test_kaatcp_kaasync_in_place()
+{
+    KAA_TRACE_IN(logger);
+
+    size_t header_size = 0;
+    kaatcp_error_t rval = kaatcp_get_request_kaasync_header_size(7, &header_size);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+    ASSERT_EQUAL(header_size, 14);
+
+    rval = kaatcp_get_request_kaasync_header_size(200, &header_size);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+    ASSERT_EQUAL(header_size, 15);
+
+    char kaasync_buf[128];
+    size_t kaasync_buf_size = 128;
+    rval = kaatcp_get_request_kaasync_header_size(7, &header_size);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+    memcpy(kaasync_buf + header_size, "payload", 7);
+
+    kaatcp_kaasync_t kaasync;
+    rval = kaatcp_fill_kaasync_message(kaasync_buf + header_size, 7, 5, 0, 1, &kaasync);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+
+    rval = kaatcp_get_request_kaasync(&kaasync, kaasync_buf, &kaasync_buf_size);
+    ASSERT_EQUAL(rval, KAATCP_ERR_NONE);
+
+    unsigned char kaasync_message[] = { 0xF0, 0x13, 0x00, 0x06, 'K', 'a', 'a', 't', 'c', 'p', 0x01, 0x00, 0x05, 0x15 };
+
+    ASSERT_EQUAL(kaasync_buf_size,  21);
+    ASSERT_EQUAL(memcmp(kaasync_message, kaasync_buf, 14),  0);
+    ASSERT_EQUAL(memcmp(kaasync_buf + 14, "payload", 7),  0);
+
+    KAA_TRACE_OUT(logger);
+}
+
 void test_kaatcp_ping()
 {
     KAA_TRACE_IN(logger);
@@ -162,5 +197,6 @@ KAA_SUITE_MAIN(Log, test_init, test_deinit
        KAA_TEST_CASE(kaatcp_connect, test_kaatcp_connect_without_key)
        KAA_TEST_CASE(kaatcp_disconnect, test_kaatcp_disconnect)
        KAA_TEST_CASE(kaatcp_kaasync, test_kaatcp_kaasync)
+       KAA_TEST_CASE(kaatcp_kaasync_in_place, test_kaatcp_kaasync_in_place)
        KAA_TEST_CASE(kaatcp_ping, test_kaatcp_ping)
 )
@@ -50,6 +50,8 @@ extern kaa_error_t ext_log_upload_strategy_by_volume_set_threshold_count(void *s
 extern kaa_error_t ext_log_upload_strategy_by_volume_set_batch_size(void *strategy, size_t log_batch_size);
 extern kaa_error_t ext_log_upload_strategy_by_volume_set_upload_timeout(void *strategy, size_t upload_timeout);
 extern kaa_error_t ext_log_upload_strategy_by_volume_set_upload_retry_period(void *strategy, size_t upload_retry_period);
+extern kaa_error_t ext_log_upload_strategy_by_volume_set_min_batch_size(void *strategy, size_t min_log_batch_size);
+extern kaa_error_t ext_log_upload_strategy_by_volume_set_max_parallel_uploads(void *strategy, size_t max_parallel_uploads);
 
 
 
@@ -150,6 +152,60 @@ void test_set_batch_size()
     KAA_TRACE_OUT(logger);
 }
 
+void test_adaptive_batch_size()
+{
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code = KAA_ERR_NONE;
+    void *strategy = NULL;
+
+    size_t MIN_BATCH_SIZE = 1024;
+    size_t MAX_BATCH_SIZE = 8 * 1024;
+
+    error_code = ext_log_upload_strategy_by_volume_create(&strategy, channel_manager, bootstrap_manager);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = ext_log_upload_strategy_by_volume_set_min_batch_size(strategy, MIN_BATCH_SIZE);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = ext_log_upload_strategy_by_volume_set_batch_size(strategy, MAX_BATCH_SIZE);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_bucket_size(strategy), MAX_BATCH_SIZE);
+
+    /* Halved on failures and timeouts down to the minimum */
+    ext_log_upload_strategy_on_failure(strategy, REMOTE_CONNECTION_ERROR);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_bucket_size(strategy), MAX_BATCH_SIZE / 2);
+    ext_log_upload_strategy_on_timeout(strategy);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_bucket_size(strategy), MAX_BATCH_SIZE / 4);
+    ext_log_upload_strategy_on_timeout(strategy);
+    ext_log_upload_strategy_on_timeout(strategy);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_bucket_size(strategy), MIN_BATCH_SIZE);
+
+    /* Grows back while deliveries are not slower than usual */
+    ASSERT_NOT_EQUAL(ext_log_upload_strategy_on_success(NULL, 100), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_upload_strategy_on_success(strategy, 100), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_bucket_size(strategy), 2 * MIN_BATCH_SIZE);
+    ext_log_upload_strategy_on_success(strategy, 150);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_bucket_size(strategy), 3 * MIN_BATCH_SIZE);
+    ext_log_upload_strategy_on_success(strategy, 1000);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_bucket_size(strategy), 3 * MIN_BATCH_SIZE);
+
+    size_t i;
+    for (i = 0; i < 16; ++i)
+        ext_log_upload_strategy_on_success(strategy, 100);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_bucket_size(strategy), MAX_BATCH_SIZE);
+
+    ASSERT_EQUAL(ext_log_upload_strategy_get_max_parallel_uploads(strategy), 4);
+    error_code = ext_log_upload_strategy_by_volume_set_max_parallel_uploads(strategy, 0);
+    ASSERT_NOT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = ext_log_upload_strategy_by_volume_set_max_parallel_uploads(strategy, 2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_upload_strategy_get_max_parallel_uploads(strategy), 2);
+
+    ext_log_upload_strategy_destroy(strategy);
+
+    KAA_TRACE_OUT(logger);
+}
+
 void test_upload_decision_by_volume()
 {
     KAA_TRACE_IN(logger);
@@ -417,6 +473,7 @@ KAA_SUITE_MAIN(MetaExtension, test_init, test_deinit,
         KAA_TEST_CASE(create_strategy, test_create_strategy)
         KAA_TEST_CASE(set_upload_timeout, test_set_upload_timeout)
         KAA_TEST_CASE(set_batch_size, test_set_batch_size)
+        KAA_TEST_CASE(adaptive_batch_size, test_adaptive_batch_size)
         KAA_TEST_CASE(upload_decision_by_volume, test_upload_decision_by_volume)
         KAA_TEST_CASE(upload_decision_by_count, test_upload_decision_by_count)
         KAA_TEST_CASE(noop_decision_on_failure, test_noop_decision_on_failure)
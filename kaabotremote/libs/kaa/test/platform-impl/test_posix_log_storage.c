@@ -0,0 +1,276 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../kaa_test.h"
+
+#include "utilities/kaa_mem.h"
+#include "utilities/kaa_log.h"
+
+#include "platform/ext_log_storage.h"
+#include "platform-impl/posix/posix_log_storage.h"
+
+
+
+extern kaa_error_t ext_log_storage_destroy(void *context);
+
+
+
+#define TEST_STORAGE_FILE       "test_log_storage.bin"
+#define TEST_RECORD_SIZE        4
+#define TEST_RECORD_FOOTPRINT   (20 + TEST_RECORD_SIZE)  /* Record header and data */
+#define TEST_RECORDS_OFFSET     64                       /* Two copies of the storage header */
+#define TEST_STORAGE_SIZE       (3 * TEST_RECORD_FOOTPRINT)
+
+static kaa_logger_t *logger = NULL;
+
+
+
+static void *open_storage(size_t storage_size)
+{
+    void *storage = NULL;
+    kaa_error_t error_code = ext_file_log_storage_create(&storage, logger, TEST_STORAGE_FILE, storage_size
+                                                       , EXT_LOG_STORAGE_SYNC_ON_TIMER, 1000);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    return storage;
+}
+
+static void add_log_record(void *storage, const char *data)
+{
+    kaa_log_record_t record = { NULL, TEST_RECORD_SIZE };
+    kaa_error_t error_code = ext_log_storage_allocate_log_record_buffer(storage, &record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    memcpy(record.data, data, TEST_RECORD_SIZE);
+
+    error_code = ext_log_storage_add_log_record(storage, &record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+}
+
+static void check_next_log_record(void *storage, uint16_t bucket_id, const char *data)
+{
+    char buffer[TEST_RECORD_SIZE];
+    size_t record_len = 0;
+    kaa_error_t error_code = ext_log_storage_write_next_record(storage, buffer, sizeof(buffer), bucket_id, &record_len);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(record_len, TEST_RECORD_SIZE);
+    ASSERT_EQUAL(memcmp(buffer, data, TEST_RECORD_SIZE), 0);
+}
+
+
+
+void test_create_file_storage()
+{
+    KAA_TRACE_IN(logger);
+
+    void *storage;
+    kaa_error_t error_code = ext_file_log_storage_create(NULL, logger, TEST_STORAGE_FILE, TEST_STORAGE_SIZE
+                                                       , EXT_LOG_STORAGE_SYNC_PER_RECORD, 0);
+    ASSERT_NOT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = ext_file_log_storage_create(&storage, logger, NULL, TEST_STORAGE_SIZE
+                                           , EXT_LOG_STORAGE_SYNC_PER_RECORD, 0);
+    ASSERT_NOT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = ext_file_log_storage_create(&storage, logger, TEST_STORAGE_FILE, 4
+                                           , EXT_LOG_STORAGE_SYNC_PER_RECORD, 0);
+    ASSERT_NOT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = ext_file_log_storage_create(&storage, logger, TEST_STORAGE_FILE, TEST_STORAGE_SIZE
+                                           , EXT_LOG_STORAGE_SYNC_PER_RECORD, 0);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 0);
+
+    add_log_record(storage, "AAAA");
+    ASSERT_EQUAL(ext_file_log_storage_sync(storage), KAA_ERR_NONE);
+    ext_log_storage_destroy(storage);
+
+    /* Another size reinitializes the file */
+    storage = open_storage(2 * TEST_STORAGE_SIZE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 0);
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_recover_undelivered_records()
+{
+    KAA_TRACE_IN(logger);
+
+    void *storage = open_storage(2 * TEST_STORAGE_SIZE);
+    add_log_record(storage, "AAAA");
+    add_log_record(storage, "BBBB");
+    add_log_record(storage, "CCCC");
+    add_log_record(storage, "DDDD");
+
+    check_next_log_record(storage, 1, "AAAA");
+    check_next_log_record(storage, 1, "BBBB");
+    check_next_log_record(storage, 2, "CCCC");
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 2), KAA_ERR_NONE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 1);
+    ext_log_storage_destroy(storage);
+
+    /* The records of the bucket in flight are unmarked, the delivered one is skipped */
+    storage = open_storage(2 * TEST_STORAGE_SIZE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 3);
+    ASSERT_EQUAL(ext_log_storage_get_total_size(storage), 3 * TEST_RECORD_SIZE);
+    check_next_log_record(storage, 1, "AAAA");
+    check_next_log_record(storage, 1, "BBBB");
+    check_next_log_record(storage, 1, "DDDD");
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 1), KAA_ERR_NONE);
+    ext_log_storage_destroy(storage);
+
+    storage = open_storage(2 * TEST_STORAGE_SIZE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 0);
+    add_log_record(storage, "EEEE");
+    ext_log_storage_destroy(storage);
+
+    storage = open_storage(2 * TEST_STORAGE_SIZE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 1);
+    check_next_log_record(storage, 1, "EEEE");
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_recover_torn_record()
+{
+    KAA_TRACE_IN(logger);
+
+    unlink(TEST_STORAGE_FILE);
+    void *storage = open_storage(TEST_STORAGE_SIZE);
+    add_log_record(storage, "AAAA");
+    add_log_record(storage, "BBBB");
+    ext_log_storage_destroy(storage);
+
+    /* Corrupts the data of the second record */
+    FILE *file = fopen(TEST_STORAGE_FILE, "r+b");
+    ASSERT_NOT_NULL(file);
+    fseek(file, TEST_RECORDS_OFFSET + TEST_RECORD_FOOTPRINT + 20, SEEK_SET);
+    fputc('X', file);
+    fclose(file);
+
+    storage = open_storage(TEST_STORAGE_SIZE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 1);
+    check_next_log_record(storage, 1, "AAAA");
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_recover_wrapped_records()
+{
+    KAA_TRACE_IN(logger);
+
+    unlink(TEST_STORAGE_FILE);
+    void *storage = open_storage(TEST_STORAGE_SIZE);
+    add_log_record(storage, "AAAA");
+    add_log_record(storage, "BBBB");
+    add_log_record(storage, "CCCC");
+    check_next_log_record(storage, 1, "AAAA");
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 1), KAA_ERR_NONE);
+
+    /* Placed at the beginning of the file */
+    add_log_record(storage, "DDDD");
+    ext_log_storage_destroy(storage);
+
+    storage = open_storage(TEST_STORAGE_SIZE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 3);
+
+    /* The eldest record is evicted */
+    add_log_record(storage, "EEEE");
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 3);
+    ext_log_storage_destroy(storage);
+
+    storage = open_storage(TEST_STORAGE_SIZE);
+    ASSERT_EQUAL(ext_log_storage_get_records_count(storage), 3);
+    check_next_log_record(storage, 1, "CCCC");
+    check_next_log_record(storage, 1, "DDDD");
+    check_next_log_record(storage, 1, "EEEE");
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_read_wrapped_record()
+{
+    KAA_TRACE_IN(logger);
+
+    unlink(TEST_STORAGE_FILE);
+    void *storage = open_storage(TEST_STORAGE_SIZE);
+    add_log_record(storage, "AAAA");
+    add_log_record(storage, "BBBB");
+    add_log_record(storage, "CCCC");
+    check_next_log_record(storage, 1, "AAAA");
+    ASSERT_EQUAL(ext_log_storage_remove_by_bucket_id(storage, 1), KAA_ERR_NONE);
+
+    /* The read cursor runs up to the tail at the end of the file */
+    check_next_log_record(storage, 2, "BBBB");
+    check_next_log_record(storage, 2, "CCCC");
+
+    char buffer[TEST_RECORD_SIZE];
+    size_t record_len = 0;
+    ASSERT_EQUAL(ext_log_storage_write_next_record(storage, buffer, sizeof(buffer), 2, &record_len), KAA_ERR_NOT_FOUND);
+
+    /* Placed at the beginning of the file */
+    add_log_record(storage, "DDDD");
+    check_next_log_record(storage, 3, "DDDD");
+    ASSERT_EQUAL(ext_log_storage_write_next_record(storage, buffer, sizeof(buffer), 3, &record_len), KAA_ERR_NOT_FOUND);
+    ext_log_storage_destroy(storage);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+int test_init()
+{
+    kaa_error_t error = kaa_log_create(&logger, KAA_MAX_LOG_MESSAGE_LENGTH, KAA_MAX_LOG_LEVEL, NULL);
+    if (error || !logger) {
+        return error;
+    }
+
+    unlink(TEST_STORAGE_FILE);
+    return 0;
+}
+
+int test_deinit()
+{
+    unlink(TEST_STORAGE_FILE);
+    kaa_log_destroy(logger);
+    return 0;
+}
+
+
+
+KAA_SUITE_MAIN(FileLogStorage, test_init, test_deinit,
+        KAA_TEST_CASE(create_file_storage, test_create_file_storage)
+        KAA_TEST_CASE(recover_undelivered_records, test_recover_undelivered_records)
+        KAA_TEST_CASE(recover_torn_record, test_recover_torn_record)
+        KAA_TEST_CASE(recover_wrapped_records, test_recover_wrapped_records)
+        KAA_TEST_CASE(read_wrapped_record, test_read_wrapped_record)
+)
@@ -32,6 +32,7 @@
 #include "kaa_platform_utils.h"
 #include "utilities/kaa_log.h"
 #include "utilities/kaa_mem.h"
+#include "utilities/kaa_timer_queue.h"
 #include "platform/ext_transport_channel.h"
 #include "kaa_platform_common.h"
 #include "kaa_platform_utils.h"
@@ -46,6 +47,8 @@ extern void kaa_channel_manager_destroy(kaa_channel_manager_t *self);
 extern kaa_transport_channel_interface_t *kaa_channel_manager_get_transport_channel(kaa_channel_manager_t *self
                                                                                   , kaa_service_t service_type);
 
+extern kaa_error_t kaa_channel_manager_request_sync(kaa_channel_manager_t *self, kaa_service_t service_type);
+
 extern kaa_error_t kaa_channel_manager_bootstrap_request_get_size(kaa_channel_manager_t *self
                                                                 , size_t *expected_size);
 
@@ -59,6 +62,8 @@ typedef struct {
     kaa_access_point_t *access_point;
     kaa_service_t* services;
     size_t         services_count;
+    size_t         sync_count;
+    size_t         synced_services_count;
 } test_channel_context_t;
 
 
@@ -119,6 +124,11 @@ static kaa_error_t test_sync_handler(void *context
                                    , size_t service_count)
 {
     KAA_RETURN_IF_NIL3(context, services, service_count, KAA_ERR_BADPARAM);
+
+    test_channel_context_t *channel_context = (test_channel_context_t *)context;
+    ++channel_context->sync_count;
+    channel_context->synced_services_count += service_count;
+
     return KAA_ERR_NONE;
 }
 
@@ -286,6 +296,53 @@ void test_get_service_specific_channel()
     kaa_channel_manager_destroy(channel_manager);
 }
 
+void test_channel_without_services()
+{
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code;
+    kaa_channel_manager_t *channel_manager = NULL;
+
+    error_code = kaa_channel_manager_create(&channel_manager, &kaa_context);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    uint16_t protocol_version = 2;
+    kaa_service_t event_channel_service[] = { KAA_SERVICE_EVENT };
+    test_channel_context_t event_channel_context = { { 0xAABBCCAA, protocol_version }
+                                                   , NULL
+                                                   , event_channel_service
+                                                   , 1 };
+
+    kaa_transport_channel_interface_t event_channel;
+    test_create_channel_interface(&event_channel, &event_channel_context);
+
+    error_code = kaa_channel_manager_add_transport_channel(channel_manager, &event_channel, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /* Added last, so it is the first one the channel manager looks through */
+    test_channel_context_t empty_channel_context = { { 0xAABBCCBB, protocol_version }
+                                                   , NULL
+                                                   , NULL
+                                                   , 0 };
+
+    kaa_transport_channel_interface_t empty_channel;
+    test_create_channel_interface(&empty_channel, &empty_channel_context);
+
+    error_code = kaa_channel_manager_add_transport_channel(channel_manager, &empty_channel, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_transport_channel_interface_t *actual_channel =
+            kaa_channel_manager_get_transport_channel(channel_manager, KAA_SERVICE_EVENT);
+    ASSERT_NOT_EQUAL(actual_channel, NULL);
+
+    compare_channels(actual_channel, &event_channel);
+
+    actual_channel = kaa_channel_manager_get_transport_channel(channel_manager, KAA_SERVICE_LOGGING);
+    ASSERT_EQUAL(actual_channel, NULL);
+
+    kaa_channel_manager_destroy(channel_manager);
+}
+
 void test_get_bootstrap_client_sync_size()
 {
     KAA_TRACE_IN(logger);
@@ -472,6 +529,79 @@ void test_get_bootstrap_client_sync_serialize()
 
 
 
+void test_sync_coalescing()
+{
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code = kaa_timer_queue_create(&kaa_context.timer_queue);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_channel_manager_t *channel_manager = NULL;
+    error_code = kaa_channel_manager_create(&channel_manager, &kaa_context);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_channel_context_t channel_context = { { 0xAABBCCAA, 1 }
+                                             , NULL
+                                             , SUPPORTED_SERVICES
+                                             , supported_services_count };
+
+    kaa_transport_channel_interface_t channel;
+    test_create_channel_interface(&channel, &channel_context);
+
+    error_code = kaa_channel_manager_add_transport_channel(channel_manager, &channel, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_channel_manager_set_sync_latency(channel_manager, KAA_SERVICE_EVENT, 100);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_channel_manager_set_sync_latency(channel_manager, KAA_SERVICE_LOGGING, 1000);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_channel_manager_set_sync_latency(channel_manager, KAA_SERVICE_BOOTSTRAP, 1000);
+    ASSERT_EQUAL(error_code, KAA_ERR_BADPARAM);
+
+    /* A burst of requests is postponed up to the shortest budget */
+    kaa_time_ms_t now = KAA_TIME_MS();
+    size_t i;
+    for (i = 0; i < 10; ++i) {
+        error_code = kaa_channel_manager_request_sync(channel_manager, KAA_SERVICE_EVENT);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    }
+    error_code = kaa_channel_manager_request_sync(channel_manager, KAA_SERVICE_LOGGING);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(channel_context.sync_count, 0);
+
+    kaa_time_ms_t deadline = 0;
+    error_code = kaa_timer_queue_get_next_deadline(kaa_context.timer_queue, &deadline);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_TRUE(deadline >= now + 100 && deadline < now + 1000);
+
+    /* ... and then sent as a single sync of both services */
+    kaa_timer_queue_process(kaa_context.timer_queue, deadline);
+    ASSERT_EQUAL(channel_context.sync_count, 1);
+    ASSERT_EQUAL(channel_context.synced_services_count, 2);
+
+    error_code = kaa_timer_queue_get_next_deadline(kaa_context.timer_queue, &deadline);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+
+    /* Flushing sends the postponed requests right away */
+    error_code = kaa_channel_manager_request_sync(channel_manager, KAA_SERVICE_LOGGING);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_channel_manager_flush_syncs(channel_manager);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(channel_context.sync_count, 2);
+    ASSERT_EQUAL(channel_context.synced_services_count, 3);
+
+    error_code = kaa_timer_queue_get_next_deadline(kaa_context.timer_queue, &deadline);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+
+    kaa_channel_manager_destroy(channel_manager);
+    kaa_timer_queue_destroy(kaa_context.timer_queue);
+    kaa_context.timer_queue = NULL;
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
 int test_init(void)
 {
     srand(time(NULL));
@@ -500,6 +630,8 @@ KAA_SUITE_MAIN(Log, test_init, test_deinit
        KAA_TEST_CASE(create_channel_manager, test_create_channel_manager)
        KAA_TEST_CASE(add_channel, test_add_channel)
        KAA_TEST_CASE(get_service_specific_channel, test_get_service_specific_channel)
+       KAA_TEST_CASE(channel_without_services, test_channel_without_services)
        KAA_TEST_CASE(get_bootstrap_client_sync_size, test_get_bootstrap_client_sync_size)
        KAA_TEST_CASE(get_bootstrap_client_sync_serialize, test_get_bootstrap_client_sync_serialize)
+       KAA_TEST_CASE(sync_coalescing, test_sync_coalescing)
        )
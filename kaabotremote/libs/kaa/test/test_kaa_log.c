@@ -35,6 +35,7 @@
 #include "kaa_status.h"
 #include "utilities/kaa_mem.h"
 #include "utilities/kaa_log.h"
+#include "utilities/kaa_timer_queue.h"
 #include "platform/sock.h"
 #include "platform/ext_log_storage.h"
 #include "platform/ext_log_upload_strategy.h"
@@ -50,15 +51,17 @@ extern void        kaa_channel_manager_destroy(kaa_channel_manager_t *self);
 extern kaa_error_t kaa_log_collector_create(kaa_log_collector_t ** log_collector_p
                                           , kaa_status_t *status
                                           , kaa_channel_manager_t *channel_manager
+                                          , kaa_timer_queue_t *timer_queue
                                           , kaa_logger_t *logger);
 extern void        kaa_log_collector_destroy(kaa_log_collector_t *self);
 
-extern kaa_error_t kaa_logging_request_serialize(kaa_log_collector_t *self, kaa_platform_message_writer_t *writer);
+extern kaa_error_t kaa_logging_request_serialize(kaa_log_collector_t *self, uint32_t request_id, kaa_platform_message_writer_t *writer);
 extern kaa_error_t kaa_logging_handle_server_sync(kaa_log_collector_t *self
                                                 , kaa_platform_message_reader_t *reader
                                                 , uint32_t extension_options
                                                 , size_t extension_length);
 extern kaa_error_t kaa_logging_request_get_size(kaa_log_collector_t *self, size_t *expected_size);
+extern kaa_error_t kaa_logging_on_sync_lost(kaa_log_collector_t *self, uint32_t request_id);
 
 extern kaa_error_t ext_unlimited_log_storage_create(void **log_storage_context_p, kaa_logger_t *logger);
 
@@ -73,11 +76,57 @@ static kaa_channel_manager_t *channel_manager = NULL;
 
 
 
+/*
+ * Log record with a single string field. The SDK is generated from an empty
+ * log schema, so the tests bring their own record type.
+ */
+typedef struct {
+    serialize_fn     serialize;
+    get_size_fn      get_size;
+    destroy_fn       destroy;
+    kaa_string_t    *data;
+} kaa_test_log_record_t;
+
+static void kaa_test_log_record_serialize(avro_writer_t writer, void *data)
+{
+    kaa_string_serialize(writer, ((kaa_test_log_record_t *)data)->data);
+}
+
+static size_t kaa_test_log_record_get_size(void *data)
+{
+    return kaa_string_get_size(((kaa_test_log_record_t *)data)->data);
+}
+
+static void kaa_test_log_record_destroy(void *data)
+{
+    kaa_test_log_record_t *record = (kaa_test_log_record_t *)data;
+    if (record) {
+        kaa_string_destroy(record->data);
+        KAA_FREE(record);
+    }
+}
+
+static kaa_test_log_record_t *kaa_test_log_record_create(void)
+{
+    kaa_test_log_record_t *record = (kaa_test_log_record_t *) KAA_CALLOC(1, sizeof(kaa_test_log_record_t));
+    if (record) {
+        record->serialize = &kaa_test_log_record_serialize;
+        record->get_size = &kaa_test_log_record_get_size;
+        record->destroy = &kaa_test_log_record_destroy;
+    }
+    return record;
+}
+
+
+
 typedef struct {
     size_t timeout;
     size_t batch_size;
     bool on_timeout_count;
     bool on_failure_count;
+    size_t decide_count;
+    ext_log_upload_decision_t decision;
+    size_t max_parallel_uploads;
 } mock_strategy_context_t;
 
 typedef struct {
@@ -95,7 +144,8 @@ typedef struct {
  */
 ext_log_upload_decision_t ext_log_upload_strategy_decide(void *context, const void *log_storage_context)
 {
-    return NOOP;
+    ((mock_strategy_context_t *)context)->decide_count++;
+    return ((mock_strategy_context_t *)context)->decision;
 }
 
 size_t ext_log_upload_strategy_get_bucket_size(void *context)
@@ -103,17 +153,33 @@ size_t ext_log_upload_strategy_get_bucket_size(void *context)
     return ((mock_strategy_context_t *)context)->batch_size;
 }
 
+size_t ext_log_upload_strategy_get_max_parallel_uploads(void *context)
+{
+    size_t max_parallel_uploads = ((mock_strategy_context_t *)context)->max_parallel_uploads;
+    return max_parallel_uploads ? max_parallel_uploads : 1;
+}
+
 size_t ext_log_upload_strategy_get_timeout(void *context)
 {
     return ((mock_strategy_context_t *)context)->timeout;
 }
 
+kaa_time_ms_t ext_log_upload_strategy_get_retry_deadline(void *context)
+{
+    return 0;
+}
+
 kaa_error_t ext_log_upload_strategy_on_timeout(void *context)
 {
     ((mock_strategy_context_t *)context)->on_timeout_count++;
     return KAA_ERR_NONE;
 }
 
+kaa_error_t ext_log_upload_strategy_on_success(void *context, kaa_time_ms_t delivery_time)
+{
+    return KAA_ERR_NONE;
+}
+
 kaa_error_t ext_log_upload_strategy_on_failure(void *context, logging_delivery_error_code_t error_code)
 {
     ((mock_strategy_context_t *)context)->on_failure_count++;
@@ -228,12 +294,12 @@ void test_create_request()
 
     kaa_error_t error_code;
 
-    kaa_user_log_record_t *test_log_record = kaa_test_log_record_create();
+    kaa_test_log_record_t *test_log_record = kaa_test_log_record_create();
     test_log_record->data = kaa_string_copy_create(TEST_LOG_BUFFER);
     size_t test_log_record_size = test_log_record->get_size(test_log_record);
 
     kaa_log_collector_t *log_collector = NULL;
-    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, logger);
+    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, NULL, logger);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     mock_strategy_context_t strategy;
@@ -246,7 +312,7 @@ void test_create_request()
     error_code = kaa_logging_init(log_collector, &storage, &strategy);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
-    error_code = kaa_logging_add_record(log_collector, test_log_record);
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     size_t expected_size = 0;
@@ -259,7 +325,7 @@ void test_create_request()
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
     ASSERT_NOT_NULL(writer);
 
-    error_code = kaa_logging_request_serialize(log_collector, writer);
+    error_code = kaa_logging_request_serialize(log_collector, 1, writer);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
     kaa_platform_message_writer_destroy(writer);
 
@@ -296,6 +362,120 @@ void test_create_request()
 
 
 
+void test_sync_lost()
+{
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code;
+
+    kaa_log_collector_t *log_collector = NULL;
+    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, NULL, logger);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_test_log_record_t *test_log_record = kaa_test_log_record_create();
+    test_log_record->data = kaa_string_copy_create(TEST_LOG_BUFFER);
+    size_t test_log_record_size = test_log_record->get_size(test_log_record);
+
+    mock_strategy_context_t strategy;
+    memset(&strategy, 0, sizeof(mock_strategy_context_t));
+    strategy.timeout = 60;
+    strategy.batch_size = 2 * test_log_record_size;
+
+    mock_storage_context_t storage;
+    memset(&storage, 0, sizeof(mock_storage_context_t));
+
+    error_code = kaa_logging_init(log_collector, &storage, &strategy);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    size_t request_buffer_size = 256;
+    char request_buffer[request_buffer_size];
+    kaa_platform_message_writer_t *writer = NULL;
+    error_code = kaa_platform_message_writer_create(&writer, request_buffer, request_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_logging_request_serialize(log_collector, 1, writer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /* Only the buckets of the lost request are returned to the storage */
+    error_code = kaa_logging_on_sync_lost(log_collector, 2);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+    ASSERT_FALSE(storage.on_unmark_by_id_count);
+
+    error_code = kaa_logging_on_sync_lost(log_collector, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_TRUE(storage.on_unmark_by_id_count);
+    ASSERT_FALSE(strategy.on_timeout_count);
+
+    error_code = kaa_logging_on_sync_lost(log_collector, 1);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+
+    test_log_record->destroy(test_log_record);
+    kaa_platform_message_writer_destroy(writer);
+    kaa_log_collector_destroy(log_collector);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
+void test_add_records()
+{
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code;
+
+    kaa_test_log_record_t *test_log_record = kaa_test_log_record_create();
+    test_log_record->data = kaa_string_copy_create(TEST_LOG_BUFFER);
+    size_t test_log_record_size = test_log_record->get_size(test_log_record);
+
+    kaa_log_collector_t *log_collector = NULL;
+    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, NULL, logger);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    mock_strategy_context_t strategy;
+    memset(&strategy, 0, sizeof(mock_strategy_context_t));
+    strategy.batch_size = 2 * test_log_record_size;
+
+    mock_storage_context_t storage;
+    memset(&storage, 0, sizeof(mock_storage_context_t));
+
+    kaa_user_log_record_t *entries[] = { (kaa_user_log_record_t *)test_log_record
+                                       , (kaa_user_log_record_t *)test_log_record
+                                       , (kaa_user_log_record_t *)test_log_record };
+
+    error_code = kaa_logging_add_records(log_collector, entries, 3);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_INITIALIZED);
+
+    error_code = kaa_logging_init(log_collector, &storage, &strategy);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_logging_add_records(log_collector, entries, 0);
+    ASSERT_NOT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_logging_add_records(log_collector, entries, 3);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(storage.record_count, 3);
+    ASSERT_EQUAL(storage.total_size, 3 * test_log_record_size);
+    ASSERT_EQUAL(strategy.decide_count, 1);
+
+    /* The records before the invalid one are kept */
+    entries[1] = NULL;
+    error_code = kaa_logging_add_records(log_collector, entries, 3);
+    ASSERT_EQUAL(error_code, KAA_ERR_BADPARAM);
+    ASSERT_EQUAL(storage.record_count, 4);
+    ASSERT_EQUAL(strategy.decide_count, 2);
+
+    kaa_log_collector_destroy(log_collector);
+    test_log_record->destroy(test_log_record);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+
 void test_response()
 {
     KAA_TRACE_IN(logger);
@@ -305,7 +485,7 @@ void test_response()
     kaa_error_t error_code;
 
     kaa_log_collector_t *log_collector = NULL;
-    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, logger);
+    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, NULL, logger);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     mock_strategy_context_t strategy;
@@ -370,10 +550,10 @@ void test_timeout()
     size_t TEST_TIMEOUT = 2;
 
     kaa_log_collector_t *log_collector = NULL;
-    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, logger);
+    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, NULL, logger);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
-    kaa_user_log_record_t *test_log_record = kaa_test_log_record_create();
+    kaa_test_log_record_t *test_log_record = kaa_test_log_record_create();
     test_log_record->data = kaa_string_copy_create(TEST_LOG_BUFFER);
     size_t test_log_record_size = test_log_record->get_size(test_log_record);
 
@@ -388,7 +568,7 @@ void test_timeout()
     error_code = kaa_logging_init(log_collector, &storage, &strategy);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
-    error_code = kaa_logging_add_record(log_collector, test_log_record);
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     size_t request_buffer_size = 256;
@@ -397,12 +577,12 @@ void test_timeout()
     error_code = kaa_platform_message_writer_create(&writer, request_buffer, request_buffer_size);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
-    error_code = kaa_logging_request_serialize(log_collector, writer);
+    error_code = kaa_logging_request_serialize(log_collector, 1, writer);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     sleep(TEST_TIMEOUT + 1);
 
-    error_code = kaa_logging_add_record(log_collector, test_log_record);
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     ASSERT_NOT_NULL(strategy.on_timeout_count);
@@ -423,10 +603,10 @@ void test_decline_timeout()
     size_t TEST_TIMEOUT = 2;
 
     kaa_log_collector_t *log_collector = NULL;
-    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, logger);
+    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, NULL, logger);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
-    kaa_user_log_record_t *test_log_record = kaa_test_log_record_create();
+    kaa_test_log_record_t *test_log_record = kaa_test_log_record_create();
     test_log_record->data = kaa_string_copy_create(TEST_LOG_BUFFER);
     size_t test_log_record_size = test_log_record->get_size(test_log_record);
 
@@ -441,7 +621,7 @@ void test_decline_timeout()
     error_code = kaa_logging_init(log_collector, &storage, &strategy);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
-    error_code = kaa_logging_add_record(log_collector, test_log_record);
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     size_t request_buffer_size = 256;
@@ -450,7 +630,7 @@ void test_decline_timeout()
     error_code = kaa_platform_message_writer_create(&writer, request_buffer, request_buffer_size);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
-    error_code = kaa_logging_request_serialize(log_collector, writer);
+    error_code = kaa_logging_request_serialize(log_collector, 1, writer);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     sleep(TEST_TIMEOUT + 1);
@@ -483,7 +663,7 @@ void test_decline_timeout()
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
     ASSERT_NOT_NULL(storage.on_remove_by_id_count);
 
-    error_code = kaa_logging_add_record(log_collector, test_log_record);
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
     ASSERT_EQUAL(error_code, KAA_ERR_NONE);
 
     ASSERT_NULL(strategy.on_timeout_count);
@@ -496,6 +676,262 @@ void test_decline_timeout()
     KAA_TRACE_OUT(logger);
 }
 
+
+void test_partial_timeout()
+{
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code;
+
+    kaa_log_collector_t *log_collector = NULL;
+    error_code = kaa_log_collector_create(&log_collector, status, channel_manager, NULL, logger);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_test_log_record_t *test_log_record = kaa_test_log_record_create();
+    test_log_record->data = kaa_string_copy_create(TEST_LOG_BUFFER);
+    size_t test_log_record_size = test_log_record->get_size(test_log_record);
+
+    mock_strategy_context_t strategy;
+    memset(&strategy, 0, sizeof(mock_strategy_context_t));
+    strategy.timeout = 60;
+    strategy.batch_size = 2 * test_log_record_size;
+    strategy.max_parallel_uploads = 2;
+
+    mock_storage_context_t storage;
+    memset(&storage, 0, sizeof(mock_storage_context_t));
+
+    error_code = kaa_logging_init(log_collector, &storage, &strategy);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    size_t request_buffer_size = 256;
+    char first_request_buffer[request_buffer_size];
+    char second_request_buffer[request_buffer_size];
+    kaa_platform_message_writer_t *first_writer = NULL;
+    kaa_platform_message_writer_t *second_writer = NULL;
+    error_code = kaa_platform_message_writer_create(&first_writer, first_request_buffer, request_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_platform_message_writer_create(&second_writer, second_request_buffer, request_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_logging_request_serialize(log_collector, 1, first_writer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    /* The second bucket times out right away, the first one is still within its timeout */
+    strategy.timeout = 0;
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_logging_request_serialize(log_collector, 2, second_writer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    size_t in_flight_count = 0;
+    error_code = kaa_logging_get_upload_stats(log_collector, &in_flight_count, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(in_flight_count, 2);
+
+    strategy.timeout = 60;
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    ASSERT_TRUE(strategy.on_timeout_count);
+    ASSERT_TRUE(storage.on_unmark_by_id_count);
+    error_code = kaa_logging_get_upload_stats(log_collector, &in_flight_count, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(in_flight_count, 1);
+
+    /* The late delivery status of the first bucket is still matched */
+    uint16_t bucket_id = *((uint16_t *)(first_request_buffer + KAA_EXTENSION_HEADER_SIZE));
+
+    uint32_t response_count = 1;
+    size_t response_buffer_size = sizeof(uint32_t) + sizeof(uint32_t) * response_count;
+    char response_buffer[response_buffer_size];
+
+    char *response = response_buffer;
+    *((uint32_t *)response) = KAA_HTONL(response_count);
+    response += sizeof(uint32_t);
+    *((uint16_t *)response) = bucket_id;
+    response += sizeof(uint16_t);
+    *((uint8_t *)response) = 0x0; // SUCCESS
+    response += sizeof(uint8_t);
+    *((uint8_t *)response) = 0;
+
+    kaa_platform_message_reader_t *reader = NULL;
+    error_code = kaa_platform_message_reader_create(&reader, response_buffer, response_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_logging_handle_server_sync(log_collector, reader, 0, response_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_TRUE(storage.on_remove_by_id_count);
+
+    error_code = kaa_logging_get_upload_stats(log_collector, &in_flight_count, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(in_flight_count, 0);
+
+    test_log_record->destroy(test_log_record);
+    kaa_platform_message_writer_destroy(first_writer);
+    kaa_platform_message_writer_destroy(second_writer);
+    kaa_platform_message_reader_destroy(reader);
+    kaa_log_collector_destroy(log_collector);
+
+    KAA_TRACE_OUT(logger);
+}
+
+
+typedef struct {
+    size_t sync_count;
+    size_t logging_sync_count;
+} test_channel_context_t;
+
+static kaa_service_t TEST_CHANNEL_SERVICES[] = { KAA_SERVICE_LOGGING };
+
+static kaa_error_t test_channel_init(void *context, kaa_transport_context_t *transport_context)
+{
+    return KAA_ERR_NONE;
+}
+
+static kaa_error_t test_channel_set_access_point(void *context, kaa_access_point_t *access_point)
+{
+    return KAA_ERR_NONE;
+}
+
+static kaa_error_t test_channel_get_protocol_id(void *context, kaa_transport_protocol_id_t *protocol_id)
+{
+    KAA_RETURN_IF_NIL(protocol_id, KAA_ERR_BADPARAM);
+    protocol_id->id = 0;
+    protocol_id->version = 0;
+    return KAA_ERR_NONE;
+}
+
+static kaa_error_t test_channel_get_supported_services(void *context
+                                                     , kaa_service_t **supported_services
+                                                     , size_t *service_count)
+{
+    KAA_RETURN_IF_NIL2(supported_services, service_count, KAA_ERR_BADPARAM);
+    *supported_services = TEST_CHANNEL_SERVICES;
+    *service_count = sizeof(TEST_CHANNEL_SERVICES) / sizeof(kaa_service_t);
+    return KAA_ERR_NONE;
+}
+
+static kaa_error_t test_channel_sync_handler(void *context
+                                           , const kaa_service_t services[]
+                                           , size_t service_count)
+{
+    test_channel_context_t *channel_context = (test_channel_context_t *)context;
+    ++channel_context->sync_count;
+
+    size_t i;
+    for (i = 0; i < service_count; ++i) {
+        if (services[i] == KAA_SERVICE_LOGGING)
+            ++channel_context->logging_sync_count;
+    }
+    return KAA_ERR_NONE;
+}
+
+/*
+ * With a zero logging sync latency a requested sync is flushed to the channel
+ * right away. Serializing a bucket must not do that: the channel is busy
+ * writing the very request the bucket goes to.
+ */
+void test_follow_up_upload_deferred()
+{
+    KAA_TRACE_IN(logger);
+
+    kaa_error_t error_code;
+
+    kaa_timer_queue_t *timer_queue = NULL;
+    error_code = kaa_timer_queue_create(&timer_queue);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_context_t context;
+    memset(&context, 0, sizeof(kaa_context_t));
+    context.logger = logger;
+    context.timer_queue = timer_queue;
+
+    kaa_channel_manager_t *manager = NULL;
+    error_code = kaa_channel_manager_create(&manager, &context);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_channel_manager_set_sync_latency(manager, KAA_SERVICE_LOGGING, 0);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_channel_context_t channel_context;
+    memset(&channel_context, 0, sizeof(test_channel_context_t));
+
+    kaa_transport_channel_interface_t channel;
+    memset(&channel, 0, sizeof(kaa_transport_channel_interface_t));
+    channel.context = &channel_context;
+    channel.init = &test_channel_init;
+    channel.set_access_point = &test_channel_set_access_point;
+    channel.get_protocol_id = &test_channel_get_protocol_id;
+    channel.get_supported_services = &test_channel_get_supported_services;
+    channel.sync_handler = &test_channel_sync_handler;
+
+    error_code = kaa_channel_manager_add_transport_channel(manager, &channel, NULL);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_log_collector_t *log_collector = NULL;
+    error_code = kaa_log_collector_create(&log_collector, status, manager, timer_queue, logger);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_test_log_record_t *test_log_record = kaa_test_log_record_create();
+    test_log_record->data = kaa_string_copy_create(TEST_LOG_BUFFER);
+    size_t test_log_record_size = test_log_record->get_size(test_log_record);
+
+    mock_strategy_context_t strategy;
+    memset(&strategy, 0, sizeof(mock_strategy_context_t));
+    strategy.timeout = 60;
+    strategy.batch_size = 2 * test_log_record_size;
+    strategy.decision = UPLOAD;
+    strategy.max_parallel_uploads = 2;
+
+    mock_storage_context_t storage;
+    memset(&storage, 0, sizeof(mock_storage_context_t));
+
+    error_code = kaa_logging_init(log_collector, &storage, &strategy);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_logging_add_record(log_collector, (kaa_user_log_record_t *)test_log_record);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(channel_context.logging_sync_count, 2);
+
+    size_t request_buffer_size = 256;
+    char request_buffer[request_buffer_size];
+    kaa_platform_message_writer_t *writer = NULL;
+    error_code = kaa_platform_message_writer_create(&writer, request_buffer, request_buffer_size);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    channel_context.sync_count = 0;
+    channel_context.logging_sync_count = 0;
+
+    error_code = kaa_logging_request_serialize(log_collector, 1, writer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(channel_context.sync_count, 0);
+
+    error_code = kaa_timer_queue_process(timer_queue, KAA_TIME_MS());
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(channel_context.logging_sync_count, 1);
+
+    /* The second bucket fills the upload window: no further upload is requested. */
+    writer->current = writer->begin;
+    error_code = kaa_logging_request_serialize(log_collector, 2, writer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    error_code = kaa_timer_queue_process(timer_queue, KAA_TIME_MS());
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(channel_context.logging_sync_count, 1);
+
+    test_log_record->destroy(test_log_record);
+    kaa_platform_message_writer_destroy(writer);
+    kaa_log_collector_destroy(log_collector);
+    kaa_channel_manager_destroy(manager);
+    kaa_timer_queue_destroy(timer_queue);
+
+    KAA_TRACE_OUT(logger);
+}
+
 #endif
 
 
@@ -542,5 +978,9 @@ KAA_SUITE_MAIN(Log, test_init, test_deinit
        KAA_TEST_CASE(process_response, test_response)
        KAA_TEST_CASE(process_timeout, test_timeout)
        KAA_TEST_CASE(decline_timeout, test_decline_timeout)
+       KAA_TEST_CASE(partial_timeout, test_partial_timeout)
+       KAA_TEST_CASE(sync_lost, test_sync_lost)
+       KAA_TEST_CASE(add_records, test_add_records)
+       KAA_TEST_CASE(follow_up_upload_deferred, test_follow_up_upload_deferred)
 #endif
         )
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kaa_test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include "utilities/kaa_mpsc_queue.h"
+
+#define TEST_PRODUCERS_COUNT    4
+#define TEST_ITEMS_COUNT        10000
+
+typedef struct {
+    kaa_mpsc_node_t    node;
+    size_t             producer;
+    size_t             value;
+} test_item_t;
+
+typedef struct {
+    kaa_mpsc_queue_t    *queue;
+    size_t              producer;
+    test_item_t         items[TEST_ITEMS_COUNT];
+} test_producer_t;
+
+void test_kaa_mpsc_queue_order()
+{
+    kaa_mpsc_queue_t queue;
+    kaa_mpsc_queue_init(&queue);
+    ASSERT_NULL(kaa_mpsc_queue_pop(&queue));
+
+    test_item_t items[3];
+    size_t i;
+    for (i = 0; i < 3; ++i)
+        kaa_mpsc_queue_push(&queue, &items[i].node);
+
+    ASSERT_EQUAL(kaa_mpsc_queue_pop(&queue), &items[0].node);
+    ASSERT_EQUAL(kaa_mpsc_queue_pop(&queue), &items[1].node);
+
+    /* The last node is detached through the stub and the queue is reusable */
+    ASSERT_EQUAL(kaa_mpsc_queue_pop(&queue), &items[2].node);
+    ASSERT_NULL(kaa_mpsc_queue_pop(&queue));
+
+    kaa_mpsc_queue_push(&queue, &items[0].node);
+    ASSERT_EQUAL(kaa_mpsc_queue_pop(&queue), &items[0].node);
+    ASSERT_NULL(kaa_mpsc_queue_pop(&queue));
+}
+
+static void *test_producer(void *context)
+{
+    test_producer_t *producer = (test_producer_t *) context;
+    size_t i;
+    for (i = 0; i < TEST_ITEMS_COUNT; ++i) {
+        producer->items[i].producer = producer->producer;
+        producer->items[i].value = i;
+        kaa_mpsc_queue_push(producer->queue, &producer->items[i].node);
+        if (!(i % 64))
+            sched_yield();
+    }
+    return NULL;
+}
+
+void test_kaa_mpsc_queue_threads()
+{
+    kaa_mpsc_queue_t queue;
+    kaa_mpsc_queue_init(&queue);
+
+    static test_producer_t producers[TEST_PRODUCERS_COUNT];
+    pthread_t threads[TEST_PRODUCERS_COUNT];
+    size_t i;
+    for (i = 0; i < TEST_PRODUCERS_COUNT; ++i) {
+        producers[i].queue = &queue;
+        producers[i].producer = i;
+        ASSERT_EQUAL(pthread_create(&threads[i], NULL, &test_producer, &producers[i]), 0);
+    }
+
+    /* Every item arrives exactly once, in order within its producer */
+    size_t expected[TEST_PRODUCERS_COUNT] = { 0 };
+    size_t received = 0;
+    bool is_ordered = true;
+    while (received < TEST_PRODUCERS_COUNT * TEST_ITEMS_COUNT) {
+        test_item_t *item = (test_item_t *) kaa_mpsc_queue_pop(&queue);
+        if (item) {
+            is_ordered = is_ordered && item->value == expected[item->producer];
+            ++expected[item->producer];
+            ++received;
+        } else {
+            sched_yield();
+        }
+    }
+
+    for (i = 0; i < TEST_PRODUCERS_COUNT; ++i)
+        ASSERT_EQUAL(pthread_join(threads[i], NULL), 0);
+
+    ASSERT_TRUE(is_ordered);
+    ASSERT_NULL(kaa_mpsc_queue_pop(&queue));
+}
+
+KAA_SUITE_MAIN(MpscQueue, NULL, NULL
+        ,
+        KAA_TEST_CASE(mpsc_queue_order, test_kaa_mpsc_queue_order)
+        KAA_TEST_CASE(mpsc_queue_threads, test_kaa_mpsc_queue_threads)
+)
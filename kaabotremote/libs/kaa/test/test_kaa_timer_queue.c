@@ -0,0 +1,166 @@
+/*
+ * Copyright 2014-2015 CyberVision, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kaa_test.h"
+
+#include "utilities/kaa_timer_queue.h"
+
+#define TEST_TIMER_COUNT 20
+
+typedef struct {
+    kaa_timer_queue_t    *queue;
+    kaa_timer_t          timer;
+    size_t               fired_count;
+    kaa_time_ms_t        reschedule_to;
+} test_timer_context_t;
+
+static void test_timer_callback(void *context)
+{
+    test_timer_context_t *timer_context = (test_timer_context_t *) context;
+    ++timer_context->fired_count;
+    if (timer_context->reschedule_to)
+        kaa_timer_queue_schedule(timer_context->queue, &timer_context->timer, timer_context->reschedule_to);
+}
+
+static void test_timer_context_init(test_timer_context_t *timer_context, kaa_timer_queue_t *queue)
+{
+    timer_context->queue = queue;
+    timer_context->fired_count = 0;
+    timer_context->reschedule_to = 0;
+    kaa_timer_init(&timer_context->timer, &test_timer_callback, timer_context);
+}
+
+void test_kaa_timer_queue_order()
+{
+    kaa_timer_queue_t *queue = NULL;
+    kaa_error_t error_code = kaa_timer_queue_create(&queue);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_time_ms_t deadline = 0;
+    error_code = kaa_timer_queue_get_next_deadline(queue, &deadline);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+
+    /* More timers than the initial heap capacity, scheduled in a scrambled order */
+    test_timer_context_t timers[TEST_TIMER_COUNT];
+    size_t i;
+    for (i = 0; i < TEST_TIMER_COUNT; ++i) {
+        test_timer_context_init(&timers[i], queue);
+        error_code = kaa_timer_queue_schedule(queue, &timers[i].timer, 100 + (i * 7) % TEST_TIMER_COUNT);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+        ASSERT_TRUE(kaa_timer_is_scheduled(&timers[i].timer));
+    }
+
+    kaa_time_ms_t previous = 0;
+    for (i = 0; i < TEST_TIMER_COUNT; ++i) {
+        error_code = kaa_timer_queue_get_next_deadline(queue, &deadline);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+        ASSERT_TRUE(deadline >= previous);
+        previous = deadline;
+
+        error_code = kaa_timer_queue_process(queue, deadline);
+        ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    }
+
+    for (i = 0; i < TEST_TIMER_COUNT; ++i) {
+        ASSERT_EQUAL(timers[i].fired_count, 1);
+        ASSERT_FALSE(kaa_timer_is_scheduled(&timers[i].timer));
+    }
+
+    error_code = kaa_timer_queue_get_next_deadline(queue, &deadline);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+
+    kaa_timer_queue_destroy(queue);
+}
+
+void test_kaa_timer_queue_cancel()
+{
+    kaa_timer_queue_t *queue = NULL;
+    kaa_error_t error_code = kaa_timer_queue_create(&queue);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_timer_context_t first, second, third;
+    test_timer_context_init(&first, queue);
+    test_timer_context_init(&second, queue);
+    test_timer_context_init(&third, queue);
+
+    kaa_timer_queue_schedule(queue, &first.timer, 10);
+    kaa_timer_queue_schedule(queue, &second.timer, 20);
+    kaa_timer_queue_schedule(queue, &third.timer, 30);
+
+    error_code = kaa_timer_queue_cancel(queue, &first.timer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_FALSE(kaa_timer_is_scheduled(&first.timer));
+
+    /* Cancelling an idle timer is harmless */
+    error_code = kaa_timer_queue_cancel(queue, &first.timer);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    kaa_time_ms_t deadline = 0;
+    error_code = kaa_timer_queue_get_next_deadline(queue, &deadline);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(deadline, 20);
+
+    /* Moving a scheduled timer keeps a single entry */
+    error_code = kaa_timer_queue_schedule(queue, &third.timer, 5);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    error_code = kaa_timer_queue_get_next_deadline(queue, &deadline);
+    ASSERT_EQUAL(deadline, 5);
+
+    error_code = kaa_timer_queue_process(queue, 100);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(first.fired_count, 0);
+    ASSERT_EQUAL(second.fired_count, 1);
+    ASSERT_EQUAL(third.fired_count, 1);
+
+    error_code = kaa_timer_queue_get_next_deadline(queue, &deadline);
+    ASSERT_EQUAL(error_code, KAA_ERR_NOT_FOUND);
+
+    kaa_timer_queue_destroy(queue);
+}
+
+void test_kaa_timer_queue_reschedule_from_callback()
+{
+    kaa_timer_queue_t *queue = NULL;
+    kaa_error_t error_code = kaa_timer_queue_create(&queue);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+
+    test_timer_context_t periodic;
+    test_timer_context_init(&periodic, queue);
+    periodic.reschedule_to = 50;
+
+    kaa_timer_queue_schedule(queue, &periodic.timer, 10);
+
+    /* The new deadline has already passed, but the timer fires only once per call */
+    error_code = kaa_timer_queue_process(queue, 100);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(periodic.fired_count, 1);
+    ASSERT_TRUE(kaa_timer_is_scheduled(&periodic.timer));
+
+    kaa_time_ms_t deadline = 0;
+    error_code = kaa_timer_queue_get_next_deadline(queue, &deadline);
+    ASSERT_EQUAL(error_code, KAA_ERR_NONE);
+    ASSERT_EQUAL(deadline, 50);
+
+    kaa_timer_queue_destroy(queue);
+    ASSERT_FALSE(kaa_timer_is_scheduled(&periodic.timer));
+}
+
+KAA_SUITE_MAIN(TimerQueue, NULL, NULL
+        ,
+        KAA_TEST_CASE(timer_queue_order, test_kaa_timer_queue_order)
+        KAA_TEST_CASE(timer_queue_cancel, test_kaa_timer_queue_cancel)
+        KAA_TEST_CASE(timer_queue_reschedule_from_callback, test_kaa_timer_queue_reschedule_from_callback)
+)
@@ -21,14 +21,14 @@
 #include <errno.h>
 #include <execinfo.h>
 #include <stddef.h>
-#include <sys/select.h>
+#include <unistd.h>
 #include <ncurses.h>
-#include <pthread.h>
 
 #include "kaa/kaa.h"
 #include "kaa/kaa_error.h"
 #include "kaa/kaa_context.h"
 #include "kaa/platform/kaa_client.h"
+#include "kaa/platform-impl/posix/posix_kaa_client.h"
 #include "kaa/utilities/kaa_log.h"
 #include "kaa/utilities/kaa_mem.h"
 #include "kaa/kaa_user.h"
@@ -52,25 +52,18 @@
 
 #define THERMO_REQUEST_FQN          "org.kaaproject.kaa.schema.sample.event.thermo.ThermostatInfoRequest"
 #define CHANGE_DEGREE_REQUEST_FQN   "org.kaaproject.kaa.schema.sample.event.thermo.ChangeDegreeRequest"
+#define MOVEMENT_DIRECTION_FQN      "com.krishna.kaabot.movementDirection"
+#define LISTENERS_CACHE_TTL_MS      30000
 
 
+static kaa_client_t *kaa_client_ = NULL;
 static kaa_context_t *kaa_context_ = NULL;
 
-static kaa_service_t BOOTSTRAP_SERVICE[] = { KAA_SERVICE_BOOTSTRAP };
-static const int BOOTSTRAP_SERVICE_COUNT = sizeof(BOOTSTRAP_SERVICE) / sizeof(kaa_service_t);
-
 static kaa_service_t OPERATIONS_SERVICES[] = { KAA_SERVICE_PROFILE
                                              , KAA_SERVICE_USER
                                              , KAA_SERVICE_EVENT};
 static const int OPERATIONS_SERVICES_COUNT = sizeof(OPERATIONS_SERVICES) / sizeof(kaa_service_t);
 
-static kaa_transport_channel_interface_t bootstrap_channel;
-static kaa_transport_channel_interface_t operations_channel;
-
-
-// The following two variables are shared across the two threads, and, technically, should be synchronized.
-// In this dirty implementation they are not - which may cause a crash once in a millenium.
-static bool is_shutdown = false;
 static kaa_movement_class_directiont_t direction = ENUM_DIRECTIONT_BOT_STOP;
 
 
@@ -120,7 +113,7 @@ kaa_error_t kaa_on_attach_success(void *context)
 kaa_error_t kaa_on_attach_failed(void *context, user_verifier_error_code_t error_code, const char *reason)
 {
     printf("Kaa Demo attach failed\n");
-    is_shutdown = true;
+    kaa_client_stop(kaa_client_);
     return KAA_ERR_NONE;
 }
 
@@ -132,32 +125,24 @@ kaa_error_t kaa_sdk_init()
 {
     printf("Initializing Kaa SDK...\n");
 
-    kaa_error_t error_code = kaa_init(&kaa_context_);
+    kaa_client_props_t props = { 0 };
+    props.operations_services = OPERATIONS_SERVICES;
+    props.operations_service_count = OPERATIONS_SERVICES_COUNT;
+    kaa_error_t error_code = kaa_client_create(&kaa_client_, &props);
     if (error_code) {
-        printf("Error during kaa context creation %d\n", error_code);
+        printf("Error during kaa client creation %d\n", error_code);
         return error_code;
     }
+    kaa_context_ = kaa_client_get_context(kaa_client_);
 
-    error_code = kaa_tcp_channel_create(&operations_channel
-                                      , kaa_context_->logger
-                                      , OPERATIONS_SERVICES
-                                      , OPERATIONS_SERVICES_COUNT);
-    KAA_RETURN_IF_ERR(error_code);
-
-    error_code = kaa_tcp_channel_create(&bootstrap_channel
-                                      , kaa_context_->logger
-                                      , BOOTSTRAP_SERVICE
-                                      , BOOTSTRAP_SERVICE_COUNT);
-    KAA_RETURN_IF_ERR(error_code);
-
-    error_code = kaa_channel_manager_add_transport_channel(kaa_context_->channel_manager
-                                                         , &bootstrap_channel
-                                                         , NULL);
+    /* Repeated listener searches within the TTL are answered without a server round trip */
+    error_code = kaa_event_manager_set_listeners_cache_ttl(kaa_context_->event_manager, LISTENERS_CACHE_TTL_MS);
     KAA_RETURN_IF_ERR(error_code);
 
-    error_code = kaa_channel_manager_add_transport_channel(kaa_context_->channel_manager
-                                                         , &operations_channel
-                                                         , NULL);
+    /* Only the latest direction matters, so a stalled link doesn't replay the intermediate ones */
+    error_code = kaa_event_manager_set_coalescing_policy(kaa_context_->event_manager
+                                                       , MOVEMENT_DIRECTION_FQN
+                                                       , KAA_EVENT_COALESCE_REPLACE);
     KAA_RETURN_IF_ERR(error_code);
 
     kaa_attachment_status_listeners_t listeners = { NULL, &kaa_on_attached, &kaa_on_detached, &kaa_on_attach_success, &kaa_on_attach_failed };
@@ -188,8 +173,7 @@ kaa_error_t kaa_demo_init()
 
 void kaa_demo_destroy()
 {
-    kaa_tcp_channel_disconnect(&operations_channel);
-    kaa_deinit(kaa_context_);
+    kaa_client_destroy(kaa_client_);
 }
 
 
@@ -215,117 +199,14 @@ int kaa_demo_process_input()
 }
 
 
-int kaa_demo_event_loop()
-{
-    kaa_error_t error_code = kaa_start(kaa_context_);
-    if (error_code) {
-        printf("Failed to start Kaa workflow\n");
-        return -1;
-    }
-
-    uint16_t select_timeout;
-    error_code = kaa_tcp_channel_get_max_timeout(&operations_channel, &select_timeout);
-    if (error_code) {
-        printf("Failed to get Operations channel keepalive timeout\n");
-        return -1;
-    }
-
-    if (select_timeout > 3) {
-        select_timeout = 3;
-    }
-
-    fd_set read_fds, write_fds, except_fds;
-    int ops_fd = 0, bootstrap_fd = 0;
-    struct timeval select_tv = { 0, 0 };
-    int max_fd = 0;
-
-    while (!is_shutdown) {
-        FD_ZERO(&read_fds);
-        FD_ZERO(&write_fds);
-        FD_ZERO(&except_fds);
-
-        max_fd = 0;
-
-        kaa_tcp_channel_get_descriptor(&operations_channel, &ops_fd);
-        if (max_fd < ops_fd)
-            max_fd = ops_fd;
-        kaa_tcp_channel_get_descriptor(&bootstrap_channel, &bootstrap_fd);
-        if (max_fd < bootstrap_fd)
-            max_fd = bootstrap_fd;
-
-        if (kaa_tcp_channel_is_ready(&operations_channel, FD_READ))
-            FD_SET(ops_fd, &read_fds);
-        if (kaa_tcp_channel_is_ready(&operations_channel, FD_WRITE))
-            FD_SET(ops_fd, &write_fds);
-
-        if (kaa_tcp_channel_is_ready(&bootstrap_channel, FD_READ))
-            FD_SET(bootstrap_fd, &read_fds);
-        if (kaa_tcp_channel_is_ready(&bootstrap_channel, FD_WRITE))
-            FD_SET(bootstrap_fd, &write_fds);
-
-//        select_tv.tv_sec = select_timeout;
-//        select_tv.tv_usec = 0;
-        select_tv.tv_sec = 0;
-        select_tv.tv_usec = 10000;
-
-        int poll_result = select(max_fd + 1, &read_fds, &write_fds, NULL, &select_tv);
-        if (poll_result == 0) {
-            kaa_tcp_channel_check_keepalive(&operations_channel);
-            kaa_tcp_channel_check_keepalive(&bootstrap_channel);
-        } else if (poll_result > 0) {
-            if (bootstrap_fd >= 0) {
-                if (FD_ISSET(bootstrap_fd, &read_fds)) {
-                    KAA_LOG_DEBUG(kaa_context_->logger, KAA_ERR_NONE,"Processing IN event for the Bootstrap client socket %d", bootstrap_fd);
-                    error_code = kaa_tcp_channel_process_event(&bootstrap_channel, FD_READ);
-                    if (error_code)
-                        KAA_LOG_ERROR(kaa_context_->logger, KAA_ERR_NONE,"Failed to process IN event for the Bootstrap client socket %d", bootstrap_fd);
-                }
-                if (FD_ISSET(bootstrap_fd, &write_fds)) {
-                    KAA_LOG_DEBUG(kaa_context_->logger, KAA_ERR_NONE,"Processing OUT event for the Bootstrap client socket %d", bootstrap_fd);
-                    error_code = kaa_tcp_channel_process_event(&bootstrap_channel, FD_WRITE);
-                    if (error_code)
-                        KAA_LOG_ERROR(kaa_context_->logger, error_code,"Failed to process OUT event for the Bootstrap client socket %d", bootstrap_fd);
-                }
-            }
-            if (ops_fd >= 0) {
-                if (FD_ISSET(ops_fd, &read_fds)) {
-                    KAA_LOG_DEBUG(kaa_context_->logger, KAA_ERR_NONE,"Processing IN event for the Operations client socket %d", ops_fd);
-                    error_code = kaa_tcp_channel_process_event(&operations_channel, FD_READ);
-                    if (error_code)
-                        KAA_LOG_ERROR(kaa_context_->logger, error_code,"Failed to process IN event for the Operations client socket %d", ops_fd);
-                }
-                if (FD_ISSET(ops_fd, &write_fds)) {
-                    KAA_LOG_DEBUG(kaa_context_->logger, KAA_ERR_NONE,"Processing OUT event for the Operations client socket %d", ops_fd);
-                    error_code = kaa_tcp_channel_process_event(&operations_channel, FD_WRITE);
-                    if (error_code)
-                        KAA_LOG_ERROR(kaa_context_->logger, error_code,"Failed to process OUT event for the Operations client socket %d", ops_fd);
-                }
-            }
-        } else {
-            KAA_LOG_ERROR(kaa_context_->logger, KAA_ERR_BAD_STATE,"Failed to poll descriptors: %s", strerror(errno));
-            return -1;
-        }
-
-        // Process keyboard input
-        kaa_demo_process_input();
-    }
-    return 0;
-}
-
-
-void* read_keyboard(void *context)
+/*
+ * Called by the Kaa client loop when stdin is readable. getch() doesn't block.
+ */
+void kaa_demo_read_keyboard(void *context, int fd, uint32_t events)
 {
-    KAA_LOG_INFO(kaa_context_->logger, 0, "This is the keyboard thread!");
-
-    int c = 'a';
-    initscr();
-    timeout(-1);
-//    cbreak();
-//    noecho();
-
-    while( c != 'q') {
-        switch(c = getch())
-        {
+    int c;
+    while ((c = getch()) != ERR) {
+        switch (c) {
             case 'w':
                 direction = ENUM_DIRECTIONT_BOT_FORWARD;
             break;
@@ -341,12 +222,35 @@ void* read_keyboard(void *context)
             case ' ':
                 direction = ENUM_DIRECTIONT_BOT_STOP;
             break;
+            case 'q':
+                kaa_client_stop(kaa_client_);
+                return;
         }
     }
+
+    kaa_demo_process_input();
+}
+
+
+int kaa_demo_event_loop()
+{
+    initscr();
+    timeout(0);
+//    cbreak();
+//    noecho();
+
+    kaa_error_t error_code = kaa_client_add_fd(kaa_client_, STDIN_FILENO, KAA_CLIENT_FD_READ
+                                             , kaa_demo_read_keyboard, NULL);
+    if (!error_code)
+        error_code = kaa_client_start(kaa_client_, NULL, NULL, 0);
+
     endwin();
-    is_shutdown = true;
 
-    return NULL;
+    if (error_code) {
+        printf("Kaa client loop failed\n");
+        return -1;
+    }
+    return 0;
 }
 
 
@@ -360,21 +264,9 @@ int main(/*int argc, char *argv[]*/)
         return error_code;
     }
 
-    pthread_t keyboard_thread;
-    if(pthread_create(&keyboard_thread, NULL, read_keyboard, NULL)) {
-        KAA_LOG_ERROR(kaa_context_->logger, KAA_ERR_BAD_STATE, "Failed to create a thread");
-        return KAA_ERR_BAD_STATE;
-    }
-
     int rval = kaa_demo_event_loop();
 
-    if(pthread_join(keyboard_thread, NULL)) {
-        KAA_LOG_ERROR(kaa_context_->logger, KAA_ERR_BAD_STATE, "Failed to join the keyboard thread");
-        return KAA_ERR_BAD_STATE;
-    }
-
     kaa_demo_destroy();
 
     return rval;
 }
-